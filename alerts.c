@@ -0,0 +1,77 @@
+/*
+ * alerts.c - Terminal bell alerts
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "alerts.h"
+#include "monitor.h"
+#include "lightning.h"
+#include "shake.h"
+
+#define MAX_ALERTED_IDS 50
+
+// --- Globals ---
+static char g_alerted_ids[MAX_ALERTED_IDS][64];
+static int g_alerted_ids_count = 0;
+static uint64_t g_storm_transitions_seen = 0; // Site level changes already alerted on
+static uint64_t g_shake_alerted = 0;          // Local triggers already alerted on
+
+// --- Bell ---
+
+static void ring_bell() {
+    if (!g_once) { printf("\a"); fflush(stdout); } // Not into an NDJSON stream
+}
+
+// Rings the bell and remembers the id so the event alerts only once.
+static int raise_alert(const char *id) {
+    for (int j = 0; j < g_alerted_ids_count; j++) {
+        if (strcmp(id, g_alerted_ids[j]) == 0) return 0;
+    }
+    ring_bell();
+    if (g_alerted_ids_count < MAX_ALERTED_IDS) {
+        snprintf(g_alerted_ids[g_alerted_ids_count++], sizeof(g_alerted_ids[0]), "%s", id);
+    } else {
+        for(int k=0; k < MAX_ALERTED_IDS - 1; k++) strcpy(g_alerted_ids[k], g_alerted_ids[k+1]);
+        snprintf(g_alerted_ids[MAX_ALERTED_IDS - 1], sizeof(g_alerted_ids[0]), "%s", id);
+    }
+    return 1;
+}
+
+// --- Checks ---
+
+int quake_alerts(const Earthquake *quake, float alert_threshold) {
+    int exposure_alert = g_exposure_alert_threshold > 0 && quake->exposure_strong >= g_exposure_alert_threshold;
+    return quake->mag >= alert_threshold || quake->exceeds_site_threshold || exposure_alert;
+}
+
+void check_for_quake_alerts(float alert_threshold) {
+    for (int i = 0; i < g_quake_count; i++) {
+        if (quake_alerts(&g_quakes[i], alert_threshold)) raise_alert(g_quakes[i].id);
+    }
+}
+
+// Rings once if any site has entered a warning since the last check.
+// Transitions are numbered, so they need no entry in g_alerted_ids.
+void check_for_storm_alerts() {
+    uint64_t first = g_storm_transitions_seen;
+    if (g_lightning_transition_count - first > LIGHTNING_MAX_TRANSITIONS) first = g_lightning_transition_count - LIGHTNING_MAX_TRANSITIONS;
+    for (uint64_t n = first; n < g_lightning_transition_count; n++) {
+        if (g_lightning_transitions[n % LIGHTNING_MAX_TRANSITIONS].to != LIGHTNING_WARNING) continue;
+        ring_bell();
+        break;
+    }
+    g_storm_transitions_seen = g_lightning_transition_count;
+}
+
+// Rings once for any seismometer triggers since the last check. Trigger
+// counts are monotonic, so they stay out of g_alerted_ids, which is kept
+// for catalog events. Returns 1 when there were any.
+int check_for_shake_alerts() {
+    ShakeStatus status;
+    shake_status(&status);
+    if (status.triggers == g_shake_alerted) return 0;
+    ring_bell();
+    g_shake_alerted = status.triggers;
+    return 1;
+}
@@ -0,0 +1,19 @@
+/*
+ * alerts.h - Terminal bell alerts
+ *
+ * An event rings once, when it first passes the alert threshold, exceeds a
+ * site's own intensity threshold or exposes enough people to strong
+ * shaking. Storm warnings and seismometer triggers ring once per check.
+ */
+
+#ifndef ALERTS_H
+#define ALERTS_H
+
+#include "quakes.h"
+
+int quake_alerts(const Earthquake *quake, float alert_threshold);
+void check_for_quake_alerts(float alert_threshold);
+void check_for_storm_alerts();
+int check_for_shake_alerts();
+
+#endif // ALERTS_H
@@ -0,0 +1,306 @@
+/*
+ * arrow.c - Apache Arrow IPC (Feather v2) export of the event history
+ *
+ * The IPC metadata is FlatBuffers-encoded. The few tables needed are built
+ * with the minimal builder in flatbuf.c rather than pulling in the
+ * FlatBuffers and Arrow libraries. Like the rest of the monitor this
+ * assumes a little-endian host, which the schema declares.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "arrow.h"
+#include "flatbuf.h"
+#include "catalog.h"
+#include "places.h"
+
+#define ARROW_ALIGNMENT 64 // Body buffers start on cache-line boundaries
+#define ARROW_COLUMNS 8
+
+// Arrow format enums (Schema.fbs, Message.fbs)
+#define METADATA_V5 4
+#define HEADER_SCHEMA 1
+#define HEADER_RECORD_BATCH 3
+#define TYPE_INT 2
+#define TYPE_FLOATING_POINT 3
+#define TYPE_UTF8 5
+#define TYPE_TIMESTAMP 10
+#define PRECISION_SINGLE 1
+#define TIME_UNIT_MILLISECOND 1
+
+typedef struct {
+    int64_t length;
+    int64_t null_count;
+} FieldNode;
+
+typedef struct {
+    int64_t offset;
+    int64_t length;
+} BufferSpec;
+
+typedef struct {
+    int64_t offset;
+    int32_t metadata_length;
+    int32_t padding;
+    int64_t body_length;
+} Block;
+
+typedef struct {
+    const void *data;
+    int64_t length;
+} BodyBuffer;
+
+// --- Schema ---
+
+static uint32_t build_field(FbBuilder *b, const char *name, int type_type, uint32_t type) {
+    uint32_t children = fb_offset_vector(b, NULL, 0);
+    uint32_t name_offset = fb_string(b, name);
+    FbField fields[] = {
+        { 0, 4, name_offset, 1 },
+        { 1, 1, 0, 0 },          // nullable: false
+        { 2, 1, type_type, 0 },
+        { 3, 4, type, 1 },
+        { 5, 4, children, 1 },
+    };
+    return fb_table(b, fields, 5);
+}
+
+static uint32_t build_schema(FbBuilder *b) {
+    static const char *float_columns[] = { "lat", "lon", "depth", "mag" };
+    uint32_t columns[ARROW_COLUMNS];
+    int count = 0;
+
+    uint32_t timezone = fb_string(b, "UTC");
+    FbField timestamp[] = { { 0, 2, TIME_UNIT_MILLISECOND, 0 }, { 1, 4, timezone, 1 } };
+    uint32_t type = fb_table(b, timestamp, 2);
+    columns[count++] = build_field(b, "time", TYPE_TIMESTAMP, type);
+
+    for (int i = 0; i < 4; i++) {
+        FbField precision[] = { { 0, 2, PRECISION_SINGLE, 0 } };
+        type = fb_table(b, precision, 1);
+        columns[count++] = build_field(b, float_columns[i], TYPE_FLOATING_POINT, type);
+    }
+
+    FbField uint16_type[] = { { 0, 4, 16, 0 }, { 1, 1, 0, 0 } }; // bitWidth 16, unsigned
+    type = fb_table(b, uint16_type, 2);
+    columns[count++] = build_field(b, "region", TYPE_INT, type);
+
+    type = fb_table(b, NULL, 0);
+    columns[count++] = build_field(b, "id", TYPE_UTF8, type);
+    type = fb_table(b, NULL, 0);
+    columns[count++] = build_field(b, "place", TYPE_UTF8, type);
+
+    uint32_t field_vector = fb_offset_vector(b, columns, count);
+    FbField schema[] = { { 0, 2, 0, 0 }, { 1, 4, field_vector, 1 } }; // Little-endian
+    return fb_table(b, schema, 2);
+}
+
+static uint32_t build_message(FbBuilder *b, int header_type, uint32_t header, int64_t body_length) {
+    FbField message[] = {
+        { 0, 2, METADATA_V5, 0 },
+        { 1, 1, header_type, 0 },
+        { 2, 4, header, 1 },
+        { 3, 8, body_length, 0 },
+    };
+    return fb_table(b, message, 4);
+}
+
+// --- Writing ---
+
+static const uint8_t g_zeros[ARROW_ALIGNMENT];
+
+static int64_t aligned(int64_t length) {
+    return (length + ARROW_ALIGNMENT - 1) / ARROW_ALIGNMENT * ARROW_ALIGNMENT;
+}
+
+// Writes an encapsulated message: continuation marker, metadata length,
+// metadata padded to 8 bytes, then the body buffers.
+static int write_message(FILE *file, FbBuilder *b, const BodyBuffer *buffers, int buffer_count, int64_t body_length,
+                         Block *block) {
+    if (b->failed) return -1;
+    uint32_t marker = 0xFFFFFFFF;
+    int32_t metadata_length = (int32_t)((b->size + 7) / 8 * 8);
+    if (block) {
+        block->offset = ftell(file);
+        block->metadata_length = 8 + metadata_length;
+        block->padding = 0;
+        block->body_length = body_length;
+    }
+    fwrite(&marker, 4, 1, file);
+    fwrite(&metadata_length, 4, 1, file);
+    fwrite(fb_bytes(b), 1, b->size, file);
+    fwrite(g_zeros, 1, metadata_length - b->size, file);
+    for (int i = 0; i < buffer_count; i++) {
+        if (buffers[i].length) fwrite(buffers[i].data, 1, buffers[i].length, file);
+        fwrite(g_zeros, 1, aligned(buffers[i].length) - buffers[i].length, file);
+    }
+    return ferror(file) ? -1 : 0;
+}
+
+// Builds an offsets buffer and character data for one string column.
+static int build_strings(uint64_t first_seq, int64_t rows, int place_column, int32_t **offsets_out, char **data_out,
+                         int64_t *data_length) {
+    int32_t *offsets = malloc((rows + 1) * sizeof(int32_t));
+    size_t capacity = rows * 16 + 64, length = 0;
+    char *data = malloc(capacity);
+    if (!offsets || !data) {
+        free(offsets);
+        free(data);
+        return -1;
+    }
+    offsets[0] = 0;
+    for (int64_t r = 0; r < rows; r++) {
+        uint64_t seq = first_seq + r;
+        const char *text = place_column ? places_get(seq) : g_catalog.id[catalog_slot(seq)];
+        size_t text_length = place_column ? strlen(text) : strnlen(text, CATALOG_ID_LEN);
+        if (length + text_length > capacity) {
+            while (length + text_length > capacity) capacity *= 2;
+            char *grown = realloc(data, capacity);
+            if (!grown) {
+                free(offsets);
+                free(data);
+                return -1;
+            }
+            data = grown;
+        }
+        memcpy(data + length, text, text_length);
+        length += text_length;
+        offsets[r + 1] = (int32_t)length;
+    }
+    *offsets_out = offsets;
+    *data_out = data;
+    *data_length = length;
+    return 0;
+}
+
+// One record batch over a run of rows that is contiguous in the ring.
+static int write_batch(FILE *file, uint64_t first_seq, int64_t rows, Block *block) {
+    uint64_t slot = catalog_slot(first_seq);
+    int32_t *id_offsets = NULL, *place_offsets = NULL;
+    char *id_data = NULL, *place_data = NULL;
+    int64_t id_length = 0, place_length = 0;
+    if (build_strings(first_seq, rows, 0, &id_offsets, &id_data, &id_length) != 0 ||
+        build_strings(first_seq, rows, 1, &place_offsets, &place_data, &place_length) != 0) {
+        free(id_offsets);
+        free(id_data);
+        fprintf(stderr, "Not enough memory to export %lld events\n", (long long)rows);
+        return -1;
+    }
+
+    // Validity buffers are empty: no column has nulls
+    BodyBuffer buffers[] = {
+        { NULL, 0 }, { g_catalog.time_ms + slot, rows * 8 },
+        { NULL, 0 }, { g_catalog.lat + slot, rows * 4 },
+        { NULL, 0 }, { g_catalog.lon + slot, rows * 4 },
+        { NULL, 0 }, { g_catalog.depth + slot, rows * 4 },
+        { NULL, 0 }, { g_catalog.mag + slot, rows * 4 },
+        { NULL, 0 }, { g_catalog.region + slot, rows * 2 },
+        { NULL, 0 }, { id_offsets, (rows + 1) * 4 }, { id_data, id_length },
+        { NULL, 0 }, { place_offsets, (rows + 1) * 4 }, { place_data, place_length },
+    };
+    const int buffer_count = sizeof(buffers) / sizeof(buffers[0]);
+    BufferSpec specs[sizeof(buffers) / sizeof(buffers[0])];
+    int64_t body_length = 0;
+    for (int i = 0; i < buffer_count; i++) {
+        specs[i].offset = body_length;
+        specs[i].length = buffers[i].length;
+        body_length += aligned(buffers[i].length);
+    }
+    FieldNode nodes[ARROW_COLUMNS];
+    for (int c = 0; c < ARROW_COLUMNS; c++) {
+        nodes[c].length = rows;
+        nodes[c].null_count = 0;
+    }
+
+    FbBuilder b = { 0 };
+    uint32_t buffer_vector = fb_struct_vector(&b, specs, buffer_count, sizeof(BufferSpec));
+    uint32_t node_vector = fb_struct_vector(&b, nodes, ARROW_COLUMNS, sizeof(FieldNode));
+    FbField batch[] = { { 0, 8, rows, 0 }, { 1, 4, node_vector, 1 }, { 2, 4, buffer_vector, 1 } };
+    uint32_t header = fb_table(&b, batch, 3);
+    fb_finish(&b, build_message(&b, HEADER_RECORD_BATCH, header, body_length));
+    int result = write_message(file, &b, buffers, buffer_count, body_length, block);
+
+    free(b.data);
+    free(id_offsets);
+    free(id_data);
+    free(place_offsets);
+    free(place_data);
+    return result;
+}
+
+// Writes the whole history to path, through a temporary file renamed into
+// place so readers never see a partial export.
+int arrow_export(const char *path) {
+    char temp_path[1024];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Could not write Arrow export %s\n", temp_path);
+        return -1;
+    }
+    fwrite("ARROW1\0\0", 1, 8, file);
+
+    FbBuilder b = { 0 };
+    fb_finish(&b, build_message(&b, HEADER_SCHEMA, build_schema(&b), 0));
+    int result = write_message(file, &b, NULL, 0, 0, NULL);
+    free(b.data);
+
+    // One batch per run of live rows contiguous in the ring: two at the
+    // wrap, plus one more per stretch of rows retired out of order
+    Block *blocks = NULL;
+    int block_count = 0, block_capacity = 0;
+    uint64_t seq = g_catalog.head;
+    while (result == 0 && seq < g_catalog.tail) {
+        uint64_t limit = g_catalog.capacity - catalog_slot(seq), run = 0;
+        if (limit > g_catalog.tail - seq) limit = g_catalog.tail - seq;
+        while (run < limit && catalog_live(seq + run)) run++;
+        if (run > 0) {
+            if (block_count == block_capacity) {
+                block_capacity = block_capacity ? block_capacity * 2 : 4;
+                Block *grown = realloc(blocks, block_capacity * sizeof(Block));
+                if (!grown) {
+                    result = -1;
+                    break;
+                }
+                blocks = grown;
+            }
+            result = write_batch(file, seq, (int64_t)run, &blocks[block_count++]);
+        }
+        seq += run;
+        while (seq < g_catalog.tail && !catalog_live(seq)) seq++;
+    }
+
+    uint32_t end_of_stream[2] = { 0xFFFFFFFF, 0 };
+    fwrite(end_of_stream, 4, 2, file);
+
+    FbBuilder footer = { 0 };
+    uint32_t batch_vector = fb_struct_vector(&footer, blocks, block_count, sizeof(Block));
+    free(blocks);
+    uint32_t dictionary_vector = fb_struct_vector(&footer, NULL, 0, sizeof(Block));
+    uint32_t schema = build_schema(&footer);
+    FbField fields[] = {
+        { 0, 2, METADATA_V5, 0 },
+        { 1, 4, schema, 1 },
+        { 2, 4, dictionary_vector, 1 },
+        { 3, 4, batch_vector, 1 },
+    };
+    fb_finish(&footer, fb_table(&footer, fields, 4));
+    if (footer.failed) result = -1;
+    int32_t footer_length = (int32_t)footer.size;
+    fwrite(fb_bytes(&footer), 1, footer.size, file);
+    fwrite(&footer_length, 4, 1, file);
+    fwrite("ARROW1", 1, 6, file);
+    free(footer.data);
+
+    if (ferror(file)) result = -1;
+    if (fclose(file) != 0) result = -1;
+    if (result == 0 && rename(temp_path, path) != 0) result = -1;
+    if (result != 0) {
+        fprintf(stderr, "Arrow export to %s failed\n", path);
+        remove(temp_path);
+    }
+    return result;
+}
@@ -0,0 +1,19 @@
+/*
+ * arrow.h - Apache Arrow IPC (Feather v2) export of the event history
+ *
+ * Writes the catalog as an Arrow IPC file that pandas, Polars or R can
+ * memory-map without copying. Numeric columns are written straight from the
+ * catalog's column arrays: each run of live rows contiguous in the ring
+ * becomes a record batch, so no row is ever serialized. Only the id and
+ * place strings need an offsets buffer built for them.
+ *
+ * Columns: time (timestamp[ms, UTC]), lat, lon, depth, mag (float32),
+ * region (uint16), id and place (utf8).
+ */
+
+#ifndef ARROW_H
+#define ARROW_H
+
+int arrow_export(const char *path);
+
+#endif // ARROW_H
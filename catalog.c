@@ -0,0 +1,162 @@
+/*
+ * catalog.c - Event history store
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "catalog.h"
+
+// --- Globals ---
+Catalog g_catalog;
+
+// --- Id Index ---
+
+static uint64_t hash_id(const char *id) {
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    for (; *id; id++) {
+        hash ^= (unsigned char)*id;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t *find_bucket(const char *id) {
+    uint64_t bucket = hash_id(id) & g_catalog.index_mask;
+    while (g_catalog.index[bucket]) {
+        uint64_t seq = g_catalog.index[bucket] - 1;
+        if (strcmp(g_catalog.id[catalog_slot(seq)], id) == 0) break;
+        bucket = (bucket + 1) & g_catalog.index_mask;
+    }
+    return &g_catalog.index[bucket];
+}
+
+// Removes a bucket by shifting later members of its probe run back, so
+// lookups never need tombstones.
+static void remove_bucket(uint64_t *bucket_ptr) {
+    uint64_t hole = bucket_ptr - g_catalog.index;
+    uint64_t next = (hole + 1) & g_catalog.index_mask;
+    while (g_catalog.index[next]) {
+        uint64_t seq = g_catalog.index[next] - 1;
+        uint64_t home = hash_id(g_catalog.id[catalog_slot(seq)]) & g_catalog.index_mask;
+        // Move the entry back unless its home lies cyclically in (hole, next]
+        if (((next - home) & g_catalog.index_mask) >= ((next - hole) & g_catalog.index_mask)) {
+            g_catalog.index[hole] = g_catalog.index[next];
+            hole = next;
+        }
+        next = (next + 1) & g_catalog.index_mask;
+    }
+    g_catalog.index[hole] = 0;
+}
+
+// --- Store ---
+
+int catalog_init(uint64_t capacity) {
+    memset(&g_catalog, 0, sizeof(g_catalog));
+    uint64_t buckets = 1;
+    while (buckets < capacity * 2) buckets <<= 1;
+
+    g_catalog.capacity = capacity;
+    g_catalog.time_ms = malloc(capacity * sizeof(int64_t));
+    g_catalog.lat = malloc(capacity * sizeof(float));
+    g_catalog.lon = malloc(capacity * sizeof(float));
+    g_catalog.depth = malloc(capacity * sizeof(float));
+    g_catalog.mag = malloc(capacity * sizeof(float));
+    g_catalog.region = malloc(capacity * sizeof(uint16_t));
+    g_catalog.id = malloc(capacity * CATALOG_ID_LEN);
+    g_catalog.retired = calloc(capacity, 1);
+    g_catalog.index = calloc(buckets, sizeof(uint64_t));
+    g_catalog.index_mask = buckets - 1;
+    if (!g_catalog.time_ms || !g_catalog.lat || !g_catalog.lon || !g_catalog.depth || !g_catalog.mag ||
+        !g_catalog.region || !g_catalog.id || !g_catalog.retired || !g_catalog.index) {
+        fprintf(stderr, "Not enough memory for a catalog of %llu events\n", (unsigned long long)capacity);
+        return -1;
+    }
+    return 0;
+}
+
+void catalog_get(uint64_t seq, CatalogEvent *event) {
+    uint64_t slot = catalog_slot(seq);
+    memcpy(event->id, g_catalog.id[slot], CATALOG_ID_LEN);
+    event->time_ms = g_catalog.time_ms[slot];
+    event->lat = g_catalog.lat[slot];
+    event->lon = g_catalog.lon[slot];
+    event->depth = g_catalog.depth[slot];
+    event->mag = g_catalog.mag[slot];
+    event->region = g_catalog.region[slot];
+}
+
+static void store_row(uint64_t slot, const CatalogEvent *event) {
+    g_catalog.time_ms[slot] = event->time_ms;
+    g_catalog.lat[slot] = event->lat;
+    g_catalog.lon[slot] = event->lon;
+    g_catalog.depth[slot] = event->depth;
+    g_catalog.mag[slot] = event->mag;
+    g_catalog.region[slot] = (uint16_t)event->region;
+}
+
+int catalog_find(const char *id, uint64_t *seq_out) {
+    uint64_t *bucket = find_bucket(id);
+    if (!*bucket) return 0;
+    if (seq_out) *seq_out = *bucket - 1;
+    return 1;
+}
+
+// No slot is free for another row; holes count until the head reaches them
+int catalog_full() {
+    return g_catalog.tail - g_catalog.head >= g_catalog.capacity;
+}
+
+// Inserts a new event or updates a known one in place. The caller must make
+// room first when the catalog is full. On a revision, previous receives the
+// row as it was.
+CatalogChange catalog_upsert(const CatalogEvent *event, uint64_t *seq_out, CatalogEvent *previous) {
+    char id[CATALOG_ID_LEN];
+    memset(id, 0, sizeof(id));
+    memcpy(id, event->id, strnlen(event->id, CATALOG_ID_LEN - 1));
+
+    uint64_t *bucket = find_bucket(id);
+    if (*bucket) {
+        uint64_t seq = *bucket - 1;
+        uint64_t slot = catalog_slot(seq);
+        if (seq_out) *seq_out = seq;
+        if (g_catalog.time_ms[slot] == event->time_ms && g_catalog.mag[slot] == event->mag &&
+            g_catalog.lat[slot] == event->lat && g_catalog.lon[slot] == event->lon &&
+            g_catalog.depth[slot] == event->depth) {
+            return CATALOG_UNCHANGED;
+        }
+        if (previous) catalog_get(seq, previous);
+        store_row(slot, event);
+        return CATALOG_REVISED;
+    }
+
+    if (catalog_full()) return CATALOG_UNCHANGED;
+    uint64_t seq = g_catalog.tail++;
+    uint64_t slot = catalog_slot(seq);
+    memcpy(g_catalog.id[slot], id, CATALOG_ID_LEN);
+    store_row(slot, event);
+    *bucket = seq + 1;
+    if (seq_out) *seq_out = seq;
+    return CATALOG_INSERTED;
+}
+
+// Drops a row wherever it sits. Its slot is reused only once the head
+// passes it, so every other row keeps its sequence number.
+void catalog_remove(uint64_t seq) {
+    if (!catalog_live(seq)) return;
+    uint64_t slot = catalog_slot(seq);
+    uint64_t *bucket = find_bucket(g_catalog.id[slot]);
+    if (*bucket) remove_bucket(bucket);
+    g_catalog.retired[slot] = 1;
+    g_catalog.holes++;
+    while (g_catalog.head < g_catalog.tail && g_catalog.retired[catalog_slot(g_catalog.head)]) {
+        g_catalog.retired[catalog_slot(g_catalog.head)] = 0;
+        g_catalog.holes--;
+        g_catalog.head++;
+    }
+}
+
+void catalog_pop_oldest() {
+    catalog_remove(g_catalog.head);
+}
@@ -0,0 +1,84 @@
+/*
+ * catalog.h - Event history store
+ *
+ * Every event the feed has ever returned, kept column-wise in a ring so the
+ * oldest rows can be retired in O(1). A row's sequence number never changes
+ * while it is live, so other modules may key their own structures on it.
+ * Events are found by id through an open-addressing hash table.
+ *
+ * The catalog never drops rows on its own: callers retire a row with
+ * catalog_remove() once every module tracking it has let go. Feeds do not
+ * list events in time order, so rows may be retired from anywhere in the
+ * ring; such a row leaves a hole that is reclaimed once every row before it
+ * has gone too. Only a full ring forces out the oldest row by insertion,
+ * with catalog_pop_oldest().
+ */
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdint.h>
+
+#define CATALOG_ID_LEN 24
+#define CATALOG_DEFAULT_CAPACITY 262144
+#define CATALOG_RETENTION_DAYS 30
+#define CATALOG_NO_SEQ UINT64_MAX // For events that never entered the catalog
+
+typedef struct {
+    char id[CATALOG_ID_LEN];
+    long long time_ms;
+    float lat;
+    float lon;
+    float depth;
+    float mag;
+    int region;
+} CatalogEvent;
+
+typedef enum {
+    CATALOG_UNCHANGED,
+    CATALOG_INSERTED,
+    CATALOG_REVISED,
+} CatalogChange;
+
+typedef struct {
+    uint64_t capacity;
+    uint64_t head; // Sequence number of the oldest live row
+    uint64_t tail; // Sequence number the next row will get
+    uint64_t holes; // Rows between head and tail retired out of order
+    int64_t *time_ms;
+    float *lat;
+    float *lon;
+    float *depth;
+    float *mag;
+    uint16_t *region;
+    char (*id)[CATALOG_ID_LEN];
+    uint8_t *retired; // Marks the holes
+    // id -> sequence number + 1 (0 marks an empty bucket)
+    uint64_t *index;
+    uint64_t index_mask;
+} Catalog;
+
+extern Catalog g_catalog;
+
+int catalog_init(uint64_t capacity);
+CatalogChange catalog_upsert(const CatalogEvent *event, uint64_t *seq_out, CatalogEvent *previous);
+int catalog_find(const char *id, uint64_t *seq_out);
+void catalog_get(uint64_t seq, CatalogEvent *event);
+int catalog_full();
+void catalog_remove(uint64_t seq);
+void catalog_pop_oldest();
+
+static inline uint64_t catalog_size() {
+    return g_catalog.tail - g_catalog.head - g_catalog.holes;
+}
+
+static inline uint64_t catalog_slot(uint64_t seq) {
+    return seq % g_catalog.capacity;
+}
+
+// Whether seq names a row still in the history, for walks from head to tail
+static inline int catalog_live(uint64_t seq) {
+    return seq >= g_catalog.head && seq < g_catalog.tail && !g_catalog.retired[catalog_slot(seq)];
+}
+
+#endif // CATALOG_H
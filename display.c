@@ -0,0 +1,381 @@
+/*
+ * display.c - Console display
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "display.h"
+#include "monitor.h"
+#include "quakes.h"
+#include "region.h"
+#include "sites.h"
+#include "gmpe.h"
+#include "catalog.h"
+#include "etas.h"
+#include "indexes.h"
+#include "places.h"
+#include "rollup.h"
+#include "lightning.h"
+#include "strikes.h"
+#include "shake.h"
+#include "tui.h"
+#include "proxy.h"
+#include "relay.h"
+#include "hostcache.h"
+#include "shard.h"
+
+#define TOP_REGIONS_SHOWN 3
+#define MAX_SITES_SHOWN 5
+#define MIN_SHAKING_SHOWN 2.0 // Estimated MMI below this counts as not felt
+#define MAX_ARRIVALS_SHOWN 8
+#define MAX_HISTORY_SHOWN 5
+
+// ANSI color codes
+#define COLOR_RED     "\x1b[31m"
+#define COLOR_YELLOW  "\x1b[33m"
+#define COLOR_GREEN   "\x1b[32m"
+#define COLOR_CYAN    "\x1b[36m"
+#define COLOR_RESET   "\x1b[0m"
+
+// --- Formatting ---
+
+static void format_count(double count, char* buffer, size_t buffer_size) {
+    if (count >= 1e6) snprintf(buffer, buffer_size, "%.1fM", count / 1e6);
+    else if (count >= 1e3) snprintf(buffer, buffer_size, "%.0fk", count / 1e3);
+    else snprintf(buffer, buffer_size, "%.0f", count);
+}
+
+static void format_countdown(const char *wave, double arrival, double now, char *buffer, size_t buffer_size) {
+    long remaining = (long)(arrival - now);
+    if (remaining <= 0) snprintf(buffer, buffer_size, "%s arrived", wave);
+    else snprintf(buffer, buffer_size, "%s in %ldm%02lds", wave, remaining / 60, remaining % 60);
+}
+
+// --- Earthquakes ---
+
+// Lists the busiest regions from the per-region tallies built at ingest.
+static void render_region_summary() {
+    int shown[TOP_REGIONS_SHOWN];
+    int shown_count = 0;
+    for (int n = 0; n < TOP_REGIONS_SHOWN; n++) {
+        int best = -1;
+        for (int r = 0; r <= MAX_REGION_CODE; r++) {
+            if (g_region_counts[r] == 0) continue;
+            int taken = 0;
+            for (int k = 0; k < shown_count; k++) if (shown[k] == r) taken = 1;
+            if (!taken && (best < 0 || g_region_counts[r] > g_region_counts[best])) best = r;
+        }
+        if (best < 0) break;
+        shown[shown_count++] = best;
+    }
+    if (shown_count == 0) return;
+
+    printf("\nMost Active Regions:");
+    for (int k = 0; k < shown_count; k++) {
+        printf("%s %s (%d)", k ? "," : "", region_name(shown[k]), g_region_counts[shown[k]]);
+    }
+    printf("\n");
+}
+
+// Summarizes the whole history from the pre-aggregated rollups.
+static void render_activity() {
+    if (catalog_size() == 0) return;
+    long long now_ms = (long long)time(NULL) * 1000 + 1;
+    uint32_t hour = rollup_count(ROLLUP_MINUTE, now_ms - 3600000LL, now_ms, ROLLUP_ALL_REGIONS, 0.0f);
+    uint32_t day = rollup_count(ROLLUP_MINUTE, now_ms - 86400000LL, now_ms, ROLLUP_ALL_REGIONS, 0.0f);
+    uint32_t month = rollup_count(ROLLUP_HOUR, now_ms - CATALOG_RETENTION_DAYS * 86400000LL, now_ms, ROLLUP_ALL_REGIONS, 0.0f);
+    uint32_t day_major = rollup_count(ROLLUP_MINUTE, now_ms - 86400000LL, now_ms, ROLLUP_ALL_REGIONS, 4.0f);
+    uint32_t month_major = rollup_count(ROLLUP_HOUR, now_ms - CATALOG_RETENTION_DAYS * 86400000LL, now_ms, ROLLUP_ALL_REGIONS, 4.0f);
+    printf("History: %u last hour, %u last 24h (M4+: %u), %u last %dd (M4+: %u)\n", hour, day, day_major, month,
+           CATALOG_RETENTION_DAYS, month_major);
+}
+
+// Lists the sites with the strongest expected shaking.
+static void render_site_shaking() {
+    printf(COLOR_CYAN "\n--- ESTIMATED SHAKING AT SITES ---\n" COLOR_RESET);
+    int shown[MAX_SITES_SHOWN];
+    int shown_count = 0;
+    while (shown_count < MAX_SITES_SHOWN) {
+        int best = -1;
+        for (int s = 0; s < g_site_count; s++) {
+            if (g_sites[s].peak_quake < 0 || g_sites[s].peak_mmi < MIN_SHAKING_SHOWN) continue;
+            int taken = 0;
+            for (int k = 0; k < shown_count; k++) if (shown[k] == s) taken = 1;
+            if (!taken && (best < 0 || g_sites[s].peak_mmi > g_sites[best].peak_mmi)) best = s;
+        }
+        if (best < 0) break;
+        shown[shown_count++] = best;
+    }
+    if (shown_count == 0) {
+        printf(COLOR_GREEN "No felt shaking expected at %d monitored site%s.\n" COLOR_RESET, g_site_count, g_site_count == 1 ? "" : "s");
+        return;
+    }
+
+    for (int k = 0; k < shown_count; k++) {
+        const Site *site = &g_sites[shown[k]];
+        const Earthquake *quake = &g_quakes[site->peak_quake];
+        const char* color = (site->peak_mmi >= site->mmi_threshold) ? COLOR_RED : (site->peak_mmi >= 4.0) ? COLOR_YELLOW : COLOR_GREEN;
+        printf("%s%-16s MMI %.1f  PGA %.3fg%s  from M %.1f %s\n", color, site->name, site->peak_mmi,
+               gmpe_pga_from_mmi(site->peak_mmi), COLOR_RESET, quake->mag, quake->place);
+    }
+}
+
+// Shows the local seismometer channels and its latest triggers.
+static void render_local_shake() {
+    ShakeStatus status;
+    shake_status(&status);
+    printf(COLOR_CYAN "\n--- LOCAL SEISMOMETER (UDP %d) ---\n" COLOR_RESET, g_shake_port);
+    if (status.channels == 0) {
+        printf("Waiting for data...\n");
+        return;
+    }
+    for (int c = 0; c < status.channels; c++) {
+        const char *color = !status.live[c] ? COLOR_YELLOW : status.ratio[c] > SHAKE_TRIGGER_ON ? COLOR_RED : COLOR_GREEN;
+        printf("%s%s %s STA/LTA %.1f%s  ", color, status.name[c], status.live[c] ? "live" : "silent", status.ratio[c], COLOR_RESET);
+    }
+    printf("\n");
+    uint64_t first = status.triggers > 3 ? status.triggers - 3 : 0;
+    for (uint64_t n = status.triggers; n-- > first;) {
+        const ShakeTrigger *trigger = &status.recent[n % SHAKE_RECENT_TRIGGERS];
+        time_t seconds = (time_t)trigger->time;
+        char time_buf[32];
+        strftime(time_buf, sizeof(time_buf), "%H:%M:%S UTC", gmtime(&seconds));
+        printf(COLOR_RED "LOCAL TRIGGER %s on %s: STA/LTA %.1f, %.0f counts rms\n" COLOR_RESET, time_buf, trigger->channel,
+               trigger->ratio, trigger->rms);
+    }
+    if (status.dropped) printf("(%llu packets dropped)\n", (unsigned long long)status.dropped);
+}
+
+// Shows live P/S countdowns, soonest S wave first.
+static void render_wave_arrivals() {
+    if (g_arrival_count == 0) return;
+    double now = (double)time(NULL);
+    int shown[MAX_ARRIVALS_SHOWN];
+    int shown_count = 0;
+    while (shown_count < MAX_ARRIVALS_SHOWN) {
+        int best = -1;
+        for (int a = 0; a < g_arrival_count; a++) {
+            if (g_arrivals[a].s_arrival + ARRIVAL_LINGER_SECONDS < now) continue;
+            int taken = 0;
+            for (int k = 0; k < shown_count; k++) if (shown[k] == a) taken = 1;
+            if (!taken && (best < 0 || g_arrivals[a].s_arrival < g_arrivals[best].s_arrival)) best = a;
+        }
+        if (best < 0) break;
+        shown[shown_count++] = best;
+    }
+    if (shown_count == 0) return;
+
+    printf(COLOR_CYAN "\n--- SEISMIC WAVE ARRIVALS ---\n" COLOR_RESET);
+    for (int k = 0; k < shown_count; k++) {
+        const WaveArrival *arrival = &g_arrivals[shown[k]];
+        const Earthquake *quake = &g_quakes[arrival->quake];
+        char p_text[32], s_text[32];
+        format_countdown("P", arrival->p_arrival, now, p_text, sizeof(p_text));
+        format_countdown("S", arrival->s_arrival, now, s_text, sizeof(s_text));
+        const char* color = (arrival->p_arrival > now) ? COLOR_YELLOW : COLOR_RED;
+        printf("%s%-16s %-14s %-14s%s M %.1f %s\n", color, g_sites[arrival->site].name, p_text, s_text, COLOR_RESET,
+               quake->mag, quake->place);
+    }
+}
+
+// Shows the ETAS forecast for every active sequence.
+static void render_aftershock_forecasts() {
+    if (g_sequence_count == 0) return;
+    printf(COLOR_CYAN "\n--- AFTERSHOCK FORECAST (next %dh) ---\n" COLOR_RESET, ETAS_HORIZON_HOURS);
+    for (int s = 0; s < g_sequence_count; s++) {
+        const EtasSequence *sequence = &g_sequences[s];
+        const char* color = (sequence->probability >= 0.10) ? COLOR_RED : (sequence->probability >= 0.01) ? COLOR_YELLOW : COLOR_GREEN;
+        printf("%sP(M%.0f+) %5.1f%%%s  M %.1f %s (%d events)\n", color, ETAS_TARGET_MAGNITUDE, sequence->probability * 100.0,
+               COLOR_RESET, sequence->mainshock_mag, sequence->place, sequence->count);
+    }
+}
+
+// Lists the newest, largest or nearest events in the whole history, read
+// straight off the matching secondary index, or the events matching the
+// place search, found through the trigram index.
+static void render_history() {
+    if (!g_history_view && !g_place_query) return;
+    uint64_t seqs[MAX_HISTORY_SHOWN];
+    uint64_t total = catalog_size();
+    int count;
+    if (g_place_query) count = places_search(g_place_query, seqs, MAX_HISTORY_SHOWN, &total);
+    else if (strcmp(g_history_view, "largest") == 0) count = index_range(INDEX_MAGNITUDE, -INFINITY, INFINITY, 1, seqs, MAX_HISTORY_SHOWN);
+    else if (strcmp(g_history_view, "nearest") == 0) count = index_range(INDEX_DISTANCE, -INFINITY, INFINITY, 0, seqs, MAX_HISTORY_SHOWN);
+    else count = index_range(INDEX_TIME, -INFINITY, INFINITY, 1, seqs, MAX_HISTORY_SHOWN);
+    if (count == 0) return;
+
+    if (g_place_query) printf(COLOR_CYAN "\n--- HISTORY: \"%s\" (%llu events) ---\n" COLOR_RESET, g_place_query, (unsigned long long)total);
+    else printf(COLOR_CYAN "\n--- HISTORY: %s OF %llu ---\n" COLOR_RESET, g_history_view, (unsigned long long)total);
+    for (int k = 0; k < count; k++) {
+        CatalogEvent event;
+        char time_ago[20];
+        catalog_get(seqs[k], &event);
+        format_time_ago(event.time_ms, time_ago, sizeof(time_ago));
+        const char *place = places_get(seqs[k]);
+        printf("M %.1f  %-10s %s\n", event.mag, time_ago, place[0] ? place : region_name(event.region));
+    }
+}
+
+// --- Lightning ---
+
+// Lists storms in the sampling rings, nearest first, with the direction
+// they lie in and when they are expected to reach the site.
+static void render_storm_approach() {
+    static const char *compass[] = { "N", "NE", "E", "SE", "S", "SW", "W", "NW" };
+    int shown[MAX_SITES_SHOWN];
+    int shown_count = 0;
+    for (int n = 0; n < MAX_SITES_SHOWN; n++) {
+        int best = -1;
+        for (int s = 0; s < g_site_count; s++) {
+            float distance = g_lightning_threats[s].distance_km;
+            if (distance <= 0.0f) continue;
+            int taken = 0;
+            for (int k = 0; k < shown_count; k++) if (shown[k] == s) taken = 1;
+            if (!taken && (best < 0 || distance < g_lightning_threats[best].distance_km)) best = s;
+        }
+        if (best < 0) break;
+        shown[shown_count++] = best;
+        const LightningThreat *threat = &g_lightning_threats[best];
+        printf("Storm %.0f km %s of %s", threat->distance_km, compass[(int)((threat->bearing_deg + 22.5f) / 45.0f) % 8],
+               g_sites[best].name);
+        if (threat->eta_minutes >= 0) printf(", arriving in ~%dh%02dm\n", threat->eta_minutes / 60, threat->eta_minutes % 60);
+        else printf(", not approaching\n");
+    }
+}
+
+// Lists warnings, then watches, across the sites, and the latest level
+// changes. Only reads the site states, so it can be redrawn at any rate.
+static void render_lightning() {
+    printf(COLOR_CYAN "\n--- LIGHTNING PROXIMITY WARNING ---\n" COLOR_RESET);
+    if (g_site_count == 1) printf("Monitoring Location: %.2f, %.2f\n\n", g_sites[0].lat, g_sites[0].lon);
+    else printf("Monitoring %d sites in %d forecast cells\n\n", g_site_count, g_shard_count ? g_shard_cells : g_lightning_cell_count);
+
+    long long now = time(NULL);
+    int shown = 0, warnings = 0, watches = 0;
+    for (int pass = LIGHTNING_WARNING; pass >= LIGHTNING_WATCH; pass--) {
+        for (int s = 0; s < g_site_count; s++) {
+            const LightningSiteState *state = lightning_site(s);
+            LightningLevel level = state->level;
+            int lead_minutes = state->onset > now ? (int)((state->onset - now) / 60) : 0;
+            if ((int)level != pass) continue;
+            if (level == LIGHTNING_WARNING) warnings++;
+            else watches++;
+            if (shown++ >= MAX_SITES_SHOWN) continue;
+            if (level == LIGHTNING_WARNING) {
+                printf(COLOR_RED "!!! SEVERE THUNDERSTORM WARNING: %s", g_sites[s].name);
+                if (lead_minutes > 0) printf(" (in %d min)", lead_minutes);
+                printf(" !!! risk %.2f\n" COLOR_RESET, state->risk);
+            } else {
+                printf(COLOR_YELLOW "--- THUNDERSTORM WATCH: %s in %dh%02dm --- risk %.2f\n" COLOR_RESET, g_sites[s].name,
+                       lead_minutes / 60, lead_minutes % 60, state->risk);
+            }
+        }
+    }
+
+    if (warnings) printf("> Isolate antenna and sensitive equipment immediately.\n");
+    else if (watches) printf("> Thunderstorms possible within the next %d hours. Monitor conditions.\n", g_lightning_horizon_hours);
+    else printf(COLOR_GREEN "STATUS: All clear.\n" COLOR_RESET);
+    if (shown > MAX_SITES_SHOWN) printf("(%d more sites under watch or warning)\n", shown - MAX_SITES_SHOWN);
+    render_storm_approach();
+    if (g_strike_feed) {
+        printf("Strike feed: %s, %.0f/s, %.0f recent near %s", g_strike_stats.connected ? "connected" : "reconnecting",
+               g_strike_stats.rate, strikes_density(g_sites[0].lat, g_sites[0].lon, time(NULL)), g_sites[0].name);
+        if (g_strike_stats.dropped) printf(", %llu dropped", (unsigned long long)g_strike_stats.dropped);
+        printf("\n");
+    }
+    static const char *level_names[] = { "clear", "watch", "warning" };
+    uint64_t first = g_lightning_transition_count > 3 ? g_lightning_transition_count - 3 : 0;
+    for (uint64_t n = g_lightning_transition_count; n-- > first;) {
+        const LightningTransition *transition = &g_lightning_transitions[n % LIGHTNING_MAX_TRANSITIONS];
+        time_t when = (time_t)transition->time;
+        char time_buf[16];
+        strftime(time_buf, sizeof(time_buf), "%H:%M", gmtime(&when));
+        printf("%s %s: %s -> %s (risk %.2f)\n", time_buf, g_sites[transition->site].name, level_names[transition->from],
+               level_names[transition->to], transition->risk);
+    }
+}
+
+// --- Screen ---
+
+// Draws the history browser, with the alerts summed up in its status line.
+static void render_interactive() {
+    char status[256];
+    int warnings = 0, watches = 0;
+    for (int s = 0; s < g_site_count; s++) {
+        LightningLevel level = lightning_site(s)->level;
+        warnings += level == LIGHTNING_WARNING;
+        watches += level == LIGHTNING_WATCH;
+    }
+    time_t now = time(NULL);
+    int used = strftime(status, sizeof(status), "Updated %H:%M:%S UTC", gmtime(&now));
+    used += snprintf(status + used, sizeof(status) - used, " | %d live events | storms: %d warning, %d watch",
+                     g_quake_count, warnings, watches);
+    if (g_arrival_count > 0) used += snprintf(status + used, sizeof(status) - used, " | %d wave arrivals pending", g_arrival_count);
+    if (g_shake_port) {
+        ShakeStatus shake;
+        shake_status(&shake);
+        snprintf(status + used, sizeof(status) - used, " | seismometer: %llu triggers", (unsigned long long)shake.triggers);
+    }
+    tui_render(status);
+}
+
+void render_display(float min_magnitude) {
+    if (g_interactive) {
+        render_interactive();
+        return;
+    }
+    printf("\033[H\033[J"); // Clear console
+    time_t now = time(NULL);
+    char time_buf[100];
+    strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S UTC", gmtime(&now));
+    
+    printf(COLOR_CYAN "--- GLOBAL SEISMIC MONITOR (Min Mag: %.1f) ---" COLOR_RESET, min_magnitude);
+    printf("\nLast Updated: %s\n\n", time_buf);
+    for (int k = 0; k < g_quake_count; k++) {
+        int i = g_quake_order[k];
+        const char* color = (g_quakes[i].mag >= 6.0) ? COLOR_RED : (g_quakes[i].mag >= 4.0) ? COLOR_YELLOW : COLOR_GREEN;
+        printf("%s[  M %.1f  ]%-10s%s %s", color, g_quakes[i].mag, g_quakes[i].time_ago, COLOR_RESET, g_quakes[i].place);
+        if (g_quakes[i].exposure_felt >= 1.0) {
+            char felt[16], strong[16];
+            format_count(g_quakes[i].exposure_felt, felt, sizeof(felt));
+            format_count(g_quakes[i].exposure_strong, strong, sizeof(strong));
+            printf(" (exposed: %s felt, %s strong)", felt, strong);
+        }
+        printf("\n");
+    }
+    render_region_summary();
+    render_activity();
+    render_site_shaking();
+    if (g_shake_port) render_local_shake();
+    render_wave_arrivals();
+    render_aftershock_forecasts();
+    render_history();
+
+    render_lightning();
+    if (g_proxy_port) {
+        printf("\nFeed proxy: port %d, %d clients, %llu requests, %llu from memory (%llu not modified), %llu upstream\n",
+               g_proxy_port, g_proxy_stats.clients, (unsigned long long)g_proxy_stats.requests,
+               (unsigned long long)g_proxy_stats.hits, (unsigned long long)g_proxy_stats.not_modified,
+               (unsigned long long)g_proxy_stats.fetches);
+    }
+    if (g_relay_port) {
+        printf("\nEvent relay: port %d, %d monitors following, %llu deltas published, %llu bytes sent, %llu snapshots\n",
+               g_relay_port, g_relay_stats.clients, (unsigned long long)g_relay_stats.published,
+               (unsigned long long)g_relay_stats.bytes_sent, (unsigned long long)g_relay_stats.snapshots);
+    }
+    if (g_shard_count) {
+        printf("\nSite workers: %d of %d answering, last cycle %.0f ms\n", g_shards_answering, g_shard_count, g_shard_cycle_ms);
+    }
+    if (g_hostcache_stats.hits) {
+        printf("\nShared feed cache: %llu fetched here, %llu fetched by other monitors (%llu waited on)\n",
+               (unsigned long long)g_hostcache_stats.fetches, (unsigned long long)g_hostcache_stats.hits,
+               (unsigned long long)g_hostcache_stats.waits);
+    }
+    if (g_relay_source) {
+        printf("\nEvent relay: %s %s, %llu deltas received, %llu reconnects, %llu resyncs\n", g_relay_source,
+               g_relay_stats.connected ? "connected" : "disconnected", (unsigned long long)g_relay_stats.received,
+               (unsigned long long)g_relay_stats.reconnects, (unsigned long long)g_relay_stats.resyncs);
+    }
+}
@@ -0,0 +1,15 @@
+/*
+ * display.h - Console display
+ *
+ * Redraws the whole screen from the live list, the site states and the
+ * history: quakes and their impact first, then lightning, then the status
+ * of whatever is serving or following other monitors. The interactive
+ * view draws the history browser instead.
+ */
+
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+void render_display(float min_magnitude);
+
+#endif // DISPLAY_H
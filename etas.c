@@ -0,0 +1,462 @@
+/*
+ * etas.c - Short-term aftershock forecasts for active sequences
+ *
+ * Model: every event of magnitude m at time t triggers aftershocks of
+ * magnitude >= ETAS_REF_MAGNITUDE at rate
+ *     K * 10^(alpha (m - Mref)) * (t' - t + c)^-p
+ * with Gutenberg-Richter magnitudes (b-value b). The parameters are generic
+ * values for active crust, not fitted per sequence.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "etas.h"
+#include "timing.h"
+#include "fastmath.h"
+#include "traveltime.h"
+#include "indexes.h"
+
+#define ETAS_REF_MAGNITUDE 2.5 // Magnitude K is calibrated for
+#define ETAS_K 0.008
+#define ETAS_ALPHA 0.8
+#define ETAS_C_DAYS 0.01
+#define ETAS_P 1.1
+#define ETAS_B 1.0
+#define ETAS_MAX_MAGNITUDE 9.5
+#define ETAS_FORESHOCK_DAYS 1.0 // Events this long before a mainshock join its sequence
+#define ETAS_BATCH 8
+#define ETAS_MAX_THREADS 16
+#define ETAS_MAX_CASCADE 65536  // Simulated events kept per run
+#define KM_PER_DEG 111.195
+#define MS_PER_DAY 86400000.0
+#define LOG2_10 3.32192809f
+
+// --- Globals ---
+EtasSequence g_sequences[MAX_SEQUENCES];
+int g_sequence_count = 0;
+
+// Read-only inputs shared by the simulation threads
+typedef struct {
+    int parents;
+    const double *cumulative_rate; // Prefix sums of each parent's expected children
+    const float *elapsed;          // Days from each parent to now
+    double horizon_days;
+    double target_mag;
+} SimulationInput;
+
+typedef struct {
+    const SimulationInput *input;
+    int runs;
+    uint64_t seed;
+    int hits;
+} SimulationTask;
+
+// --- Sequence Membership ---
+
+// Rough aftershock-zone radius from Wells & Coppersmith rupture length.
+static double zone_radius_km(double mag) {
+    double rupture_km = pow(10.0, -3.22 + 0.69 * mag);
+    return rupture_km * 2.0 > 10.0 ? rupture_km * 2.0 : 10.0;
+}
+
+static int add_member(EtasSequence *sequence, uint64_t seq, double time_days, float mag) {
+    if (sequence->count == sequence->capacity) {
+        int capacity = sequence->capacity ? sequence->capacity * 2 : 256;
+        double *time_days_grown = realloc(sequence->time_days, capacity * sizeof(double));
+        if (time_days_grown) sequence->time_days = time_days_grown;
+        float *mag_grown = realloc(sequence->mag, capacity * sizeof(float));
+        if (mag_grown) sequence->mag = mag_grown;
+        uint64_t *seq_grown = realloc(sequence->seq, capacity * sizeof(uint64_t));
+        if (seq_grown) sequence->seq = seq_grown;
+        if (!time_days_grown || !mag_grown || !seq_grown) return -1;
+        sequence->capacity = capacity;
+    }
+    sequence->time_days[sequence->count] = time_days;
+    sequence->mag[sequence->count] = mag;
+    sequence->seq[sequence->count] = seq;
+    sequence->count++;
+    sequence->dirty = 1;
+    return 0;
+}
+
+static int in_zone(const EtasSequence *sequence, uint64_t seq) {
+    uint64_t slot = catalog_slot(seq);
+    double dist_km = epicentral_distance_deg(sequence->lat, sequence->lon, g_catalog.lat[slot], g_catalog.lon[slot]) * KM_PER_DEG;
+    return dist_km <= sequence->radius_km;
+}
+
+// Refills a sequence after its zone was set or grew, walking the time index
+// from the foreshock window onwards.
+static void backfill_sequence(EtasSequence *sequence, long long mainshock_ms) {
+    sequence->count = 0;
+    long long earliest = mainshock_ms - (long long)(ETAS_FORESHOCK_DAYS * MS_PER_DAY);
+    IndexCursor cursor;
+    uint64_t seq;
+    index_seek(&cursor, INDEX_TIME, earliest, INFINITY, 0);
+    while (index_next(&cursor, &seq)) {
+        uint64_t slot = catalog_slot(seq);
+        if (!in_zone(sequence, seq)) continue;
+        add_member(sequence, seq, g_catalog.time_ms[slot] / MS_PER_DAY, g_catalog.mag[slot]);
+    }
+    sequence->dirty = 1;
+}
+
+static void set_mainshock(EtasSequence *sequence, uint64_t seq, const char *place) {
+    uint64_t slot = catalog_slot(seq);
+    memcpy(sequence->mainshock_id, g_catalog.id[slot], CATALOG_ID_LEN);
+    strncpy(sequence->place, place ? place : "", sizeof(sequence->place) - 1);
+    sequence->place[sizeof(sequence->place) - 1] = '\0';
+    sequence->mainshock_mag = g_catalog.mag[slot];
+    sequence->lat = g_catalog.lat[slot];
+    sequence->lon = g_catalog.lon[slot];
+    sequence->radius_km = zone_radius_km(g_catalog.mag[slot]);
+    backfill_sequence(sequence, g_catalog.time_ms[slot]);
+}
+
+static void free_sequence(EtasSequence *sequence) {
+    free(sequence->time_days);
+    free(sequence->mag);
+    free(sequence->seq);
+    memset(sequence, 0, sizeof(*sequence));
+}
+
+void etas_on_event(uint64_t seq, const char *place) {
+    uint64_t slot = catalog_slot(seq);
+    float mag = g_catalog.mag[slot];
+    long long time_ms = g_catalog.time_ms[slot];
+    int joined = 0;
+
+    for (int s = 0; s < g_sequence_count; s++) {
+        EtasSequence *sequence = &g_sequences[s];
+        if (!in_zone(sequence, seq)) continue;
+        joined = 1;
+        if (mag >= ETAS_MAINSHOCK_MAGNITUDE && time_ms > sequence->last_large_ms) sequence->last_large_ms = time_ms;
+        if (mag > sequence->mainshock_mag) {
+            set_mainshock(sequence, seq, place); // Re-centres and refills, including this event
+        } else {
+            add_member(sequence, seq, time_ms / MS_PER_DAY, mag);
+        }
+    }
+    if (joined || mag < ETAS_MAINSHOCK_MAGNITUDE) return;
+
+    // Open a new sequence, replacing the one that has been quiet longest
+    int target = g_sequence_count;
+    if (g_sequence_count == MAX_SEQUENCES) {
+        target = 0;
+        for (int s = 1; s < g_sequence_count; s++) {
+            if (g_sequences[s].last_large_ms < g_sequences[target].last_large_ms) target = s;
+        }
+        free_sequence(&g_sequences[target]);
+    } else {
+        g_sequence_count++;
+    }
+    EtasSequence *sequence = &g_sequences[target];
+    memset(sequence, 0, sizeof(*sequence));
+    sequence->last_large_ms = time_ms;
+    set_mainshock(sequence, seq, place);
+}
+
+void etas_on_revision(uint64_t seq) {
+    uint64_t slot = catalog_slot(seq);
+    for (int s = 0; s < g_sequence_count; s++) {
+        EtasSequence *sequence = &g_sequences[s];
+        for (int i = 0; i < sequence->count; i++) {
+            if (sequence->seq[i] != seq) continue;
+            sequence->mag[i] = g_catalog.mag[slot];
+            sequence->time_days[i] = g_catalog.time_ms[slot] / MS_PER_DAY;
+            sequence->dirty = 1;
+            break;
+        }
+    }
+}
+
+// --- Direct Triggering ---
+
+// Integral of the Omori kernel (s + c)^-p over [0, s], up to a constant
+static inline float omori_integral(float s) {
+    return fast_powf(s + (float)ETAS_C_DAYS, (float)(1.0 - ETAS_P)) / (float)(1.0 - ETAS_P);
+}
+
+// Expected number of direct aftershocks (M >= Mref) each event triggers
+// within the horizon, summed in fixed-width batches that vectorize.
+// Columns must be padded to a multiple of ETAS_BATCH.
+static double direct_rates(const float *restrict mag, const float *restrict elapsed, float *restrict rate,
+                           int count, float horizon_days) {
+    double total = 0.0;
+    for (int base = 0; base < count; base += ETAS_BATCH) {
+        float batch_total = 0.0f;
+        for (int k = 0; k < ETAS_BATCH; k++) {
+            int i = base + k;
+            float productivity = (float)ETAS_K * fast_exp2f((float)ETAS_ALPHA * (mag[i] - (float)ETAS_REF_MAGNITUDE) * LOG2_10);
+            float window = omori_integral(elapsed[i] + horizon_days) - omori_integral(elapsed[i]);
+            rate[i] = productivity * window;
+            batch_total += rate[i];
+        }
+        total += batch_total;
+    }
+    return total;
+}
+
+// --- Monte Carlo Cascades ---
+
+static inline uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state; // xorshift64*
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+static inline double uniform(uint64_t *state) {
+    return ((next_random(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0); // In (0, 1)
+}
+
+static int poisson(uint64_t *state, double mean) {
+    if (mean <= 0) return 0;
+    if (mean > 30.0) {
+        // Normal approximation for large means
+        double z = sqrt(-2.0 * log(uniform(state))) * cos(2.0 * M_PI * uniform(state));
+        double n = floor(mean + sqrt(mean) * z + 0.5);
+        return n > 0 ? (int)n : 0;
+    }
+    double limit = exp(-mean), product = uniform(state);
+    int n = 0;
+    while (product > limit) {
+        product *= uniform(state);
+        n++;
+    }
+    return n;
+}
+
+static double sample_magnitude(uint64_t *state) {
+    double tail = 1.0 - pow(10.0, -ETAS_B * (ETAS_MAX_MAGNITUDE - ETAS_REF_MAGNITUDE));
+    return ETAS_REF_MAGNITUDE - log10(1.0 - uniform(state) * tail) / ETAS_B;
+}
+
+// Time since the parent, drawn from the Omori kernel truncated to [from, to]
+static double sample_delay(uint64_t *state, double from, double to) {
+    double q = 1.0 - ETAS_P;
+    double a = pow(from + ETAS_C_DAYS, q), b = pow(to + ETAS_C_DAYS, q);
+    double u = uniform(state);
+    return pow((1.0 - u) * a + u * b, 1.0 / q) - ETAS_C_DAYS;
+}
+
+static double child_rate(double mag, double remaining_days) {
+    double productivity = ETAS_K * pow(10.0, ETAS_ALPHA * (mag - ETAS_REF_MAGNITUDE));
+    double q = 1.0 - ETAS_P;
+    return productivity * (pow(remaining_days + ETAS_C_DAYS, q) - pow(ETAS_C_DAYS, q)) / q;
+}
+
+// One simulated future: does any event reach the target magnitude?
+static int simulate_run(const SimulationInput *input, uint64_t *state, double *stack_time, float *stack_mag) {
+    double total = input->cumulative_rate[input->parents - 1];
+    int depth = 0;
+    int children = poisson(state, total);
+    for (int n = 0; n < children; n++) {
+        // Pick the parent in proportion to its expected children
+        double pick = uniform(state) * total;
+        int lo = 0, hi = input->parents - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (input->cumulative_rate[mid] < pick) lo = mid + 1;
+            else hi = mid;
+        }
+        double elapsed = input->elapsed[lo];
+        double mag = sample_magnitude(state);
+        if (mag >= input->target_mag) return 1;
+        if (depth < ETAS_MAX_CASCADE) {
+            stack_time[depth] = sample_delay(state, elapsed, elapsed + input->horizon_days) - elapsed;
+            stack_mag[depth++] = (float)mag;
+        }
+    }
+    // Secondary generations, each confined to what is left of the horizon
+    while (depth > 0) {
+        depth--;
+        double offset = stack_time[depth];
+        double remaining = input->horizon_days - offset;
+        int grandchildren = poisson(state, child_rate(stack_mag[depth], remaining));
+        for (int n = 0; n < grandchildren; n++) {
+            double mag = sample_magnitude(state);
+            if (mag >= input->target_mag) return 1;
+            if (depth < ETAS_MAX_CASCADE) {
+                stack_time[depth] = offset + sample_delay(state, 0.0, remaining);
+                stack_mag[depth++] = (float)mag;
+            }
+        }
+    }
+    return 0;
+}
+
+static void *simulation_worker(void *arg) {
+    SimulationTask *task = arg;
+    double *stack_time = malloc(ETAS_MAX_CASCADE * sizeof(double));
+    float *stack_mag = malloc(ETAS_MAX_CASCADE * sizeof(float));
+    uint64_t state = task->seed | 1;
+    task->hits = 0;
+    if (stack_time && stack_mag) {
+        for (int r = 0; r < task->runs; r++) task->hits += simulate_run(task->input, &state, stack_time, stack_mag);
+    }
+    free(stack_time);
+    free(stack_mag);
+    return NULL;
+}
+
+static int simulation_threads() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    return cores > ETAS_MAX_THREADS ? ETAS_MAX_THREADS : (int)cores;
+}
+
+// --- Forecasting ---
+
+static void forecast_sequence(EtasSequence *sequence, long long now_ms, int threads, int runs) {
+    static float *mag, *elapsed, *rate;
+    static double *cumulative;
+    static int scratch_capacity = 0;
+    int padded = (sequence->count + ETAS_BATCH - 1) / ETAS_BATCH * ETAS_BATCH;
+    if (padded > scratch_capacity) {
+        free(mag); free(elapsed); free(rate); free(cumulative);
+        mag = malloc(padded * sizeof(float));
+        elapsed = malloc(padded * sizeof(float));
+        rate = malloc(padded * sizeof(float));
+        cumulative = malloc(padded * sizeof(double));
+        scratch_capacity = (mag && elapsed && rate && cumulative) ? padded : 0;
+        if (!scratch_capacity) return;
+    }
+
+    // Completeness: the feed only carries small events in some regions
+    float completeness = (float)ETAS_REF_MAGNITUDE;
+    float smallest = 10.0f;
+    for (int i = 0; i < sequence->count; i++) if (sequence->mag[i] < smallest) smallest = sequence->mag[i];
+    if (smallest > completeness && smallest < 10.0f) completeness = smallest;
+
+    double now_days = now_ms / MS_PER_DAY;
+    int n = 0;
+    for (int i = 0; i < sequence->count; i++) {
+        if (sequence->mag[i] < completeness || sequence->time_days[i] > now_days) continue;
+        mag[n] = sequence->mag[i];
+        elapsed[n] = (float)(now_days - sequence->time_days[i]);
+        n++;
+    }
+    for (int i = n; i < padded; i++) {
+        mag[i] = 0.0f;   // Padding lanes trigger (almost) nothing
+        elapsed[i] = 1e6f;
+    }
+
+    double horizon_days = ETAS_HORIZON_HOURS / 24.0;
+    double total = direct_rates(mag, elapsed, rate, padded, (float)horizon_days);
+    double running = 0.0;
+    for (int i = 0; i < n; i++) {
+        running += rate[i];
+        cumulative[i] = running;
+    }
+    sequence->completeness_mag = completeness;
+    sequence->expected_target = total * pow(10.0, -ETAS_B * (ETAS_TARGET_MAGNITUDE - ETAS_REF_MAGNITUDE));
+    sequence->computed_ms = now_ms;
+    sequence->dirty = 0;
+    if (n == 0 || running <= 0) {
+        sequence->probability = 0.0;
+        return;
+    }
+
+    SimulationInput input = { n, cumulative, elapsed, horizon_days, ETAS_TARGET_MAGNITUDE };
+    SimulationTask tasks[ETAS_MAX_THREADS];
+    pthread_t ids[ETAS_MAX_THREADS];
+    int started[ETAS_MAX_THREADS];
+    int hits = 0;
+    for (int t = 0; t < threads; t++) {
+        tasks[t].input = &input;
+        tasks[t].runs = runs / threads + (t < runs % threads);
+        tasks[t].seed = 0x9E3779B97F4A7C15ULL * (uint64_t)(t + 1) ^ (uint64_t)now_ms;
+        started[t] = (t > 0) && pthread_create(&ids[t], NULL, simulation_worker, &tasks[t]) == 0;
+    }
+    simulation_worker(&tasks[0]); // The calling thread does the first share
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(ids[t], NULL);
+        else simulation_worker(&tasks[t]);
+    }
+    for (int t = 0; t < threads; t++) hits += tasks[t].hits;
+    sequence->probability = (double)hits / runs;
+}
+
+void etas_update(long long now_ms) {
+    long long window_ms = (long long)(ETAS_WINDOW_DAYS * MS_PER_DAY);
+    for (int s = 0; s < g_sequence_count; s++) {
+        if (now_ms - g_sequences[s].last_large_ms <= window_ms) continue;
+        free_sequence(&g_sequences[s]);
+        g_sequences[s] = g_sequences[--g_sequence_count];
+        memset(&g_sequences[g_sequence_count], 0, sizeof(EtasSequence));
+        s--;
+    }
+    int threads = simulation_threads();
+    for (int s = 0; s < g_sequence_count; s++) {
+        EtasSequence *sequence = &g_sequences[s];
+        if (sequence->dirty || now_ms - sequence->computed_ms >= ETAS_REFRESH_SECONDS * 1000LL) {
+            forecast_sequence(sequence, now_ms, threads, ETAS_SIMULATIONS);
+        }
+    }
+}
+
+// --- Benchmark ---
+
+// Times forecasts for a synthetic M7.2 sequence with the given number of
+// events spread over two days.
+int etas_benchmark(int events) {
+    EtasSequence sequence;
+    memset(&sequence, 0, sizeof(sequence));
+    uint64_t state = 12345;
+    long long now_ms = (long long)time(NULL) * 1000;
+    double now_days = now_ms / MS_PER_DAY;
+    double span_days = 2.0;
+
+    add_member(&sequence, 0, now_days - span_days, 7.2f);
+    for (int i = 1; i < events; i++) {
+        double delay = sample_delay(&state, 0.0, span_days);
+        add_member(&sequence, i, now_days - span_days + delay, (float)sample_magnitude(&state));
+    }
+    printf("ETAS benchmark: %d-event sequence, %d simulations per forecast\n\n", sequence.count, ETAS_SIMULATIONS);
+
+    struct timespec start;
+    static float mag[1 << 20], elapsed[1 << 20], rate[1 << 20];
+    int padded = (sequence.count + ETAS_BATCH - 1) / ETAS_BATCH * ETAS_BATCH;
+    if (padded > (1 << 20)) padded = 1 << 20;
+    for (int i = 0; i < padded; i++) {
+        mag[i] = i < sequence.count ? sequence.mag[i] : 0.0f;
+        elapsed[i] = i < sequence.count ? (float)(now_days - sequence.time_days[i]) : 1e6f;
+    }
+    const int repeats = 1000;
+    double total = 0.0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) total += direct_rates(mag, elapsed, rate, padded, ETAS_HORIZON_HOURS / 24.0f);
+    double kernel_ms = elapsed_us(&start) / 1e3 / repeats;
+    printf("Kernel sum:          %8.3f ms (%.1f ns/event, %.1f expected M%.1f+ aftershocks)\n",
+           kernel_ms, kernel_ms * 1e6 / sequence.count, total / repeats, ETAS_REF_MAGNITUDE);
+
+    int max_threads = simulation_threads();
+    double single_ms = 0.0;
+    for (int threads = 1;; threads = (threads * 2 < max_threads) ? threads * 2 : max_threads) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        forecast_sequence(&sequence, now_ms, threads, ETAS_SIMULATIONS);
+        double ms = elapsed_us(&start) / 1e3;
+        if (threads == 1) single_ms = ms;
+        printf("Forecast, %2d thread%s %8.3f ms (%.2fx)  P(M%.1f+ in %dh) = %.1f%%\n", threads, threads == 1 ? ": " : "s:",
+               ms, single_ms / ms, ETAS_TARGET_MAGNITUDE, ETAS_HORIZON_HOURS, sequence.probability * 100.0);
+        if (threads == max_threads) break;
+    }
+
+    // A new event only dirties its own sequence
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    add_member(&sequence, events, now_days, 3.1f);
+    forecast_sequence(&sequence, now_ms, max_threads, ETAS_SIMULATIONS);
+    printf("Incremental update:  %8.3f ms after one new event\n", elapsed_us(&start) / 1e3);
+
+    free_sequence(&sequence);
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * etas.h - Short-term aftershock forecasts for active sequences
+ *
+ * A sequence opens around every M5+ event and collects later events inside
+ * its aftershock zone. Each one gets an ETAS (epidemic-type aftershock
+ * sequence) forecast of the chance of a further large event within the
+ * horizon: direct triggering from every observed event is a vectorized
+ * kernel sum, and secondary cascades are Monte Carlo simulated on all cores.
+ *
+ * Forecasts are only recomputed for sequences that gained or revised events,
+ * or whose last forecast has gone stale.
+ */
+
+#ifndef ETAS_H
+#define ETAS_H
+
+#include <stdint.h>
+#include "catalog.h"
+
+#define ETAS_MAINSHOCK_MAGNITUDE 5.0 // Events this large open a sequence
+#define ETAS_TARGET_MAGNITUDE 5.0    // Forecast the chance of one of these
+#define ETAS_HORIZON_HOURS 24
+#define ETAS_WINDOW_DAYS 7           // Sequences close this long after their last large event
+#define ETAS_SIMULATIONS 10000
+#define ETAS_REFRESH_SECONDS 600     // Recompute quiet sequences this often as rates decay
+#define MAX_SEQUENCES 16
+
+typedef struct {
+    char mainshock_id[CATALOG_ID_LEN];
+    char place[96];
+    float mainshock_mag;
+    double lat;
+    double lon;
+    double radius_km;
+    long long last_large_ms; // Time of the latest event that could open a sequence
+    // Members, column-wise
+    int count;
+    int capacity;
+    double *time_days;
+    float *mag;
+    uint64_t *seq;
+    // Forecast
+    int dirty;
+    long long computed_ms;
+    float completeness_mag;
+    double expected_target; // Expected number of target-size events
+    double probability;     // Chance of at least one
+} EtasSequence;
+
+extern EtasSequence g_sequences[MAX_SEQUENCES];
+extern int g_sequence_count;
+
+void etas_on_event(uint64_t seq, const char *place);
+void etas_on_revision(uint64_t seq);
+void etas_update(long long now_ms);
+int etas_benchmark(int events);
+
+#endif // ETAS_H
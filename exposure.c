@@ -0,0 +1,238 @@
+/*
+ * exposure.c - Population and asset exposure from a gridded raster
+ *
+ * exposure_load() accepts either an ESRI ASCII grid (the format GPW is
+ * distributed in) or a summed-area table file. An ASCII grid is converted
+ * once, row by row, into "<path>.sat" next to it; later runs map that file
+ * directly.
+ *
+ * Summed-area table file format, native byte order:
+ *   char     magic[4]   "EXSA"
+ *   uint32_t version    1
+ *   uint32_t cols, rows
+ *   double   xll, yll   lower-left corner of the grid (degrees)
+ *   double   cellsize   degrees
+ *   (padding to 64 bytes)
+ *   double   sat[rows + 1][cols + 1]
+ *
+ * sat[r][c] is the sum of all cells north of row r and west of column c,
+ * with row 0 at the northern edge.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "exposure.h"
+
+#define SAT_HEADER_SIZE 64
+#define KM_PER_DEG 111.195
+#define MIN_COS_LAT 0.01 // Keeps boxes finite near the poles
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t cols;
+    uint32_t rows;
+    double xll;
+    double yll;
+    double cellsize;
+} SatHeader;
+
+// --- Globals ---
+static SatHeader g_header;
+static const double *g_sat = NULL;
+
+// --- Building ---
+
+// Streams an ESRI ASCII grid into a summed-area table file.
+static int build_sat_file(const char *asc_path, const char *sat_path) {
+    FILE *in = fopen(asc_path, "r");
+    if (!in) {
+        fprintf(stderr, "Could not open exposure grid %s\n", asc_path);
+        return -1;
+    }
+
+    SatHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "EXSA", 4);
+    header.version = 1;
+    double nodata = -9999.0;
+    int center_registered = 0;
+    char key[32];
+    double value;
+    // Header lines are "<key> <value>"; the first numeric token starts the data
+    for (;;) {
+        long pos = ftell(in);
+        if (fscanf(in, "%31s", key) != 1) break;
+        if ((key[0] >= '0' && key[0] <= '9') || key[0] == '-' || key[0] == '.') {
+            fseek(in, pos, SEEK_SET);
+            break;
+        }
+        if (fscanf(in, "%lf", &value) != 1) break;
+        if (strcasecmp(key, "ncols") == 0) header.cols = (uint32_t)value;
+        else if (strcasecmp(key, "nrows") == 0) header.rows = (uint32_t)value;
+        else if (strcasecmp(key, "xllcorner") == 0) header.xll = value;
+        else if (strcasecmp(key, "yllcorner") == 0) header.yll = value;
+        else if (strcasecmp(key, "xllcenter") == 0) { header.xll = value; center_registered |= 1; }
+        else if (strcasecmp(key, "yllcenter") == 0) { header.yll = value; center_registered |= 2; }
+        else if (strcasecmp(key, "cellsize") == 0) header.cellsize = value;
+        else if (strcasecmp(key, "nodata_value") == 0) nodata = value;
+    }
+    if (center_registered & 1) header.xll -= header.cellsize / 2;
+    if (center_registered & 2) header.yll -= header.cellsize / 2;
+    if (header.cols == 0 || header.rows == 0 || header.cellsize <= 0) {
+        fprintf(stderr, "Exposure grid %s has an invalid header\n", asc_path);
+        fclose(in);
+        return -1;
+    }
+
+    char tmp_path[4096 + 8]; // sat_path is at most 4095 bytes, see exposure_load()
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", sat_path);
+    FILE *out = fopen(tmp_path, "wb");
+    double *row_sat = calloc(header.cols + 1, sizeof(double));
+    if (!out || !row_sat) {
+        fprintf(stderr, "Could not create %s\n", tmp_path);
+        if (out) fclose(out);
+        free(row_sat);
+        fclose(in);
+        return -1;
+    }
+    unsigned char padded[SAT_HEADER_SIZE] = {0};
+    memcpy(padded, &header, sizeof(header));
+    fwrite(padded, 1, SAT_HEADER_SIZE, out);
+
+    // Each output row is the previous one plus this row's running prefix sum
+    int ok = fwrite(row_sat, sizeof(double), header.cols + 1, out) == header.cols + 1;
+    for (uint32_t r = 0; r < header.rows && ok; r++) {
+        double prefix = 0.0;
+        for (uint32_t c = 0; c < header.cols; c++) {
+            double cell;
+            if (fscanf(in, "%lf", &cell) != 1) {
+                fprintf(stderr, "Exposure grid %s ends early at row %u\n", asc_path, r);
+                ok = 0;
+                break;
+            }
+            if (cell == nodata || cell < 0) cell = 0.0;
+            prefix += cell;
+            row_sat[c + 1] += prefix;
+        }
+        if (ok) ok = fwrite(row_sat, sizeof(double), header.cols + 1, out) == header.cols + 1;
+    }
+    free(row_sat);
+    fclose(in);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok || rename(tmp_path, sat_path) != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// --- Loading ---
+
+static int map_sat_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < SAT_HEADER_SIZE) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    SatHeader header;
+    memcpy(&header, map, sizeof(header));
+    off_t needed = SAT_HEADER_SIZE + (off_t)(header.rows + 1) * (header.cols + 1) * sizeof(double);
+    if (memcmp(header.magic, "EXSA", 4) != 0 || header.version != 1 || needed > st.st_size) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    g_header = header;
+    g_sat = (const double *)((const char *)map + SAT_HEADER_SIZE);
+    return 0;
+}
+
+int exposure_load(const char *path) {
+    if (map_sat_file(path) == 0) return 0;
+
+    // Not a table itself: use (or build) the cached table beside the grid
+    char sat_path[4096];
+    if (snprintf(sat_path, sizeof(sat_path), "%s.sat", path) >= (int)sizeof(sat_path)) {
+        fprintf(stderr, "Exposure grid path is too long: %s\n", path);
+        return -1;
+    }
+    struct stat grid_st, sat_st;
+    int cached = stat(sat_path, &sat_st) == 0 && stat(path, &grid_st) == 0 && sat_st.st_mtime >= grid_st.st_mtime;
+    if (!cached) {
+        fprintf(stderr, "Building exposure table %s...\n", sat_path);
+        if (build_sat_file(path, sat_path) != 0) return -1;
+    }
+    if (map_sat_file(sat_path) != 0) {
+        fprintf(stderr, "Could not map exposure table %s\n", sat_path);
+        return -1;
+    }
+    return 0;
+}
+
+int exposure_available() {
+    return g_sat != NULL;
+}
+
+// --- Queries ---
+
+// Table value at a fractional grid position, interpolated so partially
+// covered cells count in proportion to their overlap.
+static double sat_at(double row, double col) {
+    if (row < 0) row = 0;
+    if (col < 0) col = 0;
+    if (row > g_header.rows) row = g_header.rows;
+    if (col > g_header.cols) col = g_header.cols;
+    uint32_t r = (uint32_t)row, c = (uint32_t)col;
+    if (r >= g_header.rows) r = g_header.rows - 1;
+    if (c >= g_header.cols) c = g_header.cols - 1;
+    double fr = row - r, fc = col - c;
+    size_t stride = g_header.cols + 1;
+    const double *p = g_sat + r * stride + c;
+    double top = p[0] + fc * (p[1] - p[0]);
+    double bottom = p[stride] + fc * (p[stride + 1] - p[stride]);
+    return top + fr * (bottom - top);
+}
+
+static double box_sum_unwrapped(double lat_min, double lat_max, double lon_min, double lon_max) {
+    double north = g_header.yll + g_header.rows * g_header.cellsize;
+    double r0 = (north - lat_max) / g_header.cellsize;
+    double r1 = (north - lat_min) / g_header.cellsize;
+    double c0 = (lon_min - g_header.xll) / g_header.cellsize;
+    double c1 = (lon_max - g_header.xll) / g_header.cellsize;
+    return sat_at(r1, c1) - sat_at(r0, c1) - sat_at(r1, c0) + sat_at(r0, c0);
+}
+
+double exposure_box_sum(double lat_min, double lat_max, double lon_min, double lon_max) {
+    if (!g_sat) return 0.0;
+    // Boxes hanging over the antimeridian pick up the other side of the grid;
+    // the parts outside the grid clamp to zero
+    return box_sum_unwrapped(lat_min, lat_max, lon_min, lon_max)
+         + box_sum_unwrapped(lat_min, lat_max, lon_min + 360.0, lon_max + 360.0)
+         + box_sum_unwrapped(lat_min, lat_max, lon_min - 360.0, lon_max - 360.0);
+}
+
+// Sum over the square with the same area as the circle of the given radius.
+double exposure_within_radius(double lat, double lon, double radius_km) {
+    if (!g_sat || radius_km <= 0) return 0.0;
+    double half_side_km = radius_km * sqrt(M_PI) / 2.0;
+    double dlat = half_side_km / KM_PER_DEG;
+    double cos_lat = cos(lat * M_PI / 180.0);
+    double dlon = dlat / (cos_lat > MIN_COS_LAT ? cos_lat : MIN_COS_LAT);
+    if (dlon > 180.0) dlon = 180.0;
+    return exposure_box_sum(lat - dlat, lat + dlat, lon - dlon, lon + dlon);
+}
@@ -0,0 +1,17 @@
+/*
+ * exposure.h - Population and asset exposure from a gridded raster
+ *
+ * Loads a GPW-style population (or asset density) grid and answers "how
+ * much lies within this box or radius" in O(1) through a summed-area table
+ * that is memory-mapped from disk.
+ */
+
+#ifndef EXPOSURE_H
+#define EXPOSURE_H
+
+int exposure_load(const char *path);
+int exposure_available();
+double exposure_box_sum(double lat_min, double lat_max, double lon_min, double lon_max);
+double exposure_within_radius(double lat, double lon, double radius_km);
+
+#endif // EXPOSURE_H
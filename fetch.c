@@ -0,0 +1,151 @@
+/*
+ * fetch.c - Feed and forecast requests
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curl/curl.h>
+#include "fetch.h"
+#include "monitor.h"
+#include "quakes.h"
+#include "lightning.h"
+#include "strikes.h"
+#include "proxy.h"
+#include "relay.h"
+#include "hostcache.h"
+#include "shard.h"
+#include "alerts.h"
+
+#define FORECAST_TIMEOUT_SECONDS 20 // Longest one forecast request may take
+
+// --- Requests ---
+
+size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
+    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
+    if (!ptr) {
+        fprintf(stderr, "Not enough memory (realloc returned NULL)\n");
+        return 0;
+    }
+    mem->memory = ptr;
+    memcpy(&(mem->memory[mem->size]), contents, realsize);
+    mem->size += realsize;
+    mem->memory[mem->size] = 0;
+    return realsize;
+}
+
+// Hands a good response to the LAN proxy, which serves it on from memory.
+static void share_response(CURL *curl_handle, const char *url, const struct MemoryStruct *chunk) {
+    long status = 0;
+    if (!g_proxy_port) return;
+    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &status);
+    if (status == 200) proxy_store(url, chunk->memory, chunk->size);
+}
+
+// --- Quake Feed ---
+
+void fetch_seismic_data(float min_magnitude, float alert_threshold) {
+    struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
+    long long now_ms = (long long)time(NULL) * 1000;
+    g_quake_count = 0;
+    memset(g_region_counts, 0, sizeof(g_region_counts));
+    expire_catalog(now_ms);
+
+    char url_buffer[256];
+    snprintf(url_buffer, sizeof(url_buffer), USGS_URL_FORMAT, g_feed);
+
+    // Another monitor on this host may have fetched it this interval, or
+    // be fetching it now
+    HostCacheTicket ticket;
+    char *shared;
+    size_t shared_length;
+    HostCacheResult cached = hostcache_get(url_buffer, UPDATE_INTERVAL_SECONDS, &shared, &shared_length, &ticket);
+    if (cached != HOSTCACHE_FETCH) {
+        if (cached == HOSTCACHE_HIT) {
+            if (g_proxy_port) proxy_store(url_buffer, shared, shared_length);
+            process_seismic_data(shared, now_ms, min_magnitude, alert_threshold);
+            relay_end_cycle(now_ms);
+            free(shared);
+        }
+        free(chunk.memory);
+        return;
+    }
+
+    CURL *curl_handle = curl_easy_init();
+    long status = 0;
+    if (curl_handle) {
+        curl_easy_setopt(curl_handle, CURLOPT_URL, url_buffer);
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_memory_callback);
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
+        curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+        if (curl_easy_perform(curl_handle) == CURLE_OK) curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &status);
+        if (status == 200) { // An error page is not a feed
+            hostcache_put(&ticket, url_buffer, chunk.memory, chunk.size);
+            share_response(curl_handle, url_buffer, &chunk);
+            process_seismic_data(chunk.memory, now_ms, min_magnitude, alert_threshold);
+            relay_end_cycle(now_ms);
+        }
+        curl_easy_cleanup(curl_handle);
+    }
+    if (status != 200) hostcache_fail(&ticket);
+    free(chunk.memory);
+}
+
+// --- Forecasts ---
+
+// Fetches the forecasts gone stale from source, a batch of cells per call.
+// Starts no request after give_up (Unix time, 0 for none); the cells left
+// stale are fetched next time.
+void refresh_forecasts(long long now, ForecastSource source, long long give_up) {
+    static int stale[LIGHTNING_MAX_CELLS];
+    char url_buffer[LIGHTNING_URL_LEN];
+    int stale_count = lightning_begin_update(now, stale, LIGHTNING_MAX_CELLS);
+    for (int first = 0; first < stale_count && (!give_up || time(NULL) < give_up); first += LIGHTNING_BATCH_SITES) {
+        int count = stale_count - first < LIGHTNING_BATCH_SITES ? stale_count - first : LIGHTNING_BATCH_SITES;
+        if (lightning_build_url(url_buffer, sizeof(url_buffer), stale + first, count) != 0) continue;
+        size_t length;
+        char *body = source(url_buffer, count, now, &length);
+        if (!body) continue;
+        lightning_parse(body, length, stale + first, count, now);
+        free(body);
+    }
+}
+
+// Requests one batch of forecasts, over a connection kept between calls.
+char *fetch_forecast(const char *url, int count, long long now, size_t *length) {
+    static CURL *curl_handle = NULL;
+    if (!curl_handle && !(curl_handle = curl_easy_init())) return NULL;
+    struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
+    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
+    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_memory_callback);
+    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
+    curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT, (long)FORECAST_TIMEOUT_SECONDS);
+    long status = 0;
+    if (curl_easy_perform(curl_handle) == CURLE_OK) curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &status);
+    if (status != 200) { // An error page is not a forecast
+        free(chunk.memory);
+        return NULL;
+    }
+    share_response(curl_handle, url, &chunk);
+    *length = chunk.size;
+    return chunk.memory;
+}
+
+// Fetches the storm forecast for every grid cell whose cached forecast has
+// gone stale, one batch of cells per request, and reassesses the levels.
+void fetch_lightning_data() {
+    long long now = time(NULL);
+    if (g_shard_count) refresh_shards(now); // Comes on below if the last worker was dropped
+    if (g_shard_count) {
+        check_for_storm_alerts();
+        return;
+    }
+    refresh_forecasts(now, fetch_forecast, 0);
+    if (g_strike_feed) strikes_update(now);
+    lightning_assess(now);
+    check_for_storm_alerts();
+}
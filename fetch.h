@@ -0,0 +1,32 @@
+/*
+ * fetch.h - Feed and forecast requests
+ *
+ * The quake feed is fetched once an update, unless another monitor on this
+ * host already has it, and every good response is handed to the LAN proxy
+ * when one is serving. Storm forecasts are fetched for the stale grid
+ * cells only, a batch per request, over a connection kept between updates.
+ */
+
+#ifndef FETCH_H
+#define FETCH_H
+
+#include <stddef.h>
+
+#define UPDATE_INTERVAL_SECONDS 120 // Update every 2 minutes
+#define USGS_URL_FORMAT "https://earthquake.usgs.gov/earthquakes/feed/v1.0/summary/all_%s.geojson"
+
+struct MemoryStruct {
+    char *memory;
+    size_t size;
+};
+
+// Fetches one forecast request for count cells; returns a malloc'd body or NULL
+typedef char *(*ForecastSource)(const char *url, int count, long long now, size_t *length);
+
+size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp);
+void fetch_seismic_data(float min_magnitude, float alert_threshold);
+void fetch_lightning_data();
+void refresh_forecasts(long long now, ForecastSource source, long long give_up);
+char *fetch_forecast(const char *url, int count, long long now, size_t *length);
+
+#endif // FETCH_H
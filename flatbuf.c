@@ -0,0 +1,211 @@
+/*
+ * flatbuf.c - Minimal FlatBuffers builder and reader
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "flatbuf.h"
+
+// --- Builder ---
+
+static int fb_reserve(FbBuilder *b, size_t bytes) {
+    if (b->size + bytes <= b->capacity) return 0;
+    size_t capacity = b->capacity ? b->capacity * 2 : 1024;
+    while (capacity < b->size + bytes) capacity *= 2;
+    uint8_t *grown = malloc(capacity);
+    if (!grown) {
+        b->failed = 1;
+        return -1;
+    }
+    if (b->size) memcpy(grown + capacity - b->size, b->data + b->capacity - b->size, b->size);
+    free(b->data);
+    b->data = grown;
+    b->capacity = capacity;
+    return 0;
+}
+
+void fb_push(FbBuilder *b, const void *bytes, size_t length) {
+    if (fb_reserve(b, length) != 0) return;
+    b->size += length;
+    if (bytes) memcpy(b->data + b->capacity - b->size, bytes, length);
+    else memset(b->data + b->capacity - b->size, 0, length);
+}
+
+// Pads so that `additional` more bytes end on an `align` boundary.
+void fb_prep(FbBuilder *b, size_t align, size_t additional) {
+    if (align > b->max_align) b->max_align = align;
+    size_t padding = (align - (b->size + additional) % align) % align;
+    fb_push(b, NULL, padding);
+}
+
+static uint32_t fb_offset_to(const FbBuilder *b, uint32_t target) {
+    return (uint32_t)(b->size + 4 - target);
+}
+
+uint32_t fb_string(FbBuilder *b, const char *text) {
+    uint32_t length = (uint32_t)strlen(text);
+    fb_prep(b, 4, length + 1);
+    fb_push(b, NULL, 1);
+    fb_push(b, text, length);
+    fb_push(b, &length, 4);
+    return (uint32_t)b->size;
+}
+
+uint32_t fb_offset_vector(FbBuilder *b, const uint32_t *targets, int count) {
+    fb_prep(b, 4, 4 * count);
+    for (int i = count - 1; i >= 0; i--) {
+        uint32_t offset = fb_offset_to(b, targets[i]);
+        fb_push(b, &offset, 4);
+    }
+    uint32_t length = count;
+    fb_push(b, &length, 4);
+    return (uint32_t)b->size;
+}
+
+uint32_t fb_struct_vector(FbBuilder *b, const void *structs, int count, size_t size) {
+    fb_prep(b, 8, size * count);
+    fb_push(b, structs, size * count);
+    uint32_t length = count;
+    fb_push(b, &length, 4);
+    return (uint32_t)b->size;
+}
+
+uint32_t fb_table(FbBuilder *b, FbField *fields, int count) {
+    // Widest fields first, so inline padding stays minimal
+    for (int i = 1; i < count; i++) {
+        FbField field = fields[i];
+        int j = i;
+        while (j > 0 && fields[j - 1].size < field.size) {
+            fields[j] = fields[j - 1];
+            j--;
+        }
+        fields[j] = field;
+    }
+
+    size_t start = b->size;
+    size_t positions[FB_MAX_FIELDS] = { 0 };
+    int max_id = -1;
+    for (int i = 0; i < count; i++) {
+        fb_prep(b, fields[i].size, fields[i].size);
+        if (fields[i].is_offset) {
+            uint32_t offset = fb_offset_to(b, (uint32_t)fields[i].value);
+            fb_push(b, &offset, 4);
+        } else {
+            fb_push(b, &fields[i].value, fields[i].size); // Low bytes on a little-endian host
+        }
+        positions[fields[i].id] = b->size;
+        if (fields[i].id > max_id) max_id = fields[i].id;
+    }
+    fb_prep(b, 4, 4);
+    fb_push(b, NULL, 4); // Offset to the vtable, patched below
+    size_t table = b->size;
+
+    uint16_t vtable[2 + FB_MAX_FIELDS];
+    int entries = 2 + max_id + 1;
+    vtable[0] = (uint16_t)(entries * 2);
+    vtable[1] = (uint16_t)(table - start);
+    for (int id = 0; id <= max_id; id++) vtable[2 + id] = positions[id] ? (uint16_t)(table - positions[id]) : 0;
+    fb_prep(b, 2, entries * 2);
+    fb_push(b, vtable, entries * 2);
+    if (b->failed) return 0;
+
+    int32_t to_vtable = (int32_t)(b->size - table);
+    memcpy(b->data + b->capacity - table, &to_vtable, 4);
+    return (uint32_t)table;
+}
+
+void fb_finish(FbBuilder *b, uint32_t root) {
+    fb_prep(b, b->max_align > 8 ? b->max_align : 8, 4);
+    uint32_t offset = fb_offset_to(b, root);
+    fb_push(b, &offset, 4);
+}
+
+const uint8_t *fb_bytes(const FbBuilder *b) {
+    return b->data + b->capacity - b->size;
+}
+
+// --- Reader ---
+
+static uint16_t read_u16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return v;
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Follows the offset stored at pos.
+static uint32_t follow(const FbReader *r, uint32_t pos) {
+    if (pos == 0 || (size_t)pos + 4 > r->size) return 0;
+    uint64_t target = (uint64_t)pos + read_u32(r->data + pos);
+    return target < r->size ? (uint32_t)target : 0;
+}
+
+uint32_t fb_root(const FbReader *r) {
+    if (r->size < 8) return 0;
+    uint32_t root = read_u32(r->data);
+    return root >= 4 && (size_t)root + 4 <= r->size ? root : 0;
+}
+
+// Position of a field's bytes, or 0 when it is absent (left at its default).
+uint32_t fb_field(const FbReader *r, uint32_t table, int id) {
+    if (table == 0 || (size_t)table + 4 > r->size) return 0;
+    int64_t vtable = (int64_t)table - (int32_t)read_u32(r->data + table);
+    if (vtable < 0 || (uint64_t)vtable + 4 > r->size) return 0;
+    uint16_t vtable_size = read_u16(r->data + vtable);
+    size_t entry = 4 + 2 * (size_t)id;
+    if (entry + 2 > vtable_size || (uint64_t)vtable + vtable_size > r->size) return 0;
+    uint16_t offset = read_u16(r->data + vtable + entry);
+    return offset && (size_t)table + offset < r->size ? table + offset : 0;
+}
+
+uint32_t fb_get_table(const FbReader *r, uint32_t table, int id) {
+    uint32_t target = follow(r, fb_field(r, table, id));
+    return target && (size_t)target + 4 <= r->size ? target : 0;
+}
+
+// Position of a vector's first element; count receives its length.
+uint32_t fb_get_vector(const FbReader *r, uint32_t table, int id, size_t element_size, uint32_t *count) {
+    *count = 0;
+    uint32_t vector = follow(r, fb_field(r, table, id));
+    if (!vector || (size_t)vector + 4 > r->size) return 0;
+    uint32_t length = read_u32(r->data + vector);
+    if ((uint64_t)length * element_size > r->size - vector - 4) return 0;
+    *count = length;
+    return vector + 4;
+}
+
+uint32_t fb_vector_table(const FbReader *r, uint32_t elements, uint32_t index) {
+    return follow(r, elements + 4 * index);
+}
+
+static int read_scalar(const FbReader *r, uint32_t table, int id, void *out, size_t size) {
+    uint32_t pos = fb_field(r, table, id);
+    if (!pos || (size_t)pos + size > r->size) return 0;
+    memcpy(out, r->data + pos, size);
+    return 1;
+}
+
+uint8_t fb_get_u8(const FbReader *r, uint32_t table, int id, uint8_t fallback) {
+    uint8_t v;
+    return read_scalar(r, table, id, &v, 1) ? v : fallback;
+}
+
+int32_t fb_get_i32(const FbReader *r, uint32_t table, int id, int32_t fallback) {
+    int32_t v;
+    return read_scalar(r, table, id, &v, 4) ? v : fallback;
+}
+
+int64_t fb_get_i64(const FbReader *r, uint32_t table, int id, int64_t fallback) {
+    int64_t v;
+    return read_scalar(r, table, id, &v, 8) ? v : fallback;
+}
+
+float fb_get_f32(const FbReader *r, uint32_t table, int id, float fallback) {
+    float v;
+    return read_scalar(r, table, id, &v, 4) ? v : fallback;
+}
@@ -0,0 +1,65 @@
+/*
+ * flatbuf.h - Minimal FlatBuffers builder and reader
+ *
+ * Enough of the FlatBuffers wire format for the Arrow export and the
+ * Open-Meteo forecast responses, without the FlatBuffers library. Assumes
+ * a little-endian host, as the format itself does.
+ */
+
+#ifndef FLATBUF_H
+#define FLATBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FB_MAX_FIELDS 16 // Most fields in any table built here
+
+// --- Builder ---
+
+// Bytes grow downwards from the end of data, so children are written
+// before the tables that point at them and every offset points forward.
+typedef struct {
+    uint8_t *data;
+    size_t capacity;
+    size_t size;
+    size_t max_align;
+    int failed;
+} FbBuilder;
+
+typedef struct {
+    int id;
+    int size;       // Bytes of an inline scalar, or 4 for an offset
+    int64_t value;  // Scalar bits, or the position of the referenced object
+    int is_offset;
+} FbField;
+
+void fb_push(FbBuilder *b, const void *bytes, size_t length);
+void fb_prep(FbBuilder *b, size_t align, size_t additional);
+uint32_t fb_string(FbBuilder *b, const char *text);
+uint32_t fb_offset_vector(FbBuilder *b, const uint32_t *targets, int count);
+uint32_t fb_struct_vector(FbBuilder *b, const void *structs, int count, size_t size);
+uint32_t fb_table(FbBuilder *b, FbField *fields, int count);
+void fb_finish(FbBuilder *b, uint32_t root);
+const uint8_t *fb_bytes(const FbBuilder *b);
+
+// --- Reader ---
+
+// Reads fields in place. Every access is bounds checked, so a truncated or
+// hostile buffer reads as missing fields. Positions are byte offsets into
+// data; 0 means absent, since the root offset always occupies it.
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+} FbReader;
+
+uint32_t fb_root(const FbReader *r);
+uint32_t fb_field(const FbReader *r, uint32_t table, int id);
+uint32_t fb_get_table(const FbReader *r, uint32_t table, int id);
+uint32_t fb_get_vector(const FbReader *r, uint32_t table, int id, size_t element_size, uint32_t *count);
+uint32_t fb_vector_table(const FbReader *r, uint32_t elements, uint32_t index);
+uint8_t fb_get_u8(const FbReader *r, uint32_t table, int id, uint8_t fallback);
+int32_t fb_get_i32(const FbReader *r, uint32_t table, int id, int32_t fallback);
+int64_t fb_get_i64(const FbReader *r, uint32_t table, int id, int64_t fallback);
+float fb_get_f32(const FbReader *r, uint32_t table, int id, float fallback);
+
+#endif // FLATBUF_H
@@ -0,0 +1,151 @@
+/*
+ * gmpe.c - Ground-motion estimates for monitored sites
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "gmpe.h"
+#include "fastmath.h"
+
+#define EARTH_RADIUS_KM 6371.0f
+#define DEG_TO_RAD (M_PI / 180.0)
+
+// Atkinson & Wald (2007) coefficients for active crustal regions
+#define AW07_C1 12.27f
+#define AW07_C2 2.270f
+#define AW07_C3 0.1304f
+#define AW07_C4 -1.30f
+#define AW07_C5 -0.0007070f
+#define AW07_C6 1.95f
+#define AW07_C7 -0.577f
+#define AW07_H 14.0f
+#define AW07_RT 30.0f
+
+// Worden et al. (2012) PGA-MMI relation, PGA in cm/s^2
+#define W12_LOG_PGA_SPLIT 1.57f
+#define W12_C1 1.78f
+#define W12_C2 1.55f
+#define W12_C3 -1.60f
+#define W12_C4 3.70f
+#define GRAVITY_CM_S2 980.665f
+
+// --- Columns ---
+
+static int grow_columns(QuakeColumns *cols, int needed) {
+    int capacity = cols->capacity ? cols->capacity : 64;
+    while (capacity < needed) capacity *= 2;
+    float **arrays[] = { &cols->mag, &cols->depth, &cols->ux, &cols->uy, &cols->uz };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        float *grown = realloc(*arrays[i], capacity * sizeof(float));
+        if (!grown) return -1;
+        *arrays[i] = grown;
+    }
+    cols->capacity = capacity;
+    return 0;
+}
+
+void quake_columns_clear(QuakeColumns *cols) {
+    cols->count = 0;
+}
+
+int quake_columns_push(QuakeColumns *cols, double mag, double depth, double lat, double lon) {
+    // Keep room for a whole padded batch past the last event
+    int padded = (cols->count + GMPE_BATCH) / GMPE_BATCH * GMPE_BATCH;
+    if (padded > cols->capacity && grow_columns(cols, padded) != 0) return -1;
+
+    int i = cols->count++;
+    double phi = lat * DEG_TO_RAD;
+    double lambda = lon * DEG_TO_RAD;
+    cols->mag[i] = (float)mag;
+    cols->depth[i] = depth > 0 ? (float)depth : 0.0f;
+    cols->ux[i] = (float)(cos(phi) * cos(lambda));
+    cols->uy[i] = (float)(cos(phi) * sin(lambda));
+    cols->uz[i] = (float)sin(phi);
+
+    // Padding lanes hold a harmless far-away event, so batches never branch
+    for (int p = cols->count; p < padded; p++) {
+        cols->mag[p] = 0.0f;
+        cols->depth[p] = 0.0f;
+        cols->ux[p] = -cols->ux[i];
+        cols->uy[p] = -cols->uy[i];
+        cols->uz[p] = -cols->uz[i];
+    }
+    return i;
+}
+
+void quake_columns_free(QuakeColumns *cols) {
+    free(cols->mag);
+    free(cols->depth);
+    free(cols->ux);
+    free(cols->uy);
+    free(cols->uz);
+    memset(cols, 0, sizeof(*cols));
+}
+
+// --- Evaluation ---
+
+static inline float aw07_mmi(float mag, float hypo_km) {
+    float R = sqrtf(hypo_km * hypo_km + AW07_H * AW07_H);
+    float log_r = fast_log10f(R);
+    float m6 = mag - 6.0f;
+    float excess = log_r - fast_log10f(AW07_RT);
+    float b = 0.5f * (excess + fabsf(excess)); // max(0, excess) without a branch
+    float value = AW07_C1 + AW07_C2 * m6 + AW07_C3 * m6 * m6 + AW07_C4 * log_r + AW07_C5 * R
+                + AW07_C6 * b + AW07_C7 * mag * log_r;
+    value = 0.5f * (value + 1.0f + fabsf(value - 1.0f)); // Clamp to [1, 10]
+    return 0.5f * (value + 10.0f - fabsf(value - 10.0f));
+}
+
+void gmpe_evaluate_site(const QuakeColumns *cols, double site_lat, double site_lon, float *mmi_out, float *dist_km_out) {
+    const float *restrict mag = cols->mag;
+    const float *restrict depth = cols->depth;
+    const float *restrict ux = cols->ux;
+    const float *restrict uy = cols->uy;
+    const float *restrict uz = cols->uz;
+    double phi = site_lat * DEG_TO_RAD;
+    double lambda = site_lon * DEG_TO_RAD;
+    const float sx = (float)(cos(phi) * cos(lambda));
+    const float sy = (float)(cos(phi) * sin(lambda));
+    const float sz = (float)sin(phi);
+
+    for (int base = 0; base < cols->count; base += GMPE_BATCH) {
+        float mmi[GMPE_BATCH];
+        float dist[GMPE_BATCH];
+        for (int k = 0; k < GMPE_BATCH; k++) {
+            int i = base + k;
+            // Straight-line site-to-hypocentre distance from the chord between
+            // the two unit vectors, which stays accurate at short range
+            float dx = ux[i] - sx, dy = uy[i] - sy, dz = uz[i] - sz;
+            float chord2 = dx * dx + dy * dy + dz * dz;
+            float r = EARTH_RADIUS_KM - depth[i];
+            float hypo = sqrtf(depth[i] * depth[i] + EARTH_RADIUS_KM * r * chord2);
+            mmi[k] = aw07_mmi(mag[i], hypo);
+            dist[k] = hypo;
+        }
+        int lanes = cols->count - base < GMPE_BATCH ? cols->count - base : GMPE_BATCH;
+        memcpy(mmi_out + base, mmi, lanes * sizeof(float));
+        if (dist_km_out) memcpy(dist_km_out + base, dist, lanes * sizeof(float));
+    }
+}
+
+// Epicentral distance (km) out to which an event reaches the given intensity.
+float gmpe_radius_for_mmi(float mag, float depth_km, float mmi) {
+    float lo = 0.0f, hi = GMPE_MAX_RADIUS_KM;
+    if (aw07_mmi(mag, depth_km) < mmi) return 0.0f;
+    if (aw07_mmi(mag, sqrtf(hi * hi + depth_km * depth_km)) >= mmi) return hi;
+    for (int step = 0; step < 24; step++) {
+        float mid = 0.5f * (lo + hi);
+        if (aw07_mmi(mag, sqrtf(mid * mid + depth_km * depth_km)) >= mmi) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+float gmpe_pga_from_mmi(float mmi) {
+    float split = W12_C1 + W12_C2 * W12_LOG_PGA_SPLIT;
+    float log_pga = (mmi <= split) ? (mmi - W12_C1) / W12_C2 : (mmi - W12_C3) / W12_C4;
+    return powf(10.0f, log_pga) / GRAVITY_CM_S2; // In g
+}
@@ -0,0 +1,37 @@
+/*
+ * gmpe.h - Ground-motion estimates for monitored sites
+ *
+ * Predicts Modified Mercalli Intensity at a site from event magnitude and
+ * hypocentral distance (Atkinson & Wald 2007 intensity prediction equation),
+ * and converts it to peak ground acceleration (Worden et al. 2012).
+ *
+ * Events are held column-wise so one site is evaluated against every event
+ * in fixed-width batches the compiler turns into SIMD code.
+ */
+
+#ifndef GMPE_H
+#define GMPE_H
+
+#define GMPE_BATCH 8 // Lanes per batch; columns are padded to a multiple
+#define GMPE_MAX_RADIUS_KM 2000.0f
+
+typedef struct {
+    int count;
+    int capacity;
+    float *mag;
+    float *depth;
+    // Unit vector of the epicentre on the sphere
+    float *ux;
+    float *uy;
+    float *uz;
+} QuakeColumns;
+
+void quake_columns_clear(QuakeColumns *cols);
+int quake_columns_push(QuakeColumns *cols, double mag, double depth, double lat, double lon);
+void quake_columns_free(QuakeColumns *cols);
+
+void gmpe_evaluate_site(const QuakeColumns *cols, double site_lat, double site_lon, float *mmi_out, float *dist_km_out);
+float gmpe_radius_for_mmi(float mag, float depth_km, float mmi);
+float gmpe_pga_from_mmi(float mmi);
+
+#endif // GMPE_H
@@ -0,0 +1,23 @@
+/*
+ * hash.h - FNV-1a, for cache keys and entity tags
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static inline uint64_t hash_bytes(const void *data, size_t length) {
+    const unsigned char *p = data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ p[i]) * 1099511628211ULL;
+    return hash;
+}
+
+static inline uint64_t hash_text(const char *text) {
+    return hash_bytes(text, strlen(text));
+}
+
+#endif // HASH_H
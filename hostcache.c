@@ -0,0 +1,144 @@
+/*
+ * hostcache.c - Feed responses shared by the monitors on one host
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "hostcache.h"
+#include "hash.h"
+
+#define LOCK_POLL_US 20000
+#define COPY_PATH_MAX (HOSTCACHE_PATH_MAX + 5) // With ".body" or ".lock"
+#define TEMP_PATH_MAX (COPY_PATH_MAX + 12)     // With "." and a pid
+
+// Starts every body file, followed by the URL and the body
+typedef struct {
+    char magic[4];
+    uint32_t url_length;
+    int64_t fetched_at; // Unix seconds
+    uint64_t length;
+} CopyHeader;
+
+// --- Globals ---
+HostCacheStats g_hostcache_stats;
+static char g_dir[HOSTCACHE_DIR_MAX]; // Empty while sharing is off
+
+// Uses dir for the shared copies, creating it if need be. Returns -1, and
+// leaves every fetch to the caller, if it is unusable.
+int hostcache_open(const char *dir) {
+    if (strlen(dir) >= sizeof(g_dir) || (mkdir(dir, 0700) != 0 && errno != EEXIST) || access(dir, R_OK | W_OK | X_OK) != 0) {
+        g_dir[0] = '\0';
+        return -1;
+    }
+    snprintf(g_dir, sizeof(g_dir), "%s", dir);
+    return 0;
+}
+
+// Reads the shared copy of url. Returns 0 and a malloc'd, terminated body
+// if there is one.
+static int read_copy(const char *path, const char *url, char **body, size_t *length, int64_t *fetched_at) {
+    CopyHeader header;
+    size_t url_length = strlen(url);
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+    char *data = NULL, *stored_url = malloc(url_length + 1);
+    int ok = stored_url && fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "HCB1", 4) == 0 &&
+             header.url_length == url_length && fread(stored_url, 1, url_length, file) == url_length &&
+             memcmp(stored_url, url, url_length) == 0 && (data = malloc(header.length + 1)) != NULL &&
+             fread(data, 1, header.length, file) == header.length;
+    fclose(file);
+    free(stored_url);
+    if (!ok) { // Missing, torn by a crash, or another URL with the same hash
+        free(data);
+        return -1;
+    }
+    data[header.length] = '\0';
+    *body = data;
+    *length = header.length;
+    *fetched_at = header.fetched_at;
+    return 0;
+}
+
+// Best effort: a lost note only means waiters try upstream themselves.
+static void note_failure(int fd, int64_t failed_at) {
+    if (pwrite(fd, &failed_at, sizeof(failed_at), 0) != sizeof(failed_at)) return;
+}
+
+// Looks for a copy of url younger than max_age_seconds. If there is none,
+// waits until no other monitor is fetching it and looks again; if there
+// still is none, the caller holds the lock and fetches.
+HostCacheResult hostcache_get(const char *url, int max_age_seconds, char **body, size_t *length, HostCacheTicket *ticket) {
+    char path[COPY_PATH_MAX];
+    int64_t fetched_at, failed_at = 0;
+    ticket->fd = -1;
+    if (!g_dir[0]) return HOSTCACHE_FETCH;
+    snprintf(ticket->path, sizeof(ticket->path), "%s/%016llx", g_dir, (unsigned long long)hash_text(url));
+    snprintf(path, sizeof(path), "%s.body", ticket->path);
+    if (read_copy(path, url, body, length, &fetched_at) == 0) {
+        if (time(NULL) - fetched_at < max_age_seconds) {
+            g_hostcache_stats.hits++;
+            return HOSTCACHE_HIT;
+        }
+        free(*body);
+    }
+
+    snprintf(path, sizeof(path), "%s.lock", ticket->path);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600), waited = 0;
+    if (fd < 0) return HOSTCACHE_FETCH;
+    while (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        if ((errno != EWOULDBLOCK && errno != EINTR) || waited >= HOSTCACHE_WAIT_SECONDS * (1000000 / LOCK_POLL_US)) {
+            close(fd); // Fetch without it rather than not at all
+            return HOSTCACHE_FETCH;
+        }
+        usleep(LOCK_POLL_US);
+        waited++;
+    }
+
+    snprintf(path, sizeof(path), "%s.body", ticket->path);
+    int have_copy = read_copy(path, url, body, length, &fetched_at) == 0;
+    if (pread(fd, &failed_at, sizeof(failed_at), 0) != sizeof(failed_at)) failed_at = 0;
+    if ((have_copy && time(NULL) - fetched_at < max_age_seconds) || time(NULL) - failed_at < HOSTCACHE_RETRY_SECONDS) {
+        close(fd); // Releases the lock
+        if (!have_copy) return HOSTCACHE_FAILED;
+        g_hostcache_stats.hits++;
+        if (waited) g_hostcache_stats.waits++;
+        return HOSTCACHE_HIT;
+    }
+    if (have_copy) free(*body);
+    ticket->fd = fd;
+    g_hostcache_stats.fetches++;
+    return HOSTCACHE_FETCH;
+}
+
+// Shares what the ticket holder fetched and lets the waiters in.
+void hostcache_put(HostCacheTicket *ticket, const char *url, const char *body, size_t length) {
+    if (ticket->fd < 0) return;
+    char path[COPY_PATH_MAX], temp_path[TEMP_PATH_MAX];
+    CopyHeader header = { .magic = { 'H', 'C', 'B', '1' }, .url_length = (uint32_t)strlen(url), .fetched_at = time(NULL), .length = length };
+    snprintf(path, sizeof(path), "%s.body", ticket->path);
+    snprintf(temp_path, sizeof(temp_path), "%s.%d", path, (int)getpid());
+    FILE *file = fopen(temp_path, "wb");
+    int ok = file && fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(url, 1, header.url_length, file) == header.url_length &&
+             fwrite(body, 1, length, file) == length;
+    if (file && fclose(file) != 0) ok = 0;
+    if (!ok || rename(temp_path, path) != 0) remove(temp_path);
+    note_failure(ticket->fd, 0);
+    close(ticket->fd);
+    ticket->fd = -1;
+}
+
+// Notes that the fetch failed, so the waiters do not all retry it at once.
+void hostcache_fail(HostCacheTicket *ticket) {
+    if (ticket->fd < 0) return;
+    note_failure(ticket->fd, time(NULL));
+    close(ticket->fd);
+    ticket->fd = -1;
+}
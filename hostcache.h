@@ -0,0 +1,54 @@
+/*
+ * hostcache.h - Feed responses shared by the monitors on one host
+ *
+ * Several monitors on a host (other thresholds, other sites) poll the same
+ * feed URL. The first to find the shared copy stale fetches it while
+ * holding a lock file; the others block on the lock and then read what it
+ * wrote, so upstream sees one request per URL per interval however many
+ * monitors run. Bodies live in a tmpfs directory, one file per URL, each
+ * replaced by rename so readers never see half of one. Locks are flock()s,
+ * which the kernel drops if a fetching monitor dies.
+ *
+ * A failed fetch is noted in the lock file; for HOSTCACHE_RETRY_SECONDS
+ * after one, waiters take the stale copy, if any, rather than all trying
+ * upstream in turn.
+ */
+
+#ifndef HOSTCACHE_H
+#define HOSTCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOSTCACHE_DEFAULT_DIR "/dev/shm/seismic-monitor"
+#define HOSTCACHE_RETRY_SECONDS 10
+#define HOSTCACHE_WAIT_SECONDS 60 // Longest to wait on another monitor's fetch before fetching anyway
+#define HOSTCACHE_DIR_MAX 256     // Longer directories turn sharing off
+#define HOSTCACHE_PATH_MAX (HOSTCACHE_DIR_MAX + 17) // The directory, '/' and a 16-digit hash
+
+typedef enum {
+    HOSTCACHE_FETCH,  // Caller fetches, then calls hostcache_put() or hostcache_fail()
+    HOSTCACHE_HIT,    // Body filled in from the shared copy
+    HOSTCACHE_FAILED, // Another monitor just failed and there is no copy
+} HostCacheResult;
+
+// A lock held while fetching; fd -1 when none is
+typedef struct {
+    int fd;
+    char path[HOSTCACHE_PATH_MAX]; // Without the .body or .lock suffix
+} HostCacheTicket;
+
+typedef struct {
+    uint64_t fetches; // Made here on behalf of every monitor
+    uint64_t hits;    // Served from another monitor's fetch
+    uint64_t waits;   // of which the other fetch was still running
+} HostCacheStats;
+
+extern HostCacheStats g_hostcache_stats;
+
+int hostcache_open(const char *dir);
+HostCacheResult hostcache_get(const char *url, int max_age_seconds, char **body, size_t *length, HostCacheTicket *ticket);
+void hostcache_put(HostCacheTicket *ticket, const char *url, const char *body, size_t length);
+void hostcache_fail(HostCacheTicket *ticket);
+
+#endif // HOSTCACHE_H
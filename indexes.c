@@ -0,0 +1,473 @@
+/*
+ * indexes.c - Ordered secondary indexes over the event history
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "indexes.h"
+#include "timing.h"
+#include "sites.h"
+#include "traveltime.h"
+
+#define INDEX_FANOUT 64 // Entries per leaf and children per inner node
+#define INDEX_MAX_DEPTH 16
+#define KM_PER_DEG 111.195
+
+typedef struct {
+    int64_t key;
+    uint64_t seq; // Tie-break, so every entry is unique
+} IndexEntry;
+
+// Leaves and inner nodes share this header
+typedef struct {
+    int leaf;
+    int count; // Entries in a leaf, children in an inner node
+} IndexNode;
+
+typedef struct IndexLeaf {
+    IndexNode header;
+    struct IndexLeaf *prev;
+    struct IndexLeaf *next;
+    IndexEntry entries[INDEX_FANOUT];
+} IndexLeaf;
+
+typedef struct {
+    IndexNode header;
+    IndexEntry separators[INDEX_FANOUT - 1]; // separators[i] is the lowest entry under children[i + 1]
+    IndexNode *children[INDEX_FANOUT];
+} IndexInner;
+
+typedef struct {
+    IndexNode *root;
+    IndexLeaf *first;
+    IndexLeaf *last;
+    uint64_t count;
+} IndexTree;
+
+// --- Globals ---
+static IndexTree g_indexes[INDEX_COUNT];
+
+// --- Keys ---
+
+static int64_t scaled_key(double value, double scale) {
+    return (int64_t)llround(value * scale);
+}
+
+double index_nearest_site_km(double lat, double lon) {
+    double nearest = INFINITY;
+    for (int s = 0; s < g_site_count; s++) {
+        double dist = epicentral_distance_deg(lat, lon, g_sites[s].lat, g_sites[s].lon) * KM_PER_DEG;
+        if (dist < nearest) nearest = dist;
+    }
+    return nearest;
+}
+
+// Bound for a range query, in the same units the index stores
+static int64_t bound_key(IndexKind kind, double value) {
+    double scale = (kind == INDEX_MAGNITUDE || kind == INDEX_DISTANCE) ? 1000.0 : 1.0;
+    double scaled = value * scale;
+    if (scaled <= -9.2e18) return INT64_MIN;
+    if (scaled >= 9.2e18) return INT64_MAX;
+    return llround(scaled);
+}
+
+static void event_keys(const CatalogEvent *event, int64_t keys[INDEX_COUNT]) {
+    double dist = g_site_count > 0 ? index_nearest_site_km(event->lat, event->lon) : 0.0;
+    keys[INDEX_TIME] = event->time_ms;
+    keys[INDEX_MAGNITUDE] = scaled_key(event->mag, 1000.0);
+    keys[INDEX_DISTANCE] = scaled_key(dist, 1000.0);
+    keys[INDEX_REGION] = event->region;
+}
+
+// --- B+tree ---
+
+static int compare_entry(const IndexEntry *entry, int64_t key, uint64_t seq) {
+    if (entry->key != key) return entry->key < key ? -1 : 1;
+    if (entry->seq != seq) return entry->seq < seq ? -1 : 1;
+    return 0;
+}
+
+// Number of entries in the array that sort before (key, seq)
+static int lower_bound(const IndexEntry *entries, int count, int64_t key, uint64_t seq) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (compare_entry(&entries[mid], key, seq) < 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Child of an inner node whose range holds (key, seq)
+static int child_for(const IndexInner *inner, int64_t key, uint64_t seq) {
+    int low = 0, high = inner->header.count - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (compare_entry(&inner->separators[mid], key, seq) <= 0) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static IndexTree *get_tree(IndexKind kind) {
+    IndexTree *tree = &g_indexes[kind];
+    if (!tree->root) {
+        IndexLeaf *leaf = calloc(1, sizeof(IndexLeaf));
+        if (!leaf) return NULL;
+        leaf->header.leaf = 1;
+        tree->root = &leaf->header;
+        tree->first = tree->last = leaf;
+    }
+    return tree;
+}
+
+// Descends to the leaf for (key, seq), recording the inner nodes passed and
+// the child taken in each.
+static IndexLeaf *descend(IndexTree *tree, int64_t key, uint64_t seq, IndexInner **path, int *slots, int *depth) {
+    IndexNode *node = tree->root;
+    *depth = 0;
+    while (!node->leaf) {
+        IndexInner *inner = (IndexInner *)node;
+        int child = child_for(inner, key, seq);
+        path[*depth] = inner;
+        slots[*depth] = child;
+        (*depth)++;
+        node = inner->children[child];
+    }
+    return (IndexLeaf *)node;
+}
+
+// Adds a child to the right of children[slot], splitting full inner nodes
+// up the path and growing a new root when the old one splits.
+static int insert_child(IndexTree *tree, IndexInner **path, int *slots, int depth, IndexEntry separator, IndexNode *child) {
+    while (depth > 0) {
+        IndexInner *inner = path[depth - 1];
+        int slot = slots[depth - 1] + 1;
+        if (inner->header.count < INDEX_FANOUT) {
+            memmove(&inner->children[slot + 1], &inner->children[slot], (inner->header.count - slot) * sizeof(IndexNode *));
+            memmove(&inner->separators[slot], &inner->separators[slot - 1], (inner->header.count - slot) * sizeof(IndexEntry));
+            inner->children[slot] = child;
+            inner->separators[slot - 1] = separator;
+            inner->header.count++;
+            return 0;
+        }
+
+        // Split a full node: lay out all FANOUT + 1 children, then halve
+        IndexNode *children[INDEX_FANOUT + 1];
+        IndexEntry separators[INDEX_FANOUT];
+        memcpy(children, inner->children, slot * sizeof(IndexNode *));
+        children[slot] = child;
+        memcpy(&children[slot + 1], &inner->children[slot], (INDEX_FANOUT - slot) * sizeof(IndexNode *));
+        memcpy(separators, inner->separators, (slot - 1) * sizeof(IndexEntry));
+        separators[slot - 1] = separator;
+        memcpy(&separators[slot], &inner->separators[slot - 1], (INDEX_FANOUT - slot) * sizeof(IndexEntry));
+
+        IndexInner *right = calloc(1, sizeof(IndexInner));
+        if (!right) return -1;
+        int left_count = (INDEX_FANOUT + 1) / 2;
+        int right_count = INDEX_FANOUT + 1 - left_count;
+        memcpy(inner->children, children, left_count * sizeof(IndexNode *));
+        memcpy(inner->separators, separators, (left_count - 1) * sizeof(IndexEntry));
+        inner->header.count = left_count;
+        memcpy(right->children, &children[left_count], right_count * sizeof(IndexNode *));
+        memcpy(right->separators, &separators[left_count], (right_count - 1) * sizeof(IndexEntry));
+        right->header.count = right_count;
+
+        separator = separators[left_count - 1];
+        child = &right->header;
+        depth--;
+    }
+
+    IndexInner *root = calloc(1, sizeof(IndexInner));
+    if (!root) return -1;
+    root->children[0] = tree->root;
+    root->children[1] = child;
+    root->separators[0] = separator;
+    root->header.count = 2;
+    tree->root = &root->header;
+    return 0;
+}
+
+static void tree_insert(IndexKind kind, int64_t key, uint64_t seq) {
+    IndexTree *tree = get_tree(kind);
+    IndexInner *path[INDEX_MAX_DEPTH];
+    int slots[INDEX_MAX_DEPTH], depth;
+    if (!tree) return;
+    IndexLeaf *leaf = descend(tree, key, seq, path, slots, &depth);
+    int position = lower_bound(leaf->entries, leaf->header.count, key, seq);
+    IndexEntry entry = { key, seq };
+
+    if (leaf->header.count < INDEX_FANOUT) {
+        memmove(&leaf->entries[position + 1], &leaf->entries[position], (leaf->header.count - position) * sizeof(IndexEntry));
+        leaf->entries[position] = entry;
+        leaf->header.count++;
+        tree->count++;
+        return;
+    }
+
+    // Split the full leaf. Appends (the time index) split at the end so
+    // leaves fill completely; others split in half.
+    IndexLeaf *right = calloc(1, sizeof(IndexLeaf));
+    if (!right) {
+        fprintf(stderr, "Not enough memory to index event %llu\n", (unsigned long long)seq);
+        return;
+    }
+    right->header.leaf = 1;
+    int keep = position == INDEX_FANOUT ? INDEX_FANOUT : INDEX_FANOUT / 2;
+    memcpy(right->entries, &leaf->entries[keep], (INDEX_FANOUT - keep) * sizeof(IndexEntry));
+    right->header.count = INDEX_FANOUT - keep;
+    leaf->header.count = keep;
+    IndexLeaf *target = position >= keep ? right : leaf;
+    int target_position = position >= keep ? position - keep : position;
+    memmove(&target->entries[target_position + 1], &target->entries[target_position],
+            (target->header.count - target_position) * sizeof(IndexEntry));
+    target->entries[target_position] = entry;
+    target->header.count++;
+    tree->count++;
+
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next) leaf->next->prev = right;
+    else tree->last = right;
+    leaf->next = right;
+    if (insert_child(tree, path, slots, depth, right->entries[0], &right->header) != 0) {
+        fprintf(stderr, "Not enough memory to index event %llu\n", (unsigned long long)seq);
+    }
+}
+
+// Removes an entry. Leaves are not rebalanced: a leaf is freed once empty,
+// and sparse leaves fill again as later rows arrive.
+static void tree_remove(IndexKind kind, int64_t key, uint64_t seq) {
+    IndexTree *tree = get_tree(kind);
+    IndexInner *path[INDEX_MAX_DEPTH];
+    int slots[INDEX_MAX_DEPTH], depth;
+    if (!tree) return;
+    IndexLeaf *leaf = descend(tree, key, seq, path, slots, &depth);
+    int position = lower_bound(leaf->entries, leaf->header.count, key, seq);
+    if (position == leaf->header.count || compare_entry(&leaf->entries[position], key, seq) != 0) return;
+    memmove(&leaf->entries[position], &leaf->entries[position + 1], (leaf->header.count - position - 1) * sizeof(IndexEntry));
+    leaf->header.count--;
+    tree->count--;
+    if (leaf->header.count > 0 || depth == 0) return;
+
+    if (leaf->prev) leaf->prev->next = leaf->next;
+    else tree->first = leaf->next;
+    if (leaf->next) leaf->next->prev = leaf->prev;
+    else tree->last = leaf->prev;
+    free(leaf);
+
+    // Unhook the freed node, and any inner node it leaves childless
+    while (depth > 0) {
+        IndexInner *inner = path[depth - 1];
+        int slot = slots[depth - 1];
+        int separator = slot > 0 ? slot - 1 : 0;
+        memmove(&inner->children[slot], &inner->children[slot + 1], (inner->header.count - slot - 1) * sizeof(IndexNode *));
+        if (inner->header.count > 1) {
+            memmove(&inner->separators[separator], &inner->separators[separator + 1],
+                    (inner->header.count - separator - 2) * sizeof(IndexEntry));
+        }
+        inner->header.count--;
+        if (inner->header.count > 0) break;
+        free(inner);
+        depth--;
+    }
+    // A root with one child hands over to it
+    while (!tree->root->leaf && tree->root->count == 1) {
+        IndexInner *root = (IndexInner *)tree->root;
+        tree->root = root->children[0];
+        free(root);
+    }
+}
+
+// --- Catalog Hooks ---
+
+void index_on_insert(uint64_t seq) {
+    CatalogEvent event;
+    int64_t keys[INDEX_COUNT];
+    catalog_get(seq, &event);
+    event_keys(&event, keys);
+    for (int k = 0; k < INDEX_COUNT; k++) tree_insert(k, keys[k], seq);
+}
+
+// Moves the row only in the indexes whose key actually changed.
+void index_on_revision(uint64_t seq, const CatalogEvent *previous) {
+    CatalogEvent event;
+    int64_t old_keys[INDEX_COUNT], keys[INDEX_COUNT];
+    catalog_get(seq, &event);
+    event_keys(previous, old_keys);
+    event_keys(&event, keys);
+    for (int k = 0; k < INDEX_COUNT; k++) {
+        if (old_keys[k] == keys[k]) continue;
+        tree_remove(k, old_keys[k], seq);
+        tree_insert(k, keys[k], seq);
+    }
+}
+
+// Call before the row leaves the catalog; its keys are read from it.
+void index_on_retire(uint64_t seq) {
+    CatalogEvent event;
+    int64_t keys[INDEX_COUNT];
+    catalog_get(seq, &event);
+    event_keys(&event, keys);
+    for (int k = 0; k < INDEX_COUNT; k++) tree_remove(k, keys[k], seq);
+}
+
+// --- Queries ---
+
+// Positions a cursor on the first entry within [low, high] in the chosen
+// direction. Pass +/-INFINITY for an open bound.
+void index_seek(IndexCursor *cursor, IndexKind kind, double low, double high, int descending) {
+    cursor->low = bound_key(kind, low);
+    cursor->high = bound_key(kind, high);
+    cursor->descending = descending;
+    cursor->leaf = NULL;
+    IndexTree *tree = get_tree(kind);
+    IndexInner *path[INDEX_MAX_DEPTH];
+    int slots[INDEX_MAX_DEPTH], depth;
+    if (!tree || tree->count == 0) return;
+
+    if (!descending) {
+        IndexLeaf *leaf = descend(tree, cursor->low, 0, path, slots, &depth);
+        cursor->leaf = leaf;
+        cursor->position = lower_bound(leaf->entries, leaf->header.count, cursor->low, 0);
+    } else {
+        IndexLeaf *leaf = descend(tree, cursor->high, UINT64_MAX, path, slots, &depth);
+        cursor->leaf = leaf;
+        cursor->position = lower_bound(leaf->entries, leaf->header.count, cursor->high, UINT64_MAX);
+        if (cursor->position < leaf->header.count && compare_entry(&leaf->entries[cursor->position], cursor->high, UINT64_MAX) == 0) {
+            cursor->position++;
+        }
+        cursor->position--; // Last entry <= (high, any)
+    }
+}
+
+// Positions a cursor on the entry (key, seq), or the first one past it in
+// the chosen direction, within [low, high]. Resumes a walk from an entry
+// remembered by its key, even if that entry has since been removed.
+void index_seek_from(IndexCursor *cursor, IndexKind kind, int64_t key, uint64_t seq, double low, double high, int descending) {
+    cursor->low = bound_key(kind, low);
+    cursor->high = bound_key(kind, high);
+    cursor->descending = descending;
+    cursor->leaf = NULL;
+    IndexTree *tree = get_tree(kind);
+    IndexInner *path[INDEX_MAX_DEPTH];
+    int slots[INDEX_MAX_DEPTH], depth;
+    if (!tree || tree->count == 0) return;
+
+    IndexLeaf *leaf = descend(tree, key, seq, path, slots, &depth);
+    cursor->leaf = leaf;
+    cursor->position = lower_bound(leaf->entries, leaf->header.count, key, seq);
+    if (descending && (cursor->position == leaf->header.count || compare_entry(&leaf->entries[cursor->position], key, seq) != 0)) {
+        cursor->position--; // Last entry before (key, seq)
+    }
+}
+
+int index_next(IndexCursor *cursor, uint64_t *seq_out) {
+    // Step across leaf boundaries; only the root leaf is ever empty
+    while (cursor->leaf && (cursor->position < 0 || cursor->position >= cursor->leaf->header.count)) {
+        if (cursor->descending) {
+            cursor->leaf = cursor->leaf->prev;
+            if (cursor->leaf) cursor->position = cursor->leaf->header.count - 1;
+        } else {
+            cursor->leaf = cursor->leaf->next;
+            cursor->position = 0;
+        }
+    }
+    if (!cursor->leaf) return 0;
+    const IndexEntry *entry = &cursor->leaf->entries[cursor->position];
+    if (entry->key < cursor->low || entry->key > cursor->high) {
+        cursor->leaf = NULL;
+        return 0;
+    }
+    *seq_out = entry->seq;
+    cursor->key = entry->key;
+    cursor->position += cursor->descending ? -1 : 1;
+    return 1;
+}
+
+// Copies up to max sequence numbers keyed within [low, high]; with open
+// bounds this is a top-N (descending) or bottom-N query.
+int index_range(IndexKind kind, double low, double high, int descending, uint64_t *out, int max) {
+    IndexCursor cursor;
+    int count = 0;
+    index_seek(&cursor, kind, low, high, descending);
+    while (count < max && index_next(&cursor, &out[count])) count++;
+    return count;
+}
+
+uint64_t index_count(IndexKind kind) {
+    return g_indexes[kind].count;
+}
+
+// --- Benchmark ---
+
+// Builds a synthetic history of the given size and times index upkeep and
+// queries against it.
+int index_benchmark(int events) {
+    if (catalog_init(events) != 0) return 1;
+    if (g_site_count == 0) sites_add("Home", 54.53, -1.05, 5.0);
+    uint64_t state = 12345;
+    long long now_ms = (long long)time(NULL) * 1000;
+    struct timespec start;
+
+    printf("Index benchmark: %d events, %d site%s\n\n", events, g_site_count, g_site_count == 1 ? "" : "s");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < events; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        CatalogEvent event = { .time_ms = now_ms - (long long)(state >> 24) % (CATALOG_RETENTION_DAYS * 86400000LL) };
+        event.lat = (float)((state >> 20 & 0xFFFF) / 65535.0 * 180.0 - 90.0);
+        event.lon = (float)((state >> 4 & 0xFFFF) / 65535.0 * 360.0 - 180.0);
+        event.mag = (float)(-log10((double)((state >> 36 & 0xFFFFF) + 1) / 1048577.0) + 1.0);
+        event.region = (int)(state >> 8 & 0x3FF);
+        snprintf(event.id, sizeof(event.id), "bench%d", i);
+        uint64_t seq;
+        if (catalog_upsert(&event, &seq, NULL) == CATALOG_INSERTED) index_on_insert(seq);
+    }
+    double ns = elapsed_us(&start) * 1e3;
+    printf("Insert:               %8.0f ns/event (all %d indexes)\n", ns / events, INDEX_COUNT);
+
+    static uint64_t out[1024];
+    const int repeats = 10000;
+    long long found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) found += index_range(INDEX_MAGNITUDE, -INFINITY, INFINITY, 1, out, 10);
+    printf("Top 10 by magnitude:  %8.0f ns\n", elapsed_us(&start) * 1e3 / repeats);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) found += index_range(INDEX_TIME, now_ms - 3600000.0, INFINITY, 1, out, 1024);
+    printf("Last hour, newest:    %8.0f ns (%d events)\n", elapsed_us(&start) * 1e3 / repeats,
+           index_range(INDEX_TIME, now_ms - 3600000.0, INFINITY, 1, out, 1024));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) found += index_range(INDEX_DISTANCE, -INFINITY, INFINITY, 0, out, 10);
+    printf("Nearest 10:           %8.0f ns\n", elapsed_us(&start) * 1e3 / repeats);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) found += index_range(INDEX_REGION, r % 1024, r % 1024, 0, out, 1024);
+    printf("One region:           %8.0f ns\n", elapsed_us(&start) * 1e3 / repeats);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < events; i++) {
+        uint64_t seq = g_catalog.head + i;
+        CatalogEvent event, previous;
+        catalog_get(seq, &event);
+        event.mag += 0.1f;
+        catalog_upsert(&event, NULL, &previous);
+        index_on_revision(seq, &previous);
+    }
+    printf("Magnitude revision:   %8.0f ns/event\n", elapsed_us(&start) * 1e3 / events);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (catalog_size() > 0) {
+        index_on_retire(g_catalog.head);
+        catalog_pop_oldest();
+    }
+    printf("Retire:               %8.0f ns/event (%llu left indexed)\n", elapsed_us(&start) * 1e3 / events,
+           (unsigned long long)(index_count(INDEX_TIME) + index_count(INDEX_MAGNITUDE) +
+                                index_count(INDEX_DISTANCE) + index_count(INDEX_REGION)));
+    return found > 0 ? 0 : 1;
+}
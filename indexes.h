@@ -0,0 +1,52 @@
+/*
+ * indexes.h - Ordered secondary indexes over the event history
+ *
+ * Keeps the catalog ordered by origin time, magnitude, distance to the
+ * nearest monitored site and region, each in a B+tree of compact 16-byte
+ * (key, sequence number) entries. Trees are updated as rows are inserted,
+ * revised and retired, so a range or top-N query in either direction costs
+ * O(log n + k) instead of a sort, and walks k entries packed in leaves.
+ *
+ * Magnitudes are keyed in thousandths and distances in metres; region keys
+ * are region codes, and ties in any index fall back to insertion order.
+ */
+
+#ifndef INDEXES_H
+#define INDEXES_H
+
+#include <stdint.h>
+#include "catalog.h"
+
+typedef enum {
+    INDEX_TIME,      // Origin time, ms since the epoch
+    INDEX_MAGNITUDE,
+    INDEX_DISTANCE,  // Epicentral km to the nearest site
+    INDEX_REGION,
+    INDEX_COUNT
+} IndexKind;
+
+struct IndexLeaf;
+
+// Walks one index between two inclusive bounds
+typedef struct {
+    struct IndexLeaf *leaf;
+    int position;
+    int64_t low;
+    int64_t high;
+    int descending;
+    int64_t key; // Key of the entry index_next last returned
+} IndexCursor;
+
+void index_on_insert(uint64_t seq);
+void index_on_revision(uint64_t seq, const CatalogEvent *previous);
+void index_on_retire(uint64_t seq);
+
+void index_seek(IndexCursor *cursor, IndexKind kind, double low, double high, int descending);
+void index_seek_from(IndexCursor *cursor, IndexKind kind, int64_t key, uint64_t seq, double low, double high, int descending);
+int index_next(IndexCursor *cursor, uint64_t *seq_out);
+int index_range(IndexKind kind, double low, double high, int descending, uint64_t *out, int max);
+uint64_t index_count(IndexKind kind);
+double index_nearest_site_km(double lat, double lon);
+int index_benchmark(int events);
+
+#endif // INDEXES_H
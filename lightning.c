@@ -0,0 +1,806 @@
+/*
+ * lightning.c - Thunderstorm watch for monitored sites
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <jansson.h>
+#include "lightning.h"
+#include "timing.h"
+#include "flatbuf.h"
+#include "traveltime.h"
+#include "strikes.h"
+
+#define WEATHER_API_URL "https://api.open-meteo.com/v1/forecast"
+#define LIGHTNING_ALERT_CODE_1 95 // Thunderstorm: Slight or moderate
+#define LIGHTNING_ALERT_CODE_2 96 // Thunderstorm with slight hail
+#define LIGHTNING_ALERT_CODE_3 99 // Thunderstorm with heavy hail
+#define LIGHTNING_VARIABLES "weather_code,lightning_potential,cape,precipitation"
+#define RISK_BATCH 16
+#define KM_PER_DEG 111.195
+#define DEG_TO_RAD (M_PI / 180.0)
+
+// Risk weights and the values at which each input saturates
+#define RISK_POTENTIAL_WEIGHT 0.5f
+#define RISK_CAPE_WEIGHT 0.3f
+#define RISK_PRECIP_WEIGHT 0.2f
+#define RISK_POTENTIAL_FULL 10.0f // Lightning potential index, J/kg
+#define RISK_CAPE_ONSET 100.0f    // J/kg
+#define RISK_CAPE_FULL 2500.0f
+#define RISK_PRECIP_FULL 10.0f    // mm/h
+#define RISK_THUNDER_CODE 0.8f    // Floor when the weather code itself is a thunderstorm
+
+// --- Globals ---
+int g_lightning_horizon_hours = LIGHTNING_DEFAULT_HORIZON_HOURS;
+int g_lightning_step_minutes = 60;
+LightningFormat g_lightning_format = LIGHTNING_FORMAT_JSON;
+LightningCell g_lightning_cells[LIGHTNING_MAX_CELLS];
+int g_lightning_cell_count = 0;
+int g_lightning_site_cell[MAX_SITES];
+float g_lightning_ring_km = LIGHTNING_DEFAULT_RING_KM;
+LightningThreat g_lightning_threats[MAX_SITES];
+LightningSiteState g_lightning_states[MAX_SITES];
+LightningTransition g_lightning_transitions[LIGHTNING_MAX_TRANSITIONS];
+uint64_t g_lightning_transition_count = 0;
+
+// Cells sampled around each site; sample 0 is the site's own cell
+typedef struct {
+    int cell[LIGHTNING_SAMPLES];
+    float distance_km[LIGHTNING_SAMPLES];
+    float bearing_deg[LIGHTNING_SAMPLES];
+    int count;
+} SiteSamples;
+
+static SiteSamples g_samples[MAX_SITES];
+static int g_ring_cursor = 0; // Where the next cycle's scan for stale ring cells starts
+
+#define CELL_BUCKETS (LIGHTNING_MAX_CELLS * 2) // Open-addressed cell lookup, at most half full
+static int g_cell_lookup[CELL_BUCKETS];       // Cell index + 1; 0 is empty
+static int g_sites_assigned = 0;
+static int g_sites_stored = 0; // Sites whose state was evaluated elsewhere
+
+// Columns of every cell's series, back to back
+static uint8_t *g_codes = NULL;
+static float *g_potential = NULL;
+static float *g_cape = NULL;
+static float *g_precip = NULL;
+static float *g_risk = NULL;
+static uint32_t g_slots_used = 0;
+static uint32_t g_slots_capacity = 0;
+
+int lightning_is_thunderstorm(int code) {
+    return code == LIGHTNING_ALERT_CODE_1 || code == LIGHTNING_ALERT_CODE_2 || code == LIGHTNING_ALERT_CODE_3;
+}
+
+// --- Grid Cells ---
+
+static int cell_for(float lat, float lon) {
+    int lat_index = (int)floor(lat / LIGHTNING_GRID_DEGREES);
+    int lon_index = (int)floor(lon / LIGHTNING_GRID_DEGREES);
+    uint32_t bucket = ((uint32_t)lat_index * 73856093u ^ (uint32_t)lon_index * 19349663u) % CELL_BUCKETS;
+    for (;; bucket = (bucket + 1) % CELL_BUCKETS) {
+        int cell = g_cell_lookup[bucket] - 1;
+        if (cell < 0) break;
+        if (g_lightning_cells[cell].lat_index == lat_index && g_lightning_cells[cell].lon_index == lon_index) return cell;
+    }
+    if (g_lightning_cell_count == LIGHTNING_MAX_CELLS) return -1;
+    int cell = g_lightning_cell_count++;
+    LightningCell *c = &g_lightning_cells[cell];
+    memset(c, 0, sizeof(*c));
+    c->lat_index = lat_index;
+    c->lon_index = lon_index;
+    c->lat = (float)((lat_index + 0.5) * LIGHTNING_GRID_DEGREES);
+    c->lon = (float)((lon_index + 0.5) * LIGHTNING_GRID_DEGREES);
+    g_cell_lookup[bucket] = cell + 1;
+    return cell;
+}
+
+static const LightningSeries *site_series(int site) {
+    static const LightningSeries none = { 0 };
+    int cell = site < g_sites_assigned ? g_lightning_site_cell[site] : -1;
+    return cell >= 0 ? &g_lightning_cells[cell].series : &none;
+}
+
+const LightningSiteState *lightning_site(int site) {
+    static const LightningSiteState none = { 0 };
+    return site < g_sites_assigned || site < g_sites_stored ? &g_lightning_states[site] : &none;
+}
+
+static int compare_offsets(const void *a, const void *b) {
+    uint32_t x = g_lightning_cells[*(const int *)a].series.offset;
+    uint32_t y = g_lightning_cells[*(const int *)b].series.offset;
+    return (x > y) - (x < y);
+}
+
+// Drops the slots of replaced forecasts. Series move down in offset order,
+// so none is overwritten before it has moved.
+static void compact_columns() {
+    static int order[LIGHTNING_MAX_CELLS];
+    int count = 0;
+    for (int c = 0; c < g_lightning_cell_count; c++) {
+        if (g_lightning_cells[c].series.valid) order[count++] = c;
+    }
+    qsort(order, count, sizeof(int), compare_offsets);
+    uint32_t used = 0;
+    for (int i = 0; i < count; i++) {
+        LightningSeries *series = &g_lightning_cells[order[i]].series;
+        if (series->offset != used) {
+            memmove(g_codes + used, g_codes + series->offset, series->count);
+            memmove(g_potential + used, g_potential + series->offset, series->count * sizeof(float));
+            memmove(g_cape + used, g_cape + series->offset, series->count * sizeof(float));
+            memmove(g_precip + used, g_precip + series->offset, series->count * sizeof(float));
+            memmove(g_risk + used, g_risk + series->offset, series->count * sizeof(float));
+            series->offset = used;
+        }
+        used += series->count;
+    }
+    g_slots_used = used;
+}
+
+static double initial_bearing_deg(double lat1, double lon1, double lat2, double lon2) {
+    double phi1 = lat1 * DEG_TO_RAD, phi2 = lat2 * DEG_TO_RAD, dlon = (lon2 - lon1) * DEG_TO_RAD;
+    double bearing = atan2(sin(dlon) * cos(phi2), cos(phi1) * sin(phi2) - sin(phi1) * cos(phi2) * cos(dlon)) / DEG_TO_RAD;
+    return bearing < 0 ? bearing + 360.0 : bearing;
+}
+
+// Maps a site to its own cell and the distinct cells of its sampling rings.
+static void assign_site(int site) {
+    const Site *s = &g_sites[site];
+    SiteSamples *samples = &g_samples[site];
+    int own = cell_for(s->lat, s->lon);
+    g_lightning_site_cell[site] = own;
+    memset(&g_lightning_states[site], 0, sizeof(LightningSiteState));
+    g_lightning_states[site].slot = -2; // Matches no slot, so the first assessment evaluates it
+    samples->count = 0;
+    if (own < 0) return;
+    g_lightning_cells[own].has_site = 1;
+    samples->cell[samples->count++] = own;
+    samples->distance_km[0] = samples->bearing_deg[0] = 0.0f;
+    if (g_lightning_ring_km <= 0.0f) return;
+
+    double phi = s->lat * DEG_TO_RAD;
+    for (int ring = 1; ring <= LIGHTNING_RINGS; ring++) {
+        double angular = g_lightning_ring_km * ring / LIGHTNING_RINGS / KM_PER_DEG * DEG_TO_RAD;
+        for (int b = 0; b < LIGHTNING_RING_BEARINGS; b++) {
+            double theta = 360.0 * b / LIGHTNING_RING_BEARINGS * DEG_TO_RAD;
+            double lat = asin(sin(phi) * cos(angular) + cos(phi) * sin(angular) * cos(theta));
+            double lon = s->lon * DEG_TO_RAD +
+                         atan2(sin(theta) * sin(angular) * cos(phi), cos(angular) - sin(phi) * sin(lat));
+            lon = fmod(lon / DEG_TO_RAD + 540.0, 360.0) - 180.0;
+            int cell = cell_for((float)(lat / DEG_TO_RAD), (float)lon);
+            int seen = cell < 0;
+            for (int k = 0; k < samples->count && !seen; k++) seen = samples->cell[k] == cell;
+            if (seen) continue;
+            const LightningCell *c = &g_lightning_cells[cell];
+            samples->cell[samples->count] = cell;
+            samples->distance_km[samples->count] = (float)(epicentral_distance_deg(s->lat, s->lon, c->lat, c->lon) * KM_PER_DEG);
+            samples->bearing_deg[samples->count] = (float)initial_bearing_deg(s->lat, s->lon, c->lat, c->lon);
+            samples->count++;
+        }
+    }
+}
+
+// Forgets the sites' cells and states before g_sites is refilled with
+// others. Cached forecasts stay with their cells for whichever sites land
+// in them.
+void lightning_reset_sites() {
+    for (int c = 0; c < g_lightning_cell_count; c++) g_lightning_cells[c].has_site = 0;
+    g_sites_assigned = 0;
+    g_sites_stored = 0;
+}
+
+// Starts a fetch cycle: maps any new sites to cells and compacts the
+// columns. Lists every stale site cell, then stale ring cells up to the
+// sampling budget, resuming where the last cycle's budget ran out.
+int lightning_begin_update(long long now, int *stale, int max) {
+    for (; g_sites_assigned < g_site_count; g_sites_assigned++) assign_site(g_sites_assigned);
+    compact_columns();
+    int count = 0;
+    for (int c = 0; c < g_lightning_cell_count && count < max; c++) {
+        if (g_lightning_cells[c].has_site && g_lightning_cells[c].expires <= now) stale[count++] = c;
+    }
+    int budget = LIGHTNING_SAMPLE_REQUESTS * LIGHTNING_BATCH_SITES - count % LIGHTNING_BATCH_SITES; // Fill the last site batch too
+    for (int n = 0; n < g_lightning_cell_count && budget > 0 && count < max; n++) {
+        int c = (g_ring_cursor + n) % g_lightning_cell_count;
+        if (g_lightning_cells[c].has_site || g_lightning_cells[c].expires > now) continue;
+        stale[count++] = c;
+        budget--;
+        if (budget == 0) g_ring_cursor = (c + 1) % g_lightning_cell_count;
+    }
+    return count;
+}
+
+int lightning_build_url(char *buffer, size_t size, const int *cells, int count) {
+    char latitudes[LIGHTNING_BATCH_SITES * 9], longitudes[LIGHTNING_BATCH_SITES * 10];
+    size_t lat_used = 0, lon_used = 0;
+    if (count > LIGHTNING_BATCH_SITES) return -1;
+    for (int i = 0; i < count; i++) {
+        const LightningCell *cell = &g_lightning_cells[cells[i]];
+        const char *separator = i ? "," : "";
+        lat_used += snprintf(latitudes + lat_used, sizeof(latitudes) - lat_used, "%s%.3f", separator, cell->lat);
+        lon_used += snprintf(longitudes + lon_used, sizeof(longitudes) - lon_used, "%s%.3f", separator, cell->lon);
+    }
+    int quarter_hours = g_lightning_step_minutes == 15;
+    int written = snprintf(buffer, size,
+                           WEATHER_API_URL "?latitude=%s&longitude=%s&current=weather_code&%s=" LIGHTNING_VARIABLES "&%s=%d&timeformat=unixtime%s",
+                           latitudes, longitudes, quarter_hours ? "minutely_15" : "hourly",
+                           quarter_hours ? "forecast_minutely_15" : "forecast_hours",
+                           g_lightning_horizon_hours * (quarter_hours ? 4 : 1),
+                           g_lightning_format == LIGHTNING_FORMAT_FLATBUFFERS ? "&format=flatbuffers" : "");
+    return written < (int)size ? 0 : -1;
+}
+
+// Leaves room for a whole scoring batch past the new slots.
+static int reserve_slots(uint32_t count) {
+    uint32_t needed = g_slots_used + count + RISK_BATCH;
+    if (needed <= g_slots_capacity) return 0;
+    uint32_t capacity = g_slots_capacity ? g_slots_capacity : 1024;
+    while (capacity < needed) capacity *= 2;
+    uint8_t *codes = realloc(g_codes, capacity);
+    if (codes) g_codes = codes;
+    float **columns[] = { &g_potential, &g_cape, &g_precip, &g_risk };
+    int failed = !codes;
+    for (int i = 0; i < 4; i++) {
+        float *grown = realloc(*columns[i], capacity * sizeof(float));
+        if (grown) *columns[i] = grown;
+        else failed = 1;
+    }
+    if (failed) return -1;
+    g_slots_capacity = capacity;
+    return 0;
+}
+
+static void read_column(json_t *values, float *out, size_t count) {
+    for (size_t i = 0; i < count; i++) out[i] = (float)json_number_value(json_array_get(values, i));
+}
+
+// Clamps to [0, limit]; written as selects so the scoring loop vectorizes.
+static inline float clamp_to(float x, float limit) {
+    x = x > 0.0f ? x : 0.0f;
+    return x < limit ? x : limit;
+}
+
+// Scores slots [first, first + count) plus the padding up to a whole batch.
+static void score_slots(uint32_t first, int count, int step) {
+    // Each input is scaled so it saturates at its weight
+    const float potential_scale = RISK_POTENTIAL_WEIGHT / RISK_POTENTIAL_FULL;
+    const float cape_scale = RISK_CAPE_WEIGHT / (RISK_CAPE_FULL - RISK_CAPE_ONSET);
+    const float precip_scale = RISK_PRECIP_WEIGHT * 3600.0f / step / RISK_PRECIP_FULL; // Per-slot amount to a rate
+    for (int p = count; p % RISK_BATCH; p++) {
+        g_codes[first + p] = 0;
+        g_potential[first + p] = g_cape[first + p] = g_precip[first + p] = 0.0f;
+    }
+    for (int base = 0; base < count; base += RISK_BATCH) {
+        const float *potential = g_potential + first + base;
+        const float *cape = g_cape + first + base;
+        const float *precip = g_precip + first + base;
+        const uint8_t *code = g_codes + first + base;
+        float risk[RISK_BATCH];
+        for (int k = 0; k < RISK_BATCH; k++) {
+            float fused = clamp_to(potential[k] * potential_scale, RISK_POTENTIAL_WEIGHT) +
+                          clamp_to((cape[k] - RISK_CAPE_ONSET) * cape_scale, RISK_CAPE_WEIGHT) +
+                          clamp_to(precip[k] * precip_scale, RISK_PRECIP_WEIGHT);
+            int thunder = (code[k] == LIGHTNING_ALERT_CODE_1) | (code[k] == LIGHTNING_ALERT_CODE_2) | (code[k] == LIGHTNING_ALERT_CODE_3);
+            float floor = thunder ? RISK_THUNDER_CODE : 0.0f;
+            risk[k] = fused > floor ? fused : floor;
+        }
+        memcpy(g_risk + first + base, risk, sizeof(risk));
+    }
+}
+
+// Claims count slots at the end of the columns for the series.
+static int begin_series(LightningSeries *series, long long start, int step, uint32_t count) {
+    if (count == 0 || step <= 0 || reserve_slots(count) != 0) return -1;
+    series->start = start;
+    series->step = step;
+    series->count = (int)count;
+    series->offset = g_slots_used;
+    return 0;
+}
+
+// Scores a fully decoded series and only then puts it in place of the
+// cell's cached one, cached until expires.
+static void store_series(int cell, LightningSeries *series, long long expires) {
+    LightningCell *c = &g_lightning_cells[cell];
+    score_slots(series->offset, series->count, series->step);
+    g_slots_used += (uint32_t)series->count;
+    series->valid = 1;
+    series->run = c->series.run + 1;
+    c->series = *series;
+    c->expires = expires;
+}
+
+// --- JSON Decoding ---
+
+// Returns -1, leaving the cell's cached forecast alone, for anything but a
+// forecast, such as an {"error":true,"reason":...} object.
+static int parse_cell(json_t *forecast, int cell, long long expires) {
+    LightningSeries fresh = { 0 }, *series = &fresh;
+    json_t *block = json_object_get(forecast, g_lightning_step_minutes == 15 ? "minutely_15" : "hourly");
+    if (!json_is_object(forecast) || !json_is_object(block)) return -1;
+    json_t *current = json_object_get(forecast, "current");
+    if (json_is_object(current)) series->current_code = (int)json_integer_value(json_object_get(current, "weather_code"));
+
+    json_t *times = json_object_get(block, "time");
+    json_t *codes = json_object_get(block, "weather_code");
+    size_t count = json_array_size(codes);
+    if (json_array_size(times) < count) count = json_array_size(times);
+    long long start = json_integer_value(json_array_get(times, 0));
+    int step = count > 1 ? (int)(json_integer_value(json_array_get(times, 1)) - start) : g_lightning_step_minutes * 60;
+    if (begin_series(series, start, step, (uint32_t)count) != 0) return -1;
+
+    uint32_t at = series->offset;
+    for (size_t i = 0; i < count; i++) g_codes[at + i] = (uint8_t)json_integer_value(json_array_get(codes, i));
+    // Lightning potential is only modelled in some regions; missing values read as 0
+    read_column(json_object_get(block, "lightning_potential"), g_potential + at, count);
+    read_column(json_object_get(block, "cape"), g_cape + at, count);
+    read_column(json_object_get(block, "precipitation"), g_precip + at, count);
+    store_series(cell, series, expires);
+    return 0;
+}
+
+// A multi-coordinate request answers with an array, a single one with an
+// object.
+static int parse_json(const char *body, size_t length, const int *cells, int count, long long expires) {
+    json_error_t error;
+    json_t *root = json_loadb(body, length, 0, &error);
+    int result = 0;
+    if (!root) return -1;
+    if (json_is_array(root)) {
+        for (int i = 0; i < count && i < (int)json_array_size(root); i++) parse_cell(json_array_get(root, i), cells[i], expires);
+    } else {
+        result = parse_cell(root, cells[0], expires);
+    }
+    json_decref(root);
+    return result;
+}
+
+// --- FlatBuffers Decoding ---
+
+// Field ids and enum values from openmeteo-sdk's weather_api.fbs
+#define FB_RESPONSE_LATITUDE 0
+#define FB_RESPONSE_LONGITUDE 1
+#define FB_RESPONSE_CURRENT 9
+#define FB_RESPONSE_HOURLY 11
+#define FB_RESPONSE_MINUTELY_15 12
+#define FB_SERIES_TIME 0
+#define FB_SERIES_INTERVAL 2
+#define FB_SERIES_VARIABLES 3
+#define FB_VALUES_VARIABLE 0
+#define FB_VALUES_VALUE 2
+#define FB_VALUES_VALUES 3
+#define FB_VARIABLE_CAPE 2
+#define FB_VARIABLE_LIGHTNING_POTENTIAL 23
+#define FB_VARIABLE_PRECIPITATION 24
+#define FB_VARIABLE_WEATHER_CODE 56
+
+static float *column_for(int variable) {
+    switch (variable) {
+    case FB_VARIABLE_LIGHTNING_POTENTIAL: return g_potential;
+    case FB_VARIABLE_CAPE: return g_cape;
+    case FB_VARIABLE_PRECIPITATION: return g_precip;
+    default: return NULL;
+    }
+}
+
+// Copies the values straight from the response into the columns; nothing
+// is unpacked into intermediate objects.
+static void decode_cell(const FbReader *r, int cell, long long expires) {
+    LightningSeries fresh = { 0 }, *series = &fresh;
+    uint32_t response = fb_root(r);
+    uint32_t count;
+
+    uint32_t current = fb_get_table(r, response, FB_RESPONSE_CURRENT);
+    uint32_t variables = fb_get_vector(r, current, FB_SERIES_VARIABLES, 4, &count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t values = fb_vector_table(r, variables, i);
+        if (fb_get_u8(r, values, FB_VALUES_VARIABLE, 0) == FB_VARIABLE_WEATHER_CODE)
+            series->current_code = (int)fb_get_f32(r, values, FB_VALUES_VALUE, 0.0f);
+    }
+
+    uint32_t block = fb_get_table(r, response, g_lightning_step_minutes == 15 ? FB_RESPONSE_MINUTELY_15 : FB_RESPONSE_HOURLY);
+    variables = fb_get_vector(r, block, FB_SERIES_VARIABLES, 4, &count);
+    uint32_t codes = 0, slots = 0;
+    for (uint32_t i = 0; i < count && !codes; i++) {
+        uint32_t values = fb_vector_table(r, variables, i);
+        if (fb_get_u8(r, values, FB_VALUES_VARIABLE, 0) == FB_VARIABLE_WEATHER_CODE)
+            codes = fb_get_vector(r, values, FB_VALUES_VALUES, 4, &slots);
+    }
+    long long start = fb_get_i64(r, block, FB_SERIES_TIME, 0);
+    int step = fb_get_i32(r, block, FB_SERIES_INTERVAL, g_lightning_step_minutes * 60);
+    if (!codes || begin_series(series, start, step, slots) != 0) return;
+
+    uint32_t at = series->offset;
+    const uint8_t *data = r->data;
+    for (uint32_t i = 0; i < slots; i++) {
+        float code;
+        memcpy(&code, data + codes + 4 * i, 4);
+        g_codes[at + i] = (uint8_t)code;
+    }
+    // Missing variables read as 0, as in the JSON path
+    int found[3] = { 0, 0, 0 };
+    float *columns[3] = { g_potential, g_cape, g_precip };
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t values = fb_vector_table(r, variables, i);
+        float *column = column_for(fb_get_u8(r, values, FB_VALUES_VARIABLE, 0));
+        uint32_t length;
+        uint32_t floats = fb_get_vector(r, values, FB_VALUES_VALUES, 4, &length);
+        if (!column || !floats) continue;
+        if (length > slots) length = slots;
+        memcpy(column + at, data + floats, 4 * (size_t)length);
+        memset(column + at + length, 0, 4 * (size_t)(slots - length));
+        for (int c = 0; c < 3; c++) found[c] |= columns[c] == column;
+    }
+    for (int c = 0; c < 3; c++) {
+        if (!found[c]) memset(columns[c] + at, 0, 4 * (size_t)slots);
+    }
+    store_series(cell, series, expires);
+}
+
+// The body holds one size-prefixed response per location, in request order.
+static int parse_flatbuffers(const char *body, size_t length, const int *cells, int count, long long expires) {
+    size_t pos = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t size;
+        if (pos + 4 > length) return i ? 0 : -1;
+        memcpy(&size, body + pos, 4);
+        if (size > length - pos - 4) return -1;
+        FbReader reader = { (const uint8_t *)body + pos + 4, size };
+        decode_cell(&reader, cells[i], expires);
+        pos += 4 + (size_t)size;
+    }
+    return 0;
+}
+
+// Decodes one response covering the given cells, in the format the request
+// asked for. Each decoded cell is cached until the next model run is out;
+// a cell the response has no forecast for keeps what it had.
+int lightning_parse(const char *body, size_t length, const int *cells, int count, long long now) {
+    long long next_run = (now / LIGHTNING_MODEL_UPDATE_SECONDS + 1) * LIGHTNING_MODEL_UPDATE_SECONDS + LIGHTNING_MODEL_DELAY_SECONDS;
+    if (now % LIGHTNING_MODEL_UPDATE_SECONDS < LIGHTNING_MODEL_DELAY_SECONDS) next_run -= LIGHTNING_MODEL_UPDATE_SECONDS;
+    return g_lightning_format == LIGHTNING_FORMAT_FLATBUFFERS ? parse_flatbuffers(body, length, cells, count, next_run)
+                                                              : parse_json(body, length, cells, count, next_run);
+}
+
+// --- Storm Approach ---
+
+static float risk_at(const LightningSeries *series, long long t) {
+    if (!series->valid || t < series->start) return 0.0f;
+    long long slot = (t - series->start) / series->step;
+    return slot < series->count ? g_risk[series->offset + slot] : 0.0f;
+}
+
+// Nearest sample at storm risk at time t, or -1.
+static int nearest_threat(const SiteSamples *samples, long long t, int include_current) {
+    int nearest = -1;
+    for (int k = 0; k < samples->count; k++) {
+        const LightningSeries *series = &g_lightning_cells[samples->cell[k]].series;
+        int stormy = risk_at(series, t) >= LIGHTNING_WATCH_ENTER_RISK ||
+                     (include_current && series->valid && lightning_is_thunderstorm(series->current_code));
+        if (stormy && (nearest < 0 || samples->distance_km[k] < samples->distance_km[nearest])) nearest = k;
+    }
+    return nearest;
+}
+
+// Finds the nearest storm around the site now and follows the forecast
+// forward. The ETA is the first slot the storm covers the site's own cell,
+// or else the distance over the fastest closing speed seen at any later
+// slot.
+static void assess_threat(int site, long long now) {
+    const SiteSamples *samples = &g_samples[site];
+    LightningThreat *threat = &g_lightning_threats[site];
+    threat->distance_km = -1.0f;
+    threat->bearing_deg = 0.0f;
+    threat->eta_minutes = -1;
+    int nearest = nearest_threat(samples, now, 1);
+    if (nearest < 0) return;
+    threat->distance_km = samples->distance_km[nearest];
+    threat->bearing_deg = samples->bearing_deg[nearest];
+    if (threat->distance_km == 0.0f) {
+        threat->eta_minutes = 0;
+        return;
+    }
+
+    int step = g_lightning_step_minutes * 60;
+    long long end = now + g_lightning_horizon_hours * 3600LL;
+    double fastest = 0.0; // km/s
+    for (long long t = now + step; t < end; t += step) {
+        int k = nearest_threat(samples, t, 0);
+        if (k < 0) continue;
+        if (samples->distance_km[k] == 0.0f) {
+            threat->eta_minutes = (int)((t - now) / 60);
+            return;
+        }
+        double closing = (threat->distance_km - samples->distance_km[k]) / (double)(t - now);
+        if (closing > fastest) fastest = closing;
+    }
+    if (fastest > 0.0) threat->eta_minutes = (int)(threat->distance_km / fastest / 60.0);
+}
+
+// Puts the nearest recent strike in place of the forecast threat when it
+// is nearer, and returns its band: 2 within STRIKE_WARNING_KM, 1 within
+// STRIKE_WATCH_KM, else 0.
+static int apply_strikes(int site, long long now) {
+    StrikeNearest nearest;
+    if (!strikes_nearest(site, now, &nearest)) return 0;
+    LightningThreat *threat = &g_lightning_threats[site];
+    if (threat->distance_km < 0.0f || nearest.distance_km < threat->distance_km) {
+        threat->distance_km = nearest.distance_km > 0.0f ? nearest.distance_km : 0.01f;
+        threat->bearing_deg = nearest.bearing_deg;
+    }
+    return nearest.distance_km <= STRIKE_WARNING_KM ? 2 : nearest.distance_km <= STRIKE_WATCH_KM ? 1 : 0;
+}
+
+// --- Assessment ---
+
+// Peak risk over the slots overlapping [from, to), and the start of the
+// first slot at or above threshold (-1 if none).
+static float scan_risk(const LightningSeries *series, long long now, long long to, float threshold, long long *onset) {
+    float peak = 0.0f;
+    *onset = -1;
+    for (int i = 0; i < series->count; i++) {
+        long long slot_start = series->start + (long long)i * series->step;
+        if (slot_start + series->step <= now) continue;
+        if (slot_start >= to) break;
+        float risk = g_risk[series->offset + i];
+        if (risk > peak) peak = risk;
+        if (risk >= threshold && *onset < 0) *onset = slot_start > now ? slot_start : now;
+    }
+    return peak;
+}
+
+// The level the site's forecast and strikes call for. Warning: risk within
+// the lead time; watch: risk anywhere within the horizon. The thresholds
+// depend on the current level, entered above one and left below a lower
+// one, so a score hovering near a threshold does not flap. Observed strikes
+// outrank the forecast.
+static LightningLevel wanted_level(const LightningSiteState *state, const LightningSeries *series, long long now,
+                                   float *risk, long long *onset) {
+    LightningLevel level = LIGHTNING_CLEAR;
+    *risk = 0.0f;
+    *onset = now;
+    if (series->valid) {
+        float warning_threshold = state->level == LIGHTNING_WARNING ? LIGHTNING_WARNING_EXIT_RISK : LIGHTNING_WARNING_ENTER_RISK;
+        float watch_threshold = state->level != LIGHTNING_CLEAR ? LIGHTNING_WATCH_EXIT_RISK : LIGHTNING_WATCH_ENTER_RISK;
+        float near = scan_risk(series, now, now + LIGHTNING_WARNING_LEAD_MINUTES * 60LL, warning_threshold, onset);
+        if (lightning_is_thunderstorm(series->current_code)) {
+            near = 1.0f;
+            *onset = now;
+        }
+        if (near >= warning_threshold) {
+            *risk = near;
+            return LIGHTNING_WARNING;
+        }
+        *risk = scan_risk(series, now, now + g_lightning_horizon_hours * 3600LL, watch_threshold, onset);
+        if (*risk >= watch_threshold) level = LIGHTNING_WATCH;
+        if (*onset < 0) *onset = now;
+    }
+    if (state->strike_band == 2) {
+        *risk = 1.0f;
+        *onset = now;
+        return LIGHTNING_WARNING;
+    }
+    if (state->strike_band == 1 && level == LIGHTNING_CLEAR) {
+        *onset = now;
+        return LIGHTNING_WATCH;
+    }
+    return level;
+}
+
+void lightning_record_transition(int site, LightningLevel from, LightningLevel to, long long now, float risk) {
+    LightningTransition *transition = &g_lightning_transitions[g_lightning_transition_count++ % LIGHTNING_MAX_TRANSITIONS];
+    transition->site = site;
+    transition->from = from;
+    transition->to = to;
+    transition->time = now;
+    transition->risk = risk;
+}
+
+static int dwell_seconds(LightningLevel level) {
+    return level == LIGHTNING_WARNING ? LIGHTNING_WARNING_DWELL_SECONDS : level == LIGHTNING_WATCH ? LIGHTNING_WATCH_DWELL_SECONDS : 0;
+}
+
+// Steps the site's state machine. Higher levels are entered at once; a
+// level is left only once nothing has supported it for its dwell time.
+static void evaluate_site(int site, long long now) {
+    LightningSiteState *state = &g_lightning_states[site];
+    float risk;
+    long long onset;
+    LightningLevel wanted = wanted_level(state, site_series(site), now, &risk, &onset);
+    if (wanted < state->level && now - state->held < dwell_seconds(state->level)) return;
+    if (wanted != state->level) {
+        lightning_record_transition(site, state->level, wanted, now, risk);
+        state->level = wanted;
+        state->since = now;
+    }
+    state->held = now;
+    state->risk = risk;
+    state->onset = onset;
+}
+
+// Updates each site's nearest threat, then re-evaluates the sites with new
+// evidence: a new forecast run for their cell, a forecast slot passed, or
+// a strike band change, and those whose level's dwell has run out.
+// Returns the number of transitions recorded.
+int lightning_assess(long long now) {
+    uint64_t before = g_lightning_transition_count;
+    for (int s = 0; s < g_sites_assigned; s++) {
+        LightningSiteState *state = &g_lightning_states[s];
+        const LightningSeries *series = site_series(s);
+        assess_threat(s, now);
+        int band = apply_strikes(s, now);
+        long long slot = series->valid ? (now - series->start) / series->step : -1;
+        int expired = state->level != LIGHTNING_CLEAR && now - state->held >= dwell_seconds(state->level);
+        if (series->run == state->run && slot == state->slot && band == state->strike_band && !expired) continue;
+        state->run = series->run;
+        state->slot = slot;
+        state->strike_band = band;
+        evaluate_site(s, now);
+    }
+    return (int)(g_lightning_transition_count - before);
+}
+
+// Takes a site's state as a worker holding its forecasts evaluated it. The
+// site has no forecast here, so lightning_assess leaves it alone.
+void lightning_store_site(int site, const LightningSiteState *state, const LightningThreat *threat) {
+    if (site < 0 || site >= MAX_SITES) return;
+    g_lightning_states[site] = *state;
+    g_lightning_threats[site] = *threat;
+    if (site >= g_sites_stored) g_sites_stored = site + 1;
+}
+
+// Assigns the site now and takes its level over from another process, or
+// from the results merged here, so its state machine carries on rather
+// than starting clear and escalating again. The next assessment still
+// re-evaluates it against this process's forecasts.
+void lightning_restore_site(int site, const LightningSiteState *state) {
+    LightningSiteState kept = *state; // May be the site's own state, which assigning clears
+    if (site < 0 || site >= g_site_count) return;
+    for (; g_sites_assigned <= site; g_sites_assigned++) assign_site(g_sites_assigned);
+    LightningSiteState *restored = &g_lightning_states[site];
+    restored->level = kept.level;
+    restored->risk = kept.risk;
+    restored->onset = kept.onset;
+    restored->since = kept.since;
+    restored->held = kept.held;
+}
+
+// --- Benchmark ---
+
+static int64_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    return bits;
+}
+
+static uint32_t build_values(FbBuilder *b, int variable, const float *values, int count) {
+    uint32_t vector = fb_struct_vector(b, values, count, sizeof(float));
+    FbField fields[] = { { FB_VALUES_VARIABLE, 1, variable, 0 }, { FB_VALUES_VALUES, 4, vector, 1 } };
+    return fb_table(b, fields, 2);
+}
+
+// One site's response as Open-Meteo would encode it.
+static void build_response(FbBuilder *b, float lat, float lon, long long start, int step, float *columns[4], int count) {
+    static const int variables[4] = { FB_VARIABLE_WEATHER_CODE, FB_VARIABLE_LIGHTNING_POTENTIAL, FB_VARIABLE_CAPE,
+                                      FB_VARIABLE_PRECIPITATION };
+    uint32_t tables[4];
+    for (int v = 0; v < 4; v++) tables[v] = build_values(b, variables[v], columns[v], count);
+    uint32_t vector = fb_offset_vector(b, tables, 4);
+    FbField block_fields[] = { { FB_SERIES_TIME, 8, start, 0 }, { FB_SERIES_INTERVAL, 4, step, 0 },
+                               { FB_SERIES_VARIABLES, 4, vector, 1 } };
+    uint32_t block = fb_table(b, block_fields, 3);
+
+    FbField code_fields[] = { { FB_VALUES_VARIABLE, 1, FB_VARIABLE_WEATHER_CODE, 0 }, { FB_VALUES_VALUE, 4, float_bits(columns[0][0]), 0 } };
+    uint32_t code = fb_table(b, code_fields, 2);
+    uint32_t current_vector = fb_offset_vector(b, &code, 1);
+    FbField current_fields[] = { { FB_SERIES_TIME, 8, start, 0 }, { FB_SERIES_VARIABLES, 4, current_vector, 1 } };
+    uint32_t current = fb_table(b, current_fields, 2);
+
+    FbField fields[] = { { FB_RESPONSE_LATITUDE, 4, float_bits(lat), 0 }, { FB_RESPONSE_LONGITUDE, 4, float_bits(lon), 0 },
+                         { FB_RESPONSE_CURRENT, 4, current, 1 },
+                         { step == 900 ? FB_RESPONSE_MINUTELY_15 : FB_RESPONSE_HOURLY, 4, block, 1 } };
+    fb_finish(b, fb_table(b, fields, 4));
+}
+
+static double risk_checksum(int sites) {
+    double sum = 0.0;
+    for (int s = 0; s < sites; s++) {
+        const LightningSeries *series = site_series(s);
+        for (int i = 0; series->valid && i < series->count; i++) sum += g_risk[series->offset + i] * (i + 1);
+    }
+    return sum;
+}
+
+static double time_parse(const char *body, size_t length, int sites, int repeats, double *checksum) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) {
+        g_slots_used = 0;
+        lightning_parse(body, length, g_lightning_site_cell, sites, 0);
+    }
+    double us = elapsed_us(&start) / repeats;
+    *checksum = risk_checksum(sites);
+    return us;
+}
+
+// Decodes the same synthetic 48-hour, 15-minute forecast for every site
+// from JSON and from FlatBuffers. Sites are placed in separate cells.
+int lightning_benchmark(int sites) {
+    int stale[LIGHTNING_MAX_CELLS];
+    if (sites > MAX_SITES) sites = MAX_SITES;
+    while (g_site_count < sites) {
+        int n = g_site_count;
+        sites_add("bench", 40.0f + (n / 100) * 0.25f, (n % 100) * 0.25f, DEFAULT_SITE_MMI_THRESHOLD);
+    }
+    if (lightning_begin_update(0, stale, LIGHTNING_MAX_CELLS) < sites) return 1;
+    g_lightning_step_minutes = 15;
+    g_lightning_horizon_hours = LIGHTNING_MAX_HORIZON_HOURS;
+    const int count = LIGHTNING_MAX_HORIZON_HOURS * 4, step = 900;
+    long long start = (long long)time(NULL) / step * step;
+
+    size_t json_capacity = (size_t)sites * count * 40 + 1024, json_length = 0;
+    char *json = malloc(json_capacity);
+    size_t fb_capacity = 0, fb_length = 0;
+    uint8_t *flat = NULL;
+    float *columns[4];
+    for (int v = 0; v < 4; v++) columns[v] = malloc(count * sizeof(float));
+    if (!json || !columns[0] || !columns[1] || !columns[2] || !columns[3]) return 1;
+
+    static const char *names[4] = { "weather_code", "lightning_potential", "cape", "precipitation" };
+    uint64_t state = 12345;
+    json_length += snprintf(json + json_length, json_capacity - json_length, "[");
+    for (int s = 0; s < sites; s++) {
+        for (int i = 0; i < count; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            columns[0][i] = (state >> 60) == 0 ? 95.0f : (float)((state >> 40) % 4);
+            columns[1][i] = (float)((state >> 20) % 1500) / 100.0f;
+            columns[2][i] = (float)((state >> 30) % 3000);
+            columns[3][i] = (float)((state >> 10) % 400) / 100.0f;
+        }
+        json_length += snprintf(json + json_length, json_capacity - json_length,
+                                "%s{\"current\":{\"time\":%lld,\"weather_code\":%d},\"minutely_15\":{\"time\":[", s ? "," : "", start,
+                                (int)columns[0][0]);
+        for (int i = 0; i < count; i++)
+            json_length += snprintf(json + json_length, json_capacity - json_length, "%s%lld", i ? "," : "", start + (long long)i * step);
+        for (int v = 0; v < 4; v++) {
+            json_length += snprintf(json + json_length, json_capacity - json_length, "],\"%s\":[", names[v]);
+            for (int i = 0; i < count; i++)
+                json_length += snprintf(json + json_length, json_capacity - json_length, v ? "%s%.2f" : "%s%.0f", i ? "," : "", columns[v][i]);
+        }
+        json_length += snprintf(json + json_length, json_capacity - json_length, "]}}");
+
+        FbBuilder b = { 0 };
+        build_response(&b, 50.0f, 0.0f, start, step, columns, count);
+        uint32_t size = (uint32_t)b.size;
+        if (b.failed || fb_length + 4 + size > fb_capacity) {
+            fb_capacity = (fb_length + 4 + size) * 2;
+            uint8_t *grown = b.failed ? NULL : realloc(flat, fb_capacity);
+            if (!grown) return 1;
+            flat = grown;
+        }
+        memcpy(flat + fb_length, &size, 4);
+        memcpy(flat + fb_length + 4, fb_bytes(&b), size);
+        fb_length += 4 + size;
+        free(b.data);
+    }
+    json_length += snprintf(json + json_length, json_capacity - json_length, "]");
+
+    const int repeats = 20;
+    double json_sum, fb_sum;
+    printf("Lightning decode benchmark: %d sites x %d slots\n\n", sites, count);
+    double json_us = time_parse(json, json_length, sites, repeats, &json_sum);
+    g_lightning_format = LIGHTNING_FORMAT_FLATBUFFERS;
+    double fb_us = time_parse((const char *)flat, fb_length, sites, repeats, &fb_sum);
+    printf("JSON:         %10.1f us/response (%zu bytes)\n", json_us, json_length);
+    printf("FlatBuffers:  %10.1f us/response (%zu bytes)\n", fb_us, fb_length);
+    printf("Decoded series %s\n", json_sum == fb_sum ? "match" : "differ");
+
+    for (int v = 0; v < 4; v++) free(columns[v]);
+    free(json);
+    free(flat);
+    return json_sum == fb_sum ? 0 : 1;
+}
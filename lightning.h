@@ -0,0 +1,133 @@
+/*
+ * lightning.h - Thunderstorm watch for monitored sites
+ *
+ * Each site's Open-Meteo forecast is kept as a time series at hourly or
+ * 15-minute resolution, out to a configurable horizon: weather code,
+ * lightning potential, CAPE and precipitation, fused into a 0..1 storm risk
+ * per slot. The series for all sites share one compact set of columns,
+ * sized to the latest responses. Sites are requested in batches of
+ * coordinates, one call per batch.
+ *
+ * Coordinates are snapped to a forecast grid and the series is kept per
+ * grid cell. Sites in the same cell share one cached forecast. A cell is
+ * refetched only once the model has published a newer run.
+ *
+ * Rings of sample cells around each site show where a storm is and which
+ * way it is heading. Sampling costs at most LIGHTNING_SAMPLE_REQUESTS
+ * requests per cycle, however many sites there are.
+ *
+ * Each site has its own storm state. It is re-evaluated only when its cell
+ * gets a new forecast run, the forecast moves on a slot, or a nearby strike
+ * changes band. Levels escalate at once but are held for a dwell time after
+ * the last evidence for them, and every change is recorded.
+ */
+
+#ifndef LIGHTNING_H
+#define LIGHTNING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sites.h"
+
+#define LIGHTNING_DEFAULT_HORIZON_HOURS 6
+#define LIGHTNING_MAX_HORIZON_HOURS 48
+#define LIGHTNING_WARNING_LEAD_MINUTES 45 // Storms forecast this soon warn rather than watch
+#define LIGHTNING_BATCH_SITES 50          // Coordinates per request
+#define LIGHTNING_GRID_DEGREES 0.1        // Cell size, about the forecast models' grid spacing
+#define LIGHTNING_MODEL_UPDATE_SECONDS 3600 // Forecast runs are published hourly
+#define LIGHTNING_MODEL_DELAY_SECONDS 600   // after this long past the hour
+#define LIGHTNING_URL_LEN 4096
+#define LIGHTNING_RING_BEARINGS 8
+#define LIGHTNING_RINGS 2                  // Evenly spaced out to the outer radius
+#define LIGHTNING_SAMPLES (1 + LIGHTNING_RING_BEARINGS * LIGHTNING_RINGS) // The site's own cell first
+#define LIGHTNING_DEFAULT_RING_KM 50.0f
+#define LIGHTNING_SAMPLE_REQUESTS 4        // Most requests per cycle spent on ring cells
+#define LIGHTNING_MAX_CELLS (MAX_SITES * LIGHTNING_SAMPLES) // Room for every site's own and ring cells, all distinct
+
+// Risk thresholds; each level is entered above one and left below a lower one
+#define LIGHTNING_WARNING_ENTER_RISK 0.60f
+#define LIGHTNING_WARNING_EXIT_RISK 0.40f
+#define LIGHTNING_WATCH_ENTER_RISK 0.35f
+#define LIGHTNING_WATCH_EXIT_RISK 0.20f
+#define LIGHTNING_WARNING_DWELL_SECONDS 1800 // A level outlasts the last evidence for it by this long
+#define LIGHTNING_WATCH_DWELL_SECONDS 3600
+#define LIGHTNING_MAX_TRANSITIONS 64
+
+typedef enum {
+    LIGHTNING_CLEAR,
+    LIGHTNING_WATCH,
+    LIGHTNING_WARNING,
+} LightningLevel;
+
+typedef enum {
+    LIGHTNING_FORMAT_JSON,
+    LIGHTNING_FORMAT_FLATBUFFERS, // Open-Meteo's format=flatbuffers, read in place
+} LightningFormat;
+
+typedef struct {
+    int valid;
+    int current_code;
+    long long start; // Unix time of the first slot
+    int step;        // Seconds per slot
+    int count;
+    uint32_t offset; // First slot in the shared columns
+    uint32_t run;    // Counts the forecasts stored for the cell
+} LightningSeries;
+
+typedef struct {
+    int lat_index, lon_index; // Grid cell key
+    float lat, lon;           // Cell centre, the coordinate requested
+    long long expires;        // Unix time the cached forecast goes stale; 0 if never fetched
+    int has_site;             // Some site sits in it, rather than only ring samples
+    LightningSeries series;
+} LightningCell;
+
+typedef struct {
+    float distance_km; // Nearest sample at storm risk now; 0 at the site, negative if none
+    float bearing_deg; // From the site towards it
+    int eta_minutes;   // Until the storm reaches the site; -1 if it is not approaching
+} LightningThreat;
+
+typedef struct {
+    LightningLevel level;
+    float risk;       // Peak risk over the window that last set or held the level
+    long long onset;  // Unix time of the first slot at that risk
+    long long since;  // Unix time the level was entered
+    long long held;   // Last time a forecast or strike supported the level
+    uint32_t run;     // Cell forecast run last evaluated
+    long long slot;   // Forecast slot current then
+    int strike_band;  // 0 none, 1 within watch, 2 within warning distance
+} LightningSiteState;
+
+typedef struct {
+    int site;
+    LightningLevel from, to;
+    long long time;
+    float risk;
+} LightningTransition;
+
+extern int g_lightning_horizon_hours;
+extern int g_lightning_step_minutes; // 60 or 15
+extern LightningFormat g_lightning_format;
+extern LightningCell g_lightning_cells[LIGHTNING_MAX_CELLS];
+extern int g_lightning_cell_count;
+extern int g_lightning_site_cell[MAX_SITES];
+extern float g_lightning_ring_km; // Outer ring radius; 0 disables sampling
+extern LightningThreat g_lightning_threats[MAX_SITES];
+extern LightningSiteState g_lightning_states[MAX_SITES];
+extern LightningTransition g_lightning_transitions[LIGHTNING_MAX_TRANSITIONS]; // Change n at n % the size
+extern uint64_t g_lightning_transition_count;
+
+void lightning_reset_sites();
+int lightning_begin_update(long long now, int *stale, int max);
+int lightning_build_url(char *buffer, size_t size, const int *cells, int count);
+int lightning_parse(const char *body, size_t length, const int *cells, int count, long long now);
+const LightningSiteState *lightning_site(int site);
+int lightning_assess(long long now);
+void lightning_record_transition(int site, LightningLevel from, LightningLevel to, long long now, float risk);
+void lightning_restore_site(int site, const LightningSiteState *state);
+void lightning_store_site(int site, const LightningSiteState *state, const LightningThreat *threat);
+int lightning_is_thunderstorm(int code);
+int lightning_benchmark(int sites);
+
+#endif // LIGHTNING_H
@@ -14,72 +14,105 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <signal.h>
 #include <unistd.h> // For sleep()
 #include <curl/curl.h>
-#include <jansson.h>
+#include "region.h"
+#include "sites.h"
+#include "traveltime.h"
+#include "exposure.h"
+#include "catalog.h"
+#include "etas.h"
+#include "rank.h"
+#include "indexes.h"
+#include "places.h"
+#include "rollup.h"
+#include "arrow.h"
+#include "lightning.h"
+#include "strikes.h"
+#include "shake.h"
+#include "tui.h"
+#include "map.h"
+#include "proxy.h"
+#include "relay.h"
+#include "hostcache.h"
+#include "shard.h"
+#include "monitor.h"
+#include "quakes.h"
+#include "fetch.h"
+#include "once.h"
+#include "display.h"
+#include "alerts.h"
 
 // --- Constants ---
-#define UPDATE_INTERVAL_SECONDS 120 // Update every 2 minutes
-
-// Seismic Monitor Constants
-#define USGS_URL "https://earthquake.usgs.gov/earthquakes/feed/v1.0/summary/all_hour.geojson"
+#define DEFAULT_FEED "hour" // Also "day", "week" or "month" to seed more history
 #define MAJOR_QUAKE_THRESHOLD 6.0
-#define MAX_QUAKES 200
-#define MAX_ALERTED_IDS 50
-
-// Lightning Monitor Constants
-#define WEATHER_API_URL_FORMAT "https://api.open-meteo.com/v1/forecast?latitude=%.2f&longitude=%.2f&current=weather_code&hourly=weather_code&forecast_hours=6"
-#define LIGHTNING_ALERT_CODE_1 95 // Thunderstorm: Slight or moderate
-#define LIGHTNING_ALERT_CODE_2 96 // Thunderstorm with slight hail
-#define LIGHTNING_ALERT_CODE_3 99 // Thunderstorm with heavy hail
-
-// ANSI color codes
-#define COLOR_RED     "\x1b[31m"
-#define COLOR_YELLOW  "\x1b[33m"
-#define COLOR_GREEN   "\x1b[32m"
-#define COLOR_CYAN    "\x1b[36m"
-#define COLOR_RESET   "\x1b[0m"
-
-// --- Structs ---
-struct MemoryStruct {
-    char *memory;
-    size_t size;
-};
-
-typedef struct {
-    double mag;
-    char place[256];
-    char time_ago[20];
-    char id[64];
-} Earthquake;
+#define COUNTDOWN_REFRESH_SECONDS 1
 
 // --- Globals ---
-// Seismic data
-Earthquake g_quakes[MAX_QUAKES];
-int g_quake_count = 0;
-char g_alerted_ids[MAX_ALERTED_IDS][64];
-int g_alerted_ids_count = 0;
-
-// Lightning data
-int g_weather_code = 0;
-int g_hourly_weather_codes[6] = {0};
-int g_is_storm_active = 0;
+double g_exposure_alert_threshold = 0.0; // 0 disables exposure-driven alerts
+const char *g_feed = DEFAULT_FEED;
+const char *g_history_view = NULL; // "newest", "largest" or "nearest"; NULL hides it
+const char *g_place_query = NULL;  // Only list events whose place contains this
+const char *g_arrow_path = NULL;   // Rewritten with the whole history after every update
+volatile sig_atomic_t g_export_requested = 0; // Set by SIGUSR1
+const char *g_strike_feed = NULL;  // host:port of a live strike stream
+int g_shake_port = 0;              // UDP port a local seismometer broadcasts to; 0 disables
+int g_interactive = 0;             // Browse the history in a full-screen view instead
+int g_once = 0;                    // Fetch once, write NDJSON and exit
+int g_proxy_port = 0;              // TCP port the LAN feed proxy serves on; 0 disables
+int g_relay_port = 0;              // TCP port event deltas are served to other monitors on; 0 disables
+const char *g_relay_source = NULL; // host:port of a relay to follow instead of polling USGS
+const char *g_hostcache_dir = HOSTCACHE_DEFAULT_DIR; // Shared with the other monitors on this host; "none" disables
+int g_local_workers = 0;           // Processes to spread site evaluation over; 0 evaluates here
+const char *g_remote_workers[SHARD_MAX_WORKERS]; // host:port of workers on other machines
+int g_remote_worker_count = 0;
 float g_latitude = 54.53; // Default: Guisborough, UK
 float g_longitude = -1.05;
 
 // --- Function Prototypes ---
-static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp);
-void fetch_seismic_data(float min_magnitude, float alert_threshold);
-void fetch_lightning_data();
-void render_display(float min_magnitude);
-void format_time_ago(long long event_time_ms, char* buffer, size_t buffer_size);
-int compare_quakes(const void *a, const void *b);
-void check_for_quake_alerts(float alert_threshold);
+void request_export(int signal_number);
+
+// --- Benchmarks ---
+// --bench-<name> [size] runs one and exits
+typedef struct {
+    const char *flag;
+    int (*run)(int size);
+    int default_size;
+} Benchmark;
+
+static const Benchmark BENCHMARKS[] = {
+    { "--bench-etas", etas_benchmark, 10000 },
+    { "--bench-index", index_benchmark, 1000000 },
+    { "--bench-places", places_benchmark, 1000000 },
+    { "--bench-rollup", rollup_benchmark, 1000000 },
+    { "--bench-lightning", lightning_benchmark, 500 },
+    { "--bench-strikes", strikes_benchmark, 1000000 },
+    { "--bench-shake", shake_benchmark, 3600 },
+    { "--bench-tui", tui_benchmark, 200000 },
+    { "--bench-map", map_benchmark, 1000 },
+    { "--bench-proxy", proxy_benchmark, 200000 },
+    { "--bench-relay", relay_benchmark, 100000 },
+    { "--bench-shard", shard_benchmark, MAX_SITES },
+};
+
+static const Benchmark *find_benchmark(const char *flag) {
+    for (size_t b = 0; b < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); b++) {
+        if (strcmp(flag, BENCHMARKS[b].flag) == 0) return &BENCHMARKS[b];
+    }
+    return NULL;
+}
 
 // --- Main Function ---
 int main(int argc, char *argv[]) {
     float min_magnitude = 0.0;
     float alert_threshold = MAJOR_QUAKE_THRESHOLD;
+    float site_mmi_threshold = DEFAULT_SITE_MMI_THRESHOLD;
+    const char *sites_path = NULL;
+    long catalog_capacity = CATALOG_DEFAULT_CAPACITY;
+    const Benchmark *benchmark = NULL;
+    int benchmark_size = 0;
+    int worker_port = 0; // Serve coordinators instead of monitoring
 
     // --- Argument Parsing ---
     for (int i = 1; i < argc; i++) {
@@ -92,219 +125,208 @@ int main(int argc, char *argv[]) {
             g_latitude = atof(argv[i + 1]);
             g_longitude = atof(argv[i + 2]);
             i += 2; // Consume the two values
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            region_filter_add(atoi(argv[i + 1]));
+            i++;
+        } else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            region_load_raster(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            sites_path = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+            site_mmi_threshold = atof(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            traveltime_load_table(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            g_arrival_min_magnitude = atof(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-E") == 0 && i + 1 < argc) {
+            exposure_load(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-X") == 0 && i + 1 < argc) {
+            g_exposure_alert_threshold = atof(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            g_feed = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+            catalog_capacity = atol(argv[i + 1]);
+            if (catalog_capacity < MAX_QUAKES) catalog_capacity = MAX_QUAKES;
+            i++;
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            rank_parse_weights(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-V") == 0 && i + 1 < argc) {
+            g_history_view = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            g_place_query = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) {
+            g_arrow_path = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+            g_lightning_horizon_hours = atoi(argv[i + 1]);
+            if (g_lightning_horizon_hours < 1) g_lightning_horizon_hours = 1;
+            if (g_lightning_horizon_hours > LIGHTNING_MAX_HORIZON_HOURS) g_lightning_horizon_hours = LIGHTNING_MAX_HORIZON_HOURS;
+            i++;
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            g_lightning_step_minutes = atoi(argv[i + 1]) == 15 ? 15 : 60;
+            i++;
+        } else if (strcmp(argv[i], "-G") == 0 && i + 1 < argc) {
+            g_lightning_ring_km = atof(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            g_strike_feed = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-U") == 0 && i + 1 < argc) {
+            g_shake_port = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            g_interactive = 1;
+        } else if (strcmp(argv[i], "-o") == 0) {
+            g_once = 1;
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            g_proxy_port = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+            g_relay_port = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-J") == 0 && i + 1 < argc) {
+            g_relay_source = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+            g_hostcache_dir = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc) {
+            g_local_workers = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            if (g_remote_worker_count < SHARD_MAX_WORKERS) g_remote_workers[g_remote_worker_count++] = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "-Y") == 0 && i + 1 < argc) {
+            worker_port = atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "flatbuffers") == 0) g_lightning_format = LIGHTNING_FORMAT_FLATBUFFERS;
+            else if (strcmp(argv[i + 1], "json") == 0) g_lightning_format = LIGHTNING_FORMAT_JSON;
+            else {
+                fprintf(stderr, "Unknown forecast format: %s (use json or flatbuffers)\n", argv[i + 1]);
+                return 1;
+            }
+            i++;
+        } else if (strncmp(argv[i], "--bench-", 8) == 0) {
+            benchmark = find_benchmark(argv[i]);
+            if (!benchmark) {
+                fprintf(stderr, "Unknown benchmark: %s\n", argv[i]);
+                return 1;
+            }
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) benchmark_size = atoi(argv[++i]);
         } else if (strcmp(argv[i], "test") == 0) {
             alert_threshold = 0.0;
         } else {
-            printf("Unknown argument: %s\n", argv[i]);
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
         }
     }
 
+    if (benchmark) return benchmark->run(benchmark_size > 0 ? benchmark_size : benchmark->default_size);
+    if (worker_port) return shard_listen(worker_port, serve_coordinator); // With every option above applied
+    if (catalog_init(catalog_capacity) != 0) return 1;
+    if (sites_path) sites_load(sites_path, site_mmi_threshold);
+    if (g_site_count == 0) sites_add("Home", g_latitude, g_longitude, site_mmi_threshold);
+    if (g_once) return run_once(min_magnitude, alert_threshold);
+
     printf("--- Starting Environmental Monitor ---\n");
     printf("Seismic Filter: M%.1f+ (Alerts >= %.1f)\n", min_magnitude, alert_threshold);
     printf("Lightning Location: %.2f, %.2f\n", g_latitude, g_longitude);
+    printf("Lightning Watch: next %dh at %d-minute resolution (%s)\n", g_lightning_horizon_hours, g_lightning_step_minutes,
+           g_lightning_format == LIGHTNING_FORMAT_FLATBUFFERS ? "flatbuffers" : "json");
+    printf("Shaking Sites: %d\n", g_site_count);
+    if (g_shake_port) printf("Local Seismometer: UDP port %d\n", g_shake_port);
+    if (g_proxy_port) printf("Feed Proxy: TCP port %d\n", g_proxy_port);
+    if (g_relay_port) printf("Event Relay: serving on TCP port %d\n", g_relay_port);
+    if (g_relay_source) printf("Event Relay: following %s\n", g_relay_source);
+    if (strcmp(g_hostcache_dir, "none") != 0 && hostcache_open(g_hostcache_dir) == 0) printf("Shared Feed Cache: %s\n", g_hostcache_dir);
+    if ((g_local_workers > 0 || g_remote_worker_count > 0) && start_workers() > 0) {
+        printf("Site Workers: %d, %d sites each or fewer\n", g_shard_count, g_shard_workers[0].site_count);
+    }
+    printf("Ranking Weights: magnitude %.2g, proximity %.2g, intensity %.2g, recency %.2g, exposure %.2g\n",
+           g_rank_weights.magnitude, g_rank_weights.proximity, g_rank_weights.intensity, g_rank_weights.recency,
+           g_rank_weights.exposure);
     sleep(4);
 
     curl_global_init(CURL_GLOBAL_ALL);
-
-    while (1) {
-        fetch_seismic_data(min_magnitude, alert_threshold);
+    signal(SIGUSR1, request_export);
+    if (g_strike_feed) strikes_start(g_strike_feed);
+    if (g_shake_port) shake_start(g_shake_port);
+    if (g_proxy_port && proxy_start(g_proxy_port) < 0) g_proxy_port = 0;
+    if (g_relay_port && relay_serve(g_relay_port) < 0) g_relay_port = 0;
+    if (g_relay_source && relay_join(g_relay_source) != 0) g_relay_source = NULL;
+    if (g_interactive && tui_start() != 0) g_interactive = 0;
+
+    int running = 1;
+    while (running) {
+        if (g_relay_source) apply_relay_deltas(min_magnitude, alert_threshold);
+        else fetch_seismic_data(min_magnitude, alert_threshold);
+        if (g_arrow_path) export_history(0);
         fetch_lightning_data();
+        time_t next_update = time(NULL) + UPDATE_INTERVAL_SECONDS;
         render_display(min_magnitude);
-        printf("\nWaiting %d seconds for the next update...\n", UPDATE_INTERVAL_SECONDS);
-        sleep(UPDATE_INTERVAL_SECONDS);
-    }
-
-    curl_global_cleanup();
-    return 0;
-}
-
-
-// --- Data Fetching and Processing ---
-
-static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if (!ptr) {
-        printf("Not enough memory (realloc returned NULL)\n");
-        return 0;
-    }
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-    return realsize;
-}
-
-void fetch_seismic_data(float min_magnitude, float alert_threshold) {
-    CURL *curl_handle;
-    CURLcode res;
-    struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
-    g_quake_count = 0;
-
-    curl_handle = curl_easy_init();
-    if (curl_handle) {
-        curl_easy_setopt(curl_handle, CURLOPT_URL, USGS_URL);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_memory_callback);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-        curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        res = curl_easy_perform(curl_handle);
-
-        if (res == CURLE_OK) {
-            json_t *root;
-            json_error_t error;
-            root = json_loads(chunk.memory, 0, &error);
-            if (root) {
-                json_t *features = json_object_get(root, "features");
-                for (size_t i = 0; i < json_array_size(features) && g_quake_count < MAX_QUAKES; i++) {
-                    json_t *value = json_array_get(features, i);
-                    json_t *properties = json_object_get(value, "properties");
-                    double mag = json_real_value(json_object_get(properties, "mag"));
-
-                    if (mag >= min_magnitude) {
-                        g_quakes[g_quake_count].mag = mag;
-                        const char *place = json_string_value(json_object_get(properties, "place"));
-                        if(place) strncpy(g_quakes[g_quake_count].place, place, sizeof(g_quakes[g_quake_count].place) - 1);
-                        const char *id = json_string_value(json_object_get(properties, "id"));
-                        if(id) strncpy(g_quakes[g_quake_count].id, id, sizeof(g_quakes[g_quake_count].id) - 1);
-                        long long time = json_integer_value(json_object_get(properties, "time"));
-                        format_time_ago(time, g_quakes[g_quake_count].time_ago, sizeof(g_quakes[g_quake_count].time_ago));
-                        g_quake_count++;
-                    }
+        if (!g_interactive) printf("\nWaiting %d seconds for the next update...\n", UPDATE_INTERVAL_SECONDS);
+        // Redraw every second while wave countdowns are running, and on
+        // every key in the interactive view
+        while (time(NULL) < next_update) {
+            int key_redraw = 0;
+            if (g_interactive) {
+                TuiAction action = tui_wait(COUNTDOWN_REFRESH_SECONDS * 1000);
+                if (action == TUI_QUIT) {
+                    running = 0;
+                    break;
                 }
-                qsort(g_quakes, g_quake_count, sizeof(Earthquake), compare_quakes);
-                check_for_quake_alerts(alert_threshold);
-                json_decref(root);
+                key_redraw = action == TUI_REDRAW;
+            } else {
+                sleep(COUNTDOWN_REFRESH_SECONDS);
             }
-        }
-        curl_easy_cleanup(curl_handle);
-    }
-    free(chunk.memory);
-}
-
-void fetch_lightning_data() {
-    CURL *curl_handle;
-    CURLcode res;
-    struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
-    g_weather_code = 0;
-    memset(g_hourly_weather_codes, 0, sizeof(g_hourly_weather_codes));
-    
-    char url_buffer[256];
-    snprintf(url_buffer, sizeof(url_buffer), WEATHER_API_URL_FORMAT, g_latitude, g_longitude);
-
-    curl_handle = curl_easy_init();
-    if (curl_handle) {
-        curl_easy_setopt(curl_handle, CURLOPT_URL, url_buffer);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_memory_callback);
-        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-        curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
-        res = curl_easy_perform(curl_handle);
-
-        if (res == CURLE_OK) {
-            json_t *root;
-            json_error_t error;
-            root = json_loads(chunk.memory, 0, &error);
-            if (root) {
-                json_t *current = json_object_get(root, "current");
-                if (json_is_object(current)) {
-                    g_weather_code = json_integer_value(json_object_get(current, "weather_code"));
-                }
-                json_t *hourly = json_object_get(root, "hourly");
-                if (json_is_object(hourly)) {
-                    json_t* hourly_codes = json_object_get(hourly, "weather_code");
-                    if (json_is_array(hourly_codes)) {
-                        for (int i = 0; i < 6 && i < json_array_size(hourly_codes); i++) {
-                            g_hourly_weather_codes[i] = json_integer_value(json_array_get(hourly_codes, i));
-                        }
-                    }
-                }
-                json_decref(root);
+            if (g_export_requested) export_history(1);
+            int strikes_changed = g_strike_feed && strikes_update(time(NULL));
+            if (strikes_changed) {
+                lightning_assess(time(NULL));
+                check_for_storm_alerts();
+            }
+            int shake_triggered = g_shake_port && check_for_shake_alerts();
+            int relayed = g_relay_source && apply_relay_deltas(min_magnitude, alert_threshold);
+            if (arrivals_pending() || strikes_changed || shake_triggered || relayed || key_redraw) {
+                render_display(min_magnitude);
+                if (!g_interactive) printf("\nNext update in %ld seconds...\n", (long)(next_update - time(NULL)));
             }
-        }
-        curl_easy_cleanup(curl_handle);
-    }
-    free(chunk.memory);
-}
-
-// --- Display and Utility Functions ---
-
-void render_display(float min_magnitude) {
-    printf("\033[H\033[J"); // Clear console
-    time_t now = time(NULL);
-    char time_buf[100];
-    strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S UTC", gmtime(&now));
-    
-    printf(COLOR_CYAN "--- GLOBAL SEISMIC MONITOR (Min Mag: %.1f) ---" COLOR_RESET, min_magnitude);
-    printf("\nLast Updated: %s\n\n", time_buf);
-    for (int i = 0; i < g_quake_count; i++) {
-        const char* color = (g_quakes[i].mag >= 6.0) ? COLOR_RED : (g_quakes[i].mag >= 4.0) ? COLOR_YELLOW : COLOR_GREEN;
-        printf("%s[  M %.1f  ]%-10s%s %s\n", color, g_quakes[i].mag, g_quakes[i].time_ago, COLOR_RESET, g_quakes[i].place);
-    }
-
-    printf(COLOR_CYAN "\n--- LIGHTNING PROXIMITY WARNING ---\n" COLOR_RESET);
-    printf("Monitoring Location: %.2f, %.2f\n\n", g_latitude, g_longitude);
-    
-    int is_warning = (g_weather_code == LIGHTNING_ALERT_CODE_1 || g_weather_code == LIGHTNING_ALERT_CODE_2 || g_weather_code == LIGHTNING_ALERT_CODE_3);
-    int is_watch = 0;
-    for (int i = 1; i < 6; i++) { // Check next 5 hours (index 1 to 5)
-        if (g_hourly_weather_codes[i] == LIGHTNING_ALERT_CODE_1 || g_hourly_weather_codes[i] == LIGHTNING_ALERT_CODE_2 || g_hourly_weather_codes[i] == LIGHTNING_ALERT_CODE_3) {
-            is_watch = 1;
-            break;
         }
     }
 
-    if (is_warning) {
-        printf(COLOR_RED "!!! SEVERE THUNDERSTORM WARNING IN EFFECT !!!\n" COLOR_RESET);
-        printf("> Isolate antenna and sensitive equipment immediately.\n");
-        if (!g_is_storm_active) {
-            printf("\a"); fflush(stdout);
-            g_is_storm_active = 1;
-        }
-    } else if (is_watch) {
-        printf(COLOR_YELLOW "--- THUNDERSTORM WATCH ---\n" COLOR_RESET);
-        printf("> Thunderstorms possible within the next 6 hours. Monitor conditions.\n");
-        g_is_storm_active = 0; // Reset active storm flag if warning is over
-    }
-    else {
-        printf(COLOR_GREEN "STATUS: All clear.\n" COLOR_RESET);
-        g_is_storm_active = 0;
-    }
+    tui_stop();
+    curl_global_cleanup();
+    return 0;
 }
 
-void format_time_ago(long long event_time_ms, char* buffer, size_t buffer_size) {
-    time_t now = time(NULL);
-    long long diff_s = (now - (event_time_ms / 1000));
-    if (diff_s < 60) snprintf(buffer, buffer_size, "%llds ago", diff_s);
-    else snprintf(buffer, buffer_size, "%lldm ago", diff_s / 60);
-}
 
-int compare_quakes(const void *a, const void *b) {
-    Earthquake *quakeA = (Earthquake *)a;
-    Earthquake *quakeB = (Earthquake *)b;
-    if (quakeA->mag < quakeB->mag) return 1;
-    if (quakeA->mag > quakeB->mag) return -1;
-    return 0;
+// --- History Export ---
+
+void request_export(int signal_number) {
+    g_export_requested = 1;
 }
 
-void check_for_quake_alerts(float alert_threshold) {
-    for (int i = 0; i < g_quake_count; i++) {
-        if (g_quakes[i].mag >= alert_threshold) {
-            int already_alerted = 0;
-            for (int j = 0; j < g_alerted_ids_count; j++) {
-                if (strcmp(g_quakes[i].id, g_alerted_ids[j]) == 0) {
-                    already_alerted = 1;
-                    break;
-                }
-            }
-            if (!already_alerted) {
-                printf("\a"); fflush(stdout);
-                if (g_alerted_ids_count < MAX_ALERTED_IDS) {
-                    strcpy(g_alerted_ids[g_alerted_ids_count++], g_quakes[i].id);
-                } else {
-                    for(int k=0; k < MAX_ALERTED_IDS - 1; k++) strcpy(g_alerted_ids[k], g_alerted_ids[k+1]);
-                    strcpy(g_alerted_ids[MAX_ALERTED_IDS - 1], g_quakes[i].id);
-                }
-            }
-        }
+// Writes the history as an Arrow file: the rolling -A file, or on SIGUSR1 a
+// snapshot named after the time, beside it or in the working directory.
+void export_history(int snapshot) {
+    char path[1024];
+    g_export_requested = 0;
+    if (snapshot) {
+        if (g_arrow_path) snprintf(path, sizeof(path), "%s.%ld", g_arrow_path, (long)time(NULL));
+        else snprintf(path, sizeof(path), "events-%ld.arrow", (long)time(NULL));
+        if (arrow_export(path) == 0) printf("Exported %llu events to %s\n", (unsigned long long)catalog_size(), path);
+    } else {
+        arrow_export(g_arrow_path);
     }
 }
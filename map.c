@@ -0,0 +1,236 @@
+/*
+ * map.c - Braille map of events and sites
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "map.h"
+#include "timing.h"
+#include "catalog.h"
+#include "indexes.h"
+#include "sites.h"
+#include "coastline_grid.h"
+
+typedef struct {
+    uint32_t glyph; // Code point; 0 in the previous frame forces a write
+    uint8_t color;
+    uint8_t rank;   // Which mark wins a shared cell
+} MapCell;
+
+enum { PEN_NONE, PEN_GREEN, PEN_YELLOW, PEN_RED, PEN_CYAN, PEN_BRIGHT };
+
+// --- Globals ---
+static const char *g_pens[] = { "\x1b[0m", "\x1b[32m", "\x1b[33m", "\x1b[31m", "\x1b[36m", "\x1b[1;37m" };
+static MapCell g_frame[MAP_MAX_ROWS][MAP_MAX_COLS];
+static MapCell g_shown[MAP_MAX_ROWS][MAP_MAX_COLS]; // What the terminal has now
+static int g_shown_top = -1, g_shown_rows, g_shown_cols;
+static double g_center_lat, g_center_lon;
+static int g_centered = 0;
+static int g_zoom = 0;
+static uint64_t g_recent[MAP_MAX_EVENTS];
+
+// --- View ---
+
+void map_center(double lat, double lon) {
+    g_center_lat = lat;
+    g_center_lon = lon;
+    g_centered = 1;
+}
+
+// Moves the centre by whole cells at the current zoom.
+void map_pan(int cols, int rows) {
+    double degrees = 360.0 / (MAP_BASE_COLS << g_zoom);
+    g_center_lon = fmod(g_center_lon + cols * degrees + 540.0, 360.0) - 180.0;
+    g_center_lat -= rows * (180.0 / (MAP_BASE_ROWS << g_zoom));
+    if (g_center_lat > 90.0) g_center_lat = 90.0;
+    if (g_center_lat < -90.0) g_center_lat = -90.0;
+}
+
+void map_zoom(int delta) {
+    g_zoom += delta;
+    if (g_zoom < 0) g_zoom = 0;
+    if (g_zoom >= MAP_ZOOM_LEVELS) g_zoom = MAP_ZOOM_LEVELS - 1;
+}
+
+int map_zoom_level() {
+    return g_zoom;
+}
+
+// Forgets what is on screen, for after the terminal was cleared.
+void map_invalidate() {
+    g_shown_top = -1;
+}
+
+// --- Drawing ---
+
+// Crops the window out of the coastline cells. A world narrower or
+// shorter than the window is centred in it; otherwise longitude wraps.
+static void crop(int rows, int cols, int *origin_row, int *origin_col) {
+    int world_cols = MAP_BASE_COLS << g_zoom, world_rows = MAP_BASE_ROWS << g_zoom;
+    const unsigned char *cells = COASTLINE_CELLS + COASTLINE_OFFSETS[g_zoom];
+    int row0 = (int)floor((90.0 - g_center_lat) / 180.0 * world_rows) - rows / 2;
+    int col0 = (int)floor((g_center_lon + 180.0) / 360.0 * world_cols) - cols / 2;
+    if (world_rows <= rows) row0 = -(rows - world_rows) / 2;
+    else if (row0 < 0) row0 = 0;
+    else if (row0 > world_rows - rows) row0 = world_rows - rows;
+    if (world_cols <= cols) col0 = -(cols - world_cols) / 2;
+    else col0 = ((col0 % world_cols) + world_cols) % world_cols;
+
+    for (int r = 0; r < rows; r++) {
+        MapCell *line = g_frame[r];
+        int world_row = row0 + r;
+        if (world_row < 0 || world_row >= world_rows) {
+            for (int c = 0; c < cols; c++) line[c] = (MapCell){ ' ', PEN_NONE, 0 };
+            continue;
+        }
+        const unsigned char *source = cells + (size_t)world_row * world_cols;
+        for (int c = 0, world_col = col0; c < cols; c++, world_col++) {
+            if (world_col >= world_cols && world_cols > cols) world_col -= world_cols;
+            unsigned char bits = (world_col >= 0 && world_col < world_cols) ? source[world_col] : 0;
+            line[c] = (MapCell){ bits ? 0x2800u | bits : ' ', PEN_NONE, 0 };
+        }
+    }
+    *origin_row = row0;
+    *origin_col = col0;
+}
+
+// Puts a mark on the cell under a point, unless a higher rank is there.
+static void mark(double lat, double lon, int rows, int cols, int origin_row, int origin_col, MapCell cell) {
+    int world_cols = MAP_BASE_COLS << g_zoom, world_rows = MAP_BASE_ROWS << g_zoom;
+    int world_row = (int)((90.0 - lat) / 180.0 * world_rows);
+    int world_col = (int)((lon + 180.0) / 360.0 * world_cols);
+    if (world_row >= world_rows) world_row = world_rows - 1; // The south pole and antimeridian sit on the last cell
+    if (world_col >= world_cols) world_col = world_cols - 1;
+    int r = world_row - origin_row, c = world_col - origin_col;
+    if (world_cols > cols && c < 0) c += world_cols;
+    if (r < 0 || r >= rows || c < 0 || c >= cols || g_frame[r][c].rank > cell.rank) return;
+    g_frame[r][c] = cell;
+}
+
+static void overlay(int rows, int cols, int origin_row, int origin_col, long long now_ms) {
+    int count = index_range(INDEX_TIME, -INFINITY, INFINITY, 1, g_recent, MAP_MAX_EVENTS);
+    int blink_off = (now_ms / 1000) & 1;
+    for (int i = count - 1; i >= 0; i--) { // Oldest first, so newer marks win ties
+        uint64_t slot = catalog_slot(g_recent[i]);
+        float mag = g_catalog.mag[slot];
+        MapCell cell = mag >= 6.0f ? (MapCell){ '@', PEN_RED, 3 } : mag >= 4.0f ? (MapCell){ 'O', PEN_YELLOW, 2 } : (MapCell){ 'o', PEN_GREEN, 1 };
+        if (blink_off && now_ms - g_catalog.time_ms[slot] < MAP_BLINK_MINUTES * 60000LL) {
+            cell.glyph = '*';
+            cell.color = PEN_BRIGHT;
+        }
+        mark(g_catalog.lat[slot], g_catalog.lon[slot], rows, cols, origin_row, origin_col, cell);
+    }
+    for (int s = 0; s < g_site_count; s++) {
+        mark(g_sites[s].lat, g_sites[s].lon, rows, cols, origin_row, origin_col, (MapCell){ '+', PEN_CYAN, 255 });
+    }
+}
+
+static int put_glyph(char *out, uint32_t glyph) {
+    if (glyph < 0x80) {
+        out[0] = (char)glyph;
+        return 1;
+    }
+    out[0] = (char)(0xE0 | glyph >> 12);
+    out[1] = (char)(0x80 | (glyph >> 6 & 0x3F));
+    out[2] = (char)(0x80 | (glyph & 0x3F));
+    return 3;
+}
+
+// Writes the cells that differ from what the terminal shows, each run of
+// them after one cursor move. Returns the bytes written to out.
+static int emit_changes(char *out, int size, int top, int rows, int cols) {
+    int used = 0, pen = PEN_NONE;
+    for (int r = 0; r < rows; r++) {
+        int cursor = -1; // Column the terminal cursor is at on this row, if known
+        for (int c = 0; c < cols; c++) {
+            MapCell *now = &g_frame[r][c], *was = &g_shown[r][c];
+            if (now->glyph == was->glyph && now->color == was->color) continue;
+            if (used + 48 >= size) {
+                map_invalidate(); // Out of room: repaint everything next frame
+                return used;
+            }
+            if (cursor != c) used += snprintf(out + used, size - used, "\x1b[%d;%dH", top + r + 1, c + 1);
+            if (now->color != pen) {
+                pen = now->color;
+                used += snprintf(out + used, size - used, "%s", g_pens[pen]);
+            }
+            used += put_glyph(out + used, now->glyph);
+            cursor = c + 1;
+            *was = *now;
+        }
+    }
+    if (pen != PEN_NONE) used += snprintf(out + used, size - used, "%s", g_pens[PEN_NONE]);
+    return used;
+}
+
+// Lays out the map in the rows from top (0-based) and writes what changed
+// since the last frame to out. Returns the bytes written.
+int map_draw(char *out, int size, int top, int rows, int cols, long long now_ms) {
+    if (rows > MAP_MAX_ROWS) rows = MAP_MAX_ROWS;
+    if (cols > MAP_MAX_COLS) cols = MAP_MAX_COLS;
+    if (rows < 1 || cols < 1) return 0;
+    if (!g_centered && g_site_count > 0) map_center(g_sites[0].lat, g_sites[0].lon);
+    if (top != g_shown_top || rows != g_shown_rows || cols != g_shown_cols) {
+        for (int r = 0; r < rows; r++) memset(g_shown[r], 0, cols * sizeof(MapCell));
+        g_shown_top = top;
+        g_shown_rows = rows;
+        g_shown_cols = cols;
+    }
+    int origin_row, origin_col;
+    crop(rows, cols, &origin_row, &origin_col);
+    overlay(rows, cols, origin_row, origin_col, now_ms);
+    return emit_changes(out, size, top, rows, cols);
+}
+
+// --- Benchmark ---
+
+// Times the given number of 40 x 120 frames per case at each zoom: full
+// repaints, a still map, the blink, and panning a cell at a time.
+int map_benchmark(int frames) {
+    static char out[1 << 20];
+    static const char *names[] = { "full repaint", "still", "blinking", "panning" };
+    uint64_t state = 12345;
+    long long now_ms = (long long)time(NULL) * 1000;
+    if (catalog_init(MAP_MAX_EVENTS * 4) != 0) return 1;
+    if (g_site_count == 0) sites_add("Home", 54.53, -1.05, 5.0);
+    for (int i = 0; i < MAP_MAX_EVENTS * 4; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        CatalogEvent event = { .time_ms = now_ms - (long long)(state >> 24) % (2 * 86400000LL) };
+        event.lat = (float)((state >> 20 & 0xFFFF) / 65535.0 * 180.0 - 90.0);
+        event.lon = (float)((state >> 4 & 0xFFFF) / 65535.0 * 360.0 - 180.0);
+        event.mag = (float)(-log10((double)((state >> 36 & 0xFFFFF) + 1) / 1048577.0) + 1.0);
+        snprintf(event.id, sizeof(event.id), "bench%d", i);
+        uint64_t seq;
+        if (catalog_upsert(&event, &seq, NULL) == CATALOG_INSERTED) index_on_insert(seq);
+    }
+
+    printf("Map benchmark: 40 x 120 cells, %d events plotted, %d frames per case\n\n", MAP_MAX_EVENTS, frames);
+    printf("%-14s", "Zoom");
+    for (int k = 0; k < 4; k++) printf(" %20s", names[k]);
+    printf("\n");
+    for (int zoom = 0; zoom < MAP_ZOOM_LEVELS; zoom++) {
+        g_zoom = zoom;
+        printf("%-14d", zoom);
+        for (int k = 0; k < 4; k++) {
+            long long bytes = 0;
+            map_center(g_sites[0].lat, g_sites[0].lon);
+            map_invalidate();
+            map_draw(out, sizeof(out), 1, 40, 120, now_ms);
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int f = 0; f < frames; f++) {
+                if (k == 0) map_invalidate();
+                if (k == 3) map_pan(1, 0);
+                bytes += map_draw(out, sizeof(out), 1, 40, 120, now_ms + (k == 2 ? f * 1000LL : 0));
+            }
+            printf(" %8.1f us %6lld B", elapsed_us(&start) / frames, bytes / frames);
+        }
+        printf("\n");
+    }
+    printf("\n(microseconds to lay out a frame and bytes written to the terminal)\n");
+    return 0;
+}
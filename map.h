@@ -0,0 +1,33 @@
+/*
+ * map.h - Braille map of events and sites
+ *
+ * Coastlines are rasterized at build time (tools/gen_coastline.c) into
+ * braille cells, 2 x 4 dots each, for every zoom level; a frame crops the
+ * window out of the finished cells and overlays events and sites. The
+ * previous frame is kept, and only the cells that changed are written, so
+ * a still map costs a cursor move per blinking event.
+ *
+ * Events from the last MAP_BLINK_MINUTES blink; marks are o, O and @ for
+ * M<4, M4-6 and M6+, sites are +.
+ */
+
+#ifndef MAP_H
+#define MAP_H
+
+#define MAP_ZOOM_LEVELS 3
+#define MAP_BASE_COLS 128      // World width in cells at zoom 0, doubling per level
+#define MAP_BASE_ROWS 32       // and its height: the dots come out square
+#define MAP_MAX_ROWS 128       // Largest window drawn
+#define MAP_MAX_COLS 512
+#define MAP_MAX_EVENTS 2048    // Newest events plotted
+#define MAP_BLINK_MINUTES 60
+
+void map_center(double lat, double lon);
+void map_pan(int cols, int rows);
+void map_zoom(int delta);
+int map_zoom_level();
+void map_invalidate();
+int map_draw(char *out, int size, int top, int rows, int cols, long long now_ms);
+int map_benchmark(int frames);
+
+#endif // MAP_H
@@ -0,0 +1,30 @@
+/*
+ * monitor.h - Command-line settings
+ *
+ * Parsed in main.c and read by the modules it drives.
+ */
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include "shard.h"
+
+extern double g_exposure_alert_threshold; // 0 disables exposure-driven alerts
+extern const char *g_feed;
+extern const char *g_history_view; // "newest", "largest" or "nearest"; NULL hides it
+extern const char *g_place_query;  // Only list events whose place contains this
+extern const char *g_arrow_path;   // Rewritten with the whole history after every update
+extern const char *g_strike_feed;  // host:port of a live strike stream
+extern int g_shake_port;           // UDP port a local seismometer broadcasts to; 0 disables
+extern int g_interactive;          // Browse the history in a full-screen view instead
+extern int g_once;                 // Fetch once, write NDJSON and exit
+extern int g_proxy_port;           // TCP port the LAN feed proxy serves on; 0 disables
+extern int g_relay_port;           // TCP port event deltas are served to other monitors on; 0 disables
+extern const char *g_relay_source; // host:port of a relay to follow instead of polling USGS
+extern int g_local_workers;        // Processes to spread site evaluation over; 0 evaluates here
+extern const char *g_remote_workers[SHARD_MAX_WORKERS]; // host:port of workers on other machines
+extern int g_remote_worker_count;
+
+void export_history(int snapshot);
+
+#endif // MONITOR_H
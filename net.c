@@ -0,0 +1,160 @@
+/*
+ * net.c - TCP plumbing shared by the feed proxy, the event relay, the
+ * strike feed reader and the site workers
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "net.h"
+
+// --- Addresses ---
+
+// Splits "host:port", at the last colon. Returns -1 if either part is
+// missing or too long.
+int net_split_address(const char *address, char *host, size_t host_size, char *port, size_t port_size) {
+    const char *colon = strrchr(address, ':');
+    if (!colon || colon == address || colon[1] == '\0' || (size_t)(colon - address) >= host_size ||
+        strlen(colon + 1) >= port_size) {
+        return -1;
+    }
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+    snprintf(port, port_size, "%s", colon + 1);
+    return 0;
+}
+
+// Connects to the first address host resolves to that answers. Returns
+// the socket, or -1.
+int net_connect(const char *host, const char *port) {
+    struct addrinfo hints = { 0 }, *results;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &results) != 0) return -1;
+    int fd = -1;
+    for (struct addrinfo *ai = results; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(results);
+    return fd;
+}
+
+// Listens on a TCP port (0 for any) on every interface, with flags such
+// as SOCK_NONBLOCK added to the socket type. Returns the socket, or -1,
+// and the port taken in *bound if asked.
+int net_listen(int port, int backlog, int flags, int *bound) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | flags, 0), one = 1;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    socklen_t length = sizeof(address);
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, backlog) != 0 ||
+        getsockname(fd, (struct sockaddr *)&address, &length) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if (bound) *bound = ntohs(address.sin_port);
+    return fd;
+}
+
+// --- Serving ---
+
+void net_watch(NetServer *server, NetConn *c, uint32_t events) {
+    if (c->events == events) return;
+    struct epoll_event event = { .events = events, .data.ptr = c };
+    epoll_ctl(server->epoll, EPOLL_CTL_MOD, c->fd, &event);
+    c->events = events;
+}
+
+// Closes the connection now and frees it after the current batch.
+void net_close(NetServer *server, NetConn *c) {
+    close(c->fd);
+    c->fd = -1; // Later events in this batch may still point here
+    c->next_closed = server->closed;
+    server->closed = c;
+}
+
+void net_wake(NetServer *server) {
+    uint64_t one = 1;
+    if (write(server->wake, &one, sizeof(one)) < 0) return; // Already signalled
+}
+
+static void accept_all(NetServer *server) {
+    for (;;) {
+        int fd = accept4(server->listener.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        NetConn *c = server->handlers->accept();
+        if (!c) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->events = EPOLLIN;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &event) != 0) server->handlers->event(c, EPOLLERR);
+    }
+}
+
+static void *serve_main(void *arg) {
+    NetServer *server = arg;
+    struct epoll_event events[64];
+    for (;;) {
+        int ready = epoll_wait(server->epoll, events, 64, -1);
+        for (int i = 0; i < ready; i++) {
+            NetConn *c = events[i].data.ptr;
+            if (c->fd < 0) continue;
+            if (c == &server->listener) accept_all(server);
+            else if (c == &server->waker) {
+                uint64_t count;
+                if (read(server->wake, &count, sizeof(count)) < 0 && errno != EAGAIN) continue;
+                server->handlers->wake();
+            } else {
+                server->handlers->event(c, events[i].events);
+            }
+        }
+        while (server->closed) {
+            NetConn *c = server->closed;
+            server->closed = c->next_closed;
+            free(c);
+        }
+    }
+    return NULL;
+}
+
+// Listens on the given TCP port (0 for any) and serves it on a thread of
+// its own. Returns the port taken, or -1.
+int net_serve(NetServer *server, int port, int backlog, const NetHandlers *handlers) {
+    int fd = net_listen(port, backlog, SOCK_NONBLOCK, &port);
+    if (fd < 0) return -1;
+    server->handlers = handlers;
+    server->epoll = epoll_create1(EPOLL_CLOEXEC);
+    server->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server->listener.fd = fd;
+    server->waker.fd = server->wake;
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = &server->listener };
+    struct epoll_event wake_event = { .events = EPOLLIN, .data.ptr = &server->waker };
+    pthread_t thread;
+    if (server->epoll < 0 || server->wake < 0 || epoll_ctl(server->epoll, EPOLL_CTL_ADD, fd, &listen_event) != 0 ||
+        epoll_ctl(server->epoll, EPOLL_CTL_ADD, server->wake, &wake_event) != 0 ||
+        pthread_create(&thread, NULL, serve_main, server) != 0) {
+        return -1;
+    }
+    pthread_detach(thread);
+    return port;
+}
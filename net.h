@@ -0,0 +1,50 @@
+/*
+ * net.h - TCP plumbing shared by the feed proxy, the event relay, the
+ * strike feed reader and the site workers
+ *
+ * A NetServer is one epoll thread serving every connection on a listening
+ * port, plus an eventfd other threads wake it with. A module embeds a
+ * NetConn at the start of its own connection struct, hands out new ones
+ * from its accept handler and sees each readiness or hang-up through its
+ * event handler. Connections it closes stay allocated until the batch of
+ * events that may still point at them has been handled.
+ */
+
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct NetConn {
+    int fd;          // -1 once closed
+    uint32_t events; // As registered with epoll
+    struct NetConn *next_closed;
+} NetConn;
+
+typedef struct {
+    NetConn *(*accept)(void);                    // A zeroed connection of the module's own, or NULL to turn it away
+    void (*event)(NetConn *c, uint32_t events);  // Ready for events, or EPOLLHUP/EPOLLERR
+    void (*wake)(void);                          // net_wake was called, once or more
+} NetHandlers;
+
+typedef struct {
+    int epoll;
+    int wake;                // -1 until serving
+    NetConn listener, waker; // Tags for the two non-connection descriptors
+    NetConn *closed;         // Freed once the current batch of events is handled
+    const NetHandlers *handlers;
+} NetServer;
+
+#define NET_SERVER_INIT { .epoll = -1, .wake = -1 }
+
+int net_split_address(const char *address, char *host, size_t host_size, char *port, size_t port_size);
+int net_connect(const char *host, const char *port);
+int net_listen(int port, int backlog, int flags, int *bound);
+
+int net_serve(NetServer *server, int port, int backlog, const NetHandlers *handlers);
+void net_watch(NetServer *server, NetConn *c, uint32_t events);
+void net_close(NetServer *server, NetConn *c);
+void net_wake(NetServer *server);
+
+#endif // NET_H
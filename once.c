@@ -0,0 +1,149 @@
+/*
+ * once.c - One-shot mode
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <curl/curl.h>
+#include "once.h"
+#include "monitor.h"
+#include "fetch.h"
+#include "quakes.h"
+#include "region.h"
+#include "sites.h"
+#include "catalog.h"
+#include "lightning.h"
+#include "alerts.h"
+
+#define ONCE_TIMEOUT_SECONDS 30 // Longest a one-shot run waits on the feeds
+#define ONCE_HOST_CONNECTIONS 4 // Per server; the other batches queue, or share them over HTTP/2
+
+// One feed request of a one-shot run
+typedef struct {
+    CURL *handle;
+    struct MemoryStruct body;
+    int first; // First of the stale forecast cells it asks for
+    int count; // and how many; 0 for the quake feed
+    int ok;
+} Transfer;
+
+// --- NDJSON ---
+
+static void print_json_string(const char *text) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') printf("\\%c", *c);
+        else if (*c < 0x20) printf("\\u%04x", *c);
+        else putchar(*c);
+    }
+    putchar('"');
+}
+
+// One object per line: the live events, highest impact first, then every
+// site's storm level, then a summary a script can check the run by.
+static void write_ndjson(long long now, int failed, float alert_threshold) {
+    static const char *level_names[] = { "clear", "watch", "warning" };
+    for (int k = 0; k < g_quake_count; k++) {
+        const Earthquake *quake = &g_quakes[g_quake_order[k]];
+        printf("{\"type\":\"event\",\"id\":");
+        print_json_string(quake->id);
+        printf(",\"time\":%lld,\"mag\":%.2f,\"lat\":%.4f,\"lon\":%.4f,\"depth\":%.1f,\"place\":", quake->time_ms,
+               quake->mag, quake->lat, quake->lon, quake->depth);
+        print_json_string(quake->place);
+        printf(",\"region\":");
+        print_json_string(region_name(quake->region));
+        printf(",\"peak_mmi\":%.1f,\"nearest_site_km\":%.0f,\"alert\":%s}\n", quake->peak_mmi, quake->nearest_site_km,
+               quake_alerts(quake, alert_threshold) ? "true" : "false");
+    }
+    for (int s = 0; s < g_site_count; s++) {
+        const LightningSiteState *state = lightning_site(s);
+        const LightningThreat *threat = &g_lightning_threats[s];
+        printf("{\"type\":\"storm\",\"site\":");
+        print_json_string(g_sites[s].name);
+        printf(",\"lat\":%.4f,\"lon\":%.4f,\"level\":\"%s\",\"risk\":%.2f", g_sites[s].lat, g_sites[s].lon,
+               level_names[state->level], state->risk);
+        if (state->level != LIGHTNING_CLEAR) printf(",\"onset\":%lld", state->onset);
+        if (threat->distance_km >= 0) {
+            printf(",\"storm_km\":%.0f,\"storm_bearing\":%.0f", threat->distance_km, threat->bearing_deg);
+            if (threat->eta_minutes >= 0) printf(",\"storm_eta_minutes\":%d", threat->eta_minutes);
+        }
+        printf("}\n");
+    }
+    printf("{\"type\":\"summary\",\"time\":%lld,\"events\":%d,\"history\":%llu,\"sites\":%d,\"failed_requests\":%d}\n",
+           now, g_quake_count, (unsigned long long)catalog_size(), g_site_count, failed);
+    fflush(stdout);
+}
+
+// --- Requests ---
+
+static int add_transfer(CURLM *multi, Transfer *transfer, const char *url, int first, int count) {
+    *transfer = (Transfer){ .handle = curl_easy_init(), .body = { .memory = malloc(1), .size = 0 }, .first = first, .count = count };
+    if (!transfer->handle || !transfer->body.memory) return -1;
+    curl_easy_setopt(transfer->handle, CURLOPT_URL, url);
+    curl_easy_setopt(transfer->handle, CURLOPT_WRITEFUNCTION, write_memory_callback);
+    curl_easy_setopt(transfer->handle, CURLOPT_WRITEDATA, (void *)&transfer->body);
+    curl_easy_setopt(transfer->handle, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+    curl_easy_setopt(transfer->handle, CURLOPT_TIMEOUT, (long)ONCE_TIMEOUT_SECONDS);
+    curl_easy_setopt(transfer->handle, CURLOPT_PRIVATE, (void *)transfer);
+    return curl_multi_add_handle(multi, transfer->handle) == CURLM_OK ? 0 : -1;
+}
+
+// Fetches the quake feed and every forecast batch at once, over at most a
+// few connections per server, writes the state as NDJSON and returns the
+// exit status: 1 if a feed failed.
+// No banner and no pauses, and curl is only set up here, so a cold run
+// costs little more than the slowest request.
+int run_once(float min_magnitude, float alert_threshold) {
+    static int stale[LIGHTNING_MAX_CELLS];
+    static Transfer transfers[1 + (LIGHTNING_MAX_CELLS + LIGHTNING_BATCH_SITES - 1) / LIGHTNING_BATCH_SITES];
+    char url_buffer[LIGHTNING_URL_LEN];
+    long long now = time(NULL);
+    int stale_count = lightning_begin_update(now, stale, LIGHTNING_MAX_CELLS);
+    int count = 0, failed = 0;
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    CURLM *multi = curl_multi_init();
+    if (multi) curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)ONCE_HOST_CONNECTIONS);
+    snprintf(url_buffer, sizeof(url_buffer), USGS_URL_FORMAT, g_feed);
+    if (multi) add_transfer(multi, &transfers[count++], url_buffer, 0, 0);
+    for (int first = 0; multi && first < stale_count; first += LIGHTNING_BATCH_SITES) {
+        int cells = stale_count - first < LIGHTNING_BATCH_SITES ? stale_count - first : LIGHTNING_BATCH_SITES;
+        if (lightning_build_url(url_buffer, sizeof(url_buffer), stale + first, cells) != 0) continue;
+        add_transfer(multi, &transfers[count++], url_buffer, first, cells);
+    }
+    for (int running = multi != NULL; running;) {
+        if (curl_multi_perform(multi, &running) != CURLM_OK) break;
+        if (running) curl_multi_wait(multi, NULL, 0, 1000, NULL);
+    }
+    CURLMsg *message;
+    int queued;
+    while (multi && (message = curl_multi_info_read(multi, &queued))) {
+        Transfer *transfer;
+        if (message->msg != CURLMSG_DONE) continue;
+        long status = 0;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+        curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &status);
+        transfer->ok = message->data.result == CURLE_OK && status == 200; // An error page is not a feed
+    }
+
+    if (!multi) failed++;
+    for (int t = 0; t < count; t++) {
+        Transfer *transfer = &transfers[t];
+        if (!transfer->ok) failed++;
+        else if (transfer->count == 0) process_seismic_data(transfer->body.memory, now * 1000, min_magnitude, alert_threshold);
+        else lightning_parse(transfer->body.memory, transfer->body.size, stale + transfer->first, transfer->count, now);
+        if (transfer->handle) {
+            curl_multi_remove_handle(multi, transfer->handle);
+            curl_easy_cleanup(transfer->handle);
+        }
+        free(transfer->body.memory);
+    }
+    if (multi) curl_multi_cleanup(multi);
+    curl_global_cleanup();
+
+    lightning_assess(now);
+    if (g_arrow_path) export_history(0);
+    write_ndjson(now, failed, alert_threshold);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+/*
+ * once.h - One-shot mode
+ *
+ * Fetches the quake feed and every stale forecast batch at once, writes
+ * the live events and site storm levels as NDJSON on stdout and exits, for
+ * scripts and cron jobs. Anything else goes to stderr.
+ */
+
+#ifndef ONCE_H
+#define ONCE_H
+
+int run_once(float min_magnitude, float alert_threshold);
+
+#endif // ONCE_H
@@ -0,0 +1,448 @@
+/*
+ * places.c - Interned place names with a trigram search index
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "places.h"
+#include "timing.h"
+#include "catalog.h"
+
+#define PLACE_NONE UINT32_MAX
+#define SEQ_NONE UINT64_MAX
+#define TRIGRAM_BITS 6 // Characters fold to 64 codes
+#define TRIGRAM_COUNT (1 << (3 * TRIGRAM_BITS))
+#define COMPACT_MIN_DEAD 1024
+
+typedef struct {
+    uint32_t offset; // Into g_text
+    uint32_t length;
+    uint32_t events; // Live events naming this place; 0 once dead
+    uint64_t first_seq; // Events naming it, chained through g_next_seq
+    uint64_t last_seq;
+} Place;
+
+typedef struct {
+    uint32_t *ids; // Ascending place ids
+    uint32_t count;
+    uint32_t capacity;
+} Posting;
+
+// --- Globals ---
+static Place *g_places = NULL;
+static uint32_t g_place_count = 0;
+static uint32_t g_place_capacity = 0;
+static uint32_t g_dead_places = 0;
+static char *g_text = NULL;
+static size_t g_text_size = 0;
+static size_t g_text_capacity = 0;
+// Hash of place text -> place id + 1 (0 marks an empty bucket)
+static uint32_t *g_lookup = NULL;
+static uint32_t g_lookup_mask = 0;
+static Posting g_postings[TRIGRAM_COUNT];
+// Per catalog slot: the row's place, and the next row naming it
+static uint32_t *g_place_of_slot = NULL;
+static uint64_t *g_next_seq = NULL;
+
+// --- Text ---
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Letters and digits keep their own codes; the rest share a few, which only
+// adds candidates that the final substring check rejects.
+static uint32_t char_code(unsigned char c) {
+    c = fold(c);
+    if (c >= 'a' && c <= 'z') return 1 + (c - 'a');
+    if (c >= '0' && c <= '9') return 27 + (c - '0');
+    if (c == ' ') return 37;
+    if (c == ',') return 38;
+    if (c < 0x80) return 39;
+    return 40 + (c % 24); // UTF-8 bytes of accented names
+}
+
+static uint32_t trigram_at(const char *text) {
+    return char_code(text[0]) << (2 * TRIGRAM_BITS) | char_code(text[1]) << TRIGRAM_BITS | char_code(text[2]);
+}
+
+// Case-insensitive substring test against an already folded needle
+static int contains_folded(const char *haystack, size_t length, const char *needle, size_t needle_length) {
+    if (needle_length == 0) return 1;
+    for (size_t i = 0; i + needle_length <= length; i++) {
+        size_t j = 0;
+        while (j < needle_length && fold(haystack[i + j]) == (unsigned char)needle[j]) j++;
+        if (j == needle_length) return 1;
+    }
+    return 0;
+}
+
+int places_contains(const char *place, const char *query) {
+    char folded[PLACE_MAX_LEN + 1];
+    size_t length = strnlen(query, PLACE_MAX_LEN);
+    for (size_t i = 0; i < length; i++) folded[i] = fold(query[i]);
+    return place && contains_folded(place, strlen(place), folded, length);
+}
+
+static uint32_t hash_text(const char *text, size_t length) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// --- Index ---
+
+static int posting_add(uint32_t trigram, uint32_t id) {
+    Posting *posting = &g_postings[trigram];
+    if (posting->count > 0 && posting->ids[posting->count - 1] == id) return 0; // Repeated in this place
+    if (posting->count == posting->capacity) {
+        uint32_t capacity = posting->capacity ? posting->capacity * 2 : 8;
+        uint32_t *grown = realloc(posting->ids, capacity * sizeof(uint32_t));
+        if (!grown) return -1;
+        posting->ids = grown;
+        posting->capacity = capacity;
+    }
+    posting->ids[posting->count++] = id;
+    return 0;
+}
+
+static void index_place(uint32_t id) {
+    const char *text = g_text + g_places[id].offset;
+    for (uint32_t i = 0; i + 3 <= g_places[id].length; i++) posting_add(trigram_at(text + i), id);
+}
+
+static void lookup_insert(uint32_t id) {
+    const Place *place = &g_places[id];
+    uint32_t bucket = hash_text(g_text + place->offset, place->length) & g_lookup_mask;
+    while (g_lookup[bucket]) bucket = (bucket + 1) & g_lookup_mask;
+    g_lookup[bucket] = id + 1;
+}
+
+static int rebuild_lookup(uint32_t buckets) {
+    uint32_t *lookup = calloc(buckets, sizeof(uint32_t));
+    if (!lookup) return -1;
+    free(g_lookup);
+    g_lookup = lookup;
+    g_lookup_mask = buckets - 1;
+    for (uint32_t id = 0; id < g_place_count; id++) lookup_insert(id);
+    return 0;
+}
+
+static uint32_t lookup_find(const char *text, size_t length) {
+    if (!g_lookup) return PLACE_NONE;
+    uint32_t bucket = hash_text(text, length) & g_lookup_mask;
+    while (g_lookup[bucket]) {
+        const Place *place = &g_places[g_lookup[bucket] - 1];
+        if (place->length == length && memcmp(g_text + place->offset, text, length) == 0) return g_lookup[bucket] - 1;
+        bucket = (bucket + 1) & g_lookup_mask;
+    }
+    return PLACE_NONE;
+}
+
+// Returns the id for a place string, adding and indexing it if new.
+static uint32_t intern(const char *text) {
+    size_t length = strnlen(text, PLACE_MAX_LEN);
+    uint32_t id = lookup_find(text, length);
+    if (id != PLACE_NONE) return id;
+
+    if (g_place_count == g_place_capacity) {
+        uint32_t capacity = g_place_capacity ? g_place_capacity * 2 : 1024;
+        Place *grown = realloc(g_places, capacity * sizeof(Place));
+        if (!grown) return PLACE_NONE;
+        g_places = grown;
+        g_place_capacity = capacity;
+    }
+    if (g_text_size + length > g_text_capacity) {
+        size_t capacity = g_text_capacity ? g_text_capacity * 2 : 65536;
+        while (capacity < g_text_size + length) capacity *= 2;
+        char *grown = realloc(g_text, capacity);
+        if (!grown) return PLACE_NONE;
+        g_text = grown;
+        g_text_capacity = capacity;
+    }
+    if ((g_place_count + 1) * 2 > g_lookup_mask + 1 || !g_lookup) {
+        if (rebuild_lookup(g_lookup ? (g_lookup_mask + 1) * 2 : 2048) != 0) return PLACE_NONE;
+    }
+
+    id = g_place_count++;
+    Place *place = &g_places[id];
+    memcpy(g_text + g_text_size, text, length);
+    place->offset = (uint32_t)g_text_size;
+    place->length = (uint32_t)length;
+    place->events = 0;
+    place->first_seq = place->last_seq = SEQ_NONE;
+    g_text_size += length;
+    g_dead_places++; // Until an event names it
+    lookup_insert(id);
+    index_place(id);
+    return id;
+}
+
+// Drops dead places: live ones are renumbered in order, so postings stay
+// sorted, and the text, lookup table and postings are rebuilt.
+static void compact() {
+    uint32_t *remap = malloc(g_place_count * sizeof(uint32_t));
+    if (!remap) return;
+    uint32_t live = 0;
+    size_t text_size = 0;
+    for (uint32_t id = 0; id < g_place_count; id++) {
+        if (g_places[id].events == 0) {
+            remap[id] = PLACE_NONE;
+            continue;
+        }
+        Place place = g_places[id];
+        memmove(g_text + text_size, g_text + place.offset, place.length);
+        place.offset = (uint32_t)text_size;
+        text_size += place.length;
+        remap[id] = live;
+        g_places[live++] = place;
+    }
+    for (uint64_t seq = g_catalog.head; seq < g_catalog.tail; seq++) {
+        uint64_t slot = catalog_slot(seq);
+        if (g_place_of_slot[slot] != PLACE_NONE) g_place_of_slot[slot] = remap[g_place_of_slot[slot]];
+    }
+    free(remap);
+
+    g_place_count = live;
+    g_text_size = text_size;
+    g_dead_places = 0;
+    for (uint32_t t = 0; t < TRIGRAM_COUNT; t++) g_postings[t].count = 0;
+    for (uint32_t id = 0; id < live; id++) index_place(id);
+    uint32_t buckets = 2048;
+    while (buckets < live * 2) buckets <<= 1;
+    rebuild_lookup(buckets);
+}
+
+// --- Event Links ---
+
+static int ensure_slots() {
+    if (g_place_of_slot) return 0;
+    g_place_of_slot = malloc(g_catalog.capacity * sizeof(uint32_t));
+    g_next_seq = malloc(g_catalog.capacity * sizeof(uint64_t));
+    if (!g_place_of_slot || !g_next_seq) {
+        fprintf(stderr, "Not enough memory to index places for %llu events\n", (unsigned long long)g_catalog.capacity);
+        free(g_place_of_slot);
+        free(g_next_seq);
+        g_place_of_slot = NULL;
+        g_next_seq = NULL;
+        return -1;
+    }
+    for (uint64_t slot = 0; slot < g_catalog.capacity; slot++) g_place_of_slot[slot] = PLACE_NONE;
+    return 0;
+}
+
+static void attach(uint64_t seq, uint32_t id) {
+    uint64_t slot = catalog_slot(seq);
+    Place *place = &g_places[id];
+    g_place_of_slot[slot] = id;
+    g_next_seq[slot] = SEQ_NONE;
+    if (place->events == 0) {
+        place->first_seq = seq;
+        g_dead_places--;
+    } else {
+        g_next_seq[catalog_slot(place->last_seq)] = seq;
+    }
+    place->last_seq = seq;
+    place->events++;
+}
+
+static void detach(uint64_t seq) {
+    uint64_t slot = catalog_slot(seq);
+    uint32_t id = g_place_of_slot[slot];
+    if (id == PLACE_NONE) return;
+    Place *place = &g_places[id];
+    g_place_of_slot[slot] = PLACE_NONE;
+
+    // Rows leave oldest first, so this is nearly always the chain head
+    uint64_t previous = SEQ_NONE;
+    uint64_t current = place->first_seq;
+    while (current != seq && current != SEQ_NONE) {
+        previous = current;
+        current = g_next_seq[catalog_slot(current)];
+    }
+    if (current == SEQ_NONE) return;
+    if (previous == SEQ_NONE) place->first_seq = g_next_seq[slot];
+    else g_next_seq[catalog_slot(previous)] = g_next_seq[slot];
+    if (place->last_seq == seq) place->last_seq = previous;
+
+    if (--place->events == 0) g_dead_places++;
+    if (g_dead_places > COMPACT_MIN_DEAD && g_dead_places > g_place_count - g_dead_places) compact();
+}
+
+void places_on_insert(uint64_t seq, const char *place) {
+    if (!place || ensure_slots() != 0) return;
+    uint32_t id = intern(place);
+    if (id != PLACE_NONE) attach(seq, id);
+}
+
+// Re-links a known row when the feed renames its place.
+void places_on_update(uint64_t seq, const char *place) {
+    if (!place || ensure_slots() != 0) return;
+    uint32_t current = g_place_of_slot[catalog_slot(seq)];
+    if (current != PLACE_NONE) {
+        const Place *known = &g_places[current];
+        size_t length = strnlen(place, PLACE_MAX_LEN);
+        if (known->length == length && memcmp(g_text + known->offset, place, length) == 0) return;
+    }
+    detach(seq);
+    places_on_insert(seq, place);
+}
+
+void places_on_retire(uint64_t seq) {
+    if (g_place_of_slot) detach(seq);
+}
+
+// Place text for a row; valid until the next insert or retire.
+const char *places_get(uint64_t seq) {
+    static char buffer[PLACE_MAX_LEN + 1];
+    if (!g_place_of_slot || g_place_of_slot[catalog_slot(seq)] == PLACE_NONE) return "";
+    const Place *place = &g_places[g_place_of_slot[catalog_slot(seq)]];
+    memcpy(buffer, g_text + place->offset, place->length);
+    buffer[place->length] = '\0';
+    return buffer;
+}
+
+// --- Search ---
+
+// Keeps the candidates also present in the posting, galloping through it
+// since candidate lists are usually much shorter. Returns the new count.
+static uint32_t intersect(uint32_t *candidates, uint32_t count, const Posting *posting) {
+    uint32_t kept = 0, position = 0;
+    for (uint32_t c = 0; c < count && position < posting->count; c++) {
+        uint32_t id = candidates[c];
+        uint32_t step = 1, high = position;
+        while (high < posting->count && posting->ids[high] < id) {
+            position = high + 1;
+            high += step;
+            step *= 2;
+        }
+        if (high > posting->count) high = posting->count;
+        while (position < high) {
+            uint32_t mid = (position + high) / 2;
+            if (posting->ids[mid] < id) position = mid + 1;
+            else high = mid;
+        }
+        if (position < posting->count && posting->ids[position] == id) candidates[kept++] = id;
+    }
+    return kept;
+}
+
+static int compare_postings(const void *a, const void *b) {
+    uint32_t count_a = (*(const Posting *const *)a)->count;
+    uint32_t count_b = (*(const Posting *const *)b)->count;
+    return (count_a > count_b) - (count_a < count_b);
+}
+
+// Collects the events of one matching place into out.
+static void emit_place(const Place *place, uint64_t *out, int max, int *count, uint64_t *total) {
+    for (uint64_t seq = place->first_seq; seq != SEQ_NONE && *count < max; seq = g_next_seq[catalog_slot(seq)]) {
+        out[(*count)++] = seq;
+    }
+    *total += place->events;
+}
+
+// Finds events whose place contains query, ignoring case. Writes up to max
+// sequence numbers, newest places first, and the full match count to
+// total_out. Returns the number written.
+int places_search(const char *query, uint64_t *out, int max, uint64_t *total_out) {
+    char folded[PLACE_MAX_LEN + 1];
+    size_t length = strnlen(query, PLACE_MAX_LEN);
+    for (size_t i = 0; i < length; i++) folded[i] = fold(query[i]);
+    folded[length] = '\0';
+    int count = 0;
+    uint64_t total = 0;
+
+    if (length < PLACE_MIN_QUERY) {
+        for (uint32_t id = g_place_count; id-- > 0;) {
+            const Place *place = &g_places[id];
+            if (place->events && contains_folded(g_text + place->offset, place->length, folded, length)) {
+                emit_place(place, out, max, &count, &total);
+            }
+        }
+        if (total_out) *total_out = total;
+        return count;
+    }
+
+    // Intersect the query's posting lists, rarest first
+    const Posting *lists[PLACE_MAX_LEN];
+    int list_count = 0;
+    for (size_t i = 0; i + 3 <= length; i++) lists[list_count++] = &g_postings[trigram_at(folded + i)];
+    qsort(lists, list_count, sizeof(lists[0]), compare_postings);
+    uint32_t candidate_count = lists[0]->count;
+    uint32_t *candidates = malloc((candidate_count + 1) * sizeof(uint32_t));
+    if (!candidates) return 0;
+    memcpy(candidates, lists[0]->ids, candidate_count * sizeof(uint32_t));
+    for (int l = 1; l < list_count && candidate_count > 0; l++) {
+        if (lists[l] != lists[l - 1]) candidate_count = intersect(candidates, candidate_count, lists[l]);
+    }
+
+    // Trigrams can match out of order, so confirm each survivor
+    for (uint32_t k = candidate_count; k-- > 0;) {
+        // Candidates are scattered across the table: fetch ahead in two steps
+        if (k >= 16) __builtin_prefetch(&g_places[candidates[k - 16]]);
+        if (k >= 8) __builtin_prefetch(g_text + g_places[candidates[k - 8]].offset);
+        const Place *place = &g_places[candidates[k]];
+        if (place->events && contains_folded(g_text + place->offset, place->length, folded, length)) {
+            emit_place(place, out, max, &count, &total);
+        }
+    }
+    free(candidates);
+    if (total_out) *total_out = total;
+    return count;
+}
+
+// --- Benchmark ---
+
+// Fills a synthetic history with USGS-style place names and times searches
+// against the index and against a plain scan of every event.
+int places_benchmark(int events) {
+    static const char *regions[] = { "Alaska", "California", "Nevada", "Hawaii", "Japan", "Tonga", "Fiji", "Chile",
+                                     "Peru", "Indonesia", "Philippines", "Papua New Guinea", "Mexico", "Puerto Rico",
+                                     "Greece", "Turkey", "Iran", "New Zealand", "Vanuatu", "Italy" };
+    static const char *syllables[] = { "ka", "lo", "ma", "ri", "to", "sen", "ver", "dal", "pu", "ne", "qui", "ash" };
+    static const char *directions[] = { "N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE", "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW" };
+    const int region_count = sizeof(regions) / sizeof(regions[0]);
+    if (catalog_init(events) != 0) return 1;
+    uint64_t state = 12345;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < events; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        char town[32] = "", place[PLACE_MAX_LEN + 1];
+        for (int s = 0; s < 3; s++) strcat(town, syllables[(state >> (20 + 4 * s)) % 12]);
+        town[0] = town[0] - 'a' + 'A';
+        snprintf(place, sizeof(place), "%d km %s of %s, %s", (int)(state >> 40) % 120 + 1, directions[(state >> 50) % 16],
+                 town, regions[(state >> 33) % region_count]);
+        CatalogEvent event = { .time_ms = i };
+        snprintf(event.id, sizeof(event.id), "bench%d", i);
+        uint64_t seq;
+        if (catalog_upsert(&event, &seq, NULL) == CATALOG_INSERTED) places_on_insert(seq, place);
+    }
+    printf("Place benchmark: %d events, %u distinct places, %.1f MB of text\n", events, g_place_count - g_dead_places,
+           g_text_size / 1e6);
+    printf("Intern + index:   %8.0f ns/event\n\n", elapsed_us(&start) * 1e3 / events);
+
+    static uint64_t out[100];
+    const char *queries[] = { "Alaska", "tonga", "Papua New", "km NNE of Kaloma", "Vanuatu" };
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+        uint64_t total = 0, scanned = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        places_search(queries[q], out, 100, &total);
+        double indexed = elapsed_us(&start) / 1e3;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint64_t seq = g_catalog.head; seq < g_catalog.tail; seq++) {
+            if (places_contains(places_get(seq), queries[q])) scanned++;
+        }
+        printf("\"%s\": %llu events, index %.3f ms, scan %.1f ms%s\n", queries[q], (unsigned long long)total, indexed,
+               elapsed_us(&start) / 1e3, total == scanned ? "" : " (MISMATCH)");
+    }
+    return 0;
+}
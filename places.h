@@ -0,0 +1,31 @@
+/*
+ * places.h - Interned place names with a trigram search index
+ *
+ * Every distinct place string in the history is stored once and given an
+ * id. A trigram inverted index maps each run of three (case-folded)
+ * characters to the ids of the places containing it, so a substring search
+ * intersects a few posting lists and only checks the surviving candidates,
+ * instead of running strstr() over every event.
+ *
+ * Places no longer referenced by any event are dropped from the index in
+ * bulk, by rebuilding it once they outnumber the live ones.
+ */
+
+#ifndef PLACES_H
+#define PLACES_H
+
+#include <stdint.h>
+
+#define PLACE_MAX_LEN 255
+#define PLACE_MIN_QUERY 3 // Shorter queries scan the place table instead
+
+void places_on_insert(uint64_t seq, const char *place);
+void places_on_update(uint64_t seq, const char *place);
+void places_on_retire(uint64_t seq);
+
+const char *places_get(uint64_t seq);
+int places_search(const char *query, uint64_t *out, int max, uint64_t *total_out);
+int places_contains(const char *place, const char *query);
+int places_benchmark(int events);
+
+#endif // PLACES_H
@@ -0,0 +1,702 @@
+/*
+ * proxy.c - Caching feed proxy for the LAN
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <curl/curl.h>
+#include <zlib.h>
+#include "proxy.h"
+#include "net.h"
+#include "hash.h"
+#include "timing.h"
+
+#define KEY_MAX 4096
+#define HEAD_MAX 512
+#define UPSTREAM_TIMEOUT_SECONDS 30
+
+typedef struct {
+    int refs; // Proxy thread only
+    char *data;
+    size_t length;
+    char *gzip; // NULL when compressing did not pay
+    size_t gzip_length;
+    char etag[17];
+    const char *type;
+} Body;
+
+typedef struct Connection Connection;
+
+typedef struct {
+    char key[KEY_MAX]; // Path and query; empty for a free slot
+    uint64_t hash;
+    int upstream;
+    Body *body;        // NULL until the first fetch lands
+    time_t fetched;
+    time_t failed;     // Last failed fetch, 0 if the last one worked
+    time_t used;
+    int fetching;
+    Connection *waiters;
+} Entry;
+
+struct Connection {
+    NetConn conn;     // First, so the server's pointers are ours
+    char in[PROXY_REQUEST_MAX];
+    int in_used;
+    char head[HEAD_MAX];
+    int head_length, head_sent;
+    Body *body;       // Held while it is being sent
+    const char *out;
+    size_t out_length, out_sent;
+    int close_after;
+    int waiting;      // Entry waited on, or -1
+    Connection *next_waiter;
+    int gzip, head_only; // From the request being waited on
+    char if_none_match[64];
+};
+
+// A fetch for the fetch threads, then its result for the proxy thread
+typedef struct Job {
+    int entry;        // -1 for a body the monitor stored itself
+    char key[KEY_MAX];
+    char url[KEY_MAX + 128];
+    Body *body;       // NULL if the fetch failed
+    struct Job *next;
+} Job;
+
+// --- Globals ---
+ProxyStats g_proxy_stats;
+static struct {
+    const char *prefix;
+    char base[128];
+    int fresh_seconds; // How long a body is served before it is refetched
+} g_upstreams[] = {
+    { "/earthquakes/", "https://earthquake.usgs.gov", 60 }, // The summary feeds update every minute
+    { "/v1/forecast", "https://api.open-meteo.com", 900 },
+};
+#define UPSTREAM_COUNT (int)(sizeof(g_upstreams) / sizeof(g_upstreams[0]))
+static Entry g_entries[PROXY_MAX_ENTRIES];
+static NetServer g_server = NET_SERVER_INIT;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work = PTHREAD_COND_INITIALIZER;
+static Job *g_todo, *g_done; // Guarded by g_lock
+
+// --- Bodies ---
+
+// Copies a response and gzips it once, on the calling thread, so serving
+// it never compresses anything.
+static Body *make_body(const char *key, const char *data, size_t length) {
+    Body *body = calloc(1, sizeof(Body));
+    if (!body || !(body->data = malloc(length + 1))) {
+        free(body);
+        return NULL;
+    }
+    memcpy(body->data, data, length);
+    body->data[length] = '\0';
+    body->length = length;
+    body->refs = 1;
+    body->type = strstr(key, "format=flatbuffers") ? "application/octet-stream" : "application/json";
+    snprintf(body->etag, sizeof(body->etag), "%016llx", (unsigned long long)hash_bytes(data, length));
+
+    z_stream stream = { 0 };
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return body;
+    uLong bound = deflateBound(&stream, length);
+    body->gzip = malloc(bound);
+    stream.next_in = (Bytef *)body->data;
+    stream.avail_in = length;
+    stream.next_out = (Bytef *)body->gzip;
+    stream.avail_out = bound;
+    if (body->gzip && deflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out < length) {
+        body->gzip_length = stream.total_out;
+    } else {
+        free(body->gzip);
+        body->gzip = NULL;
+    }
+    deflateEnd(&stream);
+    return body;
+}
+
+static void release_body(Body *body) {
+    if (!body || --body->refs > 0) return;
+    free(body->data);
+    free(body->gzip);
+    free(body);
+}
+
+// --- Fetching ---
+
+static size_t append_body(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t more = size * nmemb;
+    struct { char *data; size_t length; } *buffer = userp;
+    char *grown = realloc(buffer->data, buffer->length + more + 1);
+    if (!grown) return 0;
+    buffer->data = grown;
+    memcpy(buffer->data + buffer->length, contents, more);
+    buffer->length += more;
+    return more;
+}
+
+static void post_result(Job *job) {
+    pthread_mutex_lock(&g_lock);
+    job->next = g_done;
+    g_done = job;
+    pthread_mutex_unlock(&g_lock);
+    net_wake(&g_server);
+}
+
+static void *fetcher_main(void *arg) {
+    CURL *curl = curl_easy_init();
+    for (;;) {
+        pthread_mutex_lock(&g_lock);
+        while (!g_todo) pthread_cond_wait(&g_work, &g_lock);
+        Job *job = g_todo;
+        g_todo = job->next;
+        pthread_mutex_unlock(&g_lock);
+
+        struct { char *data; size_t length; } buffer = { NULL, 0 };
+        long status = 0;
+        job->body = NULL;
+        if (curl) {
+            curl_easy_setopt(curl, CURLOPT_URL, job->url);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append_body);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&buffer);
+            curl_easy_setopt(curl, CURLOPT_USERAGENT, "libcurl-agent/1.0");
+            curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // Upstream may compress; curl undoes it
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)UPSTREAM_TIMEOUT_SECONDS);
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            if (curl_easy_perform(curl) == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        }
+        if (status == 200 && buffer.data) job->body = make_body(job->key, buffer.data, buffer.length);
+        free(buffer.data);
+        post_result(job);
+    }
+    return NULL;
+}
+
+// --- Cache ---
+
+static int find_entry(const char *key, uint64_t hash) {
+    for (int e = 0; e < PROXY_MAX_ENTRIES; e++) {
+        if (g_entries[e].hash == hash && g_entries[e].key[0] && strcmp(g_entries[e].key, key) == 0) return e;
+    }
+    return -1;
+}
+
+// A free slot, or the least recently used one nobody is waiting on.
+static int claim_entry(const char *key, uint64_t hash, int upstream) {
+    int victim = -1;
+    for (int e = 0; e < PROXY_MAX_ENTRIES; e++) {
+        Entry *entry = &g_entries[e];
+        if (!entry->key[0]) {
+            victim = e;
+            break;
+        }
+        if (!entry->fetching && (victim < 0 || entry->used < g_entries[victim].used)) victim = e;
+    }
+    if (victim < 0) return -1;
+    Entry *entry = &g_entries[victim];
+    if (!entry->key[0]) g_proxy_stats.entries++;
+    release_body(entry->body);
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    entry->hash = hash;
+    entry->upstream = upstream;
+    return victim;
+}
+
+static void start_fetch(int e) {
+    Entry *entry = &g_entries[e];
+    Job *job = malloc(sizeof(Job));
+    if (!job) return;
+    job->entry = e;
+    snprintf(job->key, sizeof(job->key), "%s", entry->key);
+    snprintf(job->url, sizeof(job->url), "%s%s", g_upstreams[entry->upstream].base, entry->key);
+    entry->fetching = 1;
+    g_proxy_stats.fetches++;
+    pthread_mutex_lock(&g_lock);
+    job->next = g_todo;
+    g_todo = job;
+    pthread_cond_signal(&g_work);
+    pthread_mutex_unlock(&g_lock);
+}
+
+// --- Connections ---
+
+static void watch(Connection *c, uint32_t events) {
+    net_watch(&g_server, &c->conn, events);
+}
+
+static void close_connection(Connection *c) {
+    if (c->waiting >= 0) {
+        Connection **link = &g_entries[c->waiting].waiters;
+        while (*link && *link != c) link = &(*link)->next_waiter;
+        if (*link) *link = c->next_waiter;
+    }
+    release_body(c->body);
+    c->body = NULL;
+    net_close(&g_server, &c->conn);
+    g_proxy_stats.clients--;
+}
+
+static void respond_status(Connection *c, int status, const char *reason) {
+    c->head_length = snprintf(c->head, HEAD_MAX,
+                              "HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n%s\r\n%s\n", status,
+                              reason, c->head_only ? 0 : strlen(reason) + 1, c->close_after ? "Connection: close\r\n" : "",
+                              c->head_only ? "" : reason);
+    c->head_sent = 0;
+}
+
+// Sets up the answer from a cached body: a 304 if the client has it, the
+// gzipped copy if it takes gzip.
+static void respond_body(Connection *c, const Entry *entry) {
+    Body *body = entry->body;
+    int gzip = c->gzip && body->gzip;
+    int age = (int)(time(NULL) - entry->fetched);
+    int max_age = g_upstreams[entry->upstream].fresh_seconds - age;
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%s%s\"", body->etag, gzip ? "-gz" : "");
+    g_proxy_stats.hits++;
+    if (c->if_none_match[0] && strstr(c->if_none_match, body->etag)) {
+        g_proxy_stats.not_modified++;
+        c->head_length = snprintf(c->head, HEAD_MAX, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: max-age=%d\r\n%s\r\n",
+                                  etag, max_age > 0 ? max_age : 0, c->close_after ? "Connection: close\r\n" : "");
+        c->head_sent = 0;
+        return;
+    }
+    c->head_length = snprintf(c->head, HEAD_MAX,
+                              "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%sETag: %s\r\n"
+                              "Cache-Control: max-age=%d\r\nAge: %d\r\nVary: Accept-Encoding\r\n%s\r\n",
+                              body->type, gzip ? body->gzip_length : body->length, gzip ? "Content-Encoding: gzip\r\n" : "",
+                              etag, max_age > 0 ? max_age : 0, age, c->close_after ? "Connection: close\r\n" : "");
+    c->head_sent = 0;
+    if (c->head_only) return;
+    c->body = body;
+    body->refs++;
+    c->out = gzip ? body->gzip : body->data;
+    c->out_length = gzip ? body->gzip_length : body->length;
+    c->out_sent = 0;
+}
+
+static void header_value(const char *headers, const char *name, char *value, size_t size) {
+    size_t length = strlen(name);
+    value[0] = '\0';
+    for (const char *line = strstr(headers, "\r\n"); line && line[2] != '\r'; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, name, length) != 0 || line[2 + length] != ':') continue;
+        const char *start = line + 3 + length, *end = strstr(start, "\r\n");
+        while (*start == ' ') start++;
+        snprintf(value, size, "%.*s", (int)(end - start), start);
+        return;
+    }
+}
+
+// Answers one request, or parks the connection until its entry's fetch
+// lands. The request is NUL-terminated in place.
+static void handle_request(Connection *c, char *request) {
+    char method[8], path[KEY_MAX], version[16], value[64];
+    c->gzip = c->head_only = 0;
+    if (sscanf(request, "%7s %4095s %15s", method, path, version) != 3) {
+        c->close_after = 1;
+        respond_status(c, 400, "Bad Request");
+        return;
+    }
+    header_value(request, "Connection", value, sizeof(value));
+    c->close_after = strcasecmp(value, "close") == 0 || (strcmp(version, "HTTP/1.0") == 0 && strcasecmp(value, "keep-alive") != 0);
+    header_value(request, "Accept-Encoding", value, sizeof(value));
+    c->gzip = strstr(value, "gzip") != NULL;
+    header_value(request, "If-None-Match", c->if_none_match, sizeof(c->if_none_match));
+    c->head_only = strcmp(method, "HEAD") == 0;
+    g_proxy_stats.requests++;
+    if (!c->head_only && strcmp(method, "GET") != 0) {
+        respond_status(c, 405, "Method Not Allowed");
+        return;
+    }
+
+    int upstream = -1;
+    for (int u = 0; u < UPSTREAM_COUNT; u++) {
+        if (strncmp(path, g_upstreams[u].prefix, strlen(g_upstreams[u].prefix)) == 0) upstream = u;
+    }
+    if (upstream < 0) {
+        respond_status(c, 404, "Not Found");
+        return;
+    }
+    uint64_t hash = hash_text(path);
+    int e = find_entry(path, hash);
+    if (e < 0 && (e = claim_entry(path, hash, upstream)) < 0) {
+        respond_status(c, 503, "Service Unavailable");
+        return;
+    }
+    Entry *entry = &g_entries[e];
+    time_t now = time(NULL);
+    entry->used = now;
+    int stale = !entry->body || now - entry->fetched >= g_upstreams[upstream].fresh_seconds;
+    int backing_off = entry->failed && now - entry->failed < PROXY_RETRY_SECONDS;
+    if (stale && !entry->fetching && !backing_off) start_fetch(e);
+    if (entry->body) {
+        respond_body(c, entry); // Stale bodies too, while the refresh runs
+    } else if (entry->fetching) {
+        g_proxy_stats.waits++;
+        c->waiting = e;
+        c->next_waiter = entry->waiters;
+        entry->waiters = c;
+    } else {
+        respond_status(c, 502, "Bad Gateway");
+    }
+}
+
+// Sends what is queued and answers the buffered requests in turn, until
+// the socket is full, the connection waits on a fetch or input runs out.
+static void pump(Connection *c) {
+    for (;;) {
+        if (c->head_sent < c->head_length || c->out_sent < c->out_length) {
+            struct iovec parts[2] = {
+                { c->head + c->head_sent, c->head_length - c->head_sent },
+                { (char *)c->out + c->out_sent, c->out_length - c->out_sent },
+            };
+            ssize_t sent = writev(c->conn.fd, parts, 2);
+            if (sent < 0 && (errno == EAGAIN || errno == EINTR)) {
+                watch(c, EPOLLIN | EPOLLOUT);
+                return;
+            }
+            if (sent < 0) {
+                close_connection(c);
+                return;
+            }
+            int head_part = c->head_length - c->head_sent < sent ? c->head_length - c->head_sent : (int)sent;
+            c->head_sent += head_part;
+            c->out_sent += sent - head_part;
+            continue;
+        }
+        if (c->body) {
+            release_body(c->body);
+            c->body = NULL;
+            c->out = NULL;
+            c->out_length = c->out_sent = 0;
+        }
+        if (c->close_after && c->head_length) {
+            close_connection(c);
+            return;
+        }
+        c->head_length = c->head_sent = 0;
+        if (c->waiting >= 0) return;
+        char *end = strstr(c->in, "\r\n\r\n");
+        if (!end) {
+            if (c->in_used >= PROXY_REQUEST_MAX - 1) { // Will never fit
+                c->close_after = 1;
+                respond_status(c, 431, "Request Header Fields Too Large");
+                c->in_used = 0;
+                c->in[0] = '\0';
+                continue;
+            }
+            watch(c, EPOLLIN);
+            return;
+        }
+        int length = (int)(end + 4 - c->in);
+        char saved = c->in[length];
+        c->in[length] = '\0';
+        handle_request(c, c->in);
+        c->in[length] = saved;
+        memmove(c->in, c->in + length, c->in_used - length + 1);
+        c->in_used -= length;
+    }
+}
+
+static void read_requests(Connection *c) {
+    for (;;) {
+        ssize_t got = read(c->conn.fd, c->in + c->in_used, PROXY_REQUEST_MAX - 1 - c->in_used);
+        if (got > 0) {
+            c->in_used += got;
+            c->in[c->in_used] = '\0';
+            if (c->in_used < PROXY_REQUEST_MAX - 1) continue;
+            if (c->waiting >= 0) watch(c, c->conn.events & ~EPOLLIN); // Full: read more once the answer is out
+            break;
+        }
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && errno == EAGAIN) break;
+        close_connection(c); // Closed by the client, or an error
+        return;
+    }
+    pump(c);
+}
+
+static NetConn *accept_client() {
+    Connection *c = g_proxy_stats.clients < PROXY_MAX_CLIENTS ? calloc(1, sizeof(Connection)) : NULL;
+    if (!c) return NULL;
+    c->waiting = -1;
+    g_proxy_stats.clients++;
+    return &c->conn;
+}
+
+static void client_event(NetConn *conn, uint32_t events) {
+    Connection *c = (Connection *)conn;
+    if (events & (EPOLLERR | EPOLLHUP)) close_connection(c);
+    else if (events & EPOLLIN) read_requests(c);
+    else pump(c);
+}
+
+// Installs finished fetches and stored bodies, and answers whoever was
+// waiting on them.
+static void take_results() {
+    pthread_mutex_lock(&g_lock);
+    Job *jobs = g_done;
+    g_done = NULL;
+    pthread_mutex_unlock(&g_lock);
+    time_t now = time(NULL);
+    while (jobs) {
+        Job *job = jobs;
+        jobs = job->next;
+        int e = job->entry;
+        if (e < 0) { // Stored by the monitor
+            int upstream = -1;
+            for (int u = 0; u < UPSTREAM_COUNT; u++) {
+                if (strncmp(job->key, g_upstreams[u].prefix, strlen(g_upstreams[u].prefix)) == 0) upstream = u;
+            }
+            uint64_t hash = hash_text(job->key);
+            if (upstream >= 0 && (e = find_entry(job->key, hash)) < 0) e = claim_entry(job->key, hash, upstream);
+            if (e < 0) {
+                release_body(job->body);
+                free(job);
+                continue;
+            }
+            g_entries[e].used = now;
+        } else {
+            g_entries[e].fetching = 0;
+            if (!job->body) g_proxy_stats.failures++;
+        }
+        Entry *entry = &g_entries[e];
+        if (job->body) {
+            release_body(entry->body);
+            entry->body = job->body;
+            entry->fetched = now;
+            entry->failed = 0;
+        } else {
+            entry->failed = now; // Backs off even while a stale copy is served
+        }
+        Connection *waiter = entry->waiters;
+        entry->waiters = NULL;
+        while (waiter) {
+            Connection *next = waiter->next_waiter;
+            waiter->waiting = -1;
+            if (entry->body) respond_body(waiter, entry);
+            else respond_status(waiter, 502, "Bad Gateway");
+            pump(waiter);
+            waiter = next;
+        }
+        free(job);
+    }
+}
+
+static const NetHandlers g_handlers = { accept_client, client_event, take_results };
+
+// Listens on the given TCP port (0 for any) and returns the port taken,
+// or -1.
+int proxy_start(int port) {
+    int served = net_serve(&g_server, port, 512, &g_handlers);
+    if (served < 0) {
+        fprintf(stderr, "Could not serve the feed proxy on TCP port %d\n", port);
+        return -1;
+    }
+    pthread_t thread;
+    for (int f = 0; f < PROXY_FETCHERS; f++) {
+        if (pthread_create(&thread, NULL, fetcher_main, NULL) != 0) return -1;
+        pthread_detach(thread);
+    }
+    return served;
+}
+
+// Hands a response the monitor fetched itself to the cache, if its URL is
+// one the proxy serves.
+void proxy_store(const char *url, const char *body, size_t length) {
+    if (g_server.wake < 0) return;
+    for (int u = 0; u < UPSTREAM_COUNT; u++) {
+        size_t base = strlen(g_upstreams[u].base);
+        if (strncmp(url, g_upstreams[u].base, base) != 0 || strncmp(url + base, g_upstreams[u].prefix, strlen(g_upstreams[u].prefix)) != 0) continue;
+        Job *job = malloc(sizeof(Job));
+        if (!job) return;
+        job->entry = -1;
+        snprintf(job->key, sizeof(job->key), "%s", url + base);
+        job->body = make_body(job->key, body, length);
+        if (job->body) post_result(job);
+        else free(job);
+        return;
+    }
+}
+
+// --- Benchmark ---
+
+static int g_upstream_requests = 0;
+
+// A slow stand-in for USGS: answers every request with a feed after a
+// quarter of a second, and counts them.
+static void *slow_upstream_main(void *arg) {
+    int listener = (int)(intptr_t)arg;
+    static const char reply[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 28\r\nConnection: close\r\n\r\n"
+                                "{\"type\":\"FeatureCollection\"}";
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) continue;
+        char request[4096];
+        if (read(fd, request, sizeof(request)) > 0) {
+            __atomic_add_fetch(&g_upstream_requests, 1, __ATOMIC_RELAXED);
+            usleep(250000);
+            if (write(fd, reply, sizeof(reply) - 1) < 0) perror("upstream");
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+static int connect_local(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0), one = 1;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Sends one GET on a kept-alive connection and reads the whole answer.
+// Returns the status, or -1, and copies out the ETag if asked.
+static int get(int fd, const char *path, const char *extra, char *buffer, size_t size, char *etag, size_t etag_size) {
+    char request[512];
+    int length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: proxy\r\n%s\r\n", path, extra);
+    if (write(fd, request, length) != length) return -1;
+    size_t used = 0;
+    char *end = NULL;
+    while (!end) {
+        ssize_t got = read(fd, buffer + used, size - 1 - used);
+        if (got <= 0) return -1;
+        used += got;
+        buffer[used] = '\0';
+        end = strstr(buffer, "\r\n\r\n");
+    }
+    int status = atoi(buffer + 9);
+    const char *field = strcasestr(buffer, "ETag: ");
+    if (etag && field) snprintf(etag, etag_size, "%.*s", (int)strcspn(field + 6, "\r\n"), field + 6);
+    field = strcasestr(buffer, "Content-Length:");
+    size_t body = field ? strtoul(field + 15, NULL, 10) : 0;
+    size_t total = (end + 4 - buffer) + body;
+    while (used < total) { // Bodies are read through and dropped
+        ssize_t got = read(fd, buffer, total - used < size ? total - used : size);
+        if (got <= 0) return -1;
+        used += got;
+    }
+    return status;
+}
+
+typedef struct {
+    int port;
+    int requests;
+    const char *extra;
+    int ok;
+} BenchClient;
+
+static void *client_main(void *arg) {
+    BenchClient *client = arg;
+    static __thread char buffer[1 << 16];
+    int fd = connect_local(client->port);
+    for (int r = 0; fd >= 0 && r < client->requests; r++) {
+        int status = get(fd, "/earthquakes/feed/v1.0/summary/all_day.geojson", client->extra, buffer, sizeof(buffer), NULL, 0);
+        if (status == 200 || status == 304) client->ok++;
+    }
+    if (fd >= 0) close(fd);
+    return NULL;
+}
+
+// Runs clients concurrently, each on its own connection, and returns the
+// requests per second answered with a 200 or 304.
+static double run_clients(int port, int clients, int each, const char *extra, int *ok) {
+    pthread_t threads[64];
+    BenchClient states[64];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < clients; t++) {
+        states[t] = (BenchClient){ port, each, extra, 0 };
+        pthread_create(&threads[t], NULL, client_main, &states[t]);
+    }
+    *ok = 0;
+    for (int t = 0; t < clients; t++) {
+        pthread_join(threads[t], NULL);
+        *ok += states[t].ok;
+    }
+    return *ok / elapsed_us(&start) * 1e6;
+}
+
+// Points the proxy at a slow local upstream, has many clients miss at once
+// to show the fetch is shared, then serves a day-sized feed from memory.
+int proxy_benchmark(int requests) {
+    const int clients = 8, burst = 64;
+    int upstream = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t length = sizeof(address);
+    if (upstream < 0 || bind(upstream, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(upstream, 64) != 0 ||
+        getsockname(upstream, (struct sockaddr *)&address, &length) != 0) {
+        printf("Could not start the benchmark upstream\n");
+        return 1;
+    }
+    snprintf(g_upstreams[0].base, sizeof(g_upstreams[0].base), "http://127.0.0.1:%d", ntohs(address.sin_port));
+    pthread_t thread;
+    pthread_create(&thread, NULL, slow_upstream_main, (void *)(intptr_t)upstream);
+    pthread_detach(thread);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    int port = proxy_start(0), ok;
+    if (port < 0) return 1;
+
+    printf("Feed proxy benchmark: %d requests over %d connections\n\n", requests, clients);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run_clients(port, burst, 1, "", &ok);
+    printf("Cold miss, %d clients at once: %d answered in %.0f ms, %d upstream request%s\n", burst, ok,
+           elapsed_us(&start) / 1e3, g_upstream_requests, g_upstream_requests == 1 ? "" : "s");
+
+    // About the size of the all_day feed
+    size_t size = 400000, used = 0;
+    char *feed = malloc(size + 256);
+    uint64_t state = 12345;
+    used += snprintf(feed, size, "{\"type\":\"FeatureCollection\",\"features\":[");
+    while (used < size - 256) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        used += snprintf(feed + used, size - used,
+                         "{\"type\":\"Feature\",\"properties\":{\"mag\":%.2f,\"place\":\"%d km N of Bench Town\","
+                         "\"time\":%llu},\"geometry\":{\"type\":\"Point\",\"coordinates\":[%.4f,%.4f,%.2f]}},",
+                         (state >> 40 & 0xFF) / 40.0, (int)(state >> 32 & 0xFF), (unsigned long long)(state >> 24),
+                         (state >> 8 & 0xFFFF) / 182.0 - 180.0, (state >> 20 & 0xFFFF) / 364.0 - 90.0, (state >> 50 & 0x3F) / 1.0);
+    }
+    used += snprintf(feed + used - 1, size + 256 - used, "]}") - 1;
+    char url[256];
+    snprintf(url, sizeof(url), "%s/earthquakes/feed/v1.0/summary/all_day.geojson", g_upstreams[0].base);
+    proxy_store(url, feed, used);
+    usleep(100000);
+    free(feed);
+
+    char etag[48] = "", revalidate[80] = "", buffer[4096];
+    int fd = connect_local(port);
+    if (fd >= 0 && get(fd, "/earthquakes/feed/v1.0/summary/all_day.geojson", "Accept-Encoding: gzip\r\n", buffer, sizeof(buffer),
+                       etag, sizeof(etag)) == 200) {
+        snprintf(revalidate, sizeof(revalidate), "If-None-Match: %s\r\n", etag);
+    }
+    if (fd >= 0) close(fd);
+    int each = requests / clients;
+    double rate = run_clients(port, clients, each, revalidate, &ok);
+    printf("Revalidation (304):        %9.0f requests/s (%d ok)\n", rate, ok);
+    rate = run_clients(port, clients, each / 10, "Accept-Encoding: gzip\r\n", &ok);
+    printf("Full body, gzip:           %9.0f requests/s (%d ok)\n", rate, ok);
+    rate = run_clients(port, clients, each / 50, "", &ok);
+    printf("Full body, identity:       %9.0f requests/s (%d ok, %zu-byte feed)\n", rate, ok, used);
+    printf("Upstream requests in all:  %d\n", g_upstream_requests);
+    return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * proxy.h - Caching feed proxy for the LAN
+ *
+ * Serves the feeds the monitor fetches to other devices over plain HTTP,
+ * from memory. Paths mirror upstream, /earthquakes/... for USGS and
+ * /v1/forecast?... for Open-Meteo, so a client only swaps the host. Each
+ * body is stored once as is and once gzipped, with an ETag: clients
+ * sending If-None-Match get a 304, clients accepting gzip get the stored
+ * bytes. The monitor's own fetches fill the cache; anything else missing
+ * or stale is fetched once, however many clients ask for it meanwhile.
+ *
+ * One epoll thread owns the cache and every connection; a few fetch
+ * threads talk to upstream and hand finished bodies back to it.
+ */
+
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <stdint.h>
+
+#define PROXY_MAX_ENTRIES 256     // Cached URLs; the least recently used goes first
+#define PROXY_MAX_CLIENTS 4096
+#define PROXY_REQUEST_MAX 8192    // Request line and headers
+#define PROXY_FETCHERS 4          // Upstream requests in flight at once
+#define PROXY_RETRY_SECONDS 10    // After a failed fetch, answer 502 this long before trying again
+
+typedef struct {
+    uint64_t requests;
+    uint64_t hits;         // Answered from memory, fresh or stale
+    uint64_t not_modified; // of which 304s
+    uint64_t waits;        // Parked until a fetch landed
+    uint64_t fetches;      // Upstream requests made
+    uint64_t failures;     // of which failed
+    int clients;           // Connections open now
+    int entries;
+} ProxyStats;
+
+extern ProxyStats g_proxy_stats; // Written by the proxy thread only
+
+int proxy_start(int port);
+void proxy_store(const char *url, const char *body, size_t length);
+int proxy_benchmark(int requests);
+
+#endif // PROXY_H
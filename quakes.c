@@ -0,0 +1,299 @@
+/*
+ * quakes.c - Live event list
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <jansson.h>
+#include "quakes.h"
+#include "monitor.h"
+#include "sites.h"
+#include "gmpe.h"
+#include "traveltime.h"
+#include "exposure.h"
+#include "etas.h"
+#include "rank.h"
+#include "indexes.h"
+#include "places.h"
+#include "rollup.h"
+#include "relay.h"
+#include "shard.h"
+#include "alerts.h"
+
+#define EXPOSURE_FELT_MMI 4.0   // Light shaking: felt indoors by many
+#define EXPOSURE_STRONG_MMI 6.0 // Strong shaking: felt by all, slight damage
+
+// --- Globals ---
+Earthquake g_quakes[MAX_QUAKES];
+int g_quake_count = 0;
+int g_quake_order[MAX_QUAKES]; // Display order, highest impact first
+int g_region_counts[MAX_REGION_CODE + 1];
+WaveArrival g_arrivals[MAX_ARRIVALS];
+int g_arrival_count = 0;
+float g_arrival_min_magnitude = ARRIVAL_MIN_MAGNITUDE;
+static RankColumns g_rank_columns;
+static QuakeColumns g_quake_columns;
+
+// --- History ---
+
+static void retire_event(uint64_t seq) {
+    if (!catalog_live(seq)) return;
+    index_on_retire(seq);
+    rollup_on_retire(seq);
+    places_on_retire(seq);
+    catalog_remove(seq);
+}
+
+// Records one feed event in the history and tells the modules tracking it.
+// Returns its sequence number.
+static uint64_t ingest_event(const CatalogEvent *event, const char *place) {
+    if (catalog_full() && !catalog_find(event->id, NULL)) retire_event(g_catalog.head); // Room for a new row only
+    uint64_t seq = CATALOG_NO_SEQ;
+    CatalogEvent previous;
+    CatalogChange change = catalog_upsert(event, &seq, &previous);
+    if (g_relay_port && (change != CATALOG_UNCHANGED || (place && strcmp(place, places_get(seq)) != 0))) {
+        relay_publish(event, place);
+    }
+    if (change == CATALOG_INSERTED) {
+        index_on_insert(seq);
+        rollup_on_insert(seq);
+        places_on_insert(seq, place);
+        etas_on_event(seq, place);
+    } else {
+        places_on_update(seq, place);
+        if (change == CATALOG_REVISED) {
+            index_on_revision(seq, &previous);
+            rollup_on_revision(seq, &previous);
+            etas_on_revision(seq);
+        }
+    }
+    return seq;
+}
+
+// Retires every event whose origin time has left the retention window,
+// found through the time index wherever it sits in the history.
+void expire_catalog(long long now_ms) {
+    uint64_t expired[256];
+    double cutoff = (double)(now_ms - CATALOG_RETENTION_DAYS * 86400000LL);
+    int count;
+    do {
+        count = index_range(INDEX_TIME, -INFINITY, cutoff - 1, 0, expired, 256);
+        for (int i = 0; i < count; i++) retire_event(expired[i]);
+    } while (count == 256);
+}
+
+// --- Evaluation ---
+
+// Estimates intensity at every site for every event, flagging events that
+// exceed a site's own threshold so they alert regardless of magnitude.
+void evaluate_site_shaking() {
+    static float mmi[MAX_QUAKES + GMPE_BATCH];
+    static float dist_km[MAX_QUAKES + GMPE_BATCH];
+
+    quake_columns_clear(&g_quake_columns);
+    for (int i = 0; i < g_quake_count; i++) {
+        quake_columns_push(&g_quake_columns, g_quakes[i].mag, g_quakes[i].depth, g_quakes[i].lat, g_quakes[i].lon);
+        g_quakes[i].peak_mmi = 0.0;
+        g_quakes[i].nearest_site_km = -1.0;
+        g_quakes[i].exceeds_site_threshold = 0;
+    }
+
+    for (int s = 0; s < g_site_count; s++) {
+        Site *site = &g_sites[s];
+        site->peak_mmi = 0.0;
+        site->peak_quake = -1;
+        if (g_quake_columns.count == 0) continue;
+
+        gmpe_evaluate_site(&g_quake_columns, site->lat, site->lon, mmi, dist_km);
+        for (int i = 0; i < g_quake_count; i++) {
+            Earthquake *quake = &g_quakes[i];
+            if (mmi[i] > site->peak_mmi) {
+                site->peak_mmi = mmi[i];
+                site->peak_quake = i;
+            }
+            if (mmi[i] > quake->peak_mmi) quake->peak_mmi = mmi[i];
+            if (quake->nearest_site_km < 0 || dist_km[i] < quake->nearest_site_km) quake->nearest_site_km = dist_km[i];
+            if (mmi[i] >= site->mmi_threshold) quake->exceeds_site_threshold = 1;
+        }
+    }
+}
+
+// Predicts P and S arrival times at every site for events large enough to
+// be worth a countdown, skipping waves that have already passed.
+void predict_wave_arrivals() {
+    double now = (double)time(NULL);
+    g_arrival_count = 0;
+    for (int i = 0; i < g_quake_count; i++) {
+        const Earthquake *quake = &g_quakes[i];
+        if (quake->mag < g_arrival_min_magnitude) continue;
+        double origin = quake->time_ms / 1000.0;
+        for (int s = 0; s < g_site_count && g_arrival_count < MAX_ARRIVALS; s++) {
+            double dist = epicentral_distance_deg(quake->lat, quake->lon, g_sites[s].lat, g_sites[s].lon);
+            double p_seconds, s_seconds;
+            traveltime_lookup(dist, quake->depth, &p_seconds, &s_seconds);
+            if (origin + s_seconds + ARRIVAL_LINGER_SECONDS < now) continue;
+            WaveArrival *arrival = &g_arrivals[g_arrival_count++];
+            arrival->quake = i;
+            arrival->site = s;
+            arrival->p_arrival = origin + p_seconds;
+            arrival->s_arrival = origin + s_seconds;
+        }
+    }
+}
+
+int arrivals_pending() {
+    double now = (double)time(NULL);
+    for (int a = 0; a < g_arrival_count; a++) {
+        if (g_arrivals[a].s_arrival + ARRIVAL_LINGER_SECONDS >= now) return 1;
+    }
+    return 0;
+}
+
+// Sums the exposure raster within the felt and strong shaking radii so the
+// alert check can weigh who is affected, not just how big the event is.
+static void estimate_exposure() {
+    for (int i = 0; i < g_quake_count; i++) {
+        Earthquake *quake = &g_quakes[i];
+        quake->exposure_felt = 0.0;
+        quake->exposure_strong = 0.0;
+        if (!exposure_available()) continue;
+        float felt_km = gmpe_radius_for_mmi(quake->mag, quake->depth, EXPOSURE_FELT_MMI);
+        float strong_km = gmpe_radius_for_mmi(quake->mag, quake->depth, EXPOSURE_STRONG_MMI);
+        quake->exposure_felt = exposure_within_radius(quake->lat, quake->lon, felt_km);
+        quake->exposure_strong = exposure_within_radius(quake->lat, quake->lon, strong_km);
+    }
+}
+
+// Orders the event list by impact score. The ranking keeps last update's
+// order and repairs it, so g_quakes itself stays in feed order.
+static void rank_quakes() {
+    long long now_ms = (long long)time(NULL) * 1000;
+    rank_columns_clear(&g_rank_columns);
+    for (int i = 0; i < g_quake_count; i++) {
+        const Earthquake *quake = &g_quakes[i];
+        rank_columns_push(&g_rank_columns, quake->seq, quake->mag, quake->nearest_site_km, quake->peak_mmi,
+                          (now_ms - quake->time_ms) / 3600000.0f, quake->exposure_felt);
+    }
+    if (rank_order(&g_rank_columns, g_quake_order) != g_quake_count) {
+        for (int i = 0; i < g_quake_count; i++) g_quake_order[i] = i;
+    }
+}
+
+// --- Live List ---
+
+void format_time_ago(long long event_time_ms, char* buffer, size_t buffer_size) {
+    time_t now = time(NULL);
+    long long diff_s = (now - (event_time_ms / 1000));
+    if (diff_s < 60) snprintf(buffer, buffer_size, "%llds ago", diff_s);
+    else snprintf(buffer, buffer_size, "%lldm ago", diff_s / 60);
+}
+
+// Adds an event to the live list if it passes the display filters.
+static void list_quake(const CatalogEvent *event, const char *id, const char *place, uint64_t seq, float min_magnitude) {
+    if (g_quake_count >= MAX_QUAKES || event->mag < min_magnitude || !region_filter_match(event->region) ||
+        (g_place_query && !places_contains(place, g_place_query))) {
+        return;
+    }
+    Earthquake *quake = &g_quakes[g_quake_count++];
+    memset(quake, 0, sizeof(*quake));
+    quake->mag = event->mag;
+    quake->lat = event->lat;
+    quake->lon = event->lon;
+    quake->depth = event->depth;
+    quake->region = event->region;
+    if (event->region <= MAX_REGION_CODE) g_region_counts[event->region]++;
+    if (place) strncpy(quake->place, place, sizeof(quake->place) - 1);
+    if (id) strncpy(quake->id, id, sizeof(quake->id) - 1);
+    quake->time_ms = event->time_ms;
+    quake->seq = seq;
+    format_time_ago(event->time_ms, quake->time_ago, sizeof(quake->time_ago));
+}
+
+// Re-runs everything that depends on the live list.
+static void update_quake_views(long long now_ms, float alert_threshold) {
+    if (!g_once) etas_update(now_ms); // Aftershock forecasts are only displayed
+    if (g_shard_count) {
+        evaluate_shards(now_ms / 1000);
+        check_for_storm_alerts();
+    } else {
+        evaluate_site_shaking();
+        predict_wave_arrivals();
+    }
+    estimate_exposure();
+    rank_quakes();
+    check_for_quake_alerts(alert_threshold);
+}
+
+// Takes one GeoJSON feed response into the history and the live list, and
+// re-runs everything that depends on them.
+void process_seismic_data(const char *body, long long now_ms, float min_magnitude, float alert_threshold) {
+    json_error_t error;
+    json_t *root = json_loads(body, 0, &error);
+    if (!root) return;
+    json_t *features = json_object_get(root, "features");
+    size_t count = json_array_size(features);
+    uint64_t *seqs = malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!seqs) {
+        json_decref(root);
+        return;
+    }
+    // The feed lists newest first. Every event goes into the history oldest
+    // first, so its insertion order follows origin time, then the newest
+    // make the live list; the display keeps its own filters.
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t n = 0; n < count; n++) {
+            size_t i = pass == 0 ? count - 1 - n : n;
+            json_t *value = json_array_get(features, i);
+            json_t *properties = json_object_get(value, "properties");
+            json_t *coordinates = json_object_get(json_object_get(value, "geometry"), "coordinates");
+            double mag = json_real_value(json_object_get(properties, "mag"));
+            double lon = json_number_value(json_array_get(coordinates, 0));
+            double lat = json_number_value(json_array_get(coordinates, 1));
+            int region = region_lookup(lat, lon);
+            const char *place = json_string_value(json_object_get(properties, "place"));
+            const char *id = json_string_value(json_object_get(value, "id")); // On the feature, beside its properties
+            long long time = json_integer_value(json_object_get(properties, "time"));
+
+            CatalogEvent event = { .time_ms = time, .lat = lat, .lon = lon, .mag = mag, .region = region };
+            event.depth = json_number_value(json_array_get(coordinates, 2));
+            if (id) strncpy(event.id, id, sizeof(event.id) - 1);
+            if (pass == 0) seqs[i] = id ? ingest_event(&event, place) : CATALOG_NO_SEQ;
+            else list_quake(&event, id, place, seqs[i], min_magnitude);
+        }
+    }
+    free(seqs);
+    update_quake_views(now_ms, alert_threshold);
+    json_decref(root);
+}
+
+static void apply_relay_delta(const RelayDelta *delta) {
+    ingest_event(&delta->event, delta->place);
+}
+
+// Takes what the relay sent since the last call into the history. Once a
+// whole upstream cycle is in, rebuilds the live list from the history as
+// the feed would have listed it, newest first within the feed's window,
+// and returns 1.
+int apply_relay_deltas(float min_magnitude, float alert_threshold) {
+    if (relay_apply(apply_relay_delta) == 0) return 0;
+    long long now_ms = (long long)time(NULL) * 1000;
+    long long window_ms = strcmp(g_feed, "month") == 0 ? 30 * 86400000LL : strcmp(g_feed, "week") == 0 ? 7 * 86400000LL
+                        : strcmp(g_feed, "day") == 0 ? 86400000LL : 3600000LL;
+    g_quake_count = 0;
+    memset(g_region_counts, 0, sizeof(g_region_counts));
+    expire_catalog(now_ms);
+    IndexCursor cursor;
+    uint64_t seq;
+    index_seek(&cursor, INDEX_TIME, (double)(now_ms - window_ms), INFINITY, 1);
+    while (g_quake_count < MAX_QUAKES && index_next(&cursor, &seq)) {
+        CatalogEvent event;
+        catalog_get(seq, &event);
+        list_quake(&event, event.id, places_get(seq), seq, min_magnitude);
+    }
+    update_quake_views(now_ms, alert_threshold);
+    relay_end_cycle(now_ms); // Passes the cycle on when serving in turn
+    return 1;
+}
@@ -0,0 +1,64 @@
+/*
+ * quakes.h - Live event list
+ *
+ * Every feed update, or whole cycle from a relay, goes into the history and
+ * rebuilds the live list: the newest events that pass the display filters,
+ * in feed order. Each site is then evaluated against the list for expected
+ * shaking and wave arrivals, here or on the site workers, and the events
+ * are ranked by impact for display and alerts.
+ */
+
+#ifndef QUAKES_H
+#define QUAKES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "region.h"
+
+#define MAX_QUAKES 200
+#define MAX_ARRIVALS 1024
+#define ARRIVAL_MIN_MAGNITUDE 5.0 // Default smallest event given wave countdowns
+#define ARRIVAL_LINGER_SECONDS 60 // Keep showing an arrival this long after the S wave
+
+typedef struct {
+    double mag;
+    char place[256];
+    char time_ago[20];
+    char id[64];
+    double lat;
+    double lon;
+    double depth;
+    long long time_ms;
+    uint64_t seq; // Catalog sequence number
+    int region;
+    float peak_mmi;        // Highest estimated intensity over all sites
+    float nearest_site_km; // Hypocentral distance to the closest site
+    int exceeds_site_threshold;
+    double exposure_felt;   // Population/assets within the MMI IV radius
+    double exposure_strong; // ... and within the MMI VI radius
+} Earthquake;
+
+typedef struct {
+    int quake; // Index into g_quakes
+    int site;  // Index into g_sites
+    double p_arrival; // Unix time
+    double s_arrival;
+} WaveArrival;
+
+extern Earthquake g_quakes[MAX_QUAKES];
+extern int g_quake_count;
+extern int g_quake_order[MAX_QUAKES]; // Display order, highest impact first
+extern int g_region_counts[MAX_REGION_CODE + 1];
+extern WaveArrival g_arrivals[MAX_ARRIVALS];
+extern int g_arrival_count;
+extern float g_arrival_min_magnitude;
+
+void process_seismic_data(const char *body, long long now_ms, float min_magnitude, float alert_threshold);
+int apply_relay_deltas(float min_magnitude, float alert_threshold);
+void expire_catalog(long long now_ms);
+void evaluate_site_shaking();
+void predict_wave_arrivals();
+int arrivals_pending();
+void format_time_ago(long long event_time_ms, char* buffer, size_t buffer_size);
+
+#endif // QUAKES_H
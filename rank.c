@@ -0,0 +1,223 @@
+/*
+ * rank.c - Impact ranking for the event list
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rank.h"
+#include "catalog.h"
+#include "gmpe.h"
+#include "fastmath.h"
+
+#define RANK_SCALE 10.0f // Every component is scored 0-10
+
+// --- Globals ---
+RankWeights g_rank_weights = { 1.0f, 0.5f, 1.0f, 0.25f, 0.5f };
+
+// Keys in the order shown last time
+static uint64_t *g_previous_keys = NULL;
+static int g_previous_count = 0;
+static int g_previous_capacity = 0;
+
+// key -> column index for the current update
+static uint64_t *g_lookup_keys = NULL;
+static int *g_lookup_index = NULL;
+static int g_lookup_mask = -1;
+
+// Columns already given a place in the current update
+static char *g_placed = NULL;
+static int g_placed_capacity = 0;
+
+// --- Weights ---
+
+// Parses "magnitude,proximity,intensity,recency[,exposure]" weights, e.g.
+// "1,0,0,0,0" for a plain magnitude order.
+int rank_parse_weights(const char *spec) {
+    RankWeights weights = g_rank_weights;
+    if (sscanf(spec, "%f,%f,%f,%f,%f", &weights.magnitude, &weights.proximity, &weights.intensity, &weights.recency,
+               &weights.exposure) < 4) {
+        fprintf(stderr, "Ranking weights must be magnitude,proximity,intensity,recency[,exposure] (got \"%s\")\n", spec);
+        return -1;
+    }
+    g_rank_weights = weights;
+    return 0;
+}
+
+// --- Columns ---
+
+static int grow_columns(RankColumns *cols, int needed) {
+    int capacity = cols->capacity ? cols->capacity : 64;
+    while (capacity < needed) capacity *= 2;
+    float **arrays[] = { &cols->mag, &cols->nearest_km, &cols->peak_mmi, &cols->age_hours, &cols->exposure, &cols->score };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        float *grown = realloc(*arrays[i], capacity * sizeof(float));
+        if (!grown) return -1;
+        *arrays[i] = grown;
+    }
+    uint64_t *keys = realloc(cols->key, capacity * sizeof(uint64_t));
+    if (!keys) return -1;
+    cols->key = keys;
+    cols->capacity = capacity;
+    return 0;
+}
+
+void rank_columns_clear(RankColumns *cols) {
+    cols->count = 0;
+}
+
+// Inputs are clamped here so the scoring pass needs no branches.
+int rank_columns_push(RankColumns *cols, uint64_t key, float mag, float nearest_km, float peak_mmi, float age_hours,
+                      double exposure_felt) {
+    int padded = (cols->count + RANK_BATCH) / RANK_BATCH * RANK_BATCH;
+    if (padded > cols->capacity && grow_columns(cols, padded) != 0) return -1;
+
+    int i = cols->count++;
+    cols->key[i] = key;
+    cols->mag[i] = mag > 0 ? mag : 0.0f;
+    cols->nearest_km[i] = (nearest_km < 0 || nearest_km > GMPE_MAX_RADIUS_KM) ? GMPE_MAX_RADIUS_KM : nearest_km;
+    cols->peak_mmi[i] = peak_mmi > 0 ? peak_mmi : 0.0f;
+    cols->age_hours[i] = age_hours > 0 ? age_hours : 0.0f;
+    double exposure = RANK_SCALE * log10(1.0 + (exposure_felt > 0 ? exposure_felt : 0.0)) / log10(RANK_EXPOSURE_FULL_SCALE);
+    cols->exposure[i] = exposure < RANK_SCALE ? (float)exposure : RANK_SCALE;
+
+    for (int p = cols->count; p < padded; p++) {
+        cols->mag[p] = 0.0f;
+        cols->nearest_km[p] = GMPE_MAX_RADIUS_KM;
+        cols->peak_mmi[p] = 0.0f;
+        cols->age_hours[p] = 0.0f;
+        cols->exposure[p] = 0.0f;
+    }
+    return i;
+}
+
+// --- Scoring ---
+
+// Proximity falls off with log distance, reaching 0 where intensity
+// estimates stop; recency halves every RANK_RECENCY_HALF_LIFE_HOURS.
+static void score_columns(RankColumns *cols) {
+    const RankWeights w = g_rank_weights;
+    const float proximity_scale = RANK_SCALE / fast_log10f(1.0f + GMPE_MAX_RADIUS_KM);
+    const float decay = -1.0f / RANK_RECENCY_HALF_LIFE_HOURS;
+    const float *restrict mag = cols->mag;
+    const float *restrict nearest_km = cols->nearest_km;
+    const float *restrict peak_mmi = cols->peak_mmi;
+    const float *restrict age_hours = cols->age_hours;
+    const float *restrict exposure = cols->exposure;
+
+    for (int base = 0; base < cols->count; base += RANK_BATCH) {
+        float score[RANK_BATCH];
+        for (int k = 0; k < RANK_BATCH; k++) {
+            int i = base + k;
+            float proximity = RANK_SCALE - proximity_scale * fast_log10f(1.0f + nearest_km[i]);
+            float recency = RANK_SCALE * fast_exp2f(decay * age_hours[i]);
+            score[k] = w.magnitude * mag[i] + w.proximity * proximity + w.intensity * peak_mmi[i] +
+                       w.recency * recency + w.exposure * exposure[i];
+        }
+        // Columns are padded, so whole batches can be stored
+        memcpy(cols->score + base, score, sizeof(score));
+    }
+}
+
+// --- Ordering ---
+
+static uint64_t hash_key(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+static int build_lookup(const RankColumns *cols) {
+    int buckets = 16;
+    while (buckets < cols->count * 2) buckets <<= 1;
+    if (buckets - 1 > g_lookup_mask) {
+        uint64_t *keys = realloc(g_lookup_keys, buckets * sizeof(uint64_t));
+        if (keys) g_lookup_keys = keys;
+        int *index = realloc(g_lookup_index, buckets * sizeof(int));
+        if (index) g_lookup_index = index;
+        if (!keys || !index) return -1;
+        g_lookup_mask = buckets - 1;
+    }
+    for (int b = 0; b <= g_lookup_mask; b++) g_lookup_index[b] = -1;
+    for (int i = 0; i < cols->count; i++) {
+        if (cols->key[i] == CATALOG_NO_SEQ) continue;
+        int bucket = hash_key(cols->key[i]) & g_lookup_mask;
+        while (g_lookup_index[bucket] >= 0) bucket = (bucket + 1) & g_lookup_mask;
+        g_lookup_keys[bucket] = cols->key[i];
+        g_lookup_index[bucket] = i;
+    }
+    return 0;
+}
+
+static int lookup(uint64_t key) {
+    int bucket = hash_key(key) & g_lookup_mask;
+    while (g_lookup_index[bucket] >= 0) {
+        if (g_lookup_keys[bucket] == key) return g_lookup_index[bucket];
+        bucket = (bucket + 1) & g_lookup_mask;
+    }
+    return -1;
+}
+
+// Fills order with column indices, highest score first, and returns the
+// number written (always cols->count). Ties keep their previous order.
+int rank_order(RankColumns *cols, int *order) {
+    score_columns(cols);
+    const float *score = cols->score;
+    if (build_lookup(cols) != 0) g_previous_count = 0;
+
+    // Carry over the events still listed, in last update's order
+    if (cols->count > g_placed_capacity) {
+        char *grown = realloc(g_placed, cols->capacity);
+        if (!grown) return 0;
+        g_placed = grown;
+        g_placed_capacity = cols->capacity;
+    }
+    memset(g_placed, 0, cols->count);
+    int n = 0;
+    for (int k = 0; k < g_previous_count; k++) {
+        int i = lookup(g_previous_keys[k]);
+        if (i < 0 || g_placed[i]) continue;
+        g_placed[i] = 1;
+        order[n++] = i;
+    }
+
+    // Repair it; scores drift together as events age, so this is near-linear
+    for (int k = 1; k < n; k++) {
+        int i = order[k];
+        int j = k;
+        while (j > 0 && score[order[j - 1]] < score[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    // Binary-search each new event into place, after equal scores
+    for (int i = 0; i < cols->count; i++) {
+        if (g_placed[i]) continue;
+        int low = 0, high = n;
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (score[order[mid]] >= score[i]) low = mid + 1;
+            else high = mid;
+        }
+        memmove(&order[low + 1], &order[low], (n - low) * sizeof(int));
+        order[low] = i;
+        n++;
+    }
+
+    if (n > g_previous_capacity) {
+        uint64_t *grown = realloc(g_previous_keys, cols->capacity * sizeof(uint64_t));
+        if (!grown) {
+            g_previous_count = 0;
+            return n;
+        }
+        g_previous_keys = grown;
+        g_previous_capacity = cols->capacity;
+    }
+    for (int k = 0; k < n; k++) g_previous_keys[k] = cols->key[order[k]];
+    g_previous_count = n;
+    return n;
+}
@@ -0,0 +1,53 @@
+/*
+ * rank.h - Impact ranking for the event list
+ *
+ * Each listed event is scored from its magnitude, its distance to the
+ * nearest site, the strongest intensity it is expected to cause at any site,
+ * its age and the population exposed to felt shaking, each on a 0-10 scale
+ * and combined with operator-set weights.
+ * All scores come from one batched pass over event columns.
+ *
+ * The display order is kept between updates and repaired rather than
+ * rebuilt: events still listed keep their place and are insertion-sorted by
+ * their new scores (most barely move as they age), and new events are
+ * binary-searched into position.
+ */
+
+#ifndef RANK_H
+#define RANK_H
+
+#include <stdint.h>
+
+#define RANK_BATCH 8 // Lanes per batch; columns are padded to a multiple
+#define RANK_RECENCY_HALF_LIFE_HOURS 6.0f
+#define RANK_EXPOSURE_FULL_SCALE 1e7 // Felt exposure that scores the full 10
+
+typedef struct {
+    float magnitude;
+    float proximity;
+    float intensity;
+    float recency;
+    float exposure;
+} RankWeights;
+
+typedef struct {
+    int count;
+    int capacity;
+    uint64_t *key;      // Catalog sequence number, or CATALOG_NO_SEQ
+    float *mag;
+    float *nearest_km;  // Negative when no site was evaluated
+    float *peak_mmi;
+    float *age_hours;
+    float *exposure;    // Already on the 0-10 scale
+    float *score;
+} RankColumns;
+
+extern RankWeights g_rank_weights;
+
+int rank_parse_weights(const char *spec);
+void rank_columns_clear(RankColumns *cols);
+int rank_columns_push(RankColumns *cols, uint64_t key, float mag, float nearest_km, float peak_mmi, float age_hours,
+                      double exposure_felt);
+int rank_order(RankColumns *cols, int *order);
+
+#endif // RANK_H
@@ -0,0 +1,147 @@
+/*
+ * region.c - Offline Flinn-Engdahl region lookup
+ *
+ * Lookups are a single array index into a global raster, row 0 being the
+ * northernmost band and column 0 starting at 180W.
+ *
+ * Raster file format (for region_load_raster):
+ *   char     magic[4]        "FEGR"
+ *   uint16_t version         1 or 2
+ *   uint16_t bytes_per_cell  1 or 2 (little-endian codes)
+ *   uint16_t cols, rows      covering 360 x 180 degrees
+ *   uint32_t name_count      version 2; reserved in version 1
+ *   cells[rows][cols]
+ *   names                    version 2: name_count NUL-terminated names,
+ *                            the name of code n n-th
+ *
+ * A loaded raster's codes are its own, so the built-in seismic region
+ * names are never used for them; codes it has no name for are numbered.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "region.h"
+#include "region_table.h"
+#include "region_grid.h"
+
+#define RASTER_HEADER_SIZE 16
+
+// --- Globals ---
+static const unsigned char *g_raster = REGION_GRID;
+static int g_raster_cols = REGION_GRID_COLS;
+static int g_raster_rows = REGION_GRID_ROWS;
+static int g_raster_cell_bytes = 1;
+static const char *const *g_raster_names = REGION_NAMES;
+static int g_raster_name_count = REGION_COUNT + 1;
+
+static int g_region_filters[MAX_REGION_FILTERS];
+static int g_region_filter_count = 0;
+
+// --- Raster Loading ---
+
+int region_load_raster(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open region raster %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < RASTER_HEADER_SIZE) {
+        fprintf(stderr, "Region raster %s is too small\n", path);
+        close(fd);
+        return -1;
+    }
+    const unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping stays valid after the descriptor is closed
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Could not map region raster %s\n", path);
+        return -1;
+    }
+
+    int version = map[4] | (map[5] << 8);
+    int cell_bytes = map[6] | (map[7] << 8);
+    int cols = map[8] | (map[9] << 8);
+    int rows = map[10] | (map[11] << 8);
+    uint32_t name_count = version == 2 ? map[12] | (map[13] << 8) | ((uint32_t)map[14] << 16) | ((uint32_t)map[15] << 24) : 0;
+    off_t names_offset = (off_t)RASTER_HEADER_SIZE + (off_t)cols * rows * cell_bytes;
+    if (memcmp(map, "FEGR", 4) != 0 || (version != 1 && version != 2) || (cell_bytes != 1 && cell_bytes != 2) ||
+        cols == 0 || rows == 0 || names_offset > st.st_size || name_count > (uint32_t)(st.st_size - names_offset)) {
+        fprintf(stderr, "Region raster %s has an invalid header\n", path);
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+
+    // Every name must end inside the file
+    const char **names = name_count ? malloc(name_count * sizeof(*names)) : NULL;
+    if (name_count && !names) {
+        fprintf(stderr, "Not enough memory for the names in region raster %s\n", path);
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+    const char *name = (const char *)map + names_offset, *end = (const char *)map + st.st_size;
+    for (uint32_t n = 0; n < name_count; n++) {
+        const char *nul = memchr(name, '\0', end - name);
+        if (!nul) {
+            fprintf(stderr, "Region raster %s has an invalid name table\n", path);
+            free(names);
+            munmap((void *)map, st.st_size);
+            return -1;
+        }
+        names[n] = name;
+        name = nul + 1;
+    }
+
+    if (g_raster_names != REGION_NAMES) free((void *)g_raster_names);
+    g_raster_names = names;
+    g_raster_name_count = (int)name_count;
+    g_raster = map + RASTER_HEADER_SIZE;
+    g_raster_cols = cols;
+    g_raster_rows = rows;
+    g_raster_cell_bytes = cell_bytes;
+    return 0;
+}
+
+// --- Lookup ---
+
+int region_lookup(double lat, double lon) {
+    int row = (int)((90.0 - lat) * g_raster_rows / 180.0);
+    int col = (int)((lon + 180.0) * g_raster_cols / 360.0);
+    if (row < 0) row = 0;
+    if (row >= g_raster_rows) row = g_raster_rows - 1;
+    col %= g_raster_cols;
+    if (col < 0) col += g_raster_cols;
+
+    size_t cell = (size_t)row * g_raster_cols + col;
+    if (g_raster_cell_bytes == 1) return g_raster[cell];
+    return g_raster[cell * 2] | (g_raster[cell * 2 + 1] << 8);
+}
+
+const char *region_name(int region) {
+    static char numbered[32];
+    if (region >= 0 && region < g_raster_name_count) return g_raster_names[region];
+    snprintf(numbered, sizeof(numbered), "F-E region %d", region);
+    return numbered;
+}
+
+// --- Region Filter ---
+
+void region_filter_add(int region) {
+    if (g_region_filter_count < MAX_REGION_FILTERS) {
+        g_region_filters[g_region_filter_count++] = region;
+    }
+}
+
+int region_filter_match(int region) {
+    if (g_region_filter_count == 0) return 1;
+    for (int i = 0; i < g_region_filter_count; i++) {
+        if (g_region_filters[i] == region) return 1;
+    }
+    return 0;
+}
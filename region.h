@@ -0,0 +1,23 @@
+/*
+ * region.h - Offline Flinn-Engdahl region lookup
+ *
+ * Maps event coordinates to a Flinn-Engdahl seismic region number through a
+ * precomputed lat/lon raster. The default raster is embedded at build time;
+ * a finer one (e.g. the 757 geographic regions) can be memory-mapped from a
+ * file with region_load_raster(), with its own region names.
+ */
+
+#ifndef REGION_H
+#define REGION_H
+
+#define MAX_REGION_FILTERS 16
+#define MAX_REGION_CODE 1023 // Highest code kept in per-region tallies
+
+int region_load_raster(const char *path);
+int region_lookup(double lat, double lon);
+const char *region_name(int region);
+
+void region_filter_add(int region);
+int region_filter_match(int region);
+
+#endif // REGION_H
@@ -0,0 +1,146 @@
+/*
+ * region_table.h - Flinn-Engdahl seismic region definitions
+ *
+ * The 50 Flinn-Engdahl seismic regions, each approximated by one or more
+ * lat/lon boxes. The boxes are painted in table order onto a 1-degree grid
+ * by tools/gen_region_grid.c at build time, so broad ocean and continental
+ * areas come first and the narrower arcs that cut into them come last.
+ *
+ * Shared by the grid generator and region.c (for the region names).
+ */
+
+#ifndef REGION_TABLE_H
+#define REGION_TABLE_H
+
+#define REGION_COUNT 50
+#define REGION_GRID_STEP 1 // Degrees per raster cell
+
+typedef struct {
+    float lat_min, lat_max;
+    float lon_min, lon_max;
+    unsigned char region;
+} RegionBox;
+
+// Index 0 is used for cells no box covers.
+static const char *const REGION_NAMES[REGION_COUNT + 1] = {
+    "Unknown region",
+    "Alaska-Aleutian Arc",
+    "Southeastern Alaska to Washington",
+    "Oregon, California and Nevada",
+    "Baja California and Gulf of California",
+    "Mexico-Guatemala area",
+    "Central America",
+    "Caribbean loop",
+    "Andean South America",
+    "Extreme South America",
+    "Southern Antilles",
+    "New Zealand region",
+    "Kermadec-Tonga-Samoa area",
+    "Fiji Islands area",
+    "New Hebrides Islands",
+    "Bismarck and Solomon Islands",
+    "New Guinea",
+    "Caroline Islands area",
+    "Guam to Japan",
+    "Japan-Kurils-Kamchatka",
+    "Southwestern Japan and Ryukyu Islands",
+    "Taiwan area",
+    "Philippines",
+    "Borneo-Sulawesi",
+    "Sunda Arc",
+    "Myanmar and Southeast Asia",
+    "India-Tibet-Sichuan-Yunnan",
+    "Southern Xinjiang to Gansu",
+    "Lake Issyk-Kul to Lake Baikal",
+    "Western Asia",
+    "Middle East-Crimea-Eastern Balkans",
+    "Western Mediterranean area",
+    "Atlantic Ocean",
+    "Indian Ocean",
+    "Eastern North America",
+    "Eastern South America",
+    "Northwestern Europe",
+    "Africa",
+    "Australia",
+    "Pacific Basin",
+    "Arctic Zone",
+    "Eastern Asia",
+    "Northeastern Asia, Northern Alaska to Greenland",
+    "Southeastern and Antarctic Pacific Ocean",
+    "Galapagos area",
+    "Macquarie loop",
+    "Andaman Islands to Sumatra",
+    "Baluchistan",
+    "Hindu Kush and Pamir",
+    "Northern Asia",
+    "Antarctica",
+};
+
+// Boxes never cross the antimeridian; split them instead.
+static const RegionBox REGION_BOXES[] = {
+    // Oceans and polar caps
+    { -60,  60,  120,  180, 39 },
+    { -60,  60, -180,  -75, 39 },
+    { -60,  70,  -75,   20, 32 },
+    { -60,  30,   20,  120, 33 },
+    { -60, -20, -130,  -75, 43 },
+    {  70,  90, -180,  180, 40 },
+    { -90, -60, -180,  180, 50 },
+
+    // Continental interiors
+    {  25,  62, -115,  -52, 34 },
+    { -55,  10,  -65,  -34, 35 },
+    {  50,  70,   30,  140, 49 },
+    {  45,  70,  -10,   30, 36 },
+    { -35,  35,  -17,   52, 37 },
+    { -45, -10,  113,  155, 38 },
+    {  20,  50,  105,  135, 41 },
+    {  35,  50,   45,   75, 29 },
+    {  40,  50,   75,  110, 28 },
+    {  35,  40,   75,  105, 27 },
+    {   8,  35,   70,  105, 26 },
+    {   5,  28,   92,  110, 25 },
+    {  25,  47,   20,   60, 30 },
+    {  30,  45,  -10,   20, 31 },
+    {  24,  32,   60,   70, 47 },
+    {  34,  40,   68,   76, 48 },
+    {  60,  70, -170,  -20, 42 },
+    {  60,  70,  140,  180, 42 },
+
+    // Western Americas
+    {  45,  60, -140, -115,  2 },
+    {  50,  65, -180, -140,  1 },
+    {  50,  56,  170,  180,  1 },
+    {  32,  45, -127, -114,  3 },
+    {  22,  32, -118, -107,  4 },
+    {  13,  22, -107,  -90,  5 },
+    {   6,  13,  -92,  -77,  6 },
+    {  10,  22,  -77,  -59,  7 },
+    { -45,  10,  -82,  -65,  8 },
+    { -56, -45,  -76,  -63,  9 },
+    { -62, -53,  -63,  -25, 10 },
+    {  -5,   5,  -95,  -85, 44 },
+
+    // Western Pacific and Indonesian arcs
+    { -48, -34,  165,  180, 11 },
+    { -60, -48,  140,  170, 45 },
+    { -34, -13, -180, -170, 12 },
+    { -34, -25,  175,  180, 12 },
+    { -22, -12,  172,  180, 13 },
+    { -22, -10,  164,  172, 14 },
+    { -12,  -2,  148,  164, 15 },
+    { -10,   0,  130,  148, 16 },
+    {   0,  10,  135,  165, 17 },
+    {  10,  30,  138,  148, 18 },
+    {  34,  60,  139,  165, 19 },
+    {  24,  34,  123,  139, 20 },
+    {  21,  26,  119,  123, 21 },
+    {   5,  21,  116,  128, 22 },
+    {  -6,   7,  108,  128, 23 },
+    { -12,  -6,  100,  130, 24 },
+    {  -6,  15,   90,  100, 46 },
+};
+
+#define REGION_BOX_COUNT (sizeof(REGION_BOXES) / sizeof(REGION_BOXES[0]))
+
+#endif // REGION_TABLE_H
@@ -0,0 +1,660 @@
+/*
+ * relay.c - Event delta relay between monitors
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "relay.h"
+#include "net.h"
+#include "places.h"
+
+#define HELLO_BYTES 20
+#define FRAME_HEADER 11 // Length, type and seq
+#define FRAME_MAX (FRAME_HEADER + 8 + 16 + 2 + 1 + CATALOG_ID_LEN + 1 + RELAY_PLACE_MAX)
+#define READ_BUFFER 65536
+#define RELAY_BENCH_NODES 4
+#define RELAY_BENCH_LATE_NODE (RELAY_BENCH_NODES - 1) // Joins once the log has wrapped
+#define RELAY_BENCH_CYCLE 500 // Events per upstream cycle
+#define RELAY_BENCH_TIMEOUT_SECONDS 60
+
+typedef struct Node Node;
+
+// The relay's whole catalog as 'E' frames with seq 0, for nodes the log
+// no longer reaches; shared by every node sending it
+typedef struct {
+    int refs;
+    uint64_t generation;
+    uint64_t seq;  // The log resumes here after it
+    size_t length;
+    uint8_t bytes[];
+} Snapshot;
+
+struct Node {
+    NetConn conn; // First, so the server's pointers are ours
+    int slot;     // In g_nodes
+    uint8_t hello[HELLO_BYTES];
+    int hello_used;    // HELLO_BYTES once the node said where to resume
+    uint64_t next_seq; // Next delta to queue for it
+    int awaiting_snapshot;    // Out of the log's reach: unanswered until the main loop takes a snapshot
+    uint64_t snapshot_after;  // Generation current when it asked; only a newer snapshot will do
+    Snapshot *snapshot;       // Being sent, ahead of the log from snapshot->seq
+    size_t snapshot_sent;
+    uint8_t out[RELAY_SEND_BUFFER];
+    int out_used;
+    int out_sent;
+};
+
+// --- Globals ---
+RelayStats g_relay_stats;
+
+// Serving: the log is written by the main loop and read by the relay thread
+static uint8_t g_log[RELAY_LOG_RECORDS][FRAME_MAX]; // Encoded frames
+static uint64_t g_log_head = 1, g_log_tail = 1;     // Oldest seq kept, next seq given
+static uint64_t g_epoch;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static NetServer g_server = NET_SERVER_INIT;
+static Node *g_nodes[RELAY_MAX_CLIENTS];
+static int g_node_count = 0;
+static Snapshot *g_snapshot;     // Latest one, while nodes are waiting for it
+static uint64_t g_snapshot_generation = 0;
+static int g_snapshot_waiters = 0;
+
+// Joined: the reader thread fills the ring, the main loop drains it
+static RelayDelta g_ring[RELAY_RING_SIZE];
+static uint64_t g_ring_head = 0; // Next slot the reader fills
+static uint64_t g_ring_tail = 0; // Next slot the main loop drains
+static char g_host[256];
+static char g_port[16];
+static uint64_t g_joined_epoch = 0;
+static uint64_t g_next_seq = 0; // Next delta wanted; 0 for everything
+static uint64_t g_drop_at = 0;  // Benchmark only: hang up once after this delta
+
+// --- Encoding ---
+
+static uint8_t *put(uint8_t *p, const void *value, size_t size) {
+    memcpy(p, value, size); // Little-endian on every host the monitor runs on
+    return p + size;
+}
+
+static const uint8_t *get(const uint8_t *p, void *value, size_t size) {
+    memcpy(value, p, size);
+    return p + size;
+}
+
+// Writes one frame and returns its length.
+static int encode(uint8_t *frame, uint8_t type, uint64_t seq, long long time_ms, const CatalogEvent *event, const char *place) {
+    uint8_t *p = frame + 2;
+    int64_t time = time_ms;
+    *p++ = type;
+    p = put(p, &seq, 8);
+    p = put(p, &time, 8);
+    if (type == 'E') {
+        uint16_t region = (uint16_t)event->region;
+        size_t id_length = strnlen(event->id, CATALOG_ID_LEN - 1);
+        size_t place_length = place ? strnlen(place, RELAY_PLACE_MAX - 1) : 0;
+        p = put(p, &event->lat, 4);
+        p = put(p, &event->lon, 4);
+        p = put(p, &event->depth, 4);
+        p = put(p, &event->mag, 4);
+        p = put(p, &region, 2);
+        *p++ = (uint8_t)id_length;
+        p = put(p, event->id, id_length);
+        *p++ = (uint8_t)place_length;
+        p = put(p, place, place_length);
+    }
+    uint16_t length = (uint16_t)(p - frame - 2);
+    memcpy(frame, &length, 2);
+    return (int)(p - frame);
+}
+
+// Reads the frame after its length field. Returns -1 if it is malformed.
+static int decode(const uint8_t *p, int length, RelayDelta *delta) {
+    const uint8_t *end = p + length;
+    int64_t time;
+    if (length < FRAME_HEADER - 2 + 8) return -1;
+    uint8_t type = *p++;
+    memset(delta, 0, sizeof(*delta));
+    p = get(p, &delta->seq, 8);
+    p = get(p, &time, 8);
+    if (type == 'C') {
+        delta->cycle_end = 1;
+        return 0;
+    }
+    if (type != 'E' || end - p < 19) return -1;
+    uint16_t region;
+    delta->event.time_ms = time;
+    p = get(p, &delta->event.lat, 4);
+    p = get(p, &delta->event.lon, 4);
+    p = get(p, &delta->event.depth, 4);
+    p = get(p, &delta->event.mag, 4);
+    p = get(p, &region, 2);
+    delta->event.region = region;
+    int id_length = *p++;
+    if (id_length >= CATALOG_ID_LEN || end - p < id_length + 1) return -1;
+    p = get(p, delta->event.id, id_length);
+    int place_length = *p++;
+    if (place_length >= RELAY_PLACE_MAX || end - p < place_length) return -1;
+    get(p, delta->place, place_length);
+    return 0;
+}
+
+// --- Serving ---
+
+// Appends a frame to the log, pushing out the oldest once it is full.
+static void append(uint8_t type, long long time_ms, const CatalogEvent *event, const char *place) {
+    pthread_mutex_lock(&g_lock);
+    uint64_t seq = g_log_tail++;
+    encode(g_log[seq % RELAY_LOG_RECORDS], type, seq, time_ms, event, place);
+    if (g_log_tail - g_log_head > RELAY_LOG_RECORDS) g_log_head++;
+    pthread_mutex_unlock(&g_lock);
+}
+
+// Queues an event the catalog inserted or revised for every node.
+void relay_publish(const CatalogEvent *event, const char *place) {
+    if (g_server.wake < 0) return;
+    append('E', event->time_ms, event, place);
+    g_relay_stats.published++;
+}
+
+// Called with g_lock held.
+static void release_snapshot(Snapshot *snapshot) {
+    if (--snapshot->refs == 0) free(snapshot);
+}
+
+// Called with g_lock held, as a node stops waiting for a snapshot.
+static void stop_waiting(Node *n) {
+    n->awaiting_snapshot = 0;
+    if (__atomic_sub_fetch(&g_snapshot_waiters, 1, __ATOMIC_RELEASE) == 0 && g_snapshot) { // Nobody else needs it kept
+        release_snapshot(g_snapshot);
+        g_snapshot = NULL;
+    }
+}
+
+// Encodes every row of the catalog for the nodes waiting on one. Runs on
+// the main loop between cycles, when the catalog holds exactly what the
+// log up to g_log_tail says. On failure the nodes wait for the next cycle.
+static void take_snapshot() {
+    size_t capacity = 65536, length = 0;
+    Snapshot *snapshot = malloc(sizeof(Snapshot) + capacity);
+    for (uint64_t seq = g_catalog.head; snapshot && seq < g_catalog.tail; seq++) {
+        if (!catalog_live(seq)) continue;
+        if (length + FRAME_MAX > capacity) {
+            Snapshot *grown = realloc(snapshot, sizeof(Snapshot) + capacity * 2);
+            if (!grown) {
+                free(snapshot);
+                return;
+            }
+            snapshot = grown;
+            capacity *= 2;
+        }
+        CatalogEvent event;
+        catalog_get(seq, &event);
+        length += encode(snapshot->bytes + length, 'E', 0, event.time_ms, &event, places_get(seq));
+    }
+    if (!snapshot) return;
+    snapshot->refs = 1;
+    snapshot->length = length;
+    pthread_mutex_lock(&g_lock);
+    snapshot->generation = ++g_snapshot_generation;
+    snapshot->seq = g_log_tail;
+    if (g_snapshot) release_snapshot(g_snapshot);
+    g_snapshot = snapshot;
+    pthread_mutex_unlock(&g_lock);
+}
+
+// Marks the end of an upstream cycle and sends everything since the last,
+// after a snapshot for any node that joined out of the log's reach.
+void relay_end_cycle(long long now_ms) {
+    if (g_server.wake < 0) return;
+    if (__atomic_load_n(&g_snapshot_waiters, __ATOMIC_ACQUIRE) > 0) take_snapshot();
+    append('C', now_ms, NULL, NULL);
+    net_wake(&g_server);
+}
+
+static void watch(Node *n, uint32_t events) {
+    net_watch(&g_server, &n->conn, events);
+}
+
+static void close_node(Node *n) {
+    pthread_mutex_lock(&g_lock);
+    if (n->snapshot) release_snapshot(n->snapshot);
+    if (n->awaiting_snapshot) stop_waiting(n);
+    n->snapshot = NULL;
+    pthread_mutex_unlock(&g_lock);
+    net_close(&g_server, &n->conn);
+    g_nodes[n->slot] = g_nodes[--g_node_count];
+    g_nodes[n->slot]->slot = n->slot;
+    g_relay_stats.clients = g_node_count;
+}
+
+static void put_hello(Node *n) {
+    memcpy(n->out + n->out_used, "EVR1", 4);
+    memcpy(n->out + n->out_used + 4, &g_epoch, 8);
+    memcpy(n->out + n->out_used + 12, &n->next_seq, 8);
+    n->out_used += HELLO_BYTES;
+}
+
+// Copies as much of the node's snapshot, then as many logged frames, as
+// fit into its buffer. Returns the number of pieces copied, or -1 if the
+// node fell out of the log.
+static int fill(Node *n) {
+    int copied = 0;
+    pthread_mutex_lock(&g_lock);
+    if (n->awaiting_snapshot) {
+        if (!g_snapshot || g_snapshot->generation <= n->snapshot_after) {
+            pthread_mutex_unlock(&g_lock);
+            return 0;
+        }
+        n->snapshot = g_snapshot;
+        n->snapshot->refs++;
+        n->snapshot_sent = 0;
+        n->next_seq = g_snapshot->seq;
+        put_hello(n);
+        g_relay_stats.snapshots++;
+        stop_waiting(n);
+    }
+    if (n->snapshot) {
+        size_t left = n->snapshot->length - n->snapshot_sent, room = RELAY_SEND_BUFFER - n->out_used;
+        size_t take = left < room ? left : room;
+        memcpy(n->out + n->out_used, n->snapshot->bytes + n->snapshot_sent, take);
+        n->out_used += (int)take;
+        n->snapshot_sent += take;
+        copied++;
+        if (n->snapshot_sent < n->snapshot->length) {
+            pthread_mutex_unlock(&g_lock);
+            return copied;
+        }
+        release_snapshot(n->snapshot);
+        n->snapshot = NULL;
+    }
+    if (n->next_seq < g_log_head) copied = -1;
+    while (copied >= 0 && n->next_seq < g_log_tail) {
+        const uint8_t *frame = g_log[n->next_seq % RELAY_LOG_RECORDS];
+        uint16_t length;
+        memcpy(&length, frame, 2);
+        if (n->out_used + 2 + length > RELAY_SEND_BUFFER) break;
+        memcpy(n->out + n->out_used, frame, 2 + length);
+        n->out_used += 2 + length;
+        n->next_seq++;
+        copied++;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return copied;
+}
+
+static void pump(Node *n) {
+    for (;;) {
+        if (n->out_sent < n->out_used) {
+            ssize_t sent = send(n->conn.fd, n->out + n->out_sent, n->out_used - n->out_sent, MSG_NOSIGNAL);
+            if (sent < 0 && (errno == EAGAIN || errno == EINTR)) {
+                watch(n, EPOLLIN | EPOLLOUT);
+                return;
+            }
+            if (sent < 0) {
+                close_node(n);
+                return;
+            }
+            n->out_sent += sent;
+            g_relay_stats.bytes_sent += sent;
+            continue;
+        }
+        n->out_used = n->out_sent = 0;
+        if (n->hello_used < HELLO_BYTES) return;
+        int copied = fill(n);
+        if (copied < 0) { // It will reconnect and start over from a snapshot
+            close_node(n);
+            return;
+        }
+        if (copied == 0) {
+            watch(n, EPOLLIN);
+            return;
+        }
+    }
+}
+
+// Takes the node's hello and answers with where its deltas will start. A
+// node the log cannot bring up to date, because it is new, fell behind
+// or followed an earlier run of this relay, is answered once a snapshot
+// of the catalog is ready, at the end of the next cycle. While nothing
+// has fallen out of the log yet, the log from the start does as well.
+static void greet(Node *n) {
+    uint64_t epoch, want;
+    memcpy(&epoch, n->hello + 4, 8);
+    memcpy(&want, n->hello + 12, 8);
+    n->out_used = n->out_sent = 0;
+    pthread_mutex_lock(&g_lock);
+    if (epoch == g_epoch && want >= g_log_head && want <= g_log_tail) n->next_seq = want;
+    else if (g_log_head == 1) n->next_seq = 1;
+    else {
+        n->awaiting_snapshot = 1;
+        n->snapshot_after = g_snapshot_generation;
+        __atomic_add_fetch(&g_snapshot_waiters, 1, __ATOMIC_RELEASE);
+    }
+    if (!n->awaiting_snapshot) put_hello(n);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void read_node(Node *n) {
+    uint8_t scratch[256];
+    for (;;) {
+        ssize_t got = n->hello_used < HELLO_BYTES ? read(n->conn.fd, n->hello + n->hello_used, HELLO_BYTES - n->hello_used)
+                                                  : read(n->conn.fd, scratch, sizeof(scratch)); // Nothing more is expected
+        if (got > 0) {
+            if (n->hello_used >= HELLO_BYTES) continue;
+            n->hello_used += got;
+            if (n->hello_used < HELLO_BYTES) continue;
+            if (memcmp(n->hello, "EVR1", 4) != 0) {
+                close_node(n);
+                return;
+            }
+            greet(n);
+            continue;
+        }
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && errno == EAGAIN) break;
+        close_node(n); // Closed by the node, or an error
+        return;
+    }
+    pump(n);
+}
+
+static NetConn *accept_node() {
+    Node *n = g_node_count < RELAY_MAX_CLIENTS ? calloc(1, sizeof(Node)) : NULL;
+    if (!n) return NULL;
+    n->slot = g_node_count;
+    g_nodes[g_node_count++] = n;
+    g_relay_stats.clients = g_node_count;
+    return &n->conn;
+}
+
+static void node_event(NetConn *conn, uint32_t events) {
+    Node *n = (Node *)conn;
+    if (events & (EPOLLERR | EPOLLHUP)) close_node(n);
+    else if (events & EPOLLIN) read_node(n);
+    else pump(n);
+}
+
+// Sends new deltas to every node after each cycle; a node whose socket is
+// full gets the rest as it drains.
+static void send_cycle() {
+    for (int k = g_node_count - 1; k >= 0; k--) { // Closing moves the last node into k
+        if (g_nodes[k]->out_sent == g_nodes[k]->out_used) pump(g_nodes[k]);
+    }
+}
+
+static const NetHandlers g_handlers = { accept_node, node_event, send_cycle };
+
+// Listens on the given TCP port (0 for any) and returns the port taken,
+// or -1.
+int relay_serve(int port) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    g_epoch = (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    int served = net_serve(&g_server, port, 64, &g_handlers);
+    if (served < 0) fprintf(stderr, "Could not serve the event relay on TCP port %d\n", port);
+    return served;
+}
+
+// --- Joining ---
+
+// Asks to resume after the last delta taken. Returns 0 once the relay
+// said where it starts.
+static int handshake(int fd) {
+    uint8_t hello[HELLO_BYTES];
+    memcpy(hello, "EVR1", 4);
+    memcpy(hello + 4, &g_joined_epoch, 8);
+    memcpy(hello + 12, &g_next_seq, 8);
+    if (send(fd, hello, HELLO_BYTES, MSG_NOSIGNAL) != HELLO_BYTES) return -1;
+    int used = 0;
+    while (used < HELLO_BYTES) {
+        ssize_t got = recv(fd, hello + used, HELLO_BYTES - used, 0);
+        if (got <= 0) return -1;
+        used += got;
+    }
+    uint64_t epoch, first;
+    memcpy(&epoch, hello + 4, 8);
+    memcpy(&first, hello + 12, 8);
+    if (memcmp(hello, "EVR1", 4) != 0) return -1;
+    int resumed = epoch == g_joined_epoch && first == g_next_seq;
+    if (g_next_seq && !resumed) g_relay_stats.resyncs++;
+    g_joined_epoch = epoch;
+    g_next_seq = resumed ? first : 0; // Until a logged delta is in: a snapshot cut short is no place to resume
+    return 0;
+}
+
+// Waits for room rather than dropping: a full ring stalls the socket, and
+// the relay holds the rest.
+static void push_delta(const RelayDelta *delta) {
+    uint64_t head = g_ring_head;
+    while (head - __atomic_load_n(&g_ring_tail, __ATOMIC_ACQUIRE) == RELAY_RING_SIZE) usleep(1000);
+    g_ring[head & (RELAY_RING_SIZE - 1)] = *delta;
+    __atomic_store_n(&g_ring_head, head + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&g_relay_stats.received, 1, __ATOMIC_RELAXED);
+}
+
+// Queues every complete frame in buffer and returns the bytes consumed,
+// or -1 on a malformed frame.
+static int consume_frames(const uint8_t *buffer, int length) {
+    int at = 0;
+    while (length - at >= 2) {
+        uint16_t frame;
+        memcpy(&frame, buffer + at, 2);
+        if (frame > FRAME_MAX - 2) return -1;
+        if (length - at < 2 + frame) break;
+        RelayDelta delta;
+        if (decode(buffer + at + 2, frame, &delta) != 0) return -1;
+        at += 2 + frame;
+        push_delta(&delta);
+        if (delta.seq) g_next_seq = delta.seq + 1; // Snapshot rows carry 0
+        if (g_drop_at && delta.seq == g_drop_at) {
+            g_drop_at = 0;
+            return -1;
+        }
+    }
+    return at;
+}
+
+// Follows the relay for the life of the process. After a drop it
+// reconnects at once and resumes; failing to connect waits a little.
+static void *reader_main(void *arg) {
+    static uint8_t buffer[READ_BUFFER];
+    for (;;) {
+        int fd = net_connect(g_host, g_port), established = 0;
+        if (fd >= 0 && handshake(fd) == 0) {
+            established = 1;
+            __atomic_store_n(&g_relay_stats.connected, 1, __ATOMIC_RELAXED);
+            int used = 0;
+            ssize_t n;
+            while ((n = recv(fd, buffer + used, READ_BUFFER - used, 0)) > 0) {
+                int consumed = consume_frames(buffer, used + (int)n);
+                if (consumed < 0) break;
+                used += (int)n - consumed;
+                memmove(buffer, buffer + consumed, used);
+            }
+            __atomic_store_n(&g_relay_stats.connected, 0, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&g_relay_stats.reconnects, 1, __ATOMIC_RELAXED);
+        }
+        if (fd >= 0) close(fd);
+        if (!established) sleep(RELAY_RECONNECT_SECONDS);
+    }
+    return NULL;
+}
+
+// Starts following a relay at "host:port" in the background.
+int relay_join(const char *address) {
+    if (net_split_address(address, g_host, sizeof(g_host), g_port, sizeof(g_port)) != 0) {
+        fprintf(stderr, "Relay must be host:port, got %s\n", address);
+        return -1;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, reader_main, NULL) != 0) return -1;
+    pthread_detach(thread);
+    return 0;
+}
+
+// Hands every event received since the last call to apply, in order.
+// Returns the number of upstream cycles that ended among them.
+int relay_apply(void (*apply)(const RelayDelta *delta)) {
+    uint64_t tail = g_ring_tail, cycles = 0;
+    uint64_t head = __atomic_load_n(&g_ring_head, __ATOMIC_ACQUIRE);
+    for (uint64_t i = tail; i < head; i++) {
+        const RelayDelta *delta = &g_ring[i & (RELAY_RING_SIZE - 1)];
+        if (delta->cycle_end) cycles++;
+        else apply(delta);
+    }
+    __atomic_store_n(&g_ring_tail, head, __ATOMIC_RELEASE);
+    return (int)cycles;
+}
+
+// --- Benchmark ---
+
+// What each node process reports, in memory shared with the relay
+typedef struct {
+    uint64_t applied_seq; // Last event applied
+    uint64_t events;      // Rows in its catalog
+    uint64_t reconnects;
+    uint64_t resyncs;
+    uint64_t snapshot_rows; // Taken from a snapshot rather than the log
+    double done_us;       // Monotonic clock when the last cycle was in; 0 if it never was
+} BenchNode;
+
+static uint64_t g_bench_last, g_bench_snapshot_rows;
+
+static double now_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static void apply_bench_delta(const RelayDelta *delta) {
+    uint64_t seq;
+    catalog_upsert(&delta->event, &seq, NULL);
+    if (delta->seq) g_bench_last = delta->seq;
+    else g_bench_snapshot_rows++;
+}
+
+// One downstream monitor: follows the relay into its own catalog until
+// every event and the cycle after it are in. Node 0 hangs up half way and
+// resumes.
+static int run_node(int port, int node, int events, int expected_cycles, BenchNode *report) {
+    char address[32];
+    close(g_server.listener.fd); // The relay's descriptors came along with the fork
+    close(g_server.epoll);
+    close(g_server.wake);
+    for (int k = 0; k < g_node_count; k++) close(g_nodes[k]->conn.fd);
+    g_server.wake = -1;
+    if (catalog_init(events) != 0) return 1;
+    if (node == 0) g_drop_at = (uint64_t)(events + expected_cycles) / 2;
+    snprintf(address, sizeof(address), "127.0.0.1:%d", port);
+    if (relay_join(address) != 0) return 1;
+    double deadline = now_us() + RELAY_BENCH_TIMEOUT_SECONDS * 1e6;
+    while (now_us() < deadline) {
+        int cycles = relay_apply(apply_bench_delta);
+        __atomic_store_n(&report->applied_seq, g_bench_last, __ATOMIC_RELEASE);
+        if (cycles > 0 && catalog_size() == (uint64_t)events) {
+            report->done_us = now_us();
+            break;
+        }
+        usleep(100);
+    }
+    report->events = catalog_size();
+    report->reconnects = g_relay_stats.reconnects;
+    report->resyncs = g_relay_stats.resyncs;
+    report->snapshot_rows = g_bench_snapshot_rows;
+    return report->done_us > 0 ? 0 : 1;
+}
+
+// Publishes synthetic events in cycles to several node processes on this
+// machine, holding back while the slowest node is half the log behind,
+// and checks every node ends up with every event. The relay keeps its own
+// catalog, as a monitor does, for the node that joins once the log has
+// wrapped and so needs a snapshot.
+int relay_benchmark(int events) {
+    int cycles = (events + RELAY_BENCH_CYCLE - 1) / RELAY_BENCH_CYCLE;
+    BenchNode *nodes = mmap(NULL, sizeof(BenchNode) * RELAY_BENCH_NODES, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (nodes == MAP_FAILED) return 1;
+    memset(nodes, 0, sizeof(BenchNode) * RELAY_BENCH_NODES);
+    if (catalog_init(events) != 0) return 1;
+    int port = relay_serve(0);
+    if (port < 0) return 1;
+    fflush(stdout);
+    pid_t pids[RELAY_BENCH_NODES] = { 0 };
+    for (int n = 0; n < RELAY_BENCH_LATE_NODE; n++) {
+        pids[n] = fork();
+        if (pids[n] == 0) _exit(run_node(port, n, events, cycles, &nodes[n]));
+    }
+    for (int wait = 0; wait < 500 && g_relay_stats.clients < RELAY_BENCH_LATE_NODE; wait++) usleep(10000);
+
+    printf("Relay benchmark: %d events in cycles of %d to %d node processes (node 0 hangs up half way, node %d joins "
+           "once the log has wrapped)\n\n", events, RELAY_BENCH_CYCLE, RELAY_BENCH_NODES, RELAY_BENCH_LATE_NODE);
+    uint64_t state = 12345;
+    long long now_ms = (long long)time(NULL) * 1000;
+    double start = now_us(), publishing = 0;
+    for (int i = 0; i < events; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        CatalogEvent event = { .time_ms = now_ms - (long long)(state >> 24) % 86400000LL, .depth = 10.0f };
+        event.lat = (float)((state >> 20 & 0xFFFF) / 65535.0 * 180.0 - 90.0);
+        event.lon = (float)((state >> 4 & 0xFFFF) / 65535.0 * 360.0 - 180.0);
+        event.mag = (float)((state >> 36 & 0xFF) / 40.0);
+        snprintf(event.id, sizeof(event.id), "bench%d", i);
+        uint64_t seq;
+        catalog_upsert(&event, &seq, NULL);
+        places_on_insert(seq, "12 km SSW of Somewhere, Some Region");
+        double before = now_us();
+        relay_publish(&event, "12 km SSW of Somewhere, Some Region");
+        publishing += now_us() - before;
+        if ((i + 1) % RELAY_BENCH_CYCLE == 0 || i == events - 1) {
+            relay_end_cycle(now_ms);
+            if (!pids[RELAY_BENCH_LATE_NODE] && (g_log_head > 1 || i == events - 1)) { // At the end if it never wraps
+                pids[RELAY_BENCH_LATE_NODE] = fork();
+                if (pids[RELAY_BENCH_LATE_NODE] == 0) {
+                    _exit(run_node(port, RELAY_BENCH_LATE_NODE, events, cycles, &nodes[RELAY_BENCH_LATE_NODE]));
+                }
+                for (int wait = 0; wait < 500 && g_log_head > 1 && !__atomic_load_n(&g_snapshot_waiters, __ATOMIC_ACQUIRE); wait++) {
+                    usleep(10000); // Until it asks, so a snapshot is taken at the next cycle
+                }
+                if (i == events - 1 && g_log_head > 1) relay_end_cycle(now_ms); // There is no next cycle
+            }
+            for (;;) { // Flow control for the benchmark only: real cycles are minutes apart
+                uint64_t slowest = UINT64_MAX;
+                for (int n = 0; n < RELAY_BENCH_NODES; n++) {
+                    uint64_t applied = __atomic_load_n(&nodes[n].applied_seq, __ATOMIC_ACQUIRE);
+                    if (applied && applied < slowest) slowest = applied; // 0 until a node has joined
+                }
+                if (slowest == UINT64_MAX || g_log_tail - slowest < RELAY_LOG_RECORDS / 2) break;
+                usleep(100);
+            }
+        }
+    }
+
+    int failed = 0;
+    for (int n = 0; n < RELAY_BENCH_NODES; n++) {
+        int status = 0;
+        waitpid(pids[n], &status, 0);
+        int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && nodes[n].events == (uint64_t)events;
+        printf("Node %d: %llu events (%llu from a snapshot), %llu reconnects, %llu resyncs, all in after %.1f ms%s\n", n,
+               (unsigned long long)nodes[n].events, (unsigned long long)nodes[n].snapshot_rows,
+               (unsigned long long)nodes[n].reconnects, (unsigned long long)nodes[n].resyncs,
+               (nodes[n].done_us - start) / 1e3, ok ? "" : " (INCOMPLETE)");
+        failed |= !ok;
+    }
+    double total_us = 0;
+    for (int n = 0; n < RELAY_BENCH_NODES; n++) {
+        if (nodes[n].done_us - start > total_us) total_us = nodes[n].done_us - start;
+    }
+    printf("\nPublishing: %.2f us per event\n", publishing / events);
+    printf("Fan-out: %.0f events per second to every node, %.1f bytes per event on the wire\n", events / (total_us / 1e6),
+           (double)g_relay_stats.bytes_sent / RELAY_BENCH_NODES / events);
+    munmap(nodes, sizeof(BenchNode) * RELAY_BENCH_NODES);
+    return failed;
+}
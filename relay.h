@@ -0,0 +1,71 @@
+/*
+ * relay.h - Event delta relay between monitors
+ *
+ * One monitor polls upstream and serves every catalog change it makes to
+ * other monitors over TCP, as compact binary deltas: an event in about 80
+ * bytes, against a kilobyte or so of GeoJSON. Downstream monitors apply
+ * them straight into their history, with no HTTP or JSON, and rebuild
+ * their live list whenever a whole upstream cycle is in.
+ *
+ * Every delta carries a sequence number from the relay's log, which keeps
+ * the last RELAY_LOG_RECORDS of them. A reconnecting node asks to resume
+ * after the last one it applied. A new node, one that fell out of the
+ * window, or one whose relay restarted first gets a snapshot: every row
+ * of the relay's catalog, taken at the end of its next cycle, followed by
+ * the log from there. Deltas are upserts, so replaying one is harmless.
+ * A downstream node may serve in turn.
+ *
+ * Wire format, little-endian. Each side opens with 20 bytes: "EVR1", the
+ * relay's epoch (u64, its start time in ms) and a sequence number (u64):
+ * the next one wanted from the node, the first one coming from the relay.
+ * Then frames from the relay only: u16 length of what follows, u8 type,
+ * u64 seq, and for type 'E' (event) i64 time ms, f32 lat, lon, depth and
+ * mag, u16 region, u8 id length, id, u8 place length, place; for type 'C'
+ * (end of an upstream cycle) i64 time ms. Snapshot rows are 'E' frames
+ * with seq 0, ahead of the logged frames; the relay's hello then names
+ * the first logged frame after them.
+ */
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stdint.h>
+#include "catalog.h"
+
+#define RELAY_LOG_RECORDS 16384   // Deltas a reconnecting node can catch up on
+#define RELAY_MAX_CLIENTS 256
+#define RELAY_PLACE_MAX 128       // Longer places are cut short on the wire
+#define RELAY_SEND_BUFFER 65536   // Per node; a node this far behind waits for its socket
+#define RELAY_RING_SIZE 16384     // Deltas received but not yet applied; power of two
+#define RELAY_RECONNECT_SECONDS 2
+
+typedef struct {
+    uint64_t seq;
+    int cycle_end; // No event: the relay finished an upstream cycle
+    CatalogEvent event;
+    char place[RELAY_PLACE_MAX];
+} RelayDelta;
+
+typedef struct {
+    // Serving
+    int clients;
+    uint64_t published;
+    uint64_t bytes_sent;
+    uint64_t snapshots; // Nodes sent the whole catalog because the log no longer reached them
+    // Joined
+    int connected;
+    uint64_t received;
+    uint64_t reconnects;
+    uint64_t resyncs;  // Resumes the relay could not honour: a snapshot, or the log from its start, came instead
+} RelayStats;
+
+extern RelayStats g_relay_stats;
+
+int relay_serve(int port);
+void relay_publish(const CatalogEvent *event, const char *place);
+void relay_end_cycle(long long now_ms);
+int relay_join(const char *address);
+int relay_apply(void (*apply)(const RelayDelta *delta));
+int relay_benchmark(int events);
+
+#endif // RELAY_H
@@ -0,0 +1,215 @@
+/*
+ * rollup.c - Pre-aggregated event counts by time bucket, magnitude and region
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rollup.h"
+#include "timing.h"
+#include "region.h"
+
+#define ROLLUP_OTHER_SLOT (ROLLUP_REGION_SLOTS - 1)
+#define SLOT_COUNTERS (ROLLUP_REGION_SLOTS * ROLLUP_MAG_BINS)
+#define MAX_RING_BUCKETS 1440
+
+typedef struct {
+    int buckets;        // Ring length
+    long long bucket_ms;
+    int64_t *epoch;     // Bucket number each ring entry holds, -1 if none
+    uint32_t *counts;   // [ring entry][region slot][magnitude bin]
+} RollupRing;
+
+// --- Globals ---
+static RollupRing g_rings[ROLLUP_RESOLUTIONS] = {
+    { MAX_RING_BUCKETS, 60000LL, NULL, NULL }, // One day of minutes
+    { 744, 3600000LL, NULL, NULL },    // 31 days of hours
+    { 64, 86400000LL, NULL, NULL },     // 64 days
+};
+static int16_t g_region_slot[MAX_REGION_CODE + 1]; // 0 until assigned
+static int g_region_slots_used = 1; // Slot 0 counts all regions
+
+// --- Buckets ---
+
+static int init_rings() {
+    if (g_rings[0].counts) return 0;
+    for (int r = 0; r < ROLLUP_RESOLUTIONS; r++) {
+        RollupRing *ring = &g_rings[r];
+        ring->epoch = malloc(ring->buckets * sizeof(int64_t));
+        ring->counts = calloc((size_t)ring->buckets * SLOT_COUNTERS, sizeof(uint32_t));
+        if (!ring->epoch || !ring->counts) {
+            fprintf(stderr, "Not enough memory for event rollups\n");
+            return -1;
+        }
+        for (int b = 0; b < ring->buckets; b++) ring->epoch[b] = -1;
+    }
+    return 0;
+}
+
+static int mag_bin(float mag) {
+    int bin = (int)mag;
+    if (bin < 0) return 0;
+    return bin < ROLLUP_MAG_BINS ? bin : ROLLUP_MAG_BINS - 1;
+}
+
+// Column for a region; new regions get one only when counting up.
+static int region_slot(int region, int assign) {
+    if (region < 0 || region > MAX_REGION_CODE) return ROLLUP_OTHER_SLOT;
+    if (g_region_slot[region] == 0 && assign) {
+        g_region_slot[region] = g_region_slots_used < ROLLUP_OTHER_SLOT ? g_region_slots_used++ : ROLLUP_OTHER_SLOT;
+    }
+    return g_region_slot[region];
+}
+
+static int64_t bucket_of(long long time_ms, long long bucket_ms) {
+    return time_ms >= 0 ? time_ms / bucket_ms : -((-time_ms + bucket_ms - 1) / bucket_ms);
+}
+
+static int ring_index(const RollupRing *ring, int64_t bucket) {
+    int64_t index = bucket % ring->buckets;
+    return (int)(index < 0 ? index + ring->buckets : index);
+}
+
+static void count_event(long long time_ms, float mag, int region, int delta) {
+    if (init_rings() != 0) return;
+    int bin = mag_bin(mag);
+    int slot = region_slot(region, delta > 0);
+
+    for (int r = 0; r < ROLLUP_RESOLUTIONS; r++) {
+        RollupRing *ring = &g_rings[r];
+        int64_t bucket = bucket_of(time_ms, ring->bucket_ms);
+        int index = ring_index(ring, bucket);
+        uint32_t *counts = ring->counts + (size_t)index * SLOT_COUNTERS;
+        if (ring->epoch[index] != bucket) {
+            // Older than the ring reaches, or (when removing) never counted
+            if (delta < 0 || ring->epoch[index] > bucket) continue;
+            memset(counts, 0, SLOT_COUNTERS * sizeof(uint32_t));
+            ring->epoch[index] = bucket;
+        }
+        counts[bin] += delta;
+        if (slot > 0) counts[slot * ROLLUP_MAG_BINS + bin] += delta;
+    }
+}
+
+// --- Catalog Hooks ---
+
+void rollup_on_insert(uint64_t seq) {
+    uint64_t slot = catalog_slot(seq);
+    count_event(g_catalog.time_ms[slot], g_catalog.mag[slot], g_catalog.region[slot], 1);
+}
+
+void rollup_on_revision(uint64_t seq, const CatalogEvent *previous) {
+    count_event(previous->time_ms, previous->mag, previous->region, -1);
+    rollup_on_insert(seq);
+}
+
+// Call before the row leaves the catalog.
+void rollup_on_retire(uint64_t seq) {
+    uint64_t slot = catalog_slot(seq);
+    count_event(g_catalog.time_ms[slot], g_catalog.mag[slot], g_catalog.region[slot], -1);
+}
+
+// --- Queries ---
+
+// Fills counts[buckets][ROLLUP_MAG_BINS] for consecutive buckets starting at
+// the one holding from_ms. Buckets the ring no longer covers read as zero.
+// Returns -1 if the region's events are pooled in the "other" column.
+int rollup_histogram(RollupResolution resolution, long long from_ms, int buckets, int region, uint32_t *counts) {
+    const RollupRing *ring = &g_rings[resolution];
+    memset(counts, 0, (size_t)buckets * ROLLUP_MAG_BINS * sizeof(uint32_t));
+    int slot = 0;
+    if (region != ROLLUP_ALL_REGIONS) {
+        slot = region_slot(region, 0);
+        if (slot == ROLLUP_OTHER_SLOT) return -1;
+        if (slot == 0) return g_region_slots_used < ROLLUP_OTHER_SLOT ? buckets : -1; // No events yet
+    }
+    if (!ring->counts) return buckets;
+
+    int64_t first = bucket_of(from_ms, ring->bucket_ms);
+    for (int k = 0; k < buckets; k++) {
+        int index = ring_index(ring, first + k);
+        if (ring->epoch[index] != first + k) continue;
+        memcpy(counts + (size_t)k * ROLLUP_MAG_BINS, ring->counts + (size_t)index * SLOT_COUNTERS + slot * ROLLUP_MAG_BINS,
+               ROLLUP_MAG_BINS * sizeof(uint32_t));
+    }
+    return buckets;
+}
+
+// Events in [from_ms, to_ms) at bucket granularity, from min_mag's bin up.
+uint32_t rollup_count(RollupResolution resolution, long long from_ms, long long to_ms, int region, float min_mag) {
+    int64_t first = bucket_of(from_ms, g_rings[resolution].bucket_ms);
+    int64_t last = bucket_of(to_ms - 1, g_rings[resolution].bucket_ms);
+    int buckets = (int)(last - first + 1);
+    if (buckets <= 0) return 0;
+    if (buckets > g_rings[resolution].buckets) buckets = g_rings[resolution].buckets;
+    static uint32_t counts[MAX_RING_BUCKETS * ROLLUP_MAG_BINS];
+    if (rollup_histogram(resolution, from_ms, buckets, region, counts) < 0) return 0;
+
+    uint32_t total = 0;
+    for (int k = 0; k < buckets; k++) {
+        for (int bin = mag_bin(min_mag); bin < ROLLUP_MAG_BINS; bin++) total += counts[k * ROLLUP_MAG_BINS + bin];
+    }
+    return total;
+}
+
+// --- Benchmark ---
+
+// Spreads a synthetic history over the retention window and times rollup
+// upkeep and queries against a scan of the raw rows.
+int rollup_benchmark(int events) {
+    if (catalog_init(events) != 0) return 1;
+    uint64_t state = 12345;
+    long long now_ms = (long long)time(NULL) * 1000;
+    long long span_ms = CATALOG_RETENTION_DAYS * 86400000LL;
+    struct timespec start;
+
+    for (int i = 0; i < events; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        CatalogEvent event = { .time_ms = now_ms - span_ms + (long long)((double)i / events * span_ms) };
+        event.mag = (float)((state >> 40) % 700) / 100.0f;
+        event.region = (int)((state >> 20) % 50) + 1;
+        snprintf(event.id, sizeof(event.id), "bench%d", i);
+        catalog_upsert(&event, NULL, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t seq = g_catalog.head; seq < g_catalog.tail; seq++) rollup_on_insert(seq);
+    printf("Rollup benchmark: %d events over %d days\n\n", events, CATALOG_RETENTION_DAYS);
+    printf("Insert:                     %8.1f ns/event\n", elapsed_us(&start) * 1e3 / events);
+
+    static uint32_t counts[MAX_RING_BUCKETS * ROLLUP_MAG_BINS];
+    long long from_ms = now_ms - 720 * 3600000LL;
+    const int repeats = 1000;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) rollup_histogram(ROLLUP_HOUR, from_ms, 720, ROLLUP_ALL_REGIONS, counts);
+    printf("Hourly histogram, 30 days:  %8.1f us\n", elapsed_us(&start) / repeats);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) rollup_histogram(ROLLUP_HOUR, from_ms, 720, 7, counts);
+    printf("Same, one region:           %8.1f us\n", elapsed_us(&start) / repeats);
+
+    uint32_t rolled = 0, scanned = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeats; r++) rolled = rollup_count(ROLLUP_MINUTE, now_ms - 86400000LL + 60000, now_ms + 1, ROLLUP_ALL_REGIONS, 4.0f);
+    printf("M4+ in the last day:        %8.1f us (%u events)\n", elapsed_us(&start) / repeats, rolled);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int64_t first = bucket_of(now_ms - 86400000LL + 60000, 60000LL) * 60000LL;
+    for (uint64_t seq = g_catalog.head; seq < g_catalog.tail; seq++) {
+        uint64_t slot = catalog_slot(seq);
+        if (g_catalog.time_ms[slot] >= first && g_catalog.mag[slot] >= 4.0f) scanned++;
+    }
+    printf("Same, scanning every row:   %8.1f us (%u events)\n", elapsed_us(&start), scanned);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t seq = g_catalog.head; seq < g_catalog.tail; seq++) {
+        CatalogEvent event, previous;
+        catalog_get(seq, &event);
+        event.mag += 0.5f;
+        catalog_upsert(&event, NULL, &previous);
+        rollup_on_revision(seq, &previous);
+    }
+    printf("Magnitude revision:         %8.1f ns/event\n", elapsed_us(&start) * 1e3 / events);
+    return rolled == scanned ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+/*
+ * rollup.h - Pre-aggregated event counts by time bucket, magnitude and region
+ *
+ * Keeps materialized counts of history events per minute (last day), hour
+ * (last month) and day, each split by whole-magnitude bin and by region.
+ * Counts move with the catalog: inserts add, retirements subtract, and a
+ * revision moves an event between buckets and bins. A histogram query reads
+ * buckets x bins counters, whatever the size of the history.
+ *
+ * Regions get a counter column on first use; once ROLLUP_REGION_SLOTS are
+ * taken, further regions share a final "other" column.
+ */
+
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdint.h>
+#include "catalog.h"
+
+#define ROLLUP_MAG_BINS 10       // M<1, M1-2, ..., M9+
+#define ROLLUP_REGION_SLOTS 128  // Including the all-regions and "other" columns
+#define ROLLUP_ALL_REGIONS -1
+
+typedef enum {
+    ROLLUP_MINUTE,
+    ROLLUP_HOUR,
+    ROLLUP_DAY,
+    ROLLUP_RESOLUTIONS
+} RollupResolution;
+
+void rollup_on_insert(uint64_t seq);
+void rollup_on_revision(uint64_t seq, const CatalogEvent *previous);
+void rollup_on_retire(uint64_t seq);
+
+int rollup_histogram(RollupResolution resolution, long long from_ms, int buckets, int region, uint32_t *counts);
+uint32_t rollup_count(RollupResolution resolution, long long from_ms, long long to_ms, int region, float min_mag);
+int rollup_benchmark(int events);
+
+#endif // ROLLUP_H
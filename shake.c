@@ -0,0 +1,367 @@
+/*
+ * shake.c - Local seismometer ingest
+ */
+
+#define _GNU_SOURCE // recvmmsg
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "shake.h"
+#include "timing.h"
+
+#define SHAKE_BATCH 32          // Datagrams per recvmmsg call
+#define SHAKE_PACKET_MAX 2048   // A Shake packet is a few hundred bytes
+#define SHAKE_STALE_SECONDS 5   // A channel silent this long stops holding the others back
+#define SHAKE_BANDPASS_LOW_HZ 1.0f
+#define SHAKE_BANDPASS_HIGH_HZ 10.0f
+#define SAMPLE_MASK (SHAKE_RING_SAMPLES - 1)
+#define LANES SHAKE_MAX_CHANNELS
+#define NEVER UINT64_MAX
+
+// Second-order section, transposed direct form II
+typedef struct {
+    float b0, b1, b2, a1, a2;
+} Biquad;
+
+typedef struct {
+    char name[8];
+    uint64_t written;    // Samples stored, counted on the shared timeline
+    uint64_t armed_from; // First sample allowed to trigger, once the filters have settled
+    uint64_t base_index; // Timeline position of the last packet's first sample
+    double base_time;    // and its Unix time
+    long long heard;     // Monotonic second of the last packet
+    float last;          // Held while the channel is silent
+    int triggered;
+} ShakeChannel;
+
+// Filter and detector state, one lane per channel
+typedef struct {
+    float hp1[LANES], hp2[LANES];
+    float lp1[LANES], lp2[LANES];
+    float sta[LANES], lta[LANES];
+    float ratio[LANES];
+} Detector;
+
+// --- Globals ---
+// Samples for every channel at one timeline position sit together, so the
+// detector loads a whole row per step.
+static float g_ring[SHAKE_RING_SAMPLES][LANES];
+static ShakeChannel g_channels[LANES];
+static int g_channel_count = 0;
+static uint64_t g_processed = 0; // Timeline position the detector has reached
+static Detector g_detector;
+static Biquad g_highpass, g_lowpass;
+static uint64_t g_packets = 0, g_dropped = 0, g_trigger_count = 0;
+static ShakeTrigger g_recent[SHAKE_RECENT_TRIGGERS];
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// --- Filters ---
+
+// RBJ cookbook Butterworth section at the Shake sample rate.
+static Biquad design_biquad(int highpass, float corner_hz) {
+    double w0 = 2.0 * M_PI * corner_hz / SHAKE_SAMPLE_RATE;
+    double alpha = sin(w0) / (2.0 * M_SQRT1_2), c = cos(w0), a0 = 1.0 + alpha;
+    double b1 = highpass ? -(1.0 + c) : 1.0 - c;
+    Biquad q = {
+        .b0 = (float)(fabs(b1) / 2.0 / a0),
+        .b1 = (float)(b1 / a0),
+        .b2 = (float)(fabs(b1) / 2.0 / a0),
+        .a1 = (float)(-2.0 * c / a0),
+        .a2 = (float)((1.0 - alpha) / a0),
+    };
+    return q;
+}
+
+// Clears a lane's detector, starting the highpass as if the input had
+// been level at the first sample. The counts sit on a large DC offset, and
+// the step from zero would otherwise swamp the LTA for minutes.
+static void reset_lane(int lane, float first) {
+    g_detector.hp1[lane] = -g_highpass.b0 * first;
+    g_detector.hp2[lane] = g_highpass.b2 * first;
+    g_detector.lp1[lane] = g_detector.lp2[lane] = 0.0f;
+    g_detector.sta[lane] = g_detector.lta[lane] = g_detector.ratio[lane] = 0.0f;
+    g_channels[lane].triggered = 0;
+}
+
+static void record_trigger(int lane, uint64_t t, float ratio, float sta) {
+    ShakeChannel *channel = &g_channels[lane];
+    ShakeTrigger *trigger = &g_recent[g_trigger_count++ % SHAKE_RECENT_TRIGGERS];
+    memcpy(trigger->channel, channel->name, sizeof(trigger->channel));
+    trigger->time = channel->base_time + ((double)t - (double)channel->base_index) / SHAKE_SAMPLE_RATE;
+    trigger->ratio = ratio;
+    trigger->rms = sqrtf(sta);
+}
+
+// Bandpasses timeline positions [from, to) for every lane and updates the
+// STA/LTA ratios. The per-sample work runs across lanes so it vectorizes;
+// lanes only drop to scalar code on the rare steps where one crosses a
+// trigger threshold.
+static void detect(uint64_t from, uint64_t to) {
+    const Biquad hp = g_highpass, lp = g_lowpass;
+    const float sta_c = 1.0f / (SHAKE_STA_SECONDS * SHAKE_SAMPLE_RATE);
+    const float lta_c = 1.0f / (SHAKE_LTA_SECONDS * SHAKE_SAMPLE_RATE);
+    float hp1[LANES], hp2[LANES], lp1[LANES], lp2[LANES], sta[LANES], lta[LANES], ratio[LANES];
+    int triggered[LANES], flip[LANES];
+    memcpy(hp1, g_detector.hp1, sizeof(hp1));
+    memcpy(hp2, g_detector.hp2, sizeof(hp2));
+    memcpy(lp1, g_detector.lp1, sizeof(lp1));
+    memcpy(lp2, g_detector.lp2, sizeof(lp2));
+    memcpy(sta, g_detector.sta, sizeof(sta));
+    memcpy(lta, g_detector.lta, sizeof(lta));
+    memcpy(ratio, g_detector.ratio, sizeof(ratio));
+    for (int k = 0; k < LANES; k++) triggered[k] = g_channels[k].triggered;
+
+    for (uint64_t t = from; t < to; t++) {
+        const float *x = g_ring[t & SAMPLE_MASK];
+        int any = 0;
+        for (int k = 0; k < LANES; k++) {
+            float h = hp.b0 * x[k] + hp1[k];
+            hp1[k] = hp.b1 * x[k] - hp.a1 * h + hp2[k];
+            hp2[k] = hp.b2 * x[k] - hp.a2 * h;
+            float y = lp.b0 * h + lp1[k];
+            lp1[k] = lp.b1 * h - lp.a1 * y + lp2[k];
+            lp2[k] = lp.b2 * h - lp.a2 * y;
+            float energy = y * y;
+            sta[k] += sta_c * (energy - sta[k]);
+            lta[k] += lta_c * (energy - lta[k]);
+            ratio[k] = sta[k] / (lta[k] + 1e-6f);
+            // Bitwise rather than a branch, so the lanes stay in one vector
+            flip[k] = ((ratio[k] > SHAKE_TRIGGER_ON) & (triggered[k] ^ 1)) | ((ratio[k] < SHAKE_TRIGGER_OFF) & triggered[k]);
+            any |= flip[k];
+        }
+        if (!any) continue;
+        for (int k = 0; k < LANES; k++) {
+            if (!flip[k] || t < g_channels[k].armed_from) continue;
+            triggered[k] = !triggered[k];
+            if (triggered[k]) record_trigger(k, t, ratio[k], sta[k]);
+        }
+    }
+
+    memcpy(g_detector.hp1, hp1, sizeof(hp1));
+    memcpy(g_detector.hp2, hp2, sizeof(hp2));
+    memcpy(g_detector.lp1, lp1, sizeof(lp1));
+    memcpy(g_detector.lp2, lp2, sizeof(lp2));
+    memcpy(g_detector.sta, sta, sizeof(sta));
+    memcpy(g_detector.lta, lta, sizeof(lta));
+    memcpy(g_detector.ratio, ratio, sizeof(ratio));
+    for (int k = 0; k < LANES; k++) g_channels[k].triggered = triggered[k];
+}
+
+// --- Ingest ---
+
+static int find_lane(const char *name, size_t length) {
+    if (length == 0 || length >= sizeof(g_channels[0].name)) return -1;
+    for (int c = 0; c < g_channel_count; c++) {
+        if (strncmp(g_channels[c].name, name, length) == 0 && g_channels[c].name[length] == '\0') return c;
+    }
+    if (g_channel_count == LANES) return -1;
+    ShakeChannel *channel = &g_channels[g_channel_count];
+    memset(channel, 0, sizeof(*channel));
+    memcpy(channel->name, name, length);
+    channel->heard = -SHAKE_STALE_SECONDS - 1;
+    return g_channel_count++;
+}
+
+// Appends one {'EHZ', 1554306963.170, 16802, 16773, ...} datagram to its
+// channel's ring.
+static int accept_packet(const char *packet, long long now) {
+    const char *open = strchr(packet, '\'');
+    const char *close = open ? strchr(open + 1, '\'') : NULL;
+    if (!close) return -1;
+    int lane = find_lane(open + 1, close - open - 1);
+    if (lane < 0) return -1;
+    const char *p = strchr(close, ',');
+    if (!p) return -1;
+    char *end;
+    double start = strtod(p + 1, &end);
+    if (end == p + 1) return -1;
+
+    ShakeChannel *channel = &g_channels[lane];
+    if (now - channel->heard > SHAKE_STALE_SECONDS) {
+        // New or back from silence: rejoin the timeline where it is now and
+        // let the filters settle again before this channel may trigger
+        if (channel->written < g_processed) channel->written = g_processed;
+        reset_lane(lane, *end == ',' ? strtof(end + 1, NULL) : 0.0f);
+        channel->armed_from = channel->written + (uint64_t)(SHAKE_LTA_SECONDS * SHAKE_SAMPLE_RATE);
+    }
+    channel->heard = now;
+    channel->base_index = channel->written;
+    channel->base_time = start;
+
+    p = end;
+    while (*p == ',') {
+        long count = strtol(p + 1, &end, 10);
+        if (end == p + 1) break;
+        if (channel->written - g_processed >= SHAKE_RING_SAMPLES) return -1; // Others too far behind
+        channel->last = (float)count;
+        g_ring[channel->written++ & SAMPLE_MASK][lane] = channel->last;
+        while (*end == ' ') end++;
+        p = end;
+    }
+    return 0;
+}
+
+// Runs the detector up to the slowest live channel. Silent channels hold
+// their last value so they neither stall the rest nor trigger on the step.
+static void process(long long now) {
+    uint64_t target = NEVER;
+    for (int c = 0; c < g_channel_count; c++) {
+        if (now - g_channels[c].heard <= SHAKE_STALE_SECONDS && g_channels[c].written < target) target = g_channels[c].written;
+    }
+    if (target == NEVER || target <= g_processed) return;
+    for (int c = g_channel_count; c < LANES; c++) g_channels[c].written = target; // Unused lanes run on zeros
+    for (int c = 0; c < g_channel_count; c++) {
+        ShakeChannel *channel = &g_channels[c];
+        if (channel->written >= target) continue;
+        channel->armed_from = NEVER;
+        while (channel->written < target) g_ring[channel->written++ & SAMPLE_MASK][c] = channel->last;
+    }
+    detect(g_processed, target);
+    g_processed = target;
+}
+
+static long long monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+// --- Receiver Thread ---
+
+static void *receiver_main(void *arg) {
+    static char buffers[SHAKE_BATCH][SHAKE_PACKET_MAX + 1];
+    struct mmsghdr messages[SHAKE_BATCH];
+    struct iovec vectors[SHAKE_BATCH];
+    int fd = (int)(intptr_t)arg;
+    memset(messages, 0, sizeof(messages));
+    for (int i = 0; i < SHAKE_BATCH; i++) {
+        vectors[i].iov_base = buffers[i];
+        vectors[i].iov_len = SHAKE_PACKET_MAX;
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (;;) {
+        // Blocks for the first datagram, then takes whatever else is queued
+        int n = recvmmsg(fd, messages, SHAKE_BATCH, MSG_WAITFORONE, NULL);
+        long long now = monotonic_seconds();
+        pthread_mutex_lock(&g_lock);
+        for (int i = 0; i < n; i++) {
+            buffers[i][messages[i].msg_len] = '\0';
+            if (accept_packet(buffers[i], now) == 0) g_packets++;
+            else g_dropped++;
+        }
+        process(now); // Also after a receive timeout, to release silent channels
+        pthread_mutex_unlock(&g_lock);
+    }
+    return NULL;
+}
+
+// Listens for Shake datagrams on the UDP port in the background.
+int shake_start(int port) {
+    g_highpass = design_biquad(1, SHAKE_BANDPASS_LOW_HZ);
+    g_lowpass = design_biquad(0, SHAKE_BANDPASS_HIGH_HZ);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    struct timeval timeout = { .tv_sec = 1 };
+    int buffer_bytes = 1 << 20;
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "Could not listen for the seismometer on UDP port %d\n", port);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_bytes, sizeof(buffer_bytes));
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, receiver_main, (void *)(intptr_t)fd) != 0) return -1;
+    pthread_detach(thread);
+    return 0;
+}
+
+// Copies out the channels and recent triggers for the main loop.
+void shake_status(ShakeStatus *status) {
+    long long now = monotonic_seconds();
+    pthread_mutex_lock(&g_lock);
+    status->channels = g_channel_count;
+    for (int c = 0; c < g_channel_count; c++) {
+        memcpy(status->name[c], g_channels[c].name, sizeof(status->name[c]));
+        status->ratio[c] = g_detector.ratio[c];
+        status->live[c] = now - g_channels[c].heard <= SHAKE_STALE_SECONDS;
+    }
+    status->packets = g_packets;
+    status->dropped = g_dropped;
+    status->triggers = g_trigger_count;
+    memcpy(status->recent, g_recent, sizeof(g_recent));
+    pthread_mutex_unlock(&g_lock);
+}
+
+// --- Benchmark ---
+
+// Synthesizes a four-channel Shake stream with a local event two thirds of
+// the way through and feeds it, as text datagrams in recvmmsg-sized
+// batches, through the same parse, ring and detector path as the socket.
+int shake_benchmark(int seconds) {
+    static const char *names[] = { "EHZ", "ENZ", "ENN", "ENE" };
+    const int channels = 4, per_packet = 25, packets = seconds * (int)SHAKE_SAMPLE_RATE / per_packet * channels;
+    const double epoch = 1700000000.0, onset = seconds * 2 / 3;
+    uint64_t state = 12345;
+    char *text = malloc((size_t)packets * 256);
+    int *offsets = malloc((packets + 1) * sizeof(int));
+    if (!text || !offsets) return 1;
+    g_highpass = design_biquad(1, SHAKE_BANDPASS_LOW_HZ);
+    g_lowpass = design_biquad(0, SHAKE_BANDPASS_HIGH_HZ);
+
+    int used = 0;
+    for (int p = 0; p < packets; p++) {
+        int c = p % channels;
+        long first = (long)(p / channels) * per_packet;
+        offsets[p] = used;
+        used += sprintf(text + used, "{'%s', %.3f", names[c], epoch + first / SHAKE_SAMPLE_RATE);
+        for (int i = 0; i < per_packet; i++) {
+            double t = (first + i) / SHAKE_SAMPLE_RATE - onset, value = 0.0;
+            for (int u = 0; u < 4; u++) {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                value += (double)(state >> 40) / (1 << 24) - 0.5; // Background noise
+            }
+            value *= 60.0;
+            if (t >= 0.0) value += 400.0 * exp(-t / 3.0) * sin(2.0 * M_PI * 5.0 * t + c); // P
+            if (t >= 4.0) value += 1500.0 * exp(-(t - 4.0) / 5.0) * sin(2.0 * M_PI * 3.0 * t + c); // S
+            used += sprintf(text + used, ", %ld", (c ? 0 : 16800) + lround(value));
+        }
+        used += sprintf(text + used, "}");
+        text[used++] = '\0';
+    }
+    offsets[packets] = used;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int p = 0; p < packets; p += SHAKE_BATCH) {
+        long long now = (long long)(p / channels) * per_packet / (long long)SHAKE_SAMPLE_RATE;
+        for (int i = p; i < p + SHAKE_BATCH && i < packets; i++) {
+            if (accept_packet(text + offsets[i], now) == 0) g_packets++;
+            else g_dropped++;
+        }
+        process(now);
+    }
+    double us = elapsed_us(&start);
+
+    double samples = (double)packets * per_packet;
+    printf("Seismometer ingest benchmark: %d s of %d channels at %.0f Hz\n\n", seconds, channels, SHAKE_SAMPLE_RATE);
+    printf("Parse, ring and detect: %8.1f ns/sample (%.0fx real time)\n", us * 1e3 / samples, seconds * 1e6 / us);
+    printf("Packets %llu, dropped %llu, triggers %llu\n", (unsigned long long)g_packets,
+           (unsigned long long)g_dropped, (unsigned long long)g_trigger_count);
+    uint64_t first = g_trigger_count > SHAKE_RECENT_TRIGGERS ? g_trigger_count - SHAKE_RECENT_TRIGGERS : 0;
+    for (uint64_t n = first; n < g_trigger_count; n++) {
+        const ShakeTrigger *trigger = &g_recent[n % SHAKE_RECENT_TRIGGERS];
+        printf("  %s at onset %+.2f s, STA/LTA %.1f, %.0f counts rms\n", trigger->channel,
+               trigger->time - epoch - onset, trigger->ratio, trigger->rms);
+    }
+    free(text);
+    free(offsets);
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * shake.h - Local seismometer ingest
+ *
+ * A Raspberry Shake broadcasts each channel as UDP text datagrams,
+ * {'EHZ', 1554306963.170, 16802, 16773, ...}: the channel, the time of the
+ * first sample in Unix seconds, then raw counts. A receiver thread takes
+ * them in recvmmsg batches into per-channel ring buffers and runs a
+ * bandpass and STA/LTA detector over all channels in step. Triggers are
+ * kept for the main loop to alert on, usually well before the event
+ * reaches the catalog.
+ */
+
+#ifndef SHAKE_H
+#define SHAKE_H
+
+#include <stdint.h>
+
+#define SHAKE_DEFAULT_PORT 8888
+#define SHAKE_MAX_CHANNELS 8       // Channels detected together, one per vector lane
+#define SHAKE_RING_SAMPLES 8192    // Per channel, power of two: 80 s at 100 Hz
+#define SHAKE_SAMPLE_RATE 100.0f   // Every current Shake model streams at 100 Hz
+#define SHAKE_STA_SECONDS 1.0f
+#define SHAKE_LTA_SECONDS 30.0f    // Also how long a channel settles before it can trigger
+#define SHAKE_TRIGGER_ON 4.0f      // STA/LTA ratio that starts a trigger
+#define SHAKE_TRIGGER_OFF 1.5f     // and the ratio that ends it
+#define SHAKE_RECENT_TRIGGERS 8
+
+typedef struct {
+    char channel[8];
+    double time;  // Unix seconds of the sample that crossed the threshold
+    float ratio;  // STA/LTA at that sample
+    float rms;    // Filtered amplitude over the STA window, in counts
+} ShakeTrigger;
+
+typedef struct {
+    int channels;
+    char name[SHAKE_MAX_CHANNELS][8];
+    float ratio[SHAKE_MAX_CHANNELS]; // Latest STA/LTA
+    int live[SHAKE_MAX_CHANNELS];    // Heard from recently
+    uint64_t packets;
+    uint64_t dropped;  // Unparsable, or more channels than lanes, or too far ahead
+    uint64_t triggers; // Ever; the last SHAKE_RECENT_TRIGGERS are kept
+    ShakeTrigger recent[SHAKE_RECENT_TRIGGERS]; // Trigger n is at n % SHAKE_RECENT_TRIGGERS
+} ShakeStatus;
+
+int shake_start(int port);
+void shake_status(ShakeStatus *status);
+int shake_benchmark(int seconds);
+
+#endif // SHAKE_H
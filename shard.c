@@ -0,0 +1,750 @@
+/*
+ * shard.c - Site evaluation spread over worker processes
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "shard.h"
+#include "net.h"
+#include "monitor.h"
+#include "sites.h"
+#include "quakes.h"
+#include "lightning.h"
+#include "fetch.h"
+#include "timing.h"
+
+#define SHARD_CYCLE_SECONDS 10      // Workers answering a quake cycle later than this are dropped
+#define SHARD_REFRESH_SECONDS 60    // and a forecast refresh, which waits on Open-Meteo
+#define SHARD_BENCH_ROUND_TRIP_MS 50 // About an Open-Meteo request, for the worker benchmark
+
+// --- Globals ---
+ShardWorker g_shard_workers[SHARD_MAX_WORKERS];
+int g_shard_count = 0;
+int g_shard_cells = 0;        // Forecast cells over all workers
+double g_shard_cycle_ms = 0;  // Last round trip to the workers
+int g_shards_answering = 0;
+
+// --- Messages ---
+
+void shard_put(ShardBuffer *b, const void *bytes, size_t length) {
+    if (b->failed) return;
+    if (b->size + length > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity : 4096;
+        while (capacity < b->size + length) capacity *= 2;
+        uint8_t *grown = realloc(b->data, capacity);
+        if (!grown) {
+            b->failed = 1;
+            return;
+        }
+        b->data = grown;
+        b->capacity = capacity;
+    }
+    memcpy(b->data + b->size, bytes, length); // Little-endian on every host the monitor runs on
+    b->size += length;
+}
+
+void shard_get(ShardReader *r, void *out, size_t length) {
+    if (r->failed || (size_t)(r->end - r->at) < length) {
+        r->failed = 1;
+        memset(out, 0, length);
+        return;
+    }
+    memcpy(out, r->at, length);
+    r->at += length;
+}
+
+static long long now_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
+// Waits until fd is ready for events or the deadline (monotonic ms, 0 for
+// none) passes. Returns -1 on timeout.
+static int wait_ready(int fd, short events, long long deadline) {
+    for (;;) {
+        struct pollfd ready = { .fd = fd, .events = events };
+        long long left = deadline ? deadline - now_ms() : -1;
+        if (deadline && left <= 0) return -1;
+        int got = poll(&ready, 1, left > INT32_MAX ? INT32_MAX : (int)left);
+        if (got > 0) return 0;
+        if (got < 0 && errno != EINTR) return -1;
+    }
+}
+
+static int write_all(int fd, const void *data, size_t length, long long deadline) {
+    const uint8_t *p = data;
+    while (length > 0) {
+        if (wait_ready(fd, POLLOUT, deadline) != 0) return -1;
+        ssize_t sent = send(fd, p, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (sent <= 0) return -1;
+        p += sent;
+        length -= sent;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *data, size_t length, long long deadline) {
+    uint8_t *p = data;
+    while (length > 0) {
+        if (wait_ready(fd, POLLIN, deadline) != 0) return -1;
+        ssize_t got = recv(fd, p, length, MSG_DONTWAIT);
+        if (got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (got <= 0) return -1;
+        p += got;
+        length -= got;
+    }
+    return 0;
+}
+
+// Waits up to timeout_ms for a message to start on any of fds. Returns the
+// index of one that is ready, or -1.
+int shard_wait_any(const int *fds, int count, int timeout_ms) {
+    struct pollfd ready[SHARD_MAX_WORKERS];
+    long long deadline = now_ms() + timeout_ms;
+    if (count > SHARD_MAX_WORKERS) count = SHARD_MAX_WORKERS;
+    for (int i = 0; i < count; i++) ready[i] = (struct pollfd){ .fd = fds[i], .events = POLLIN };
+    for (;;) {
+        long long left = deadline - now_ms();
+        int got = poll(ready, count, left > 0 ? (int)left : 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        for (int i = 0; i < count; i++) {
+            if (ready[i].revents) return i; // Hang-ups too, for the read to fail on
+        }
+    }
+}
+
+// Gives up after timeout_ms, or waits as long as it takes if that is
+// negative. A message cut short leaves the stream unusable.
+int shard_send(int fd, uint8_t type, const ShardBuffer *payload, int timeout_ms) {
+    uint8_t head[5];
+    uint32_t length = (uint32_t)payload->size;
+    long long deadline = timeout_ms < 0 ? 0 : now_ms() + timeout_ms;
+    if (payload->failed) return -1;
+    memcpy(head, &length, 4);
+    head[4] = type;
+    if (write_all(fd, head, sizeof(head), deadline) != 0) return -1;
+    return write_all(fd, payload->data, payload->size, deadline);
+}
+
+// Waits for the next message, for timeout_ms or, if that is negative, as
+// long as it takes. The payload reuses and grows the buffer.
+int shard_receive(int fd, uint8_t *type, ShardBuffer *payload, int timeout_ms) {
+    uint8_t head[5];
+    uint32_t length;
+    long long deadline = timeout_ms < 0 ? 0 : now_ms() + timeout_ms;
+    if (read_all(fd, head, sizeof(head), deadline) != 0) return -1;
+    memcpy(&length, head, 4);
+    if (length > SHARD_MAX_MESSAGE) return -1;
+    *type = head[4];
+    payload->size = 0;
+    payload->failed = 0;
+    if (length > payload->capacity) {
+        uint8_t *grown = realloc(payload->data, length);
+        if (!grown) return -1;
+        payload->data = grown;
+        payload->capacity = length;
+    }
+    if (read_all(fd, payload->data, length, deadline) != 0) return -1;
+    payload->size = length;
+    return 0;
+}
+
+// --- Protocol ---
+
+// 'S': the settings a worker evaluates with and its shard of the sites,
+// each with the storm state it had, wherever it was evaluated before
+static void put_sites(ShardBuffer *b, int first, int count) {
+    float arrival_magnitude = g_arrival_min_magnitude, ring_km = g_lightning_ring_km;
+    int32_t settings[3] = { g_lightning_horizon_hours, g_lightning_step_minutes, (int32_t)g_lightning_format };
+    uint32_t n = count;
+    shard_put(b, &arrival_magnitude, 4);
+    shard_put(b, &ring_km, 4);
+    shard_put(b, settings, sizeof(settings));
+    shard_put(b, &n, 4);
+    for (int s = first; s < first + count; s++) {
+        const LightningSiteState *state = lightning_site(s);
+        float threshold = g_sites[s].mmi_threshold;
+        int64_t times[3] = { state->onset, state->since, state->held };
+        uint8_t level = state->level;
+        shard_put(b, &g_sites[s].lat, 8);
+        shard_put(b, &g_sites[s].lon, 8);
+        shard_put(b, &threshold, 4);
+        shard_put(b, g_sites[s].name, sizeof(g_sites[s].name));
+        shard_put(b, &level, 1);
+        shard_put(b, &state->risk, 4);
+        shard_put(b, times, sizeof(times));
+    }
+}
+
+static void read_sites(ShardReader *r) {
+    int32_t settings[3];
+    uint32_t count;
+    shard_get(r, &g_arrival_min_magnitude, 4);
+    shard_get(r, &g_lightning_ring_km, 4);
+    shard_get(r, settings, sizeof(settings));
+    shard_get(r, &count, 4);
+    g_lightning_horizon_hours = settings[0];
+    g_lightning_step_minutes = settings[1];
+    g_lightning_format = (LightningFormat)settings[2];
+    g_site_count = 0;
+    lightning_reset_sites();
+    for (uint32_t s = 0; s < count && !r->failed; s++) {
+        LightningSiteState state = { 0 };
+        double lat, lon;
+        float threshold;
+        char name[sizeof(g_sites[0].name)];
+        int64_t times[3];
+        uint8_t level;
+        shard_get(r, &lat, 8);
+        shard_get(r, &lon, 8);
+        shard_get(r, &threshold, 4);
+        shard_get(r, name, sizeof(name));
+        shard_get(r, &level, 1);
+        shard_get(r, &state.risk, 4);
+        shard_get(r, times, sizeof(times));
+        name[sizeof(name) - 1] = '\0';
+        int site = r->failed ? -1 : sites_add(name, lat, lon, threshold);
+        if (site < 0) continue;
+        state.level = level <= LIGHTNING_WARNING ? (LightningLevel)level : LIGHTNING_CLEAR;
+        state.onset = times[0];
+        state.since = times[1];
+        state.held = times[2];
+        lightning_restore_site(site, &state);
+    }
+}
+
+// 'C' (quake cycle) and 'F' (the same, after refreshing the forecasts):
+// the time and the live list, as much of each event as evaluation reads
+static void put_cycle(ShardBuffer *b, long long now) {
+    int64_t when = now;
+    uint32_t count = g_quake_count;
+    shard_put(b, &when, 8);
+    shard_put(b, &count, 4);
+    for (int i = 0; i < g_quake_count; i++) {
+        int64_t time_ms = g_quakes[i].time_ms;
+        shard_put(b, &g_quakes[i].mag, 8);
+        shard_put(b, &g_quakes[i].lat, 8);
+        shard_put(b, &g_quakes[i].lon, 8);
+        shard_put(b, &g_quakes[i].depth, 8);
+        shard_put(b, &time_ms, 8);
+    }
+}
+
+static long long read_cycle(ShardReader *r) {
+    int64_t now;
+    uint32_t count;
+    shard_get(r, &now, 8);
+    shard_get(r, &count, 4);
+    g_quake_count = 0;
+    for (uint32_t i = 0; i < count && g_quake_count < MAX_QUAKES && !r->failed; i++) {
+        Earthquake *quake = &g_quakes[g_quake_count++];
+        int64_t time_ms;
+        memset(quake, 0, sizeof(*quake));
+        shard_get(r, &quake->mag, 8);
+        shard_get(r, &quake->lat, 8);
+        shard_get(r, &quake->lon, 8);
+        shard_get(r, &quake->depth, 8);
+        shard_get(r, &time_ms, 8);
+        quake->time_ms = time_ms;
+    }
+    return now;
+}
+
+// 'R': shaking and storm state per site, per-event summaries over the
+// shard and wave arrivals
+static void put_results(ShardBuffer *b) {
+    uint32_t cells = g_lightning_cell_count, sites = g_site_count, quakes = g_quake_count, arrivals = g_arrival_count;
+    shard_put(b, &cells, 4);
+    shard_put(b, &sites, 4);
+    for (int s = 0; s < g_site_count; s++) {
+        const LightningSiteState *state = lightning_site(s);
+        const LightningThreat *threat = &g_lightning_threats[s];
+        int32_t peak_quake = g_sites[s].peak_quake, eta = threat->eta_minutes;
+        int64_t times[3] = { state->onset, state->since, state->held };
+        uint8_t level = state->level;
+        shard_put(b, &g_sites[s].peak_mmi, 4);
+        shard_put(b, &peak_quake, 4);
+        shard_put(b, &level, 1);
+        shard_put(b, &state->risk, 4);
+        shard_put(b, times, sizeof(times));
+        shard_put(b, &threat->distance_km, 4);
+        shard_put(b, &threat->bearing_deg, 4);
+        shard_put(b, &eta, 4);
+    }
+    shard_put(b, &quakes, 4);
+    for (int i = 0; i < g_quake_count; i++) {
+        uint8_t exceeds = g_quakes[i].exceeds_site_threshold != 0;
+        shard_put(b, &g_quakes[i].peak_mmi, 4);
+        shard_put(b, &g_quakes[i].nearest_site_km, 4);
+        shard_put(b, &exceeds, 1);
+    }
+    shard_put(b, &arrivals, 4);
+    for (int a = 0; a < g_arrival_count; a++) {
+        int32_t indexes[2] = { g_arrivals[a].quake, g_arrivals[a].site };
+        shard_put(b, indexes, sizeof(indexes));
+        shard_put(b, &g_arrivals[a].p_arrival, 8);
+        shard_put(b, &g_arrivals[a].s_arrival, 8);
+    }
+}
+
+// Folds one worker's reply into the coordinator's views, its site indexes
+// offset to the worker's shard. A site whose level differs from the one
+// stored here records the transition, so levels carried over to a new
+// shard alert only when they change. Returns -1 if the reply does not fit.
+static int merge_results(const ShardWorker *worker, ShardReader *r) {
+    uint32_t cells, sites, quakes, arrivals;
+    shard_get(r, &cells, 4);
+    shard_get(r, &sites, 4);
+    if (r->failed || sites != (uint32_t)worker->site_count) return -1;
+    g_shard_cells += cells;
+    for (uint32_t i = 0; i < sites && !r->failed; i++) {
+        Site *site = &g_sites[worker->first_site + i];
+        LightningSiteState state = { 0 };
+        LightningThreat threat;
+        int32_t peak_quake, eta;
+        int64_t times[3];
+        uint8_t level;
+        shard_get(r, &site->peak_mmi, 4);
+        shard_get(r, &peak_quake, 4);
+        shard_get(r, &level, 1);
+        shard_get(r, &state.risk, 4);
+        shard_get(r, times, sizeof(times));
+        shard_get(r, &threat.distance_km, 4);
+        shard_get(r, &threat.bearing_deg, 4);
+        shard_get(r, &eta, 4);
+        site->peak_quake = peak_quake >= 0 && peak_quake < g_quake_count ? peak_quake : -1;
+        state.level = level <= LIGHTNING_WARNING ? (LightningLevel)level : LIGHTNING_CLEAR;
+        state.onset = times[0];
+        state.since = times[1];
+        state.held = times[2];
+        threat.eta_minutes = eta;
+        LightningLevel stored = lightning_site(worker->first_site + i)->level;
+        if (!r->failed && state.level != stored) {
+            lightning_record_transition(worker->first_site + i, stored, state.level, state.since, state.risk);
+        }
+        lightning_store_site(worker->first_site + i, &state, &threat);
+    }
+    shard_get(r, &quakes, 4);
+    if (r->failed || quakes != (uint32_t)g_quake_count) return -1;
+    for (int i = 0; i < g_quake_count && !r->failed; i++) {
+        Earthquake *quake = &g_quakes[i];
+        float peak_mmi, nearest_km;
+        uint8_t exceeds;
+        shard_get(r, &peak_mmi, 4);
+        shard_get(r, &nearest_km, 4);
+        shard_get(r, &exceeds, 1);
+        if (peak_mmi > quake->peak_mmi) quake->peak_mmi = peak_mmi;
+        if (nearest_km >= 0 && (quake->nearest_site_km < 0 || nearest_km < quake->nearest_site_km)) quake->nearest_site_km = nearest_km;
+        quake->exceeds_site_threshold |= exceeds;
+    }
+    shard_get(r, &arrivals, 4);
+    for (uint32_t a = 0; a < arrivals && !r->failed; a++) {
+        int32_t indexes[2];
+        double p_arrival, s_arrival;
+        shard_get(r, indexes, sizeof(indexes));
+        shard_get(r, &p_arrival, 8);
+        shard_get(r, &s_arrival, 8);
+        if (g_arrival_count >= MAX_ARRIVALS || indexes[0] < 0 || indexes[0] >= g_quake_count || indexes[1] < 0 || indexes[1] >= worker->site_count) continue;
+        g_arrivals[g_arrival_count++] = (WaveArrival){ .quake = indexes[0], .site = worker->first_site + indexes[1], .p_arrival = p_arrival, .s_arrival = s_arrival };
+    }
+    return r->failed ? -1 : 0;
+}
+
+// --- Workers ---
+
+// Forks count local workers, each running worker_main on its end of a
+// socketpair until the coordinator goes away. Returns the workers added.
+int shard_spawn(int count, int (*worker_main)(int fd)) {
+    int added = 0;
+    fflush(stdout); // Or the children print it again
+    for (int n = 0; n < count && g_shard_count < SHARD_MAX_WORKERS; n++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) break;
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(pair[0]);
+            close(pair[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(pair[0]);
+            for (int w = 0; w < g_shard_count; w++) close(g_shard_workers[w].fd);
+            _exit(worker_main(pair[1]));
+        }
+        close(pair[1]);
+        g_shard_workers[g_shard_count++] = (ShardWorker){ .fd = pair[0], .pid = pid };
+        added++;
+    }
+    return added;
+}
+
+// Adds the worker listening at "host:port".
+int shard_connect(const char *address) {
+    char host[256], port[16];
+    if (net_split_address(address, host, sizeof(host), port, sizeof(port)) != 0 || g_shard_count >= SHARD_MAX_WORKERS) {
+        fprintf(stderr, "Worker must be host:port, got %s\n", address);
+        return -1;
+    }
+    int fd = net_connect(host, port), one = 1;
+    if (fd < 0) {
+        fprintf(stderr, "Could not connect to worker %s\n", address);
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    g_shard_workers[g_shard_count++] = (ShardWorker){ .fd = fd };
+    return 0;
+}
+
+// Serves coordinators on a TCP port for the life of the process, each in a
+// worker process of its own. Returns only if the port cannot be taken.
+int shard_listen(int port, int (*worker_main)(int fd)) {
+    int fd = net_listen(port, 16, 0, NULL), one = 1;
+    if (fd < 0) {
+        fprintf(stderr, "Could not listen for a coordinator on TCP port %d\n", port);
+        return 1;
+    }
+    signal(SIGCHLD, SIG_IGN); // Finished workers need no reaping
+    printf("Worker listening on TCP port %d\n", port);
+    fflush(stdout);
+    for (;;) {
+        int client = accept(fd, NULL, NULL);
+        if (client < 0) continue;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fd);
+            _exit(worker_main(client));
+        }
+        close(client);
+    }
+}
+
+// Splits the sites into contiguous shards as even as can be.
+void shard_partition(int sites) {
+    for (int w = 0, first = 0; w < g_shard_count; w++) {
+        int count = sites / g_shard_count + (w < sites % g_shard_count);
+        g_shard_workers[w].first_site = first;
+        g_shard_workers[w].site_count = count;
+        first += count;
+    }
+}
+
+// Forgets the workers that were hung up on (fd -1), stopping local ones,
+// and returns how many are left.
+int shard_prune() {
+    int kept = 0;
+    for (int w = 0; w < g_shard_count; w++) {
+        const ShardWorker *worker = &g_shard_workers[w];
+        if (worker->fd >= 0) {
+            g_shard_workers[kept++] = *worker;
+            continue;
+        }
+        if (worker->pid > 0) { // It may be stuck rather than gone
+            kill(worker->pid, SIGKILL);
+            waitpid(worker->pid, NULL, 0);
+        }
+    }
+    g_shard_count = kept;
+    return kept;
+}
+
+// Hangs up on every worker; local ones exit and are reaped.
+void shard_stop() {
+    for (int w = 0; w < g_shard_count; w++) {
+        close(g_shard_workers[w].fd);
+        if (g_shard_workers[w].pid > 0) waitpid(g_shard_workers[w].pid, NULL, 0);
+    }
+    g_shard_count = 0;
+}
+
+// --- Site Evaluation ---
+
+// Answers the coordinator on fd until it hangs up: first its shard of the
+// sites, again whenever the shards change, then one reply per cycle. A
+// refresh fetches forecasts from source, leaving itself time to answer.
+static int run_worker(int fd, ForecastSource source) {
+    ShardBuffer in = { 0 }, out = { 0 };
+    uint8_t type;
+    while (shard_receive(fd, &type, &in, -1) == 0) {
+        ShardReader r = { in.data, in.data + in.size, 0 };
+        if (type == 'S') {
+            read_sites(&r);
+            continue;
+        }
+        if (type != 'C' && type != 'F') continue;
+        long long now = read_cycle(&r);
+        if (r.failed) break;
+        evaluate_site_shaking();
+        predict_wave_arrivals();
+        if (type == 'F') refresh_forecasts(now, source, time(NULL) + SHARD_REFRESH_SECONDS / 2); // The rest is for the last request
+        lightning_assess(now);
+        out.size = 0;
+        put_results(&out);
+        if (shard_send(fd, 'R', &out, -1) != 0) break;
+    }
+    free(in.data);
+    free(out.data);
+    close(fd);
+    return 0;
+}
+
+int serve_coordinator(int fd) {
+    return run_worker(fd, fetch_forecast);
+}
+
+// Hangs up on a worker that failed or missed a deadline. Its sites lose
+// their shaking until another worker, or this process, evaluates them.
+static void drop_worker(ShardWorker *worker) {
+    fprintf(stderr, "Site worker for sites %d-%d stopped answering; handing them on\n", worker->first_site + 1,
+            worker->first_site + worker->site_count);
+    for (int s = worker->first_site; s < worker->first_site + worker->site_count; s++) {
+        g_sites[s].peak_mmi = 0;
+        g_sites[s].peak_quake = -1;
+    }
+    close(worker->fd);
+    worker->fd = -1;
+}
+
+// Splits the sites over the workers and hands every one its shard. Any
+// that cannot take it are dropped and the rest split them again.
+static void send_sites() {
+    ShardBuffer message = { 0 };
+    for (int dropped = 1; dropped && shard_prune() > 0;) {
+        dropped = 0;
+        shard_partition(g_site_count);
+        for (int w = 0; w < g_shard_count; w++) {
+            message.size = 0;
+            put_sites(&message, g_shard_workers[w].first_site, g_shard_workers[w].site_count);
+            if (shard_send(g_shard_workers[w].fd, 'S', &message, SHARD_CYCLE_SECONDS * 1000) != 0) {
+                drop_worker(&g_shard_workers[w]);
+                dropped = 1;
+            }
+        }
+    }
+    free(message.data);
+}
+
+// Forks the local workers and connects to the remote ones, then hands out
+// the sites. Returns the number of workers.
+int start_workers() {
+    if (g_local_workers > 0) shard_spawn(g_local_workers, serve_coordinator);
+    for (int r = 0; r < g_remote_worker_count; r++) shard_connect(g_remote_workers[r]);
+    if (g_shard_count == 0) return 0;
+    if (g_strike_feed) {
+        fprintf(stderr, "Strike feed is not used with site workers\n");
+        g_strike_feed = NULL;
+    }
+    send_sites();
+    return g_shard_count;
+}
+
+// Runs one cycle of the given type on every worker at once, then merges
+// their replies in shard order. Takes as long as the slowest worker, but
+// no longer than seconds: workers that fail or are late are dropped,
+// their sites handed to the rest and a quake cycle run again for them, or
+// evaluated here once no workers are left.
+static void run_shards(uint8_t type, long long now, int seconds) {
+    static ShardBuffer message, replies[SHARD_MAX_WORKERS];
+    int answered[SHARD_MAX_WORKERS] = { 0 }, waiting[SHARD_MAX_WORKERS], dropped = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    message.size = 0;
+    put_cycle(&message, now);
+    for (int w = 0; w < g_shard_count; w++) {
+        int left_ms = seconds * 1000 - (int)(elapsed_us(&start) / 1e3);
+        if (shard_send(g_shard_workers[w].fd, type, &message, left_ms > 0 ? left_ms : 0) != 0) {
+            drop_worker(&g_shard_workers[w]);
+            dropped = 1;
+        }
+    }
+    // Takes the replies as they come, so a hung worker holds up no others
+    for (;;) {
+        int fds[SHARD_MAX_WORKERS], count = 0;
+        for (int w = 0; w < g_shard_count; w++) {
+            if (g_shard_workers[w].fd >= 0 && !answered[w]) {
+                fds[count] = g_shard_workers[w].fd;
+                waiting[count++] = w;
+            }
+        }
+        int left_ms = seconds * 1000 - (int)(elapsed_us(&start) / 1e3);
+        int ready = count > 0 && left_ms > 0 ? shard_wait_any(fds, count, left_ms) : -1;
+        if (ready < 0) break;
+        int w = waiting[ready];
+        uint8_t reply_type;
+        if (shard_receive(fds[ready], &reply_type, &replies[w], left_ms) != 0 || reply_type != 'R') {
+            drop_worker(&g_shard_workers[w]);
+            dropped = 1;
+            continue;
+        }
+        answered[w] = 1;
+    }
+    for (int i = 0; i < g_quake_count; i++) {
+        g_quakes[i].peak_mmi = 0;
+        g_quakes[i].nearest_site_km = -1;
+        g_quakes[i].exceeds_site_threshold = 0;
+    }
+    g_arrival_count = 0;
+    g_shard_cells = 0;
+    g_shards_answering = 0;
+    for (int w = 0; w < g_shard_count; w++) {
+        ShardWorker *worker = &g_shard_workers[w];
+        if (worker->fd < 0) continue;
+        ShardReader r = { replies[w].data, replies[w].data + replies[w].size, 0 };
+        if (!answered[w] || merge_results(worker, &r) != 0) { // Late, or an answer that does not fit
+            drop_worker(worker);
+            dropped = 1;
+            continue;
+        }
+        g_shards_answering++;
+    }
+    g_shard_cycle_ms = elapsed_us(&start) / 1e3;
+    if (!dropped) return;
+    send_sites();
+    if (g_shard_count) {
+        run_shards('C', now, SHARD_CYCLE_SECONDS);
+    } else {
+        fprintf(stderr, "No site workers left; evaluating every site here\n");
+        for (int s = 0; s < g_site_count; s++) lightning_restore_site(s, lightning_site(s)); // Keeps the merged levels
+        evaluate_site_shaking();
+        predict_wave_arrivals();
+    }
+}
+
+// Evaluates the live list on every worker, with the forecasts they have.
+void evaluate_shards(long long now) {
+    run_shards('C', now, SHARD_CYCLE_SECONDS);
+}
+
+// Has every worker fetch its stale forecasts and reassess its sites.
+void refresh_shards(long long now) {
+    run_shards('F', now, SHARD_REFRESH_SECONDS);
+}
+
+// --- Benchmark ---
+
+// Stands in for Open-Meteo in the benchmark: count cells of forecast with
+// a thunderstorm in about one slot in eight, after a request's round trip.
+static char *synthetic_forecast(const char *url, int count, long long now, size_t *length) {
+    static const char *columns[] = { "weather_code", "lightning_potential", "cape", "precipitation" };
+    static uint64_t state = 12345;
+    int quarter_hours = g_lightning_step_minutes == 15, step = quarter_hours ? 900 : 3600;
+    int slots = g_lightning_horizon_hours * (quarter_hours ? 4 : 1);
+    size_t capacity = (size_t)count * (slots * 80 + 256) + 16, used = 0;
+    char *body = malloc(capacity);
+    (void)url;
+    if (!body) return NULL;
+    long long first_slot = now / step * step;
+    used += snprintf(body + used, capacity - used, "[");
+    for (int c = 0; c < count; c++) {
+        used += snprintf(body + used, capacity - used, "%s{\"current\":{\"time\":%lld,\"weather_code\":1},\"%s\":{\"time\":[",
+                         c ? "," : "", now, quarter_hours ? "minutely_15" : "hourly");
+        for (int i = 0; i < slots; i++) used += snprintf(body + used, capacity - used, "%s%lld", i ? "," : "", first_slot + (long long)i * step);
+        for (int v = 0; v < 4; v++) {
+            used += snprintf(body + used, capacity - used, "],\"%s\":[", columns[v]);
+            for (int i = 0; i < slots; i++) {
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                unsigned value = (unsigned)(state >> 33);
+                if (v == 0) used += snprintf(body + used, capacity - used, "%s%u", i ? "," : "", value % 8 == 0 ? 95 : value % 4);
+                else used += snprintf(body + used, capacity - used, "%s%u.%u", i ? "," : "", value % (v == 2 ? 3000 : 40), value % 10);
+            }
+        }
+        used += snprintf(body + used, capacity - used, "]}}");
+    }
+    used += snprintf(body + used, capacity - used, "]");
+    struct timespec round_trip = { 0, SHARD_BENCH_ROUND_TRIP_MS * 1000000L };
+    nanosleep(&round_trip, NULL);
+    *length = used;
+    return body;
+}
+
+static int serve_benchmark(int fd) {
+    return run_worker(fd, synthetic_forecast);
+}
+
+// Times a cycle that refreshes every forecast, and a quake-only one, over
+// growing numbers of local workers.
+int shard_benchmark(int sites) {
+    static const int worker_counts[] = { 1, 2, 4, 8 };
+    uint64_t state = 12345;
+    long long now = time(NULL);
+    if (sites > MAX_SITES) sites = MAX_SITES;
+    for (int n = g_site_count; n < sites; n++) {
+        sites_add("bench", 40.0f + (n / 100) * 0.25f, (n % 100) * 0.25f, DEFAULT_SITE_MMI_THRESHOLD);
+    }
+    g_quake_count = MAX_QUAKES;
+    for (int i = 0; i < g_quake_count; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        g_quakes[i] = (Earthquake){ .mag = 3.0 + (state >> 33) % 40 / 10.0, .lat = 38.0 + (state >> 20) % 1400 / 100.0,
+                                    .lon = -2.0 + (state >> 40) % 2800 / 100.0, .depth = 10.0, .time_ms = (now - 60) * 1000 };
+    }
+    printf("Site worker benchmark: %d sites, %d events, %d ms per forecast request, %ld CPU cores\n\n",
+           g_site_count, g_quake_count, SHARD_BENCH_ROUND_TRIP_MS, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-8s %16s %16s %10s\n", "Workers", "Refresh cycle", "Quake cycle", "Cells");
+    for (size_t k = 0; k < sizeof(worker_counts) / sizeof(worker_counts[0]); k++) {
+        if (shard_spawn(worker_counts[k], serve_benchmark) != worker_counts[k]) {
+            printf("Could not start %d workers\n", worker_counts[k]);
+            shard_stop();
+            return 1;
+        }
+        send_sites();
+        refresh_shards(now); // Every cell is stale in fresh workers
+        double refresh_ms = g_shard_cycle_ms;
+        evaluate_shards(now);
+        if (g_shard_count != worker_counts[k] || g_shards_answering != g_shard_count) {
+            printf("Only %d of %d workers answered\n", g_shards_answering, worker_counts[k]);
+            shard_stop();
+            return 1;
+        }
+        printf("%-8d %13.0f ms %13.1f ms %10d\n", worker_counts[k], refresh_ms, g_shard_cycle_ms, g_shard_cells);
+        shard_stop();
+    }
+
+    // A worker that hangs is dropped at the deadline, and the others take
+    // its sites within the same cycle, storm levels and all
+    int workers = worker_counts[sizeof(worker_counts) / sizeof(worker_counts[0]) - 1];
+    if (shard_spawn(workers, serve_benchmark) != workers) return 1;
+    send_sites();
+    refresh_shards(now);
+    evaluate_shards(now);
+    double before = 0, after = 0;
+    int storms = 0, levels_kept = 1;
+    static LightningLevel levels[MAX_SITES];
+    for (int s = 0; s < g_site_count; s++) {
+        before += g_sites[s].peak_mmi;
+        levels[s] = lightning_site(s)->level;
+        storms += levels[s] != LIGHTNING_CLEAR;
+    }
+    uint64_t transitions = g_lightning_transition_count;
+    kill(g_shard_workers[1].pid, SIGSTOP);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    printf("\n");
+    evaluate_shards(now);
+    for (int s = 0; s < g_site_count; s++) {
+        after += g_sites[s].peak_mmi;
+        levels_kept &= lightning_site(s)->level == levels[s];
+    }
+    levels_kept &= g_lightning_transition_count == transitions;
+    int ok = g_shard_count == workers - 1 && g_shards_answering == g_shard_count && fabs(after - before) < 1e-3 * (1 + before);
+    printf("Hung worker: cycle done in %.0f ms by %d workers, shaking at every site %s, %d storm levels %s\n",
+           elapsed_us(&start) / 1e3, g_shards_answering, ok ? "as before" : "DIFFERS", storms,
+           levels_kept ? "kept" : "CHANGED");
+    ok &= levels_kept;
+    shard_stop();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/*
+ * shard.h - Site evaluation spread over worker processes
+ *
+ * A coordinator polls the quake feed as usual, but splits the site list
+ * into contiguous shards, one per worker. Each quake cycle it sends every
+ * worker the live event list; the worker evaluates shaking, wave arrivals
+ * and storm levels for its own sites and answers with the results; the
+ * coordinator records any storm level changes as it merges them. Forecasts
+ * are fetched in a refresh cycle of their own, so quake alerts never wait
+ * on Open-Meteo. Workers run in parallel, so a cycle takes as long as the
+ * slowest shard, and the coordinator alerts and draws from the merged
+ * results as if it had done the work itself.
+ *
+ * A worker that fails, or misses the cycle's deadline, is dropped and its
+ * sites are split over the rest; with none left the coordinator evaluates
+ * them itself. Either way each site's storm state goes with it, so a
+ * level already alerted on does not escalate and alert again.
+ *
+ * Workers are local processes forked at start over socketpairs, or other
+ * machines running a worker listener, over TCP; each coordinator
+ * connection there gets a fresh worker process. Messages are a u32
+ * length, a type byte and a payload built with ShardBuffer, little-endian.
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SHARD_MAX_WORKERS 64
+#define SHARD_MAX_MESSAGE (64 << 20) // Larger frames mean a broken peer
+
+typedef struct {
+    int fd;
+    pid_t pid;      // Local workers; 0 for remote ones
+    int first_site; // Shard: sites first_site .. first_site + site_count - 1
+    int site_count;
+} ShardWorker;
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    int failed;
+} ShardBuffer;
+
+typedef struct {
+    const uint8_t *at;
+    const uint8_t *end;
+    int failed; // Read past the end
+} ShardReader;
+
+extern ShardWorker g_shard_workers[SHARD_MAX_WORKERS];
+extern int g_shard_count;
+extern int g_shard_cells;       // Forecast cells over all workers
+extern double g_shard_cycle_ms; // Last round trip to the workers
+extern int g_shards_answering;
+
+int shard_spawn(int count, int (*worker_main)(int fd));
+int shard_connect(const char *address);
+int shard_listen(int port, int (*worker_main)(int fd));
+void shard_partition(int sites);
+int shard_prune();
+void shard_stop();
+
+void shard_put(ShardBuffer *b, const void *bytes, size_t length);
+void shard_get(ShardReader *r, void *out, size_t length);
+int shard_send(int fd, uint8_t type, const ShardBuffer *payload, int timeout_ms);
+int shard_receive(int fd, uint8_t *type, ShardBuffer *payload, int timeout_ms);
+int shard_wait_any(const int *fds, int count, int timeout_ms);
+
+int start_workers();
+void evaluate_shards(long long now);
+void refresh_shards(long long now);
+int serve_coordinator(int fd);
+int shard_benchmark(int sites);
+
+#endif // SHARD_H
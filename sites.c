@@ -0,0 +1,52 @@
+/*
+ * sites.c - Monitored site list
+ *
+ * Sites file format, one site per line ('#' starts a comment):
+ *   <name> <latitude> <longitude> [mmi_threshold]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sites.h"
+
+// --- Globals ---
+Site g_sites[MAX_SITES];
+int g_site_count = 0;
+
+int sites_add(const char *name, double lat, double lon, float mmi_threshold) {
+    if (g_site_count >= MAX_SITES) {
+        fprintf(stderr, "Too many sites (max %d), ignoring %s\n", MAX_SITES, name);
+        return -1;
+    }
+    Site *site = &g_sites[g_site_count];
+    memset(site, 0, sizeof(*site));
+    strncpy(site->name, name, sizeof(site->name) - 1);
+    site->lat = lat;
+    site->lon = lon;
+    site->mmi_threshold = mmi_threshold;
+    site->peak_quake = -1;
+    return g_site_count++;
+}
+
+int sites_load(const char *path, float default_mmi_threshold) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Could not open sites file %s\n", path);
+        return -1;
+    }
+    char line[256];
+    int loaded = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char name[32];
+        double lat, lon;
+        float mmi = default_mmi_threshold;
+        int fields = sscanf(line, "%31s %lf %lf %f", name, &lat, &lon, &mmi);
+        if (fields < 3) continue;
+        if (sites_add(name, lat, lon, mmi) < 0) break;
+        loaded++;
+    }
+    fclose(fp);
+    return loaded;
+}
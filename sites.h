@@ -0,0 +1,31 @@
+/*
+ * sites.h - Monitored site list
+ *
+ * A site is a named location whose expected shaking (and, later, storm
+ * exposure) is evaluated for every event. Sites come from a sites file or,
+ * when none is given, from the single -l location.
+ */
+
+#ifndef SITES_H
+#define SITES_H
+
+#define MAX_SITES 4096
+#define DEFAULT_SITE_MMI_THRESHOLD 5.0 // MMI V: felt by nearly everyone
+
+typedef struct {
+    char name[32];
+    double lat;
+    double lon;
+    float mmi_threshold;
+    // Results of the most recent shaking evaluation
+    float peak_mmi;
+    int peak_quake; // Index into g_quakes, -1 if none
+} Site;
+
+extern Site g_sites[MAX_SITES];
+extern int g_site_count;
+
+int sites_add(const char *name, double lat, double lon, float mmi_threshold);
+int sites_load(const char *path, float default_mmi_threshold);
+
+#endif // SITES_H
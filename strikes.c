@@ -0,0 +1,345 @@
+/*
+ * strikes.c - Live lightning strike stream
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "strikes.h"
+#include "net.h"
+#include "timing.h"
+#include "fastmath.h"
+
+#define GRID_ROWS (180 * STRIKE_GRID_PER_DEGREE)
+#define GRID_COLS (360 * STRIKE_GRID_PER_DEGREE)
+#define GRID_CELLS (GRID_ROWS * GRID_COLS)
+#define STRIKE_BUCKETS 3 // The window is tracked as this many rolling buckets
+#define BUCKET_SECONDS (STRIKE_WINDOW_SECONDS / STRIKE_BUCKETS)
+#define STRIKE_LINE_MAX 65536
+#define STRIKE_RECONNECT_SECONDS 5
+#define KM_PER_DEG 111.195f
+#define DEG_TO_RAD (M_PI / 180.0)
+
+// Nearest strike to a site in each bucket of the window
+typedef struct {
+    long long epoch[STRIKE_BUCKETS]; // Bucket number the entry belongs to
+    float distance_km[STRIKE_BUCKETS];
+    float bearing_deg[STRIKE_BUCKETS];
+    long long time_ms[STRIKE_BUCKETS];
+    float cos_lat; // Scales longitude degrees to km at the site
+    int band;      // 0 none, 1 watch, 2 warning, as last reported
+} SiteStrikes;
+
+// --- Globals ---
+StrikeStats g_strike_stats = { 0 };
+
+// Single-producer, single-consumer queue from the reader thread
+static Strike g_ring[STRIKE_RING_SIZE];
+static uint64_t g_ring_head = 0; // Next slot the reader fills
+static uint64_t g_ring_tail = 0; // Next slot the main loop drains
+
+static float g_density[GRID_CELLS];
+static uint32_t g_stamp[GRID_CELLS]; // Unix seconds the density was last decayed to
+
+// Sites within STRIKE_TRACK_KM of each grid cell, as compressed rows
+static uint32_t g_cell_first[GRID_CELLS + 1];
+static uint16_t *g_cell_sites = NULL;
+static int g_indexed_sites = 0;
+static SiteStrikes g_site_strikes[MAX_SITES];
+
+static char g_host[256];
+static char g_port[16];
+static long long g_last_update_ms = 0;
+
+// --- Parsing ---
+
+static int number_field(const char *line, const char *key, double *value) {
+    const char *p = strstr(line, key);
+    if (!p) return 0;
+    p += strlen(key);
+    while (*p == ' ' || *p == ':') p++;
+    char *end;
+    *value = strtod(p, &end);
+    return end != p;
+}
+
+// Reads one {"time":..,"lat":..,"lon":..} line. Time may be in seconds,
+// milliseconds or nanoseconds; without one the strike is stamped received.
+static int parse_strike(const char *line, long long received_ms, Strike *strike) {
+    double lat, lon, t;
+    if (!number_field(line, "\"lat\"", &lat) || !number_field(line, "\"lon\"", &lon)) return -1;
+    if (lat < -90.0 || lat > 90.0 || lon < -180.0 || lon > 180.0) return -1;
+    strike->lat = (float)lat;
+    strike->lon = (float)lon;
+    if (!number_field(line, "\"time\"", &t)) strike->time_ms = received_ms;
+    else if (t > 1e15) strike->time_ms = (long long)(t / 1e6);
+    else if (t > 1e11) strike->time_ms = (long long)t;
+    else strike->time_ms = (long long)(t * 1000.0);
+    return 0;
+}
+
+static void push_strike(const Strike *strike) {
+    uint64_t head = g_ring_head;
+    if (head - __atomic_load_n(&g_ring_tail, __ATOMIC_ACQUIRE) == STRIKE_RING_SIZE) {
+        __atomic_fetch_add(&g_strike_stats.dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    g_ring[head & (STRIKE_RING_SIZE - 1)] = *strike;
+    __atomic_store_n(&g_ring_head, head + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&g_strike_stats.received, 1, __ATOMIC_RELAXED);
+}
+
+// Parses every complete line in buffer and returns the bytes consumed.
+static size_t consume_lines(char *buffer, size_t length, long long received_ms) {
+    char *line = buffer, *end = buffer + length, *newline;
+    while ((newline = memchr(line, '\n', end - line)) != NULL) {
+        *newline = '\0';
+        Strike strike;
+        if (parse_strike(line, received_ms, &strike) == 0) push_strike(&strike);
+        else if (newline > line + 1) __atomic_fetch_add(&g_strike_stats.dropped, 1, __ATOMIC_RELAXED);
+        line = newline + 1;
+    }
+    return line - buffer;
+}
+
+// --- Reader Thread ---
+
+// Reads the feed for the life of the process, reconnecting after drops.
+static void *reader_main(void *arg) {
+    static char buffer[STRIKE_LINE_MAX + 1];
+    for (;;) {
+        int fd = net_connect(g_host, g_port);
+        if (fd >= 0) {
+            __atomic_store_n(&g_strike_stats.connected, 1, __ATOMIC_RELAXED);
+            size_t used = 0;
+            ssize_t n;
+            while ((n = recv(fd, buffer + used, STRIKE_LINE_MAX - used, 0)) > 0) {
+                used += n;
+                size_t consumed = consume_lines(buffer, used, (long long)time(NULL) * 1000);
+                used -= consumed;
+                memmove(buffer, buffer + consumed, used);
+                if (used == STRIKE_LINE_MAX) used = 0; // No newline in a whole buffer: not our feed
+            }
+            close(fd);
+            __atomic_store_n(&g_strike_stats.connected, 0, __ATOMIC_RELAXED);
+        }
+        sleep(STRIKE_RECONNECT_SECONDS);
+    }
+    return NULL;
+}
+
+// Starts reading strikes from a "host:port" feed in the background.
+int strikes_start(const char *address) {
+    if (net_split_address(address, g_host, sizeof(g_host), g_port, sizeof(g_port)) != 0) {
+        fprintf(stderr, "Strike feed must be host:port, got %s\n", address);
+        return -1;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, reader_main, NULL) != 0) return -1;
+    pthread_detach(thread);
+    return 0;
+}
+
+// --- Grid and Sites ---
+
+static int grid_cell(float lat, float lon) {
+    int row = (int)((lat + 90.0f) * STRIKE_GRID_PER_DEGREE);
+    int col = (int)((lon + 180.0f) * STRIKE_GRID_PER_DEGREE);
+    if (row >= GRID_ROWS) row = GRID_ROWS - 1;
+    if (col >= GRID_COLS) col = GRID_COLS - 1;
+    return row * GRID_COLS + col;
+}
+
+// Calls visit for every grid cell within STRIKE_TRACK_KM of the site.
+static void for_each_nearby_cell(int site, void (*visit)(int cell, int site)) {
+    const Site *s = &g_sites[site];
+    double dlat = STRIKE_TRACK_KM / KM_PER_DEG;
+    double cos_lat = cos(s->lat * DEG_TO_RAD);
+    double dlon = cos_lat > 0.01 ? dlat / cos_lat : 180.0;
+    int row_low = (int)floor((s->lat - dlat + 90.0) * STRIKE_GRID_PER_DEGREE);
+    int row_high = (int)floor((s->lat + dlat + 90.0) * STRIKE_GRID_PER_DEGREE);
+    int col_low = (int)floor((s->lon - dlon + 180.0) * STRIKE_GRID_PER_DEGREE);
+    int col_high = (int)floor((s->lon + dlon + 180.0) * STRIKE_GRID_PER_DEGREE);
+    if (col_high - col_low >= GRID_COLS) col_high = col_low + GRID_COLS - 1;
+    for (int row = row_low < 0 ? 0 : row_low; row <= row_high && row < GRID_ROWS; row++) {
+        for (int col = col_low; col <= col_high; col++) visit(row * GRID_COLS + (col % GRID_COLS + GRID_COLS) % GRID_COLS, site);
+    }
+}
+
+static void count_cell(int cell, int site) {
+    g_cell_first[cell + 1]++;
+}
+
+static void fill_cell(int cell, int site) {
+    g_cell_sites[g_cell_first[cell]++] = (uint16_t)site;
+}
+
+// Rebuilds the cell-to-sites rows when sites have been added.
+static int index_sites() {
+    memset(g_cell_first, 0, sizeof(g_cell_first));
+    for (int s = 0; s < g_site_count; s++) for_each_nearby_cell(s, count_cell);
+    for (int c = 0; c < GRID_CELLS; c++) g_cell_first[c + 1] += g_cell_first[c];
+    uint16_t *entries = realloc(g_cell_sites, (g_cell_first[GRID_CELLS] + 1) * sizeof(uint16_t));
+    if (!entries) return -1;
+    g_cell_sites = entries;
+    for (int s = 0; s < g_site_count; s++) for_each_nearby_cell(s, fill_cell);
+    // fill_cell advanced each row start to the next row's; shift them back
+    memmove(g_cell_first + 1, g_cell_first, GRID_CELLS * sizeof(uint32_t));
+    g_cell_first[0] = 0;
+
+    for (int s = g_indexed_sites; s < g_site_count; s++) {
+        memset(&g_site_strikes[s], 0, sizeof(SiteStrikes));
+        for (int b = 0; b < STRIKE_BUCKETS; b++) g_site_strikes[s].epoch[b] = -1;
+        g_site_strikes[s].cos_lat = (float)cos(g_sites[s].lat * DEG_TO_RAD);
+    }
+    g_indexed_sites = g_site_count;
+    return 0;
+}
+
+static void ingest_strike(const Strike *strike) {
+    int cell = grid_cell(strike->lat, strike->lon);
+    uint32_t t = (uint32_t)(strike->time_ms / 1000);
+    if (t >= g_stamp[cell]) {
+        g_density[cell] = g_density[cell] * fast_exp2f(-(float)(t - g_stamp[cell]) / STRIKE_HALF_LIFE_SECONDS) + 1.0f;
+        g_stamp[cell] = t;
+    } else {
+        g_density[cell] += fast_exp2f(-(float)(g_stamp[cell] - t) / STRIKE_HALF_LIFE_SECONDS);
+    }
+
+    long long epoch = strike->time_ms / 1000 / BUCKET_SECONDS;
+    int b = (int)(epoch % STRIKE_BUCKETS);
+    for (uint32_t i = g_cell_first[cell]; i < g_cell_first[cell + 1]; i++) {
+        int site = g_cell_sites[i];
+        SiteStrikes *tracked = &g_site_strikes[site];
+        if (epoch < tracked->epoch[b]) continue; // Older than the bucket now holds
+        float dlon = strike->lon - (float)g_sites[site].lon;
+        if (dlon >= 180.0f) dlon -= 360.0f; // Across the antimeridian, before scaling to km
+        else if (dlon < -180.0f) dlon += 360.0f;
+        float dx = dlon * KM_PER_DEG * tracked->cos_lat;
+        float dy = (strike->lat - (float)g_sites[site].lat) * KM_PER_DEG;
+        float d2 = dx * dx + dy * dy;
+        if (d2 > STRIKE_TRACK_KM * STRIKE_TRACK_KM) continue;
+        float distance = sqrtf(d2);
+        if (epoch > tracked->epoch[b] || distance < tracked->distance_km[b]) {
+            tracked->epoch[b] = epoch;
+            tracked->distance_km[b] = distance;
+            tracked->bearing_deg[b] = (float)fmod(atan2(dx, dy) / DEG_TO_RAD + 360.0, 360.0);
+            tracked->time_ms[b] = strike->time_ms;
+        }
+    }
+}
+
+// Nearest strike to the site within the recent window, if any.
+int strikes_nearest(int site, long long now, StrikeNearest *nearest) {
+    if (site >= g_indexed_sites) return 0;
+    const SiteStrikes *tracked = &g_site_strikes[site];
+    long long current = now / BUCKET_SECONDS;
+    int found = 0;
+    for (int b = 0; b < STRIKE_BUCKETS; b++) {
+        if (tracked->epoch[b] <= current - STRIKE_BUCKETS || tracked->epoch[b] > current) continue;
+        if (!found || tracked->distance_km[b] < nearest->distance_km) {
+            nearest->distance_km = tracked->distance_km[b];
+            nearest->bearing_deg = tracked->bearing_deg[b];
+            nearest->time_ms = tracked->time_ms[b];
+            found = 1;
+        }
+    }
+    return found;
+}
+
+// Strikes in the grid cell containing the point, decayed to now.
+float strikes_density(float lat, float lon, long long now) {
+    int cell = grid_cell(lat, lon);
+    if (g_density[cell] == 0.0f || now <= g_stamp[cell]) return g_density[cell];
+    return g_density[cell] * fast_exp2f(-(float)(now - g_stamp[cell]) / STRIKE_HALF_LIFE_SECONDS);
+}
+
+static int band_of(int site, long long now) {
+    StrikeNearest nearest;
+    if (!strikes_nearest(site, now, &nearest)) return 0;
+    return nearest.distance_km <= STRIKE_WARNING_KM ? 2 : nearest.distance_km <= STRIKE_WATCH_KM ? 1 : 0;
+}
+
+static int drain_ring() {
+    uint64_t tail = g_ring_tail;
+    uint64_t head = __atomic_load_n(&g_ring_head, __ATOMIC_ACQUIRE);
+    for (uint64_t i = tail; i < head; i++) ingest_strike(&g_ring[i & (STRIKE_RING_SIZE - 1)]);
+    __atomic_store_n(&g_ring_tail, head, __ATOMIC_RELEASE);
+    return (int)(head - tail);
+}
+
+// Drains queued strikes into the grid and the per-site nearest strikes.
+// Returns 1 when a site's nearest strike crossed a watch or warning
+// distance, either way, since the last call.
+int strikes_update(long long now) {
+    if (g_indexed_sites != g_site_count && index_sites() != 0) return 0;
+    int drained = drain_ring();
+
+    long long now_ms = now * 1000;
+    if (g_last_update_ms && now_ms > g_last_update_ms) {
+        float rate = drained * 1000.0f / (float)(now_ms - g_last_update_ms);
+        g_strike_stats.rate = g_strike_stats.rate ? 0.7f * g_strike_stats.rate + 0.3f * rate : rate;
+    }
+    g_last_update_ms = now_ms;
+
+    int changed = 0;
+    for (int s = 0; s < g_indexed_sites; s++) {
+        int band = band_of(s, now);
+        if (band != g_site_strikes[s].band) changed = 1;
+        g_site_strikes[s].band = band;
+    }
+    return changed;
+}
+
+// --- Benchmark ---
+
+// Feeds synthetic strike lines over a 20 x 20 degree storm region with a
+// thousand sites in it, through the same parse, queue and ingest path as
+// the socket reader, draining as the main loop would.
+int strikes_benchmark(int strikes) {
+    const int sites = 1000, chunk = 4096;
+    uint64_t state = 12345;
+    while (g_site_count < sites) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        sites_add("bench", 40.0 + (state >> 40) % 2000 / 100.0, (state >> 20) % 2000 / 100.0, DEFAULT_SITE_MMI_THRESHOLD);
+    }
+    long long now = (long long)time(NULL);
+    size_t capacity = (size_t)strikes * 64, length = 0;
+    char *lines = malloc(capacity);
+    if (!lines || index_sites() != 0) return 1;
+    for (int i = 0; i < strikes; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        length += snprintf(lines + length, capacity - length, "{\"time\":%lld,\"lat\":%.4f,\"lon\":%.4f}\n",
+                           (now * 1000 + i / 10) * 1000000LL, 40.0 + (state >> 40) % 200000 / 10000.0,
+                           (state >> 16) % 200000 / 10000.0);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t pos = 0;
+    while (pos < length) {
+        // A chunk of lines at a time, as recv would deliver them
+        size_t end = pos + (size_t)chunk * 60 < length ? pos + (size_t)chunk * 60 : length;
+        while (end < length && lines[end - 1] != '\n') end++;
+        pos += consume_lines(lines + pos, end - pos, now * 1000);
+        drain_ring();
+    }
+    double us = elapsed_us(&start);
+
+    int near = 0;
+    for (int s = 0; s < sites; s++) near += band_of(s, now) > 0;
+    printf("Strike ingest benchmark: %d strikes, %d sites\n\n", strikes, sites);
+    printf("Parse, queue and ingest:  %8.1f ns/strike (%.0f strikes/s)\n", us * 1e3 / strikes, strikes / us * 1e6);
+    printf("Sites with a strike within %.0f km: %d, dropped %llu\n", STRIKE_WATCH_KM, near,
+           (unsigned long long)g_strike_stats.dropped);
+    printf("Fixed memory:             %8.1f MB\n",
+           (sizeof(g_ring) + sizeof(g_density) + sizeof(g_stamp) + sizeof(g_cell_first) + sizeof(g_site_strikes)) / 1e6);
+    free(lines);
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * strikes.h - Live lightning strike stream
+ *
+ * A reader thread takes newline-delimited JSON strikes from a TCP feed
+ * ({"time":..,"lat":..,"lon":..}, time in s, ms or ns) and queues them in
+ * a fixed ring. The main loop drains the ring into a time-decayed density
+ * grid and the nearest recent strike to each site. Memory is fixed however
+ * fast strikes arrive; a full ring drops and counts the excess.
+ */
+
+#ifndef STRIKES_H
+#define STRIKES_H
+
+#include <stdint.h>
+#include "sites.h"
+
+#define STRIKE_RING_SIZE 65536 // Power of two
+#define STRIKE_GRID_PER_DEGREE 2 // Density cells of 0.5 degrees
+#define STRIKE_HALF_LIFE_SECONDS 600.0f // Density halves every 10 minutes
+#define STRIKE_TRACK_KM 100.0f          // Strikes farther from every site only feed the grid
+#define STRIKE_WINDOW_SECONDS 900       // A strike counts as recent for 15 minutes
+#define STRIKE_WARNING_KM 10.0f         // Storm overhead: the next strike could be here
+#define STRIKE_WATCH_KM 30.0f
+
+typedef struct {
+    long long time_ms;
+    float lat;
+    float lon;
+} Strike;
+
+typedef struct {
+    float distance_km;
+    float bearing_deg;
+    long long time_ms;
+} StrikeNearest;
+
+typedef struct {
+    int connected;
+    uint64_t received;
+    uint64_t dropped; // Ring full, or line unparsable
+    float rate;       // Strikes per second, smoothed
+} StrikeStats;
+
+extern StrikeStats g_strike_stats;
+
+int strikes_start(const char *address);
+int strikes_update(long long now);
+int strikes_nearest(int site, long long now, StrikeNearest *nearest);
+float strikes_density(float lat, float lon, long long now);
+int strikes_benchmark(int strikes);
+
+#endif // STRIKES_H
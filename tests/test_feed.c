@@ -0,0 +1,123 @@
+/*
+ * test_feed.c - Checks that a feed response shaped like the real USGS
+ * GeoJSON summary, with each event's id on the feature rather than in its
+ * properties, reaches both the history and the live list, and goes out
+ * over the event relay to a monitor following it.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../monitor.h"
+#include "../quakes.h"
+#include "../catalog.h"
+#include "../relay.h"
+
+#define FEED_EVENTS 3
+#define RELAY_WAIT_MS 5000
+
+// The settings main.c parses, at their defaults; one-shot keeps the bell quiet
+double g_exposure_alert_threshold = 0.0;
+const char *g_feed = "hour";
+const char *g_history_view = NULL;
+const char *g_place_query = NULL;
+const char *g_arrow_path = NULL;
+const char *g_strike_feed = NULL;
+int g_shake_port = 0;
+int g_interactive = 0;
+int g_once = 1;
+int g_proxy_port = 0;
+int g_relay_port = 0;
+const char *g_relay_source = NULL;
+int g_local_workers = 0;
+const char *g_remote_workers[SHARD_MAX_WORKERS];
+int g_remote_worker_count = 0;
+
+void export_history(int snapshot) {
+}
+
+// Trimmed from a real all_hour response, newest first, times relative to now_ms
+static const char FEED_FORMAT[] =
+    "{\"type\":\"FeatureCollection\",\"metadata\":{\"generated\":%lld,"
+    "\"url\":\"https://earthquake.usgs.gov/earthquakes/feed/v1.0/summary/all_hour.geojson\","
+    "\"title\":\"USGS All Earthquakes, Past Hour\",\"status\":200,\"api\":\"1.14.1\",\"count\":3},\"features\":["
+    "{\"type\":\"Feature\",\"properties\":{\"mag\":4.6,\"place\":\"112 km SSE of Sand Point, Alaska\",\"time\":%lld,"
+    "\"updated\":%lld,\"tz\":null,\"felt\":null,\"cdi\":null,\"mmi\":null,\"alert\":null,\"status\":\"reviewed\","
+    "\"tsunami\":0,\"sig\":326,\"net\":\"us\",\"code\":\"7000abcd\",\"ids\":\",us7000abcd,ak0241xyz,\","
+    "\"sources\":\",us,ak,\",\"types\":\",origin,phase-data,\",\"magType\":\"mb\",\"type\":\"earthquake\","
+    "\"title\":\"M 4.6 - 112 km SSE of Sand Point, Alaska\"},"
+    "\"geometry\":{\"type\":\"Point\",\"coordinates\":[-159.9,54.4,24.5]},\"id\":\"us7000abcd\"},"
+    "{\"type\":\"Feature\",\"properties\":{\"mag\":1.72,\"place\":\"5 km NW of The Geysers, CA\",\"time\":%lld,"
+    "\"updated\":%lld,\"tz\":null,\"status\":\"automatic\",\"tsunami\":0,\"sig\":45,\"net\":\"nc\",\"code\":\"75012345\","
+    "\"ids\":\",nc75012345,\",\"sources\":\",nc,\",\"magType\":\"md\",\"type\":\"earthquake\","
+    "\"title\":\"M 1.7 - 5 km NW of The Geysers, CA\"},"
+    "\"geometry\":{\"type\":\"Point\",\"coordinates\":[-122.8,38.8,2.1]},\"id\":\"nc75012345\"},"
+    "{\"type\":\"Feature\",\"properties\":{\"mag\":2.1,\"place\":\"8 km E of Pahala, Hawaii\",\"time\":%lld,"
+    "\"updated\":%lld,\"tz\":null,\"status\":\"automatic\",\"tsunami\":0,\"sig\":68,\"net\":\"hv\",\"code\":\"74400001\","
+    "\"ids\":\",hv74400001,\",\"sources\":\",hv,\",\"magType\":\"ml\",\"type\":\"earthquake\","
+    "\"title\":\"M 2.1 - 8 km E of Pahala, Hawaii\"},"
+    "\"geometry\":{\"type\":\"Point\",\"coordinates\":[-155.4,19.2,31.9]},\"id\":\"hv74400001\"}"
+    "],\"bbox\":[-159.9,19.2,2.1,-122.8,54.4,31.9]}";
+
+static int g_relayed = 0;
+
+static void count_delta(const RelayDelta *delta) {
+    if (delta->event.id[0]) g_relayed++;
+}
+
+// Follows the relay this process serves until the cycle the feed went
+// out in has ended, and checks every event came with it.
+static int test_relay(int port) {
+    char address[32];
+    int cycles = 0;
+    snprintf(address, sizeof(address), "127.0.0.1:%d", port);
+    if (relay_join(address) != 0) return 1;
+    for (int waited = 0; cycles == 0 && waited < RELAY_WAIT_MS; waited++) {
+        cycles = relay_apply(count_delta);
+        usleep(1000);
+    }
+    if (cycles == 0 || g_relayed != FEED_EVENTS) {
+        printf("FAIL relay sent %d events in %d cycles, want %d in one\n", g_relayed, cycles, FEED_EVENTS);
+        return 1;
+    }
+    printf("Relay: %d events published, %d received\n", (int)g_relay_stats.published, g_relayed);
+    return 0;
+}
+
+int main() {
+    static char body[sizeof(FEED_FORMAT) + 256];
+    long long now_ms = (long long)time(NULL) * 1000;
+    int failures = 0;
+    if (catalog_init(1000) != 0) return 1;
+    g_relay_port = relay_serve(0);
+    if (g_relay_port < 0) return 1;
+    snprintf(body, sizeof(body), FEED_FORMAT, now_ms, now_ms - 60000, now_ms - 30000, now_ms - 900000, now_ms - 800000,
+             now_ms - 1800000, now_ms - 1700000);
+
+    process_seismic_data(body, now_ms, 0.0f, 10.0f);
+    relay_end_cycle(now_ms);
+    if (catalog_size() != FEED_EVENTS) {
+        printf("FAIL %llu events in the history, want %d\n", (unsigned long long)catalog_size(), FEED_EVENTS);
+        failures++;
+    }
+    if (g_quake_count != FEED_EVENTS) {
+        printf("FAIL %d events in the live list, want %d\n", g_quake_count, FEED_EVENTS);
+        failures++;
+    }
+    for (int i = 0; i < g_quake_count; i++) {
+        if (g_quakes[i].id[0] == '\0' || g_quakes[i].seq == CATALOG_NO_SEQ) {
+            printf("FAIL live event %d (%s) has no id or history row\n", i, g_quakes[i].place);
+            failures++;
+        }
+    }
+    if (g_quake_count > 0 && strcmp(g_quakes[0].id, "us7000abcd") != 0) {
+        printf("FAIL newest event has id \"%s\", want \"us7000abcd\"\n", g_quakes[0].id);
+        failures++;
+    }
+    printf("Feed: %d events in the history, %d listed\n", (int)catalog_size(), g_quake_count);
+    failures += test_relay(g_relay_port);
+    if (failures) printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * test_gmpe.c - Checks the fast log10 and the intensity equation built on
+ * it against libm, over the distances the ground-motion model sees.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <math.h>
+#include "../gmpe.h"
+#include "../fastmath.h"
+
+#define MIN_R_KM 14.0    // AW07_H: R never gets closer than the depth term
+#define MAX_R_KM 13500.0 // Antipodal, at the deepest events
+#define LOG10_TOLERANCE 1e-3
+#define MMI_TOLERANCE 0.02
+
+static int failures = 0;
+
+static void check(int ok, const char *what, double got, double want) {
+    if (ok) return;
+    printf("FAIL %s: got %.6f, want %.6f\n", what, got, want);
+    failures++;
+}
+
+// Atkinson & Wald (2007) in double precision with libm's log10
+static double reference_mmi(double mag, double hypo_km) {
+    double R = sqrt(hypo_km * hypo_km + 14.0 * 14.0);
+    double log_r = log10(R), m6 = mag - 6.0;
+    double b = fmax(0.0, log10(R / 30.0));
+    double value = 12.27 + 2.270 * m6 + 0.1304 * m6 * m6 - 1.30 * log_r - 0.0007070 * R + 1.95 * b - 0.577 * mag * log_r;
+    return fmin(10.0, fmax(1.0, value));
+}
+
+static void test_log10() {
+    double worst = 0;
+    for (int n = 0; n <= 100000; n++) {
+        float r = (float)(MIN_R_KM * pow(MAX_R_KM / MIN_R_KM, n / 100000.0));
+        double error = fabs((double)fast_log10f(r) - log10f(r));
+        if (error > worst) worst = error;
+        if (error > LOG10_TOLERANCE) {
+            char what[64];
+            snprintf(what, sizeof(what), "fast_log10f(%.3f)", r);
+            check(0, what, fast_log10f(r), log10f(r));
+            return;
+        }
+    }
+    printf("fast_log10f: worst error %.2e over %.0f..%.0f km\n", worst, MIN_R_KM, MAX_R_KM);
+}
+
+static void test_intensity() {
+    static const double mags[] = { 3.0, 5.0, 6.5, 8.0 };
+    static const double depths[] = { 0.0, 10.0, 100.0, 600.0 };
+    QuakeColumns cols = { 0 };
+    float mmi[64], dist[64];
+    double worst = 0;
+    for (int m = 0; m < 4; m++) {
+        for (int d = 0; d < 4; d++) {
+            quake_columns_clear(&cols);
+            for (int k = 0; k < 60; k++) quake_columns_push(&cols, mags[m], depths[d], 0.0, k * 3.0); // Out to 177 degrees
+            gmpe_evaluate_site(&cols, 0.0, 0.0, mmi, dist);
+            for (int k = 0; k < 60; k++) {
+                double want = reference_mmi(mags[m], dist[k]);
+                double error = fabs(mmi[k] - want);
+                if (error > worst) worst = error;
+                char what[96];
+                snprintf(what, sizeof(what), "MMI for M%.1f at %.0f km depth, %.0f km", mags[m], depths[d], dist[k]);
+                check(error <= MMI_TOLERANCE, what, mmi[k], want);
+            }
+        }
+    }
+    quake_columns_free(&cols);
+    printf("AW07 intensity: worst error %.4f MMI\n", worst);
+}
+
+int main() {
+    test_log10();
+    test_intensity();
+    if (failures) printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * test_lightning.c - Checks that a full site list gets every site its own
+ * forecast cell, even when every site's sampling rings are distinct, and
+ * that an error response leaves a cell's cached forecast in place.
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include "../lightning.h"
+
+#define SPACING_DEGREES 1.2 // Wider than a ring's diameter, so no two sites share a cell
+
+static int test_error_response(int cell) {
+    static const char forecast[] = "{\"current\":{\"time\":0,\"weather_code\":1},\"hourly\":{\"time\":[0,3600],"
+                                   "\"weather_code\":[95,1],\"lightning_potential\":[0,0],\"cape\":[0,0],\"precipitation\":[0,0]}}";
+    static const char error[] = "{\"error\":true,\"reason\":\"Cannot initialize WeatherVariable from invalid String value\"}";
+    if (lightning_parse(forecast, sizeof(forecast) - 1, &cell, 1, 0) != 0 || !g_lightning_cells[cell].series.valid) {
+        printf("FAIL forecast for cell %d not stored\n", cell);
+        return 1;
+    }
+    LightningCell cached = g_lightning_cells[cell];
+    int result = lightning_parse(error, sizeof(error) - 1, &cell, 1, 0);
+    const LightningCell *after = &g_lightning_cells[cell];
+    if (result == 0 || !after->series.valid || after->series.run != cached.series.run || after->expires != cached.expires) {
+        printf("FAIL error response replaced the cached forecast for cell %d\n", cell);
+        return 1;
+    }
+    printf("Error response: cached forecast kept\n");
+    return 0;
+}
+
+int main() {
+    int failures = 0;
+    int *stale = malloc(LIGHTNING_MAX_CELLS * sizeof(int));
+    if (!stale) return 1;
+    for (int n = 0; n < MAX_SITES; n++) {
+        sites_add("test", -38.0 + (n / 64) * SPACING_DEGREES, -38.0 + (n % 64) * SPACING_DEGREES, DEFAULT_SITE_MMI_THRESHOLD);
+    }
+    if (g_site_count != MAX_SITES) {
+        printf("FAIL only %d of %d sites added\n", g_site_count, MAX_SITES);
+        return 1;
+    }
+
+    int count = lightning_begin_update(0, stale, LIGHTNING_MAX_CELLS), site_cells = 0;
+    for (int s = 0; s < MAX_SITES; s++) {
+        int cell = g_lightning_site_cell[s];
+        if (cell < 0 || !g_lightning_cells[cell].has_site) {
+            if (failures++ < 5) printf("FAIL site %d (%.1f, %.1f) has no forecast cell\n", s, g_sites[s].lat, g_sites[s].lon);
+        }
+    }
+    for (int i = 0; i < count; i++) site_cells += g_lightning_cells[stale[i]].has_site;
+    if (site_cells != MAX_SITES) {
+        printf("FAIL %d site cells listed stale, want %d\n", site_cells, MAX_SITES);
+        failures++;
+    }
+    printf("Cells: %d sites mapped to %d cells of %d\n", MAX_SITES, g_lightning_cell_count, LIGHTNING_MAX_CELLS);
+    failures += test_error_response(g_lightning_site_cell[0]);
+    if (failures) printf("%d checks failed\n", failures);
+    free(stale);
+    return failures ? 1 : 0;
+}
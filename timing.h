@@ -0,0 +1,17 @@
+/*
+ * timing.h - Monotonic elapsed time, for benchmarks and deadlines
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <time.h>
+
+// Microseconds since start, on CLOCK_MONOTONIC
+static inline double elapsed_us(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+#endif // TIMING_H
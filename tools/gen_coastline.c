@@ -0,0 +1,243 @@
+/*
+ * gen_coastline.c - Build-time generator for the map's coastline rasters
+ *
+ * Draws coastlines onto a braille dot grid at every map zoom level and
+ * writes the finished cells to stdout as a C header, so map.c only crops
+ * and copies at runtime. Each cell is one byte: the eight dots of a 2 x 4
+ * braille character, bit for bit as in U+2800.
+ *
+ * The built-in outlines are coarse (a degree or two), enough to place an
+ * event on a continent. For real coastlines, pass a file of "lon lat"
+ * lines with segments separated by '>' or blank lines, the GMT
+ * multi-segment format (gmt coast -W -M, or ogr2ogr -f GMT).
+ *
+ * Usage: gen_coastline [coastline file] > coastline_grid.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../map.h"
+
+#define BREAK { 999, 999 } // Ends one line
+
+// Closed outlines repeat their first point; Antarctica is left open at
+// the antimeridian.
+static const float OUTLINES[][2] = {
+    // North America
+    {-168,66}, {-162,70}, {-156,71.3}, {-141,69.6}, {-128,70}, {-115,68.5}, {-95,68}, {-85,69.5}, {-82,66},
+    {-87,64}, {-93,61}, {-94,58.8}, {-88,56.5}, {-82,55}, {-79,51.5}, {-77,56}, {-78,60}, {-73,62}, {-65,60},
+    {-62,57}, {-56,52}, {-60,50}, {-65,49}, {-64,47}, {-60,46}, {-66,44.5}, {-70,43.5}, {-70,41.7}, {-74,40.5},
+    {-76,38}, {-75.5,35.2}, {-78,33.8}, {-81,31.5}, {-80,27}, {-80.4,25.2}, {-82,26.5}, {-83,29.5}, {-85,30},
+    {-89,30.2}, {-94,29.6}, {-97.2,27.8}, {-97.5,24}, {-97.8,22}, {-96,19}, {-94,18.3}, {-91,18.8}, {-90.4,21},
+    {-87,21.5}, {-88,18}, {-88.5,15.8}, {-84,15.8}, {-83.5,12}, {-83.7,10.8}, {-81.5,9}, {-79.5,9.5}, {-77.5,8.6},
+    {-78,7}, {-80,7.5}, {-81,8}, {-83.5,8.5}, {-85.7,10}, {-87.5,13}, {-91,13.8}, {-94,16}, {-96.5,15.7},
+    {-101,17.3}, {-105.5,20}, {-105,22.5}, {-109,25.5}, {-112.5,29.5}, {-114.8,31.5}, {-113,29}, {-110,24},
+    {-109.5,23}, {-112,24.8}, {-114,28}, {-115.8,30}, {-117,32.5}, {-120.5,34.5}, {-122.5,37.5}, {-124,40.5},
+    {-124.5,43}, {-124,46.5}, {-124.7,48.4}, {-123,49}, {-127,51}, {-130.5,54.5}, {-133,57}, {-136.5,58.5},
+    {-140,59.8}, {-146,60.8}, {-150,59.6}, {-152,58.8}, {-156,57.5}, {-162,55}, {-158,58.5}, {-162,58.6},
+    {-164.5,60.5}, {-166,61.5}, {-164.8,63.2}, {-161,64.5}, {-166,64.7}, {-168,66}, BREAK,
+    // Greenland, Baffin, Ellesmere and Victoria Islands
+    {-73,78}, {-66,81}, {-45,82.5}, {-22,82}, {-18,79}, {-20,75}, {-22,70.5}, {-26,68.5}, {-32,68}, {-40,65},
+    {-43,60}, {-48,61}, {-51,64}, {-53,67}, {-55,70.5}, {-58,75.5}, {-66,76.5}, {-73,78}, BREAK,
+    {-80,73.5}, {-72,71.5}, {-68,70.5}, {-62,66.5}, {-65,62.5}, {-72,63}, {-78,64.5}, {-74,67}, {-82,69.5},
+    {-89,71.5}, {-80,73.5}, BREAK,
+    {-80,77}, {-90,80}, {-70,83}, {-62,82}, {-75,79}, {-80,77}, BREAK,
+    {-118,71}, {-105,73.5}, {-101,69.5}, {-113,68.5}, {-118,71}, BREAK,
+    // Caribbean
+    {-85,21.9}, {-82,23.1}, {-77.2,22}, {-74.2,20.2}, {-77.5,19.9}, {-78.7,21.6}, {-81.8,22.1}, {-85,21.9}, BREAK,
+    {-74.4,18.5}, {-72.8,19.9}, {-69.9,19.7}, {-68.4,18.6}, {-71.4,17.6}, {-74.4,18.5}, BREAK,
+    // South America
+    {-77.5,8.6}, {-75.5,10.5}, {-72,11.8}, {-71.5,12.4}, {-68,10.5}, {-62,10.7}, {-60,8.5}, {-57,6}, {-52,5},
+    {-51,4}, {-50,1.8}, {-48,-1}, {-44,-2.5}, {-40,-2.8}, {-35.2,-5.5}, {-35,-9}, {-37,-12}, {-39,-15},
+    {-39.5,-18}, {-41,-22}, {-44,-23}, {-48,-26}, {-48.8,-28.5}, {-51,-31}, {-53,-34}, {-56.5,-35}, {-57.5,-38},
+    {-62,-39}, {-65,-41}, {-65,-45}, {-67.5,-46.5}, {-66,-48}, {-69,-51}, {-68.5,-52.5}, {-70,-55}, {-74,-53},
+    {-75.5,-49}, {-74,-45}, {-73.5,-41}, {-73.5,-37}, {-71.5,-32}, {-71.5,-28}, {-70.5,-23}, {-70.2,-18.5},
+    {-75,-15.5}, {-77,-12}, {-79.5,-8}, {-81.2,-5}, {-80,-2}, {-80.5,0}, {-79,1.5}, {-77.5,4}, {-77.3,6.5},
+    {-77.5,8.6}, BREAK,
+    // Iceland, Britain and Ireland
+    {-22.5,64}, {-24,65.5}, {-22,66.4}, {-16,66.5}, {-13.5,65.2}, {-15,64.2}, {-18.5,63.4}, {-22.5,64}, BREAK,
+    {-5.7,50}, {1.4,51.2}, {1.7,52.7}, {0.3,53.5}, {-1.6,55.6}, {-2,57.6}, {-3.3,58.6}, {-5,58.6}, {-6.2,56.8},
+    {-5.5,55.3}, {-3,54.8}, {-3.1,53.4}, {-4.6,53.2}, {-4.2,52}, {-5.2,51.7}, {-3,51.4}, {-5.7,50}, BREAK,
+    {-6,52.2}, {-6,54}, {-7.3,55.3}, {-8.5,54.5}, {-10,53.7}, {-9.6,52}, {-8,51.6}, {-6,52.2}, BREAK,
+    // Eurasia, from Portugal up round Scandinavia and Siberia, down the
+    // Pacific and Indian Ocean coasts and back through the Mediterranean
+    {-9,37}, {-9.5,39.5}, {-8.8,42.5}, {-8,43.7}, {-2,43.4}, {-1.5,46}, {-4.5,48}, {-1.5,48.7}, {1.5,50.5},
+    {4,51.5}, {5,53.2}, {8.5,53.8}, {8.5,57}, {10.5,57.7}, {10.5,54.5}, {14,54}, {19,54.4}, {21,55.5},
+    {21.5,57.5}, {24,57.2}, {24,59.5}, {29.5,60}, {22.5,60.2}, {21.5,61.5}, {21.5,63.5}, {25.5,65.2},
+    {22.5,65.8}, {21,64.3}, {17.5,62.5}, {19,60}, {16.5,57}, {14,55.5}, {12.5,56.5}, {11,58.8}, {8,58},
+    {5.5,58.8}, {5,62}, {8,63.5}, {12.5,66}, {15,68.5}, {19,70}, {24,71}, {29,70.8}, {33,69.5}, {40,67.5},
+    {41,66.3}, {34.5,64.5}, {37,63.8}, {44,65.8}, {43.5,68.5}, {53,68.7}, {58,68.5}, {60,69.8}, {66,69.5},
+    {68.5,72.8}, {73,72.5}, {72,66.5}, {77,72.5}, {82,73.5}, {87,74.8}, {99,76}, {105,77.7}, {112,76.5},
+    {113,73.8}, {127,73.5}, {132,71.5}, {140,72.5}, {150,71.5}, {160,69.7}, {170,70}, {176,69.8}, {180,69},
+    BREAK,
+    {-180,69}, {-175,67.5}, {-171,66.5}, {-174,64.5}, {-178,64.5}, {-180,65.5}, BREAK,
+    {180,65.5}, {178,64.5}, {178.5,62.5}, {173,61.5}, {170,60}, {163.5,59.8}, {162,58}, {163,56}, {156.7,51},
+    {156,57}, {160,61.5}, {155,59.3}, {150,59.6}, {143,59.3}, {138,54}, {141,53}, {140.5,48}, {135,43.5},
+    {131,42.5}, {129.5,40.5}, {128,38.5}, {129.3,35.5}, {126.5,34.5}, {126,37.5}, {125,39.5}, {121.5,39},
+    {122,40.5}, {117.8,39}, {119,37}, {122.5,37}, {120.5,36}, {119.5,35}, {121,32.5}, {122,30}, {120,26},
+    {117,23.5}, {113.5,22.3}, {110.5,21}, {108.5,21.5}, {106.6,20.2}, {105.7,18.5}, {109,13}, {109.2,11.5},
+    {105,8.6}, {104.8,10.5}, {102.5,12}, {100.5,13.5}, {100,10}, {99.2,8}, {100.5,6.5}, {103.2,5}, {104.2,1.5},
+    {103.4,1.3}, {101.3,2.8}, {100.3,5.5}, {98.5,8}, {98.2,10}, {97.7,16.5}, {94.2,16}, {94.2,18.8},
+    {92.3,20.8}, {91.8,22.5}, {88.5,21.5}, {86.9,20.6}, {85,19.5}, {82.3,16.6}, {80.3,15.5}, {80,11},
+    {79.8,10.3}, {78,8.3}, {76.5,8.9}, {74.8,12.8}, {73.5,16}, {72.8,19}, {72.7,21.5}, {70,22.8}, {68.2,23.7},
+    {66.6,25.4}, {62,25.2}, {57.5,25.7}, {56.3,27.2}, {54,26.6}, {51.3,27.9}, {49,30}, {48,30}, {48.9,27.6},
+    {50.5,25.7}, {51.5,24}, {54.5,24.3}, {56.3,26.2}, {57,23.5}, {59.8,22.4}, {58.5,20.5}, {55.5,17.8},
+    {52,16}, {45,12.8}, {43.3,13}, {42.5,16}, {39,21.5}, {38.5,24}, {36,27.5}, {34.6,28.2}, {34.2,31.2},
+    {35.5,33.8}, {36,36}, {32.5,36.2}, {30,36.3}, {27.3,37}, {26.5,39.5}, {26.2,40.4}, {24,40.8}, {22.8,40.5},
+    {23.9,38.2}, {22.5,36.5}, {21.5,37.8}, {20.5,39.5}, {19.5,41.8}, {18.5,42.5}, {15.7,44}, {13.7,45.6},
+    {12.3,45.3}, {12.5,44.2}, {14,42.5}, {16,41.4}, {18.5,40.2}, {16.5,38.5}, {15.6,38}, {16,39.6}, {15,40.2},
+    {12.5,41.3}, {10.5,42.9}, {8.8,44.4}, {7,43.6}, {4.5,43.4}, {3,42.5}, {3.2,41.9}, {0.9,41}, {-0.3,39.5},
+    {0.2,38.7}, {-0.7,37.6}, {-2,36.7}, {-4.5,36.6}, {-5.6,36}, {-6.5,36.9}, {-7.5,37.2}, {-9,37}, BREAK,
+    // Black and Caspian Seas, Sicily, Novaya Zemlya, Sri Lanka
+    {28,41.2}, {28,43.5}, {29.7,45.3}, {31,46.6}, {33.5,46}, {35.5,45.3}, {37.5,47}, {38.3,46.6}, {37.5,44.7},
+    {40,43.4}, {41.6,41.6}, {39,41}, {36,41.7}, {34,42}, {31,41.2}, {28,41.2}, BREAK,
+    {47,44.5}, {50,46.8}, {53,46.7}, {53.2,45}, {51.5,44.3}, {52.8,42}, {53,40}, {54,37.4}, {51,36.7}, {49,38},
+    {49.5,40.3}, {48,42}, {47,44.5}, BREAK,
+    {12.4,38}, {15.6,38.3}, {15.1,36.7}, {12.4,38}, BREAK,
+    {52,71.5}, {56,75}, {68,77}, {58,70.5}, {52,71.5}, BREAK,
+    {79.9,9.8}, {81.4,8.5}, {81.8,7}, {80.6,5.9}, {79.8,6.5}, {79.9,9.8}, BREAK,
+    // Africa and Madagascar
+    {-6,35.8}, {-1,35.5}, {3,36.8}, {10,37.2}, {11,33.5}, {15,32}, {19.5,30.5}, {20,32.5}, {25,32}, {29,31},
+    {32.3,31.2}, {34,27.5}, {35.5,23.5}, {37.5,18.5}, {39.5,15.5}, {43.2,12.5}, {45,10.5}, {51,11.8}, {51,10},
+    {48,4.5}, {42,-1}, {40.2,-3}, {39.5,-6.5}, {40.5,-10.5}, {40.7,-15}, {35.5,-22.5}, {32.8,-26}, {31,-29.5},
+    {27.5,-33.5}, {22,-34.3}, {18.5,-34.2}, {18,-31.5}, {15.5,-27}, {14.5,-22.5}, {11.8,-17}, {13.5,-11.5},
+    {12.3,-6}, {9.5,-2}, {9.8,3}, {8.5,4.5}, {5.5,4.4}, {2,6.3}, {-3,5}, {-7.5,4.4}, {-12,7}, {-13.5,9.5},
+    {-15,11}, {-16.8,13}, {-17.5,14.7}, {-16.5,19.5}, {-17,21}, {-15,24.5}, {-13,27.5}, {-9.8,29.5},
+    {-9.5,32.5}, {-6,35.8}, BREAK,
+    {49.5,-12}, {50.5,-15.5}, {47.5,-24.5}, {45,-25.5}, {43.5,-22}, {44,-17}, {47,-15.5}, {49.5,-12}, BREAK,
+    // Japan, Sakhalin, Taiwan, the Philippines
+    {130.9,34}, {132,35.4}, {135.5,35.6}, {136.8,37.2}, {139.5,38.5}, {140,40.5}, {141.5,41.4}, {142,39.5},
+    {141,38}, {140.8,35.7}, {139.8,35}, {138.5,34.6}, {137,34.6}, {135.1,33.8}, {133,33.9}, {131.7,34.1},
+    {130.9,34}, BREAK,
+    {129.7,33.4}, {131,33.9}, {131.8,32.6}, {130.7,31}, {130.2,31.4}, {129.7,33.4}, BREAK,
+    {140,41.5}, {139.8,42.6}, {141.5,45.4}, {143,44.3}, {145.5,43.3}, {143.3,42}, {141,41.8}, {140,41.5}, BREAK,
+    {142,46}, {142.5,54.3}, {143.3,52}, {144,49}, {142,46}, BREAK,
+    {120.1,23}, {121,25.2}, {122,25}, {121,22}, {120.1,23}, BREAK,
+    {120,16}, {120.6,18.5}, {122.2,18.5}, {122.3,16.2}, {124,13}, {121.8,13.8}, {120.6,14.3}, {120,16}, BREAK,
+    {122,7}, {123.6,8.7}, {126.5,9.2}, {126.5,6.3}, {125.3,5.7}, {124,6.5}, {122,7}, BREAK,
+    // Indonesia and New Guinea
+    {109,1.5}, {110,-1.8}, {111.8,-3.5}, {114.5,-4}, {116.5,-3.2}, {118,1}, {119,5}, {117,7}, {115.5,5.2},
+    {113,3.2}, {111,1.8}, {109,1.5}, BREAK,
+    {95.3,5.6}, {97.5,5.2}, {100.3,2.5}, {103.8,-1}, {106,-3.2}, {105.8,-5.8}, {104.5,-5.9}, {102,-4},
+    {100.3,-1}, {98.6,1.7}, {95.3,5.6}, BREAK,
+    {105.2,-6.8}, {106,-6}, {108.5,-6.4}, {111,-6.4}, {112.7,-6.9}, {114.5,-7.8}, {114.4,-8.7}, {111,-8.2},
+    {108,-7.8}, {105.2,-6.8}, BREAK,
+    {119.5,-5.5}, {119,-3.5}, {119.8,0}, {120.8,1.3}, {124.5,1.5}, {125,1.4}, {121,0.5}, {120.3,-1},
+    {121.5,-1.9}, {123.2,-4.8}, {122,-4.7}, {120.5,-2.8}, {120.4,-5.5}, {119.5,-5.5}, BREAK,
+    {131,-1.2}, {134,-0.9}, {136.3,-2.2}, {138,-1.6}, {141,-2.6}, {144.5,-3.8}, {146,-5.5}, {147.8,-6.2},
+    {147.5,-8}, {150.5,-10.3}, {148,-10.2}, {146,-8.1}, {143.6,-9.3}, {141,-9.2}, {139,-8.1}, {138,-8.4},
+    {137.5,-7.5}, {138.5,-6.9}, {137.5,-5}, {135,-4.5}, {132.5,-4}, {132,-2.8}, {131,-1.2}, BREAK,
+    // Australia and New Zealand
+    {113.5,-22}, {114,-26.5}, {115,-30}, {115,-34}, {117.8,-35}, {123.5,-33.9}, {126,-32.3}, {131,-31.5},
+    {135,-34.6}, {137.8,-32.6}, {137.5,-35.5}, {140,-37.5}, {143.5,-38.8}, {146.3,-39}, {150,-37.5},
+    {150.8,-34.5}, {153,-31}, {153.6,-28}, {153,-25}, {150.8,-22.5}, {149,-20.5}, {146.2,-18.5}, {145.4,-15},
+    {143.5,-14}, {142.5,-10.8}, {141.5,-13}, {141.6,-17}, {140,-17.7}, {137.5,-16}, {135.6,-14.8},
+    {136.8,-12.3}, {132.6,-11.5}, {130.2,-12.8}, {129.5,-15}, {127.5,-14}, {125,-14.7}, {123.5,-17},
+    {122.2,-18}, {119.8,-20}, {116.8,-20.6}, {113.5,-22}, BREAK,
+    {144.6,-40.7}, {148.3,-40.9}, {148,-43.2}, {146.5,-43.6}, {145.2,-42.2}, {144.6,-40.7}, BREAK,
+    {172.7,-34.4}, {174.6,-36}, {175.9,-37.6}, {178.5,-37.7}, {177,-39.3}, {176.8,-40.4}, {175.2,-41.6},
+    {174.6,-39.8}, {173.8,-39.2}, {174.6,-37.5}, {172.7,-34.4}, BREAK,
+    {172.6,-40.5}, {174.3,-41.7}, {173,-43.8}, {171.2,-44.4}, {169,-46.6}, {166.5,-46}, {166.7,-45},
+    {168.3,-44}, {170.5,-43}, {172.6,-40.5}, BREAK,
+    // Antarctica
+    {-180,-78.5}, {-160,-77.5}, {-150,-76}, {-135,-74.5}, {-120,-73.8}, {-100,-73}, {-85,-73}, {-75,-71},
+    {-68,-67}, {-58,-63.5}, {-60,-66}, {-62,-70}, {-60,-75}, {-45,-78}, {-30,-77}, {-20,-73.5}, {-10,-71},
+    {0,-70}, {20,-70}, {40,-69}, {55,-66.5}, {70,-68}, {80,-67.5}, {95,-66.5}, {110,-66}, {130,-66.3},
+    {145,-67}, {160,-70}, {170,-72}, {165,-78}, {180,-78.5}, BREAK,
+};
+
+static unsigned char *g_cells[MAP_ZOOM_LEVELS];
+
+// Sets one dot, wrapping in longitude.
+static void plot(int level, int x, int y) {
+    static const unsigned char bits[4][2] = { { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 } };
+    int cols = MAP_BASE_COLS << level, rows = MAP_BASE_ROWS << level;
+    x = ((x % (cols * 2)) + cols * 2) % (cols * 2);
+    if (y < 0 || y >= rows * 4) return;
+    g_cells[level][(y / 4) * cols + x / 2] |= bits[y % 4][x % 2];
+}
+
+// Draws a segment at every level, stepping under half a dot at a time.
+static void segment(double lon1, double lat1, double lon2, double lat2) {
+    if (fabs(lon2 - lon1) > 180.0) return; // Crosses the antimeridian: a seam in the data, not a coast
+    for (int level = 0; level < MAP_ZOOM_LEVELS; level++) {
+        double scale = (MAP_BASE_COLS << level) * 2 / 360.0; // Dots per degree, the same both ways
+        double x1 = (lon1 + 180.0) * scale, y1 = (90.0 - lat1) * scale;
+        double x2 = (lon2 + 180.0) * scale, y2 = (90.0 - lat2) * scale;
+        int steps = (int)ceil(fmax(fabs(x2 - x1), fabs(y2 - y1)) * 2.0) + 1;
+        for (int s = 0; s <= steps; s++) {
+            double t = (double)s / steps;
+            plot(level, (int)floor(x1 + (x2 - x1) * t), (int)floor(y1 + (y2 - y1) * t));
+        }
+    }
+}
+
+static void draw_builtin() {
+    int have = 0;
+    double lon = 0, lat = 0;
+    for (size_t p = 0; p < sizeof(OUTLINES) / sizeof(OUTLINES[0]); p++) {
+        if (OUTLINES[p][0] > 900) {
+            have = 0;
+            continue;
+        }
+        if (have) segment(lon, lat, OUTLINES[p][0], OUTLINES[p][1]);
+        lon = OUTLINES[p][0];
+        lat = OUTLINES[p][1];
+        have = 1;
+    }
+}
+
+static int draw_file(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    char line[256];
+    int have = 0;
+    double lon = 0, lat = 0, next_lon, next_lat;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%lf %lf", &next_lon, &next_lat) != 2) {
+            have = 0; // '>', '#' or a blank line ends the segment
+            continue;
+        }
+        if (next_lon > 180.0) next_lon -= 360.0;
+        if (have) segment(lon, lat, next_lon, next_lat);
+        lon = next_lon;
+        lat = next_lat;
+        have = 1;
+    }
+    fclose(file);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t total = 0;
+    for (int level = 0; level < MAP_ZOOM_LEVELS; level++) {
+        g_cells[level] = calloc((size_t)(MAP_BASE_COLS << level) * (MAP_BASE_ROWS << level), 1);
+        if (!g_cells[level]) return 1;
+    }
+    if (argc > 1 && argv[1][0]) {
+        if (draw_file(argv[1]) != 0) return 1;
+    } else {
+        draw_builtin();
+    }
+
+    printf("// Generated by tools/gen_coastline.c - do not edit.\n");
+    printf("static const unsigned int COASTLINE_OFFSETS[%d] = {", MAP_ZOOM_LEVELS);
+    for (int level = 0; level < MAP_ZOOM_LEVELS; level++) {
+        printf(" %zu,", total);
+        total += (size_t)(MAP_BASE_COLS << level) * (MAP_BASE_ROWS << level);
+    }
+    printf(" };\n");
+    printf("static const unsigned char COASTLINE_CELLS[%zu] = {", total);
+    size_t n = 0;
+    for (int level = 0; level < MAP_ZOOM_LEVELS; level++) {
+        size_t cells = (size_t)(MAP_BASE_COLS << level) * (MAP_BASE_ROWS << level);
+        for (size_t c = 0; c < cells; c++, n++) printf("%s%d,", (n % 24 == 0) ? "\n    " : "", g_cells[level][c]);
+    }
+    printf("\n};\n");
+    return 0;
+}
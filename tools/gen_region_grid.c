@@ -0,0 +1,44 @@
+/*
+ * gen_region_grid.c - Build-time generator for the region lookup raster
+ *
+ * Paints the boxes from region_table.h onto a global grid and writes it to
+ * stdout as a C header, so region.c can embed the finished raster and never
+ * has to rasterize anything at runtime.
+ *
+ * Usage: gen_region_grid > region_grid.h
+ */
+
+#include <stdio.h>
+#include "../region_table.h"
+
+#define ROWS (int)(180 / REGION_GRID_STEP)
+#define COLS (int)(360 / REGION_GRID_STEP)
+
+int main(void) {
+    static unsigned char grid[ROWS][COLS];
+
+    for (int r = 0; r < ROWS; r++) {
+        double lat = 90.0 - (r + 0.5) * REGION_GRID_STEP;
+        for (int c = 0; c < COLS; c++) {
+            double lon = -180.0 + (c + 0.5) * REGION_GRID_STEP;
+            for (size_t b = 0; b < REGION_BOX_COUNT; b++) {
+                const RegionBox *box = &REGION_BOXES[b];
+                if (lat >= box->lat_min && lat < box->lat_max && lon >= box->lon_min && lon < box->lon_max) {
+                    grid[r][c] = box->region;
+                }
+            }
+        }
+    }
+
+    printf("// Generated by tools/gen_region_grid.c - do not edit.\n");
+    printf("#define REGION_GRID_ROWS %d\n", ROWS);
+    printf("#define REGION_GRID_COLS %d\n", COLS);
+    printf("static const unsigned char REGION_GRID[REGION_GRID_ROWS * REGION_GRID_COLS] = {\n");
+    for (int r = 0; r < ROWS; r++) {
+        for (int c = 0; c < COLS; c++) {
+            printf("%s%d,", (c % 24 == 0) ? "\n    " : "", grid[r][c]);
+        }
+    }
+    printf("\n};\n");
+    return 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * gen_traveltime.c - Build-time generator for the P/S travel-time table
+ *
+ * Traces rays through the IASP91 velocity model and writes first-arrival
+ * P and S times against epicentral distance and source depth to stdout as a
+ * C header embedded by traveltime.c.
+ *
+ * The sphere is flattened with the earth-flattening transform and cut into
+ * thin layers with a linear velocity gradient, where ray distance and time
+ * have closed forms. For every ray parameter the up-going and down-going
+ * rays from each source depth are binned by distance, keeping the earliest
+ * time. The P column includes the core phase PKIKP and both columns extend
+ * past the core shadow as diffracted waves along the core-mantle boundary.
+ *
+ * For other phases or models, generate a file with TauP and load it with
+ * -T instead (see traveltime.c for the format).
+ *
+ * Usage: gen_traveltime > traveltime_table.h
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "../traveltime.h"
+
+#define EARTH_RADIUS 6371.0
+#define CMB_DEPTH 2889.0
+#define ICB_DEPTH 5153.9
+#define LAYER_STEP 10.0
+#define MAX_LAYERS 1024
+#define RAY_COUNT 40000
+#define DIST_BINS TT_BUILTIN_DIST_COUNT
+#define DEPTH_BINS TT_BUILTIN_DEPTH_COUNT
+
+// Depths where the model is discontinuous; layers always break here
+static const double BREAKS[] = { 20, 35, 120, 210, 410, 660, 760, 2740, CMB_DEPTH, ICB_DEPTH };
+#define BREAK_COUNT (int)(sizeof(BREAKS) / sizeof(BREAKS[0]))
+
+// IASP91 (Kennett & Engdahl 1991). side < 0 evaluates just above a
+// discontinuity, side > 0 just below it.
+static double iasp91(double depth, int wave, int side) {
+    double x = (EARTH_RADIUS - depth) / EARTH_RADIUS;
+    #define IN(top, bottom) ((side > 0) ? (depth >= (top) && depth < (bottom)) : (depth > (top) && depth <= (bottom)))
+    if (depth <= 0 || IN(0, 20)) return wave ? 3.36 : 5.80;
+    if (IN(20, 35)) return wave ? 3.75 : 6.50;
+    if (IN(35, 120)) return wave ? 6.706231 - 2.248585 * x : 8.78541 - 0.74953 * x;
+    if (IN(120, 210)) return wave ? 5.75020 - 1.27420 * x : 25.41389 - 17.69722 * x;
+    if (IN(210, 410)) return wave ? 15.24213 - 11.08552 * x : 30.78765 - 23.25415 * x;
+    if (IN(410, 660)) return wave ? 17.70732 - 13.50652 * x : 29.38896 - 21.40656 * x;
+    if (IN(660, 760)) return wave ? 20.76890 - 16.53147 * x : 25.96984 - 16.93412 * x;
+    if (IN(760, 2740)) return wave ? 12.9303 - 21.2590 * x + 27.8988 * x * x - 14.1080 * x * x * x
+                                   : 25.1486 - 41.1538 * x + 51.9932 * x * x - 26.6083 * x * x * x;
+    if (IN(2740, CMB_DEPTH)) return wave ? 8.16616 - 1.58206 * x : 14.49470 - 1.47089 * x;
+    if (IN(CMB_DEPTH, ICB_DEPTH)) return wave ? 0.0 : 10.03904 + 3.75665 * x - 13.67046 * x * x;
+    return wave ? 3.56454 - 3.45241 * x * x : 11.24094 - 4.09689 * x * x;
+    #undef IN
+}
+
+// Flattened layers: depth, thickness and velocity at top/bottom
+typedef struct {
+    double top_depth;
+    double thickness;
+    double v_top, v_bottom;
+} Layer;
+
+static int build_layers(Layer *layers, int wave) {
+    double bounds[MAX_LAYERS];
+    int n = 0, b = 0;
+    for (double d = 0; d < EARTH_RADIUS - LAYER_STEP; d += LAYER_STEP) {
+        while (b < BREAK_COUNT && BREAKS[b] < d) bounds[n++] = BREAKS[b++];
+        if (b < BREAK_COUNT && BREAKS[b] == d) b++;
+        bounds[n++] = d;
+    }
+    bounds[n++] = EARTH_RADIUS - 1.0; // Stop just short of the centre
+
+    int count = 0;
+    for (int i = 0; i + 1 < n; i++) {
+        double r1 = EARTH_RADIUS - bounds[i], r2 = EARTH_RADIUS - bounds[i + 1];
+        Layer *layer = &layers[count++];
+        layer->top_depth = bounds[i];
+        // Earth-flattening transform: z = -R ln(r/R), v = v_sphere * R / r
+        layer->thickness = EARTH_RADIUS * log(r1 / r2);
+        layer->v_top = iasp91(bounds[i], wave, 1) * EARTH_RADIUS / r1;
+        layer->v_bottom = iasp91(bounds[i + 1], wave, -1) * EARTH_RADIUS / r2;
+    }
+    return count;
+}
+
+// Distance (flat km) and time through one layer for slowness p (s/km).
+// Returns 1 if the ray turns inside the layer.
+static int cross_layer(const Layer *layer, double p, double *x, double *t) {
+    double v1 = layer->v_top, v2 = layer->v_bottom;
+    double q1 = 1.0 - p * p * v1 * v1;
+    double g = (v2 - v1) / layer->thickness;
+    if (p == 0.0) {
+        *x = 0.0;
+        *t = (fabs(g) < 1e-9) ? layer->thickness / v1 : log(v2 / v1) / g;
+        return 0;
+    }
+    if (fabs(g) < 1e-9) {
+        *x = layer->thickness * p * v1 / sqrt(q1);
+        *t = layer->thickness / (v1 * sqrt(q1));
+        return 0;
+    }
+    double q2 = 1.0 - p * p * v2 * v2;
+    if (q2 <= 0) {
+        *x = sqrt(q1) / (p * g);
+        *t = log((1.0 + sqrt(q1)) / (p * v1)) / g;
+        return 1;
+    }
+    *x = (sqrt(q1) - sqrt(q2)) / (p * g);
+    *t = log(v2 * (1.0 + sqrt(q1)) / (v1 * (1.0 + sqrt(q2)))) / g;
+    return 0;
+}
+
+static float g_table[2][DEPTH_BINS][DIST_BINS];
+
+// Records every whole degree crossed between two consecutive rays.
+static void bin_segment(float *row, double d0, double t0, double d1, double t1) {
+    if (d0 > d1) {
+        double swap = d0; d0 = d1; d1 = swap;
+        swap = t0; t0 = t1; t1 = swap;
+    }
+    if (d1 > 180.0) d1 = 180.0;
+    for (int k = (int)ceil(d0); k <= (int)floor(d1); k++) {
+        double f = (d1 > d0) ? (k - d0) / (d1 - d0) : 0.0;
+        double t = t0 + f * (t1 - t0);
+        if (t < row[k]) row[k] = (float)t;
+    }
+}
+
+static void trace_wave(int wave) {
+    static Layer layers[MAX_LAYERS];
+    static double cum_x[MAX_LAYERS + 1], cum_t[MAX_LAYERS + 1];
+    int layer_count = build_layers(layers, wave);
+    const double km_to_deg = 180.0 / (M_PI * EARTH_RADIUS);
+
+    int source_layer[DEPTH_BINS];
+    for (int d = 0; d < DEPTH_BINS; d++) {
+        source_layer[d] = 0;
+        while (source_layer[d] < layer_count && layers[source_layer[d]].top_depth < d * TT_BUILTIN_DEPTH_STEP) source_layer[d]++;
+        for (int k = 0; k < DIST_BINS; k++) g_table[wave][d][k] = INFINITY;
+    }
+
+    double prev[DEPTH_BINS][2][2];
+    int have_prev[DEPTH_BINS][2] = {{0}};
+    int joined[DEPTH_BINS] = {0};
+    double graze_dist[DEPTH_BINS], graze_time[DEPTH_BINS], graze_p = 0;
+    int grazed = 0;
+    double p_max = 1.0 / layers[0].v_top;
+
+    // Sweep from grazing to vertical rays, so core-bound rays come last
+    for (int i = RAY_COUNT - 1; i >= 0; i--) {
+        double p = p_max * i / RAY_COUNT;
+        int turn = layer_count, blocked = 0;
+        cum_x[0] = cum_t[0] = 0;
+        for (int l = 0; l < layer_count; l++) {
+            if (p * layers[l].v_top >= 1.0) { turn = l; break; } // Turns at the layer's top
+            if (wave == 1 && layers[l].v_top <= 0.0) { blocked = 1; break; } // S cannot enter the fluid core
+            double x, t;
+            int turned = cross_layer(&layers[l], p, &x, &t);
+            cum_x[l + 1] = cum_x[l] + x;
+            cum_t[l + 1] = cum_t[l] + t;
+            if (turned) { turn = l + 1; break; }
+        }
+
+        // The first ray that reaches the core marks where the last mantle
+        // ray grazed it; that ray starts the diffracted branch
+        if (!grazed && (blocked || layers[turn - 1].top_depth >= CMB_DEPTH)) {
+            grazed = 1;
+            graze_p = p_max * (i + 1) / RAY_COUNT;
+            for (int d = 0; d < DEPTH_BINS; d++) {
+                graze_dist[d] = prev[d][1][0];
+                graze_time[d] = prev[d][1][1];
+                have_prev[d][1] = 0; // Do not bridge the shadow zone
+            }
+        }
+
+        for (int d = 0; d < DEPTH_BINS; d++) {
+            int s = source_layer[d];
+            for (int branch = 0; branch < 2; branch++) {
+                double x, t;
+                if (branch == 0) {
+                    // Up-going ray straight from the source
+                    if (p * layers[s].v_top >= 1.0 || turn <= s) continue;
+                    x = cum_x[s];
+                    t = cum_t[s];
+                } else {
+                    // Down-going ray turning below the source
+                    if (blocked || turn <= s) continue;
+                    x = 2.0 * cum_x[turn] - cum_x[s];
+                    t = 2.0 * cum_t[turn] - cum_t[s];
+                }
+                double dist = x * km_to_deg;
+                if (have_prev[d][branch]) {
+                    bin_segment(g_table[wave][d], prev[d][branch][0], prev[d][branch][1], dist, t);
+                }
+                prev[d][branch][0] = dist;
+                prev[d][branch][1] = t;
+                have_prev[d][branch] = 1;
+            }
+            // Both branches start at the horizontal take-off ray; join them
+            if (!joined[d] && have_prev[d][0] && have_prev[d][1]) {
+                bin_segment(g_table[wave][d], prev[d][0][0], prev[d][0][1], prev[d][1][0], prev[d][1][1]);
+                joined[d] = 1;
+            }
+        }
+    }
+
+    for (int d = 0; d < DEPTH_BINS; d++) {
+        for (int k = 0; k < DIST_BINS; k++) {
+            if (grazed && k > graze_dist[d]) {
+                double diffracted = graze_time[d] + (k - graze_dist[d]) / km_to_deg * graze_p;
+                if (diffracted < g_table[wave][d][k]) g_table[wave][d][k] = (float)diffracted;
+            }
+        }
+    }
+}
+
+int main(void) {
+    trace_wave(0);
+    trace_wave(1);
+
+    printf("// Generated by tools/gen_traveltime.c - do not edit.\n");
+    printf("#define TT_BUILTIN_DIST_COUNT %d\n", DIST_BINS);
+    printf("#define TT_BUILTIN_DEPTH_COUNT %d\n", DEPTH_BINS);
+    for (int wave = 0; wave < 2; wave++) {
+        printf("static const float TT_BUILTIN_%s[TT_BUILTIN_DEPTH_COUNT * TT_BUILTIN_DIST_COUNT] = {", wave ? "S" : "P");
+        for (int d = 0; d < DEPTH_BINS; d++) {
+            for (int k = 0; k < DIST_BINS; k++) {
+                printf("%s%.1f,", (k % 12 == 0) ? "\n    " : "", g_table[wave][d][k]);
+            }
+        }
+        printf("\n};\n");
+    }
+    return 0;
+}
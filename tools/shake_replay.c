@@ -0,0 +1,134 @@
+/*
+ * shake_replay.c - Local stand-in for a Raspberry Shake
+ *
+ * Sends Shake UDP datagrams, {'EHZ', 1554306963.170, 16802, ...}, in real
+ * time to a host and port. With a capture file (datagrams as the Shake sent
+ * them, one after another) it replays the capture, paced by its own packet
+ * times and restamped to now. Without one it synthesizes four channels of
+ * background noise with a local event a minute in, then every two minutes.
+ *
+ * Usage: shake_replay [host] [port] [capture file]
+ *        monitor -U <port>
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#define DEFAULT_PORT "8888"
+#define SAMPLE_RATE 100
+#define PER_PACKET 25 // Samples per datagram, as a Shake sends them
+#define FIRST_EVENT_SECONDS 60
+#define EVENT_PERIOD_SECONDS 120
+#define PACKET_MAX 2048
+
+static uint64_t g_state = 88172645463325252ULL;
+
+static double uniform() {
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 7;
+    g_state ^= g_state << 17;
+    return (g_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleep_until(double t) {
+    double wait = t - now_seconds();
+    if (wait > 0) usleep((useconds_t)(wait * 1e6));
+}
+
+// Counts for one sample: noise, plus a P then S wave after each onset.
+static long synth_sample(int channel, double t) {
+    double value = 60.0 * (uniform() + uniform() + uniform() + uniform() - 2.0);
+    if (t >= FIRST_EVENT_SECONDS) {
+        double since = fmod(t - FIRST_EVENT_SECONDS, EVENT_PERIOD_SECONDS);
+        value += 400.0 * exp(-since / 3.0) * sin(2.0 * M_PI * 5.0 * since + channel);
+        if (since >= 4.0) value += 1500.0 * exp(-(since - 4.0) / 5.0) * sin(2.0 * M_PI * 3.0 * since + channel);
+    }
+    return (channel ? 0 : 16800) + lround(value);
+}
+
+static void synthesize(int fd) {
+    static const char *names[] = { "EHZ", "ENZ", "ENN", "ENE" };
+    char packet[PACKET_MAX];
+    double start = now_seconds();
+    for (long first = 0;; first += PER_PACKET) {
+        double t = first / (double)SAMPLE_RATE;
+        sleep_until(start + t + PER_PACKET / (double)SAMPLE_RATE);
+        for (int c = 0; c < 4; c++) {
+            int used = snprintf(packet, sizeof(packet), "{'%s', %.3f", names[c], start + t);
+            for (int i = 0; i < PER_PACKET; i++) {
+                used += snprintf(packet + used, sizeof(packet) - used, ", %ld", synth_sample(c, t + i / (double)SAMPLE_RATE));
+            }
+            used += snprintf(packet + used, sizeof(packet) - used, "}");
+            send(fd, packet, used, 0); // Datagrams: nobody listening is not an error
+        }
+    }
+}
+
+static void replay(int fd, FILE *capture) {
+    char packet[PACKET_MAX];
+    double shift = 0.0;
+    int ch, used = 0, sent = 0;
+    while ((ch = fgetc(capture)) != EOF) {
+        if (used == 0 && ch != '{') continue;
+        if (used < PACKET_MAX - 32) packet[used++] = (char)ch;
+        if (ch != '}') continue;
+        packet[used] = '\0';
+        used = 0;
+        char *comma = strchr(packet, ','), *end;
+        double t = comma ? strtod(comma + 1, &end) : 0.0;
+        if (!comma || end == comma + 1) continue;
+        if (!sent) shift = now_seconds() - t;
+        sleep_until(t + shift);
+        char restamped[PACKET_MAX];
+        int length = snprintf(restamped, sizeof(restamped), "%.*s %.3f%s", (int)(comma + 1 - packet), packet, t + shift, end);
+        send(fd, restamped, length, 0);
+        sent++;
+    }
+    printf("Replayed %d packets\n", sent);
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = argc > 1 ? argv[1] : "localhost";
+    const char *port = argc > 2 ? argv[2] : DEFAULT_PORT;
+    struct addrinfo hints = { 0 }, *address;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, port, &hints, &address) != 0) {
+        printf("Cannot resolve %s:%s\n", host, port);
+        return 1;
+    }
+    int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0 || connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+        perror("shake_replay");
+        return 1;
+    }
+    freeaddrinfo(address);
+
+    if (argc > 3) {
+        FILE *capture = fopen(argv[3], "r");
+        if (!capture) {
+            perror(argv[3]);
+            return 1;
+        }
+        printf("Replaying %s to %s:%s\n", argv[3], host, port);
+        replay(fd, capture);
+        fclose(capture);
+        return 0;
+    }
+    printf("Sending 4 synthetic channels to %s:%s, first event in %d s\n", host, port, FIRST_EVENT_SECONDS);
+    synthesize(fd);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * strike_feed.c - Local stand-in for a live lightning strike network
+ *
+ * Listens on a TCP port and streams newline-delimited JSON strikes, in the
+ * format strikes.c reads, to each client that connects. Most strikes come
+ * from a storm cell that starts 60 km west of the given point and drifts
+ * east over it at 40 km/h; the rest are scattered over the surrounding
+ * ten degrees.
+ *
+ * Usage: strike_feed [port] [strikes per second] [lat lon]
+ *        monitor -l <lat> <lon> -L localhost:<port>
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define DEFAULT_PORT 7070
+#define DEFAULT_RATE 10000
+#define STORM_FRACTION 0.7
+#define STORM_START_KM -60.0
+#define STORM_SPEED_KMH 40.0
+#define STORM_SPREAD_KM 8.0
+#define KM_PER_DEG 111.195
+#define TICK_MS 10
+
+static uint64_t g_state = 88172645463325252ULL;
+
+static double uniform() {
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 7;
+    g_state ^= g_state << 17;
+    return (g_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian() {
+    return sqrt(-2.0 * log(uniform() + 1e-300)) * cos(2.0 * M_PI * uniform());
+}
+
+static long long now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static int stream(int client, int rate, double lat, double lon) {
+    static char buffer[1 << 20];
+    long long start = now_ms();
+    double km_per_lon = KM_PER_DEG * cos(lat * M_PI / 180.0);
+    double owed = 0.0;
+    for (;;) {
+        long long t = now_ms();
+        double hours = (t - start) / 3600000.0;
+        double storm_east_km = STORM_START_KM + STORM_SPEED_KMH * hours;
+        owed += rate * TICK_MS / 1000.0;
+        size_t used = 0;
+        for (; owed >= 1.0 && used < sizeof(buffer) - 128; owed -= 1.0) {
+            double strike_lat, strike_lon;
+            if (uniform() < STORM_FRACTION) {
+                strike_lat = lat + STORM_SPREAD_KM * gaussian() / KM_PER_DEG;
+                strike_lon = lon + (storm_east_km + STORM_SPREAD_KM * gaussian()) / km_per_lon;
+            } else {
+                strike_lat = lat + (uniform() - 0.5) * 10.0;
+                strike_lon = lon + (uniform() - 0.5) * 10.0;
+            }
+            used += snprintf(buffer + used, sizeof(buffer) - used, "{\"time\":%lld,\"lat\":%.4f,\"lon\":%.4f}\n",
+                             t * 1000000LL, strike_lat, strike_lon);
+        }
+        for (size_t sent = 0; sent < used;) {
+            ssize_t n = send(client, buffer + sent, used - sent, 0);
+            if (n <= 0) return -1;
+            sent += n;
+        }
+        usleep(TICK_MS * 1000);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int port = argc > 1 ? atoi(argv[1]) : DEFAULT_PORT;
+    int rate = argc > 2 ? atoi(argv[2]) : DEFAULT_RATE;
+    double lat = argc > 4 ? atof(argv[3]) : 54.53;
+    double lon = argc > 4 ? atof(argv[4]) : -1.05;
+    signal(SIGPIPE, SIG_IGN);
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (server < 0 || bind(server, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(server, 4) != 0) {
+        perror("strike_feed");
+        return 1;
+    }
+    printf("Streaming %d strikes/s around %.2f, %.2f on port %d\n", rate, lat, lon, port);
+    for (;;) {
+        int client = accept(server, NULL, NULL);
+        if (client < 0) continue;
+        printf("Client connected\n");
+        stream(client, rate, lat, lon);
+        close(client);
+        printf("Client disconnected\n");
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * traveltime.c - P/S travel times for wave-arrival countdowns
+ *
+ * Table file format (for traveltime_load_table), little-endian:
+ *   char     magic[4]      "TTBL"
+ *   uint16_t version       1
+ *   uint16_t dist_count
+ *   uint16_t depth_count
+ *   uint16_t reserved
+ *   float    dist_step     degrees, first column at 0
+ *   float    depth_step    kilometres, first row at the surface
+ *   float    p[depth_count][dist_count]   seconds
+ *   float    s[depth_count][dist_count]
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "traveltime.h"
+#include "traveltime_table.h"
+
+#define TABLE_HEADER_SIZE 20
+
+typedef struct {
+    int dist_count;
+    int depth_count;
+    float dist_step;
+    float depth_step;
+    const float *p;
+    const float *s;
+} TravelTimeTable;
+
+// --- Globals ---
+static TravelTimeTable g_table = {
+    TT_BUILTIN_DIST_COUNT, TT_BUILTIN_DEPTH_COUNT,
+    TT_BUILTIN_DIST_STEP, TT_BUILTIN_DEPTH_STEP,
+    TT_BUILTIN_P, TT_BUILTIN_S,
+};
+
+// --- Table Loading ---
+
+int traveltime_load_table(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open travel-time table %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < TABLE_HEADER_SIZE) {
+        fprintf(stderr, "Travel-time table %s is too small\n", path);
+        close(fd);
+        return -1;
+    }
+    const unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Could not map travel-time table %s\n", path);
+        return -1;
+    }
+
+    uint16_t dist_count, depth_count;
+    float dist_step, depth_step;
+    memcpy(&dist_count, map + 6, sizeof(dist_count));
+    memcpy(&depth_count, map + 8, sizeof(depth_count));
+    memcpy(&dist_step, map + 12, sizeof(dist_step));
+    memcpy(&depth_step, map + 16, sizeof(depth_step));
+    off_t cells = (off_t)dist_count * depth_count;
+    if (memcmp(map, "TTBL", 4) != 0 || dist_count < 2 || depth_count < 1 || !(dist_step > 0) || !(depth_step > 0) ||
+        TABLE_HEADER_SIZE + cells * 2 * (off_t)sizeof(float) > st.st_size) {
+        fprintf(stderr, "Travel-time table %s has an invalid header\n", path);
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+
+    g_table.dist_count = dist_count;
+    g_table.depth_count = depth_count;
+    g_table.dist_step = dist_step;
+    g_table.depth_step = depth_step;
+    g_table.p = (const float *)(map + TABLE_HEADER_SIZE);
+    g_table.s = g_table.p + cells;
+    return 0;
+}
+
+// --- Lookup ---
+
+static double interpolate(const float *grid, int row, int col, double fr, double fc) {
+    const float *r0 = grid + (size_t)row * g_table.dist_count + col;
+    const float *r1 = (row + 1 < g_table.depth_count) ? r0 + g_table.dist_count : r0;
+    double top = r0[0] + fc * (r0[1] - r0[0]);
+    double bottom = r1[0] + fc * (r1[1] - r1[0]);
+    return top + fr * (bottom - top);
+}
+
+void traveltime_lookup(double dist_deg, double depth_km, double *p_seconds, double *s_seconds) {
+    double x = dist_deg / g_table.dist_step;
+    double y = depth_km / g_table.depth_step;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x > g_table.dist_count - 1) x = g_table.dist_count - 1;
+    if (y > g_table.depth_count - 1) y = g_table.depth_count - 1;
+
+    int col = (int)x;
+    int row = (int)y;
+    if (col > g_table.dist_count - 2) col = g_table.dist_count - 2;
+    double fc = x - col;
+    double fr = y - row;
+    if (p_seconds) *p_seconds = interpolate(g_table.p, row, col, fr, fc);
+    if (s_seconds) *s_seconds = interpolate(g_table.s, row, col, fr, fc);
+}
+
+double epicentral_distance_deg(double lat1, double lon1, double lat2, double lon2) {
+    const double rad = M_PI / 180.0;
+    double dlat = (lat2 - lat1) * rad;
+    double dlon = (lon2 - lon1) * rad;
+    double a = sin(dlat / 2) * sin(dlat / 2) + cos(lat1 * rad) * cos(lat2 * rad) * sin(dlon / 2) * sin(dlon / 2);
+    return 2.0 * asin(sqrt(a < 1.0 ? a : 1.0)) / rad;
+}
@@ -0,0 +1,22 @@
+/*
+ * traveltime.h - P/S travel times for wave-arrival countdowns
+ *
+ * Travel times come from a distance x depth table, either the approximate
+ * IASP91 table compiled into the binary or a TauP-generated one memory-mapped
+ * with traveltime_load_table(). Lookups are a bilinear interpolation.
+ */
+
+#ifndef TRAVELTIME_H
+#define TRAVELTIME_H
+
+// Layout of the table embedded at build time
+#define TT_BUILTIN_DIST_STEP 1.0   // Degrees
+#define TT_BUILTIN_DIST_COUNT 181  // 0 to 180 degrees
+#define TT_BUILTIN_DEPTH_STEP 10.0 // Kilometres
+#define TT_BUILTIN_DEPTH_COUNT 71  // 0 to 700 km
+
+int traveltime_load_table(const char *path);
+void traveltime_lookup(double dist_deg, double depth_km, double *p_seconds, double *s_seconds);
+double epicentral_distance_deg(double lat1, double lon1, double lat2, double lon2);
+
+#endif // TRAVELTIME_H
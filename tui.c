@@ -0,0 +1,482 @@
+/*
+ * tui.c - Interactive catalog browser
+ */
+
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "tui.h"
+#include "timing.h"
+#include "catalog.h"
+#include "indexes.h"
+#include "places.h"
+#include "region.h"
+#include "sites.h"
+#include "map.h"
+
+#define HEADER_ROWS 3 // Title, view, column headings
+#define FOOTER_ROWS 2 // Status, keys
+#define LINE_MAX 512
+#define MAGNITUDE_STEP 0.5f
+#define PAN_COLS 8 // Map cells moved per key
+#define PAN_ROWS 4
+
+#define COLOR_RED    "\x1b[31m"
+#define COLOR_YELLOW "\x1b[33m"
+#define COLOR_GREEN  "\x1b[32m"
+#define COLOR_CYAN   "\x1b[36m"
+#define COLOR_RESET  "\x1b[0m"
+
+typedef struct {
+    IndexKind sort;
+    int descending;
+    float min_mag;    // 0 for none
+    int limit;        // Index into g_distance_limits; 0 for none
+    int region;       // -1 for any
+    int anchored;     // 0 while the view starts at the top of the order
+    int64_t anchor_key; // Top row, as its entry in the sort index
+    uint64_t anchor_seq;
+} TuiView;
+
+// --- Globals ---
+static const double g_distance_limits[] = { 0.0, 100.0, 300.0, 1000.0, 3000.0 };
+static const char *g_sort_names[INDEX_COUNT] = { "time", "magnitude", "distance", "region" };
+static TuiView g_view = { INDEX_TIME, 1, 0.0f, 0, -1, 0, 0, 0 };
+static struct termios g_saved_termios;
+static int g_active = 0;
+static volatile sig_atomic_t g_resized = 0;
+static int g_scan_exhausted = 0; // The last walk hit TUI_SCAN_LIMIT
+static int g_map_mode = 0;
+static int g_clear = 1; // The next frame starts from a blank screen
+static char g_frame[TUI_FRAME_MAX];
+
+// --- Walking the View ---
+
+// Filters on the sort column, as bounds on the sort index.
+static void sort_bounds(double *low, double *high) {
+    *low = -INFINITY;
+    *high = INFINITY;
+    if (g_view.sort == INDEX_MAGNITUDE && g_view.min_mag > 0.0f) *low = g_view.min_mag;
+    if (g_view.sort == INDEX_DISTANCE && g_view.limit > 0) *high = g_distance_limits[g_view.limit];
+    if (g_view.sort == INDEX_REGION && g_view.region >= 0) *low = *high = g_view.region;
+}
+
+// Filters on the other columns, checked per row.
+static int row_matches(const CatalogEvent *event) {
+    if (g_view.min_mag > 0.0f && g_view.sort != INDEX_MAGNITUDE && event->mag < g_view.min_mag) return 0;
+    if (g_view.region >= 0 && g_view.sort != INDEX_REGION && event->region != g_view.region) return 0;
+    if (g_view.limit > 0 && g_view.sort != INDEX_DISTANCE &&
+        index_nearest_site_km(event->lat, event->lon) > g_distance_limits[g_view.limit]) return 0;
+    return 1;
+}
+
+// Opens a cursor at the anchor, or at the top of the order, walking down
+// the view or back up it.
+static void open_cursor(IndexCursor *cursor, int upwards) {
+    double low, high;
+    sort_bounds(&low, &high);
+    int descending = g_view.descending ^ upwards;
+    if (g_view.anchored) index_seek_from(cursor, g_view.sort, g_view.anchor_key, g_view.anchor_seq, low, high, descending);
+    else index_seek(cursor, g_view.sort, low, high, descending);
+}
+
+// Next row passing the filters; 0 at the end or once the budget is spent.
+static int next_match(IndexCursor *cursor, int *budget, uint64_t *seq, CatalogEvent *event) {
+    while (*budget > 0 && index_next(cursor, seq)) {
+        (*budget)--;
+        catalog_get(*seq, event);
+        if (row_matches(event)) return 1;
+    }
+    if (*budget <= 0) g_scan_exhausted = 1;
+    return 0;
+}
+
+static void set_anchor(const IndexCursor *cursor, uint64_t seq) {
+    g_view.anchor_key = cursor->key;
+    g_view.anchor_seq = seq;
+    g_view.anchored = 1;
+}
+
+// Moves the anchor by rows matching rows, down if positive. Stops at the
+// last row going down and at the top going up.
+static void scroll(int rows) {
+    IndexCursor cursor;
+    CatalogEvent event;
+    uint64_t seq;
+    int budget = TUI_SCAN_LIMIT, moved = 0, wanted = rows < 0 ? -rows : rows;
+    if (rows == 0 || (rows < 0 && !g_view.anchored)) return;
+    int at_top = !g_view.anchored; // The first row walked is then the current top
+    open_cursor(&cursor, rows < 0);
+    while (moved < wanted && next_match(&cursor, &budget, &seq, &event)) {
+        if (at_top) {
+            at_top = 0;
+            set_anchor(&cursor, seq);
+            continue;
+        }
+        if (cursor.key == g_view.anchor_key && seq == g_view.anchor_seq) continue; // The anchor, if still there
+        set_anchor(&cursor, seq);
+        moved++;
+    }
+}
+
+// Anchors the view so the last page of rows fills the screen.
+static void scroll_to_end(int page) {
+    IndexCursor cursor;
+    CatalogEvent event;
+    uint64_t seq;
+    int budget = TUI_SCAN_LIMIT;
+    g_view.anchored = 0;
+    open_cursor(&cursor, 1);
+    for (int n = 0; n < page && next_match(&cursor, &budget, &seq, &event); n++) set_anchor(&cursor, seq);
+}
+
+// --- Drawing ---
+
+static void screen_size(int *rows, int *cols) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col < LINE_MAX - 1 ? ws.ws_col : LINE_MAX - 1;
+    } else {
+        *rows = 24;
+        *cols = 80;
+    }
+}
+
+// Appends one screen line, cut to the width without splitting a UTF-8
+// character, and clears the rest of it.
+static int append_line(int used, int cols, const char *color, const char *text) {
+    int length = (int)strlen(text);
+    if (length > cols) {
+        length = cols;
+        while (length > 0 && ((unsigned char)text[length] & 0xC0) == 0x80) length--;
+    }
+    if (used + length + 32 >= TUI_FRAME_MAX) return used;
+    used += snprintf(g_frame + used, TUI_FRAME_MAX - used, "%s%.*s%s\x1b[K\n", color ? color : "", length, text,
+                     color ? COLOR_RESET : "");
+    return used;
+}
+
+static void describe_view(char *buffer, size_t size) {
+    int used = snprintf(buffer, size, "Sort: %s %s", g_sort_names[g_view.sort], g_view.descending ? "(descending)" : "(ascending)");
+    if (g_view.min_mag > 0.0f) used += snprintf(buffer + used, size - used, " | M%.1f+", g_view.min_mag);
+    if (g_view.limit > 0) used += snprintf(buffer + used, size - used, " | within %.0f km", g_distance_limits[g_view.limit]);
+    if (g_view.region >= 0) snprintf(buffer + used, size - used, " | %s", region_name(g_view.region));
+}
+
+// Lays out a whole frame in g_frame and returns its length. Reads only the
+// rows that fit in the table.
+static int build_frame(int rows, int cols, const char *status) {
+    char line[LINE_MAX], view[LINE_MAX];
+    int table_rows = rows - HEADER_ROWS - FOOTER_ROWS;
+    int used = snprintf(g_frame, TUI_FRAME_MAX, "\x1b[H");
+    snprintf(line, sizeof(line), "--- GLOBAL SEISMIC MONITOR --- %llu events in history", (unsigned long long)catalog_size());
+    used = append_line(used, cols, COLOR_CYAN, line);
+    describe_view(view, sizeof(view));
+    used = append_line(used, cols, NULL, view);
+    snprintf(line, sizeof(line), "%-6s %-19s %8s %6s  %s", "Mag", "Time (UTC)", "Distance", "Depth", "Place");
+    used = append_line(used, cols, NULL, line);
+
+    IndexCursor cursor;
+    CatalogEvent event;
+    uint64_t seq;
+    int budget = TUI_SCAN_LIMIT, shown = 0;
+    g_scan_exhausted = 0;
+    open_cursor(&cursor, 0);
+    while (shown < table_rows && next_match(&cursor, &budget, &seq, &event)) {
+        char when[24];
+        time_t seconds = (time_t)(event.time_ms / 1000);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", gmtime(&seconds));
+        const char *place = places_get(seq);
+        snprintf(line, sizeof(line), "M %-4.1f %-19s %5.0f km %3.0f km  %s", event.mag, when,
+                 index_nearest_site_km(event.lat, event.lon), event.depth, place[0] ? place : region_name(event.region));
+        const char *color = event.mag >= 6.0f ? COLOR_RED : event.mag >= 4.0f ? COLOR_YELLOW : COLOR_GREEN;
+        used = append_line(used, cols, color, line);
+        shown++;
+    }
+    if (shown == 0) used = append_line(used, cols, NULL, g_scan_exhausted ? "(no match in the next rows; sort by the filtered column)" : "(no events)");
+    used += snprintf(g_frame + used, TUI_FRAME_MAX - used, "\x1b[J\x1b[%d;1H", rows - FOOTER_ROWS + 1);
+    if (g_scan_exhausted && shown > 0 && shown < table_rows) {
+        snprintf(line, sizeof(line), "%s (stopped after %d rows; sort by the filtered column to see all)", status, TUI_SCAN_LIMIT);
+        used = append_line(used, cols, NULL, line);
+    } else {
+        used = append_line(used, cols, NULL, status);
+    }
+    used = append_line(used, cols, COLOR_CYAN, "j/k scroll  space/b page  g/G top/end  s sort  r reverse  m/M magnitude  d distance  R region  c clear  w map  q quit");
+    if (used > 0 && g_frame[used - 1] == '\n') used--; // A newline on the bottom row would scroll the screen
+    return used;
+}
+
+// Lays out the map view: the map writes only the cells that changed, the
+// header and footer lines are redrawn whole.
+static int build_map_frame(int rows, int cols, const char *status) {
+    char line[LINE_MAX];
+    int used = 0;
+    if (g_clear) {
+        used += snprintf(g_frame, TUI_FRAME_MAX, "\x1b[2J");
+        map_invalidate();
+    }
+    used += snprintf(g_frame + used, TUI_FRAME_MAX - used, "\x1b[H");
+    snprintf(line, sizeof(line), "--- GLOBAL SEISMIC MONITOR --- zoom %d | o M<4  O M4-6  @ M6+  * last %d min  + site",
+             map_zoom_level() + 1, MAP_BLINK_MINUTES);
+    used = append_line(used, cols, COLOR_CYAN, line);
+    used += map_draw(g_frame + used, TUI_FRAME_MAX - used - 2 * LINE_MAX, 1, rows - 1 - FOOTER_ROWS, cols,
+                     (long long)time(NULL) * 1000);
+    used += snprintf(g_frame + used, TUI_FRAME_MAX - used, "\x1b[%d;1H", rows - FOOTER_ROWS + 1);
+    used = append_line(used, cols, NULL, status);
+    used = append_line(used, cols, COLOR_CYAN, "arrows/h/j/k/l pan  +/- zoom  c centre on home  w table  q quit");
+    if (used > 0 && g_frame[used - 1] == '\n') used--;
+    return used;
+}
+
+void tui_render(const char *status) {
+    int rows, cols;
+    screen_size(&rows, &cols);
+    int length = g_map_mode ? build_map_frame(rows, cols, status) : build_frame(rows, cols, status);
+    g_clear = 0;
+    fflush(stdout); // Anything printed since the last frame goes first
+    for (int written = 0; written < length;) {
+        ssize_t n = write(STDOUT_FILENO, g_frame + written, length - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
+    }
+}
+
+// --- Keys ---
+
+// Applies one key press in the map view; returns 1 when it changed.
+static int handle_map_key(const char *keys, int length, int *consumed) {
+    *consumed = 1;
+    if (keys[0] == '\x1b' && length >= 3 && keys[1] == '[') {
+        *consumed = 3;
+        switch (keys[2]) {
+        case 'A': map_pan(0, -PAN_ROWS); return 1;
+        case 'B': map_pan(0, PAN_ROWS); return 1;
+        case 'C': map_pan(PAN_COLS, 0); return 1;
+        case 'D': map_pan(-PAN_COLS, 0); return 1;
+        }
+        return 0;
+    }
+    switch (keys[0]) {
+    case 'h': map_pan(-PAN_COLS, 0); return 1;
+    case 'l': map_pan(PAN_COLS, 0); return 1;
+    case 'k': map_pan(0, -PAN_ROWS); return 1;
+    case 'j': map_pan(0, PAN_ROWS); return 1;
+    case '+': case '=': map_zoom(1); return 1;
+    case '-': map_zoom(-1); return 1;
+    case 'c': if (g_site_count > 0) map_center(g_sites[0].lat, g_sites[0].lon); return 1;
+    case 'w': g_map_mode = 0; return 1;
+    }
+    return 0;
+}
+
+// Applies one key press; returns 1 when the view changed.
+static int handle_key(const char *keys, int length, int *consumed) {
+    int rows, cols;
+    screen_size(&rows, &cols);
+    int page = rows - HEADER_ROWS - FOOTER_ROWS;
+    if (page < 1) page = 1;
+    if (g_map_mode) return handle_map_key(keys, length, consumed);
+    *consumed = 1;
+    if (keys[0] == '\x1b' && length >= 3 && keys[1] == '[') {
+        *consumed = 3;
+        switch (keys[2]) {
+        case 'A': scroll(-1); return 1;
+        case 'B': scroll(1); return 1;
+        case 'H': g_view.anchored = 0; return 1;
+        case 'F': scroll_to_end(page); return 1;
+        case '5': *consumed = length >= 4 ? 4 : 3; scroll(-page); return 1;
+        case '6': *consumed = length >= 4 ? 4 : 3; scroll(page); return 1;
+        }
+        return 0;
+    }
+    switch (keys[0]) {
+    case 'j': scroll(1); return 1;
+    case 'k': scroll(-1); return 1;
+    case ' ': scroll(page); return 1;
+    case 'b': scroll(-page); return 1;
+    case 'g': g_view.anchored = 0; return 1;
+    case 'G': scroll_to_end(page); return 1;
+    case 's':
+        g_view.sort = (IndexKind)((g_view.sort + 1) % INDEX_COUNT);
+        g_view.descending = g_view.sort == INDEX_TIME || g_view.sort == INDEX_MAGNITUDE;
+        g_view.anchored = 0;
+        return 1;
+    case 'r': g_view.descending = !g_view.descending; g_view.anchored = 0; return 1;
+    case 'm': g_view.min_mag += MAGNITUDE_STEP; g_view.anchored = 0; return 1;
+    case 'M':
+        g_view.min_mag = g_view.min_mag > MAGNITUDE_STEP ? g_view.min_mag - MAGNITUDE_STEP : 0.0f;
+        g_view.anchored = 0;
+        return 1;
+    case 'd':
+        g_view.limit = (g_view.limit + 1) % (int)(sizeof(g_distance_limits) / sizeof(g_distance_limits[0]));
+        g_view.anchored = 0;
+        return 1;
+    case 'R': {
+        if (g_view.region >= 0) {
+            g_view.region = -1;
+        } else {
+            IndexCursor cursor;
+            CatalogEvent event;
+            uint64_t seq;
+            int budget = TUI_SCAN_LIMIT;
+            open_cursor(&cursor, 0);
+            if (next_match(&cursor, &budget, &seq, &event)) g_view.region = event.region;
+        }
+        g_view.anchored = 0;
+        return 1;
+    }
+    case 'w':
+        g_map_mode = 1;
+        g_clear = 1;
+        return 1;
+    case 'c':
+        g_view.min_mag = 0.0f;
+        g_view.limit = 0;
+        g_view.region = -1;
+        g_view.anchored = 0;
+        return 1;
+    }
+    return 0;
+}
+
+// Waits up to timeout_ms for keys and applies them. The map redraws on
+// every timeout, to blink the newest events.
+TuiAction tui_wait(int timeout_ms) {
+    struct pollfd fds = { .fd = STDIN_FILENO, .events = POLLIN };
+    int ready = poll(&fds, 1, timeout_ms);
+    if (g_resized) {
+        g_resized = 0;
+        g_clear = 1;
+        return TUI_REDRAW;
+    }
+    if (ready <= 0) return g_map_mode ? TUI_REDRAW : TUI_IDLE;
+    char keys[64];
+    ssize_t length = read(STDIN_FILENO, keys, sizeof(keys));
+    if (length <= 0) return TUI_IDLE;
+    int changed = 0;
+    for (int pos = 0, consumed; pos < length; pos += consumed) {
+        if (keys[pos] == 'q' || keys[pos] == '\x03') return TUI_QUIT;
+        changed |= handle_key(keys + pos, (int)length - pos, &consumed);
+    }
+    return changed ? TUI_REDRAW : TUI_IDLE;
+}
+
+// --- Terminal ---
+
+static void on_resize(int signal_number) {
+    g_resized = 1;
+}
+
+static void on_terminate(int signal_number) {
+    tui_stop();
+    _exit(128 + signal_number);
+}
+
+// Switches to the alternate screen with unbuffered, unechoed keys.
+int tui_start() {
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO) || tcgetattr(STDIN_FILENO, &g_saved_termios) != 0) {
+        fprintf(stderr, "Interactive view needs a terminal\n");
+        return -1;
+    }
+    struct termios raw = g_saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0) return -1;
+    g_active = 1;
+    atexit(tui_stop);
+    signal(SIGWINCH, on_resize);
+    signal(SIGINT, on_terminate);
+    signal(SIGTERM, on_terminate);
+    static const char enter[] = "\x1b[?1049h\x1b[?25l";
+    if (write(STDOUT_FILENO, enter, sizeof(enter) - 1) < 0) return -1;
+    return 0;
+}
+
+// Restores the terminal. Safe to call more than once, and from a signal.
+void tui_stop() {
+    if (!g_active) return;
+    g_active = 0;
+    static const char leave[] = "\x1b[?25h\x1b[?1049l";
+    if (write(STDOUT_FILENO, leave, sizeof(leave) - 1) < 0) return;
+    tcsetattr(STDIN_FILENO, TCSANOW, &g_saved_termios);
+}
+
+// --- Benchmark ---
+
+static void bench_fill(int count, uint64_t *state, long long now_ms) {
+    while (catalog_size() < (uint64_t)count) {
+        *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+        CatalogEvent event = { .time_ms = now_ms - (long long)(*state >> 24) % (CATALOG_RETENTION_DAYS * 86400000LL) };
+        event.lat = (float)((*state >> 20 & 0xFFFF) / 65535.0 * 180.0 - 90.0);
+        event.lon = (float)((*state >> 4 & 0xFFFF) / 65535.0 * 360.0 - 180.0);
+        event.depth = (float)(*state >> 50 & 0x3F);
+        event.mag = (float)(-log10((double)((*state >> 36 & 0xFFFFF) + 1) / 1048577.0) + 1.0);
+        event.region = (int)(*state >> 8 & 0x3FF);
+        snprintf(event.id, sizeof(event.id), "bench%llu", (unsigned long long)catalog_size());
+        uint64_t seq;
+        char place[48];
+        snprintf(place, sizeof(place), "%d km N of Bench Town %d", (int)(*state >> 40 & 0xFF), (int)(*state >> 32 & 0x3F));
+        if (catalog_upsert(&event, &seq, NULL) == CATALOG_INSERTED) {
+            index_on_insert(seq);
+            places_on_insert(seq, place);
+        }
+    }
+}
+
+// Average microseconds to lay out a 50 x 120 frame in each view, after
+// the given number of page scrolls.
+static void time_views(double *out, int pages) {
+    static const TuiView views[] = {
+        { INDEX_TIME, 1, 0.0f, 0, -1, 0, 0, 0 },
+        { INDEX_MAGNITUDE, 1, 0.0f, 0, -1, 0, 0, 0 },
+        { INDEX_DISTANCE, 0, 0.0f, 0, -1, 0, 0, 0 },
+        { INDEX_MAGNITUDE, 1, 5.0f, 0, -1, 0, 0, 0 },
+        { INDEX_TIME, 1, 4.0f, 0, -1, 0, 0, 0 },
+    };
+    const int repeats = 200;
+    for (size_t v = 0; v < sizeof(views) / sizeof(views[0]); v++) {
+        g_view = views[v];
+        for (int p = 0; p < pages; p++) scroll(50 - HEADER_ROWS - FOOTER_ROWS);
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int r = 0; r < repeats; r++) build_frame(50, 120, "bench");
+        out[v] = elapsed_us(&start) / repeats;
+    }
+}
+
+// Times frame layout in several views over a small and a large history;
+// frames read only the visible rows, so the two should cost about the same.
+int tui_benchmark(int events) {
+    static const char *names[] = { "newest first", "largest first", "nearest first", "M5+ by magnitude", "M4+ newest (filtered scan)" };
+    const int small = 200;
+    double small_us[5], large_us[5], deep_us[5];
+    uint64_t state = 12345;
+    long long now_ms = (long long)time(NULL) * 1000;
+    if (events < small) events = small;
+    if (catalog_init(events) != 0) return 1;
+    if (g_site_count == 0) sites_add("Home", 54.53, -1.05, 5.0);
+
+    bench_fill(small, &state, now_ms);
+    time_views(small_us, 0);
+    bench_fill(events, &state, now_ms);
+    time_views(large_us, 0);
+    time_views(deep_us, 1000);
+
+    printf("Interactive view benchmark: 50 x 120 frame, %d vs %d events\n\n", small, events);
+    printf("%-28s %10s %10s %14s\n", "View", "small", "large", "large, deep");
+    for (int v = 0; v < 5; v++) printf("%-28s %7.1f us %7.1f us %11.1f us\n", names[v], small_us[v], large_us[v], deep_us[v]);
+    printf("\n(deep: after scrolling down 1000 pages)\n");
+    return 0;
+}
@@ -0,0 +1,36 @@
+/*
+ * tui.h - Interactive catalog browser
+ *
+ * Puts the terminal in raw mode and shows the event history as a table
+ * that fills the screen. Only the visible rows are read: the view keeps
+ * its scroll position as an anchor entry in one of the ordered indexes and
+ * walks on from it, so a frame costs the same for 200 events or 200,000.
+ * Filters on the sort column become index bounds; others are checked row
+ * by row, at most TUI_SCAN_LIMIT rows per frame.
+ *
+ * Keys: j/k or arrows scroll, space/b or PgDn/PgUp page, g/G top and end,
+ * s cycles the sort column, r reverses it, m/M raise and lower the minimum
+ * magnitude, d cycles a distance limit, R keeps only the top row's region,
+ * c clears the filters, w switches to the map (map.h) and back, q quits.
+ * On the map, arrows or h/j/k/l pan, + and - zoom and c centres on home.
+ */
+
+#ifndef TUI_H
+#define TUI_H
+
+#define TUI_SCAN_LIMIT 4096 // Rows checked against filters per frame
+#define TUI_FRAME_MAX (1 << 18)
+
+typedef enum {
+    TUI_IDLE,
+    TUI_REDRAW,
+    TUI_QUIT,
+} TuiAction;
+
+int tui_start();
+void tui_stop();
+TuiAction tui_wait(int timeout_ms);
+void tui_render(const char *status);
+int tui_benchmark(int events);
+
+#endif // TUI_H